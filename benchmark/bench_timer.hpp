@@ -0,0 +1,32 @@
+#ifndef BENCH_TIMER_HPP
+#define BENCH_TIMER_HPP
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+// wall clock time since construction or the last restart()
+class bench_timer
+{
+public:
+    bench_timer()
+        : start_(now()) {}
+
+    void restart()
+    {
+        start_ = now();
+    }
+
+    double milliseconds() const
+    {
+        return (now() - start_).total_microseconds() / 1000.0;
+    }
+
+private:
+    static boost::posix_time::ptime now()
+    {
+        return boost::posix_time::microsec_clock::universal_time();
+    }
+
+    boost::posix_time::ptime start_;
+};
+
+#endif // BENCH_TIMER_HPP
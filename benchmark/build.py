@@ -0,0 +1,16 @@
+import os
+import glob
+from copy import copy
+
+Import ('env')
+
+benchmark_env = env.Clone()
+
+headers = env['CPPPATH'] 
+
+libraries =  copy(env['LIBMAPNIK_LIBS'])
+libraries.append('mapnik2')
+
+for cpp_benchmark in glob.glob('*.cpp'):
+    benchmark_program = benchmark_env.Program(cpp_benchmark.replace('.cpp',''), [cpp_benchmark], CPPPATH=headers, LIBS=libraries, LINKFLAGS=env['CUSTOM_LDFLAGS'])
+    Depends(benchmark_program, env.subst('../src/%s' % env['MAPNIK_LIB_NAME']))
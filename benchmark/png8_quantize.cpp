@@ -0,0 +1,96 @@
+// Times PNG8 encoding of synthetic 256x256 tiles with each quantizer:
+// hextree (the png8/png256 default), octree and a fixed rgba_palette.
+//
+//   png8_quantize [num_tiles] [passes] [compression]
+//
+// Compression 0 leaves zlib out of the timings.
+
+#include <mapnik/image_data.hpp>
+#include <mapnik/palette.hpp>
+#include <mapnik/png_io.hpp>
+#include "bench_timer.hpp"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <vector>
+
+// tiles as rendered maps look: large flat areas, a few gradients and
+// antialiased, partly transparent edges between them
+static void fill_tile(mapnik::image_data_32 & image, unsigned seed)
+{
+    unsigned const size = image.width();
+    for (unsigned y = 0; y < size; ++y)
+    {
+        unsigned * row = image.getRow(y);
+        for (unsigned x = 0; x < size; ++x)
+        {
+            unsigned area = ((x + seed * 13) / 64 + (y + seed * 7) / 48) % 6;
+            unsigned r = 40 * area + seed % 16;
+            unsigned g = 200 - 30 * area;
+            unsigned b = 120 + 20 * area;
+            unsigned a = 255;
+            if (area == 5)
+            {
+                // gradient
+                r = (x * 255) / size;
+                g = (y * 255) / size;
+            }
+            if ((x + y + seed) % 61 < 2)
+            {
+                // antialiased road edge
+                r = g = b = 90 + (x + seed) % 3 * 40;
+                a = 128 + (x + y) % 2 * 64;
+            }
+            row[x] = (a << 24) | (b << 16) | (g << 8) | r;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned num_tiles = argc > 1 ? std::atoi(argv[1]) : 40;
+    unsigned passes = argc > 2 ? std::atoi(argv[2]) : 20;
+    int compression = argc > 3 ? std::atoi(argv[3]) : Z_DEFAULT_COMPRESSION;
+
+    std::vector<mapnik::image_data_32*> tiles;
+    for (unsigned i = 0; i < num_tiles; ++i)
+    {
+        tiles.push_back(new mapnik::image_data_32(256, 256));
+        fill_tile(*tiles.back(), i);
+    }
+
+    // a 64 colour grey and colour ramp, as passed with palette=
+    std::string pal;
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        pal += char(i * 4);
+        pal += char(255 - i * 4);
+        pal += char(i % 8 * 32);
+        pal += char(i < 56 ? 255 : i * 4);
+    }
+    mapnik::rgba_palette palette(pal, mapnik::rgba_palette::PALETTE_RGBA);
+
+    std::cout << num_tiles << " tiles, " << passes << " passes" << std::endl;
+    char const* names[] = { "hextree", "octree", "rgba_palette" };
+    for (unsigned q = 0; q < 3; ++q)
+    {
+        std::size_t bytes = 0;
+        bench_timer timer;
+        for (unsigned p = 0; p < passes; ++p)
+        {
+            for (unsigned i = 0; i < num_tiles; ++i)
+            {
+                std::ostringstream stream;
+                if (q == 0) mapnik::save_as_png8_hex(stream, *tiles[i], 256, compression);
+                else if (q == 1) mapnik::save_as_png8_oct(stream, *tiles[i], 256, compression);
+                else mapnik::save_as_png8_pal(stream, *tiles[i], palette, compression);
+                bytes += stream.str().size();
+            }
+        }
+        std::cout << names[q] << ": " << timer.milliseconds() << "ms, "
+                  << bytes / (num_tiles * passes) << " bytes/tile" << std::endl;
+    }
+
+    for (unsigned i = 0; i < num_tiles; ++i) delete tiles[i];
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Times raster_colorizer on a 4096x4096 single band float raster (as read
+// by the GDAL plugin) and single value lookups through get_color().
+//
+//   raster_colorizer [size] [num_stops]
+
+#include <mapnik/raster.hpp>
+#include <mapnik/raster_colorizer.hpp>
+#include <boost/make_shared.hpp>
+#include "bench_timer.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv)
+{
+    unsigned size = argc > 1 ? std::atoi(argv[1]) : 4096;
+    unsigned num_stops = argc > 2 ? std::atoi(argv[2]) : 16;
+
+    // a gradient from -10 to num_stops + 10, partly outside the stops
+    mapnik::image_data_32 values(size, size);
+    for (unsigned y = 0; y < size; ++y)
+    {
+        unsigned * row = values.getRow(y);
+        for (unsigned x = 0; x < size; ++x)
+        {
+            float value = -10.0f + (num_stops + 20.0f) * (x + y) / (2.0f * size);
+            std::memcpy(&row[x], &value, sizeof(float));
+        }
+    }
+    std::map<std::string, mapnik::value> props;
+    props["NODATA"] = -5.0;
+
+    char const* modes[] = { "linear", "discrete", "exact" };
+    for (unsigned m = 0; m < 3; ++m)
+    {
+        mapnik::colorizer_mode mode;
+        mode.from_string(modes[m]);
+        mapnik::raster_colorizer colorizer(mode, mapnik::color(0, 0, 0, 0));
+        for (unsigned i = 0; i < num_stops; ++i)
+        {
+            colorizer.add_stop(mapnik::colorizer_stop(i, mapnik::COLORIZER_INHERIT,
+                                                      mapnik::color(i * 16 % 256, 255 - i * 8 % 256, 128, 255)));
+        }
+
+        mapnik::raster_ptr raster = boost::make_shared<mapnik::raster>(mapnik::box2d<double>(0, 0, size, size), values);
+        bench_timer timer;
+        colorizer.colorize(raster, props);
+        double colorize = timer.milliseconds();
+
+        unsigned const lookups = 1000000;
+        unsigned sum = 0;
+        timer.restart();
+        for (unsigned i = 0; i < lookups; ++i)
+        {
+            sum += colorizer.get_color(-10.0f + (num_stops + 20.0f) * i / lookups).red();
+        }
+        double get_color = timer.milliseconds();
+
+        std::cout << modes[m] << ": colorize " << size << "x" << size << " " << colorize << "ms, "
+                  << lookups << " get_color " << get_color << "ms (" << sum << ")" << std::endl;
+    }
+    return 0;
+}
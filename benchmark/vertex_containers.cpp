@@ -0,0 +1,110 @@
+// Compares the geometry containers: memory per linestring and the time to
+// build linestrings and walk them with vertex() and with get_vertices().
+//
+//   vertex_containers [num_geometries] [passes]
+
+#include <mapnik/geometry.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include "bench_timer.hpp"
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+
+// bytes allocated through operator new by the program
+static std::size_t allocated = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc)
+{
+    allocated += size;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw()
+{
+    std::free(p);
+}
+
+template <template <typename> class Container>
+static void run(char const* name, unsigned num_geometries, unsigned num_points, unsigned passes)
+{
+    typedef mapnik::geometry<mapnik::vertex2d, Container> geometry_type;
+
+    std::size_t before = allocated;
+    bench_timer timer;
+    boost::ptr_vector<geometry_type> paths;
+    for (unsigned k = 0; k < num_geometries; ++k)
+    {
+        geometry_type* path = new geometry_type(mapnik::LineString);
+        path->set_capacity(num_points);
+        path->move_to(k, 0);
+        for (unsigned i = 1; i < num_points; ++i)
+        {
+            path->line_to(k + i, i);
+        }
+        paths.push_back(path);
+    }
+    double build = timer.milliseconds();
+    std::size_t bytes = (allocated - before) / num_geometries;
+
+    double sum = 0;
+    timer.restart();
+    for (unsigned p = 0; p < passes; ++p)
+    {
+        for (unsigned k = 0; k < num_geometries; ++k)
+        {
+            double x, y;
+            paths[k].rewind(0);
+            while (paths[k].vertex(&x, &y) != mapnik::SEG_END) sum += x;
+        }
+    }
+    double walk = timer.milliseconds();
+
+    timer.restart();
+    for (unsigned p = 0; p < passes; ++p)
+    {
+        for (unsigned k = 0; k < num_geometries; ++k)
+        {
+            double const* coords;
+            unsigned command;
+            unsigned pos = 0;
+            while (unsigned count = paths[k].get_vertices(pos, &coords, &command))
+            {
+                for (unsigned i = 0; i < count; ++i) sum -= coords[2 * i];
+                pos += count;
+            }
+        }
+    }
+    double runs = timer.milliseconds();
+
+    std::cout << std::setw(14) << name
+              << std::setw(8) << num_points
+              << std::setw(12) << bytes
+              << std::setw(12) << build
+              << std::setw(12) << walk
+              << std::setw(12) << runs
+              << (sum == 0 ? "" : "  (mismatch)") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned num_geometries = argc > 1 ? std::atoi(argv[1]) : 2000;
+    unsigned passes = argc > 2 ? std::atoi(argv[2]) : 100;
+
+    std::cout << num_geometries << " linestrings, " << passes << " passes, times in ms" << std::endl;
+    std::cout << std::setw(14) << "container"
+              << std::setw(8) << "points"
+              << std::setw(12) << "bytes/geom"
+              << std::setw(12) << "build"
+              << std::setw(12) << "vertex()"
+              << std::setw(12) << "runs" << std::endl;
+    unsigned const points[] = { 1, 10, 100, 1000 };
+    for (unsigned i = 0; i < sizeof(points) / sizeof(points[0]); ++i)
+    {
+        run<mapnik::vertex_vector>("vertex_vector", num_geometries, points[i], passes);
+        run<mapnik::vertex_array>("vertex_array", num_geometries, points[i], passes);
+    }
+    return 0;
+}
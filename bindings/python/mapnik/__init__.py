@@ -352,6 +352,48 @@ def Shapefile(**keywords):
     keywords['type'] = 'shape'
     return CreateDatasource(keywords)
 
+def CSV(**keywords):
+    """Create a CSV Datasource.
+
+    Required keyword arguments:
+      file -- path to the csv file
+
+    Optional keyword arguments:
+      base -- path prefix (default None)
+      encoding -- file encoding (default 'utf-8')
+      separator -- field separator (default ',')
+      quote -- quote character (default '"')
+      wkt_field -- column holding WKT geometries (default: detected from the header)
+      x_field, y_field -- point coordinate columns (default: detected, e.g. x/y or lon/lat)
+
+    >>> from mapnik import CSV, Layer
+    >>> csv = CSV(file='/home/mapnik/data/points.csv')
+    >>> lyr = Layer('CSV Layer')
+    >>> lyr.datasource = csv
+
+    """
+    keywords['type'] = 'csv'
+    return CreateDatasource(keywords)
+
+def GeoJSON(**keywords):
+    """Create a GeoJSON Datasource.
+
+    Required keyword arguments:
+      file -- path to a file holding a FeatureCollection or a Feature
+
+    Optional keyword arguments:
+      base -- path prefix (default None)
+      encoding -- file encoding (default 'utf-8')
+
+    >>> from mapnik import GeoJSON, Layer
+    >>> json = GeoJSON(file='/home/mapnik/data/points.json')
+    >>> lyr = Layer('GeoJSON Layer')
+    >>> lyr.datasource = json
+
+    """
+    keywords['type'] = 'geojson'
+    return CreateDatasource(keywords)
+
 def PostGIS(**keywords):
     """Create a PostGIS Datasource.
 
@@ -428,7 +470,9 @@ def Gdal(**keywords):
 
     Optional keyword arguments:
       base -- path prefix (default None)
-      shared -- boolean, open GdalDataset in shared mode (default: False)
+      initial_size -- number of datasets opened up front (default 1)
+      max_size -- maximum number of pooled datasets (default 10)
+      idle_timeout -- seconds before an unused dataset is closed, checked whenever the layer is read (default 0, never)
       bbox -- tuple (minx, miny, maxx, maxy). If specified, overrides the bbox detected by GDAL.
 
     >>> from mapnik import Gdal, Layer
@@ -534,6 +578,11 @@ def Rasterlite(**keywords):
     Optional keyword arguments:
       base -- path prefix (default None)
       extent -- manually specified data extent (comma delimited string, default None)
+      initial_size -- number of database handles opened up front (default 1)
+      max_size -- maximum number of pooled database handles (default 10)
+      idle_timeout -- seconds before an unused handle is closed, checked whenever the layer is read (default 0, never)
+      tile_size -- size in pixels of the blocks read from each pyramid level (default 256)
+      cache_max -- megabytes of decoded blocks kept across queries (default 16, 0 disables)
 
     >>> from mapnik import Rasterlite, Layer
     >>> rasterlite = Rasterlite(base='/home/mapnik/data',file='osm.db',table='osm',extent='-20037508,-19929239,20037508,19929239') 
@@ -554,6 +603,8 @@ def Osm(**keywords):
       encoding -- file encoding (default 'utf-8')
       url -- url to fetch data (default None)
       bbox -- data bounding box for fetching data (default None)
+      cache_file -- file to keep the parsed data in, read instead of
+                    the OSM file while that is unchanged (default None)
 
     >>> from mapnik import Osm, Layer
     >>> datasource = Osm(file='test.osm') 
@@ -595,6 +646,7 @@ def Geos(**keywords):
     Optional keyword arguments:
       multiple_geometries -- boolean, direct the GEOS wkt reader to interpret as multigeometries (default False)
       extent -- manually specified data extent (comma delimited string, default None)
+      clip_buffer -- pixels added around the query before the geometry is clipped to it (default 16)
 
     >>> from mapnik import Geos, Layer
     >>> datasource = Geos(wkt='MULTIPOINT(100 100, 50 50, 0 0)') 
@@ -646,6 +698,7 @@ __all__ = [
     'Box2d',
     'Feature',
     'Featureset',
+    'FileRenderCache',
     'FontEngine',
     'Geometry2d',
     'GlyphSymbolizer',
@@ -659,11 +712,13 @@ __all__ = [
     'LineSymbolizer',
     'Map',
     'MarkersSymbolizer',
+    'MemoryRenderCache',
     'Names',
     'Path',
     'Parameter',
     'Parameters',
     'PointDatasource',
+    'PointQueryCache',
     'PointSymbolizer',
     'PolygonPatternSymbolizer',
     'PolygonSymbolizer',
@@ -672,6 +727,7 @@ __all__ = [
     'Query',
     'RasterSymbolizer',
     'RasterColorizer',
+    'RenderCache',
     'Rule', 'Rules',
     'ShieldSymbolizer',
     'Singleton',
@@ -698,6 +754,8 @@ __all__ = [
     'Datasource',
     'CreateDatasource',
     'Shapefile',
+    'CSV',
+    'GeoJSON',
     'PostGIS',
     'Raster',
     'Gdal',
@@ -725,6 +783,9 @@ __all__ = [
     'render_grid',
     'render_tile_to_file',
     'render_to_file',
+    'render_to_stream',
+    'render_to_string_cached',
+    'render_with_grid',
     #   other
     'register_plugins',
     'register_fonts',
@@ -733,3 +794,6 @@ __all__ = [
     'Filter',
     'Envelope',
     ]
+
+if has_cairo():
+    __all__.append('CairoFontCache')
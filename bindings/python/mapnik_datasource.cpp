@@ -193,6 +193,17 @@ void export_datasource()
              ">>> ms = MemoryDatasource()\n"
              ">>> feature = Feature(1)\n"
              ">>> ms.add_feature(Feature(1))\n")
+        .def("remove_features",&memory_datasource::remove,
+             "Removes every Feature with the given id\n"
+             "and returns how many were removed:\n"
+             ">>> ms.remove_features(1)\n"
+             "1\n")
+        .def("update_feature",&memory_datasource::update,
+             "Replaces the Feature with the same id\n"
+             "(adds it when there is none), to be called\n"
+             "as well after modifying a Feature in place:\n"
+             ">>> ms.update_feature(feature)\n")
+        .def("clear",&memory_datasource::clear)
         .def("num_features",&memory_datasource::size)
         ;
 }
@@ -34,6 +34,7 @@ using namespace boost::python;
 
 // help compiler see template definitions
 static dict (*encode)( mapnik::grid const&, std::string, bool, unsigned int) = mapnik::grid_encode;
+static std::string (*to_json)( mapnik::grid const&, bool, unsigned int) = mapnik::grid_to_json;
 
 bool painted(mapnik::grid const& grid)
 {
@@ -57,6 +58,10 @@ void export_grid()
             ( arg("encoding")="utf",arg("features")=true,arg("resolution")=4 ),
             "Encode the grid as as optimized json\n"
             )
+        .def("to_json",to_json,
+            ( arg("features")=true,arg("resolution")=4 ),
+            "Encode the grid as a UTFGrid json string\n"
+            )
         .add_property("key",
             make_function(&mapnik::grid::get_key,return_value_policy<copy_const_reference>()),
             &mapnik::grid::set_key,
@@ -36,6 +36,7 @@ using namespace boost::python;
 
 // help compiler see template definitions
 static dict (*encode)( mapnik::grid_view const&, std::string, bool, unsigned int) = mapnik::grid_encode;
+static std::string (*to_json)( mapnik::grid_view const&, bool, unsigned int) = mapnik::grid_to_json;
 
 void export_grid_view()
 {
@@ -48,5 +49,9 @@ void export_grid_view()
             ( arg("encoding")="utf",arg("add_features")=true,arg("resolution")=4 ),
             "Encode the grid as as optimized json\n"
             )
+        .def("to_json",to_json,
+            ( arg("add_features")=true,arg("resolution")=4 ),
+            "Encode the grid as a UTFGrid json string\n"
+            )
         ;
 }
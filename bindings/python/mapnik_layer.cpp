@@ -120,7 +120,7 @@ void export_layer()
 
         .def_pickle(layer_pickle_suite())
          
-        .def("envelope",&layer::envelope, 
+        .def("envelope",(mapnik::box2d<double> (layer::*)() const)&layer::envelope, 
              "Return the geographic envelope/bounding box."
              "\n"
              "Determined based on the layer datasource.\n"
@@ -131,6 +131,16 @@ void export_layer()
              ">>> lyr.envelope()\n"
              "box2d(-1.0,-1.0,0.0,0.0) # default until a datasource is loaded\n"
             )
+
+        .def("reset_envelope",&layer::reset_envelope,
+             "Discard the cached envelope of this layer.\n"
+             "\n"
+             "In-memory datasources report their changes and need no reset;\n"
+             "call this after the data behind any other datasource changed.\n"
+             "\n"
+             "Usage:\n"
+             ">>> lyr.reset_envelope()\n"
+            )
         
         .def("visible", &layer::isVisible,
              "Return True if this layer's data is active and visible at a given scale.\n"
@@ -25,6 +25,7 @@
 #include <boost/python.hpp>
 #include <boost/python/detail/api_placeholder.hpp>
 #include <boost/python/suite/indexing/vector_indexing_suite.hpp>
+#include <boost/python/stl_iterator.hpp>
 
 // mapnik
 #include <mapnik/layer.hpp>
@@ -173,6 +174,68 @@ mapnik::featureset_ptr query_map_point(mapnik::Map const& m, int index, double x
     return m.query_map_point(idx, x, y);
 }
 
+namespace {
+
+std::vector<mapnik::coord2d> extract_points(boost::python::object const& points)
+{
+    using namespace boost::python;
+    std::vector<mapnik::coord2d> result;
+    stl_input_iterator<object> itr(points), end;
+    for (; itr != end; ++itr)
+    {
+        object p = *itr;
+        result.push_back(mapnik::coord2d(extract<double>(p[0]), extract<double>(p[1])));
+    }
+    return result;
+}
+
+boost::python::list to_list(mapnik::point_query_results const& results)
+{
+    boost::python::list l;
+    for (unsigned i = 0; i < results.size(); ++i)
+    {
+        boost::python::list features;
+        for (unsigned j = 0; j < results[i].size(); ++j)
+        {
+            features.append(results[i][j]);
+        }
+        l.append(features);
+    }
+    return l;
+}
+
+}
+
+boost::python::list query_points(mapnik::Map const& m, int index,
+                                 boost::python::object const& points,
+                                 double tolerance,
+                                 boost::python::object const& fields,
+                                 mapnik::point_query_cache * cache)
+{
+    if (index < 0){
+        PyErr_SetString(PyExc_IndexError, "Please provide a layer index >= 0");
+        boost::python::throw_error_already_set();    
+    }
+    std::vector<std::string> names((boost::python::stl_input_iterator<std::string>(fields)),
+                                   boost::python::stl_input_iterator<std::string>());
+    return to_list(m.query_points(index, extract_points(points), tolerance, names, cache));
+}
+
+boost::python::list query_map_points(mapnik::Map const& m, int index,
+                                     boost::python::object const& points,
+                                     double tolerance,
+                                     boost::python::object const& fields,
+                                     mapnik::point_query_cache * cache)
+{
+    if (index < 0){
+        PyErr_SetString(PyExc_IndexError, "Please provide a layer index >= 0");
+        boost::python::throw_error_already_set();    
+    }
+    std::vector<std::string> names((boost::python::stl_input_iterator<std::string>(fields)),
+                                   boost::python::stl_input_iterator<std::string>());
+    return to_list(m.query_map_points(index, extract_points(points), tolerance, names, cache));
+}
+
 void export_map() 
 {
     using namespace boost::python;
@@ -326,6 +389,38 @@ void export_map()
              ">>> [<mapnik.Feature object at 0x3995630>]\n"
             )
         
+        .def("query_map_points",query_map_points,
+             (arg("layer_idx"),arg("points"),arg("tolerance")=3.0,
+              arg("fields")=boost::python::list(),arg("cache")=object()),
+             "Query a Map Layer (by layer index) for features \n"
+             "at many x,y locations in the pixel coordinates of\n"
+             "the rendered map image at once.\n"
+             "The tolerance is in pixels. Only the given fields\n"
+             "are loaded (all of them if empty). An optional\n"
+             "PointQueryCache keeps hot layers indexed in memory.\n"
+             "Returns one list of features per point.\n"
+             "\n"
+             "Usage:\n"
+             ">>> m.query_map_points(0,[(200,200),(10,10)],3,['NAME'])\n"
+             "[[<mapnik.Feature object at 0x3995630>], []]\n"
+            )
+
+        .def("query_points",query_points,
+             (arg("layer_idx"),arg("points"),arg("tolerance")=3.0,
+              arg("fields")=boost::python::list(),arg("cache")=object()),
+             "Query a Map Layer (by layer index) for features \n"
+             "at many x,y locations in the coordinates of map\n"
+             "projection at once.\n"
+             "The tolerance is in pixels. Only the given fields\n"
+             "are loaded (all of them if empty). An optional\n"
+             "PointQueryCache keeps hot layers indexed in memory.\n"
+             "Returns one list of features per point.\n"
+             "\n"
+             "Usage:\n"
+             ">>> m.query_points(0,[(-122,48),(0,0)],3,['NAME'])\n"
+             "[[<mapnik.Feature object at 0x3995630>], []]\n"
+            )
+
         .def("query_point",query_point,
              (arg("layer idx"),arg("x"),arg("y")),
              "Query a Map Layer (by layer index) for features \n"
@@ -344,7 +439,7 @@ void export_map()
             )
 
         .def("remove_all",&Map::remove_all,
-             "Remove all Mapnik Styles and layers from the Map.\n"
+             "Remove all Mapnik Styles, fontsets and layers from the Map.\n"
              "\n"
              "Usage:\n"
              ">>> m.remove_all()\n"
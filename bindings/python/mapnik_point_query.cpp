@@ -0,0 +1,54 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// boost
+#include <boost/python.hpp>
+
+// mapnik
+#include <mapnik/point_query.hpp>
+
+using mapnik::point_query_cache;
+
+void export_point_query()
+{
+    using namespace boost::python;
+
+    class_<point_query_cache, boost::noncopyable>
+        ("PointQueryCache",
+         "In-memory feature indexes for layers that are point queried often.\n"
+         "Pass to Map.query_points or Map.query_map_points.",
+         init<optional<unsigned> >(
+             (arg("hot_threshold")=10),
+             "Create a cache that indexes a layer once it has been queried\n"
+             "hot_threshold times with the same fields.\n"
+             "\n"
+             "Usage:\n"
+             ">>> cache = PointQueryCache(10)\n"
+             ">>> m.query_map_points(0, [(10,10),(20,20)], 3, ['NAME'], cache)\n"))
+        .def("invalidate", &point_query_cache::invalidate,
+             "Drop the indexes built from the given datasource.\n")
+        .def("clear", &point_query_cache::clear,
+             "Drop all indexes.\n")
+        .def("__len__", &point_query_cache::size)
+        ;
+}
@@ -66,6 +66,8 @@ void export_view_transform();
 void export_raster_colorizer();
 void export_glyph_symbolizer();
 void export_inmem_metawriter();
+void export_render_cache();
+void export_point_query();
 
 #include <mapnik/version.hpp>
 #include <mapnik/value_error.hpp>
@@ -83,6 +85,9 @@ void export_inmem_metawriter();
 #include <mapnik/save_map.hpp>
 #include "python_grid_utils.hpp"
 
+// stl
+#include <sstream>
+
 #if defined(HAVE_CAIRO) && defined(HAVE_PYCAIRO)
 #include <pycairo.h>
 static Pycairo_CAPI_t *Pycairo_CAPI;
@@ -300,6 +305,43 @@ void render_to_file3(const mapnik::Map& map,
     }
 }
 
+#if defined(HAVE_CAIRO)
+
+void render_to_stream2(const mapnik::Map& map,
+                       boost::python::object stream,
+                       const std::string& format,
+                       mapnik::cairo_font_cache_ptr const& font_cache)
+{
+    std::ostringstream s(std::ios::out | std::ios::binary);
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        mapnik::save_to_cairo_stream(map,s,format,font_cache);
+    }
+    catch (...)
+    {
+        Py_BLOCK_THREADS
+        throw;
+    }
+    Py_END_ALLOW_THREADS
+    std::string data = s.str();
+    boost::python::handle<> bytes(PyString_FromStringAndSize(data.data(), data.size()));
+    stream.attr("write")(boost::python::object(bytes));
+}
+
+#endif
+
+void render_to_stream1(const mapnik::Map& map,
+                       boost::python::object stream,
+                       const std::string& format)
+{
+#if defined(HAVE_CAIRO)
+    render_to_stream2(map,stream,format,mapnik::cairo_font_cache_ptr());
+#else
+    throw mapnik::ImageWriterException("Cairo backend not available, cannot write to format: " + format);
+#endif
+}
+
 double scale_denominator(mapnik::Map const &map, bool geographic)
 {
     return mapnik::scale_denominator(map, geographic);
@@ -427,6 +469,16 @@ BOOST_PYTHON_MODULE(_mapnik2)
     export_raster_colorizer();
     export_glyph_symbolizer();
     export_inmem_metawriter();
+    export_render_cache();
+    export_point_query();
+
+#if defined(HAVE_CAIRO)
+    class_<mapnik::cairo_font_cache, mapnik::cairo_font_cache_ptr, boost::noncopyable>
+        ("CairoFontCache",
+         "Fonts loaded for Cairo rendering, kept across renders when\n"
+         "passed to render_to_stream. Use a cache from one thread at a time.\n",
+         init<>());
+#endif
 
     def("render_grid",&render_grid,
       ( arg("map"),
@@ -479,6 +531,39 @@ BOOST_PYTHON_MODULE(_mapnik2)
         "\n"
         );
         
+    def("render_to_stream",&render_to_stream1,
+        "\n"
+        "Render Map with Cairo and write the output to a file-like object\n"
+        "(anything with a write method) in the given format: one of\n"
+        "'pdf', 'svg', 'ps', 'ARGB32' or 'RGB24' (the latter two as png).\n"
+        "\n"
+        "Usage:\n"
+        ">>> from mapnik import Map, render_to_stream, load_map\n"
+        ">>> from StringIO import StringIO\n"
+        ">>> m = Map(256,256)\n"
+        ">>> load_map(m,'mapfile.xml')\n"
+        ">>> output = StringIO()\n"
+        ">>> render_to_stream(m,output,'pdf')\n"
+        "\n"
+        );
+
+#if defined(HAVE_CAIRO)
+    def("render_to_stream",&render_to_stream2,
+        "\n"
+        "Render Map with Cairo and write the output to a file-like object,\n"
+        "reusing the fonts loaded into a CairoFontCache by earlier renders.\n"
+        "\n"
+        "Usage:\n"
+        ">>> from mapnik import Map, render_to_stream, CairoFontCache\n"
+        ">>> fonts = CairoFontCache()\n"
+        ">>> for name in ('a.xml', 'b.xml'):\n"
+        "...     m = Map(256,256)\n"
+        "...     load_map(m,name)\n"
+        "...     render_to_stream(m,open(name + '.pdf','wb'),'pdf',fonts)\n"
+        "\n"
+        );
+#endif
+
     def("render_tile_to_file",&render_tile_to_file,
         "\n"
         "TODO\n"
@@ -510,6 +595,23 @@ BOOST_PYTHON_MODULE(_mapnik2)
     def("render_layer", &mapnik::render_layer_for_grid,
       (arg("map"),arg("grid"),args("layer"),arg("fields")=boost::python::list())
     ); 
+
+    def("render_with_grid", &mapnik::render_with_grid,
+      (arg("map"),arg("image"),arg("grid"),args("layer"),arg("fields")=boost::python::list()),
+        "\n"
+        "Render Map to an AGG image_32 and the given layer to a Grid\n"
+        "in a single pass over the datasources.\n"
+        "\n"
+        "Usage:\n"
+        ">>> from mapnik import Map, Image, Grid, render_with_grid, load_map\n"
+        ">>> m = Map(256,256)\n"
+        ">>> load_map(m,'mapfile.xml')\n"
+        ">>> im = Image(m.width,m.height)\n"
+        ">>> grid = Grid(m.width,m.height,key='__id__')\n"
+        ">>> render_with_grid(m,im,grid,layer=0,fields=['NAME'])\n"
+        ">>> utf = grid.encode('utf',resolution=4)\n"
+        "\n"
+    ); 
     
 #if defined(HAVE_CAIRO) && defined(HAVE_PYCAIRO)
     def("render",&render3,
@@ -39,17 +39,17 @@ struct raster_symbolizer_pickle_suite : boost::python::pickle_suite
     static  boost::python::tuple
     getstate(const raster_symbolizer& r)
     {
-        return boost::python::make_tuple(r.get_mode(),r.get_scaling(),r.get_opacity(),r.get_filter_factor(),r.get_mesh_size());
+        return boost::python::make_tuple(r.get_mode(),r.get_scaling(),r.get_opacity(),r.get_filter_factor(),r.get_mesh_size(),r.get_warp_threads());
     }
 
     static void
     setstate (raster_symbolizer& r, boost::python::tuple state)
     {
         using namespace boost::python;
-        if (len(state) != 5)
+        if (len(state) != 6)
         {
             PyErr_SetObject(PyExc_ValueError,
-                            ("expected 5-item tuple in call to __setstate__; got %s"
+                            ("expected 6-item tuple in call to __setstate__; got %s"
                              % state).ptr()
                 );
             throw_error_already_set();
@@ -60,6 +60,7 @@ struct raster_symbolizer_pickle_suite : boost::python::pickle_suite
         r.set_opacity(extract<float>(state[2]));
         r.set_filter_factor(extract<float>(state[3]));
         r.set_mesh_size(extract<unsigned>(state[4]));
+        r.set_warp_threads(extract<unsigned>(state[5]));
     }
 
 };
@@ -162,5 +163,18 @@ void export_raster_symbolizer()
                       ">>> r = RasterSymbolizer()\n"
                       ">>> r.mesh_size = 32\n"
             )
+        .add_property("warp_threads",
+                      &raster_symbolizer::get_warp_threads,
+                      &raster_symbolizer::set_warp_threads,
+                      "Get/Set the number of threads used to warp large\n"
+                      "reprojected rasters. The default of 1 warps on the\n"
+                      "rendering thread.\n"
+                      "\n"
+                      "Usage:\n"
+                      "\n"
+                      ">>> from mapnik import RasterSymbolizer\n"
+                      ">>> r = RasterSymbolizer()\n"
+                      ">>> r.warp_threads = 4\n"
+            )
         ;    
 }
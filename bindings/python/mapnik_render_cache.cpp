@@ -0,0 +1,130 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// boost
+#include <boost/python.hpp>
+#include <boost/python/module.hpp>
+#include <boost/python/def.hpp>
+
+// mapnik
+#include <mapnik/map.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/render_cache.hpp>
+
+using mapnik::render_cache;
+using mapnik::render_cache_ptr;
+using mapnik::memory_render_cache;
+using mapnik::file_render_cache;
+
+namespace {
+
+PyObject* render_to_string_cached(mapnik::Map const& map,
+                                  render_cache & cache,
+                                  std::string const& map_id,
+                                  std::string const& format,
+                                  double scale_factor)
+{
+    std::string data;
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        data = mapnik::render_to_string_cached(map, cache, map_id, format, scale_factor);
+    }
+    catch (...)
+    {
+        Py_BLOCK_THREADS
+        throw;
+    }
+    Py_END_ALLOW_THREADS
+    return PyString_FromStringAndSize(data.data(), data.size());
+}
+
+}
+
+void export_render_cache()
+{
+    using namespace boost::python;
+
+    class_<render_cache, boost::noncopyable>
+        ("RenderCache",
+         "Abstract cache of encoded render results.",
+         no_init)
+        .def("invalidate", &render_cache::invalidate,
+             "Expire all entries depending on the given dependency key.\n")
+        .def("invalidate_layer", &render_cache::invalidate_layer,
+             "Expire all entries rendered from the named layer.\n"
+             "\n"
+             "Usage:\n"
+             ">>> cache.invalidate_layer('roads')\n")
+        .def("invalidate_datasource", &render_cache::invalidate_datasource,
+             "Expire all entries rendered from a datasource with the\n"
+             "same parameters as the given one.\n"
+             "\n"
+             "Usage:\n"
+             ">>> cache.invalidate_datasource(m.layers[0].datasource)\n")
+        .def("clear", &render_cache::clear,
+             "Remove all entries from the cache.\n")
+        ;
+
+    class_<memory_render_cache, bases<render_cache>, boost::noncopyable>
+        ("MemoryRenderCache",
+         "In-memory least recently used render cache bounded in bytes.",
+         init<optional<std::size_t> >(
+             ( arg("max_bytes") ),
+             "Create an in-memory render cache.\n"
+             "\n"
+             "Usage:\n"
+             ">>> from mapnik import MemoryRenderCache\n"
+             ">>> cache = MemoryRenderCache(64*1024*1024)\n"))
+        .def("__len__", &memory_render_cache::size)
+        .add_property("bytes", &memory_render_cache::bytes,
+                      "Total size of the cached data in bytes.\n")
+        ;
+
+    class_<file_render_cache, bases<render_cache>, boost::noncopyable>
+        ("FileRenderCache",
+         "Render cache storing one file per entry in a directory.",
+         init<std::string>(
+             ( arg("directory") ),
+             "Create a render cache backed by the given directory.\n"
+             "\n"
+             "Usage:\n"
+             ">>> from mapnik import FileRenderCache\n"
+             ">>> cache = FileRenderCache('/tmp/tiles')\n"))
+        ;
+
+    def("render_to_string_cached", &render_to_string_cached,
+        ( arg("map"),
+          arg("cache"),
+          arg("map_id"),
+          arg("format")="png",
+          arg("scale_factor")=1.0 ),
+        "\n"
+        "Render Map to an encoded image string through a render cache.\n"
+        "\n"
+        "Usage:\n"
+        ">>> from mapnik import Map, MemoryRenderCache, render_to_string_cached\n"
+        ">>> cache = MemoryRenderCache()\n"
+        ">>> png = render_to_string_cached(m, cache, 'mystyle-v1', 'png256')\n"
+        );
+}
@@ -24,13 +24,14 @@
 
 // boost
 #include <boost/python.hpp>
-#include <boost/scoped_array.hpp>
 #include <boost/foreach.hpp>
 
 // mapnik
 #include <mapnik/grid/grid_renderer.hpp>
+#include <mapnik/grid/image_grid_renderer.hpp>
 #include <mapnik/grid/grid.hpp>
 #include <mapnik/grid/grid_util.hpp>
+#include <mapnik/grid/grid_encode.hpp>
 #include <mapnik/grid/grid_view.hpp>
 #include <mapnik/value_error.hpp>
 #include "mapnik_value_converter.hpp"
@@ -39,226 +40,55 @@
 namespace mapnik {
 
 
-template <typename T>
-static void grid2utf(T const& grid_type, 
-    boost::python::list& l,
-    std::vector<grid::lookup_type>& key_order)
-{
-    typename T::data_type const& data = grid_type.data();
-    typename T::feature_key_type const& feature_keys = grid_type.get_feature_keys();
-    typename T::key_type keys;
-    typename T::key_type::const_iterator key_pos;
-    typename T::feature_key_type::const_iterator feature_pos;
-    // start counting at utf8 codepoint 32, aka space character
-    uint16_t codepoint = 32;
-    
-    unsigned array_size = data.width();
-    for (unsigned y = 0; y < data.height(); ++y)
-    {
-        uint16_t idx = 0;
-        boost::scoped_array<Py_UNICODE> line(new Py_UNICODE[array_size]);
-        typename T::value_type const* row = data.getRow(y);
-        for (unsigned x = 0; x < data.width(); ++x)
-        {
-            feature_pos = feature_keys.find(row[x]);
-            if (feature_pos != feature_keys.end())
-            {
-                mapnik::grid::lookup_type val = feature_pos->second;
-                key_pos = keys.find(val);
-                if (key_pos == keys.end())
-                {
-                    // Create a new entry for this key. Skip the codepoints that
-                    // can't be encoded directly in JSON.
-                    if (codepoint == 34) ++codepoint;      // Skip "
-                    else if (codepoint == 92) ++codepoint; // Skip backslash
-                
-                    keys[val] = codepoint;
-                    key_order.push_back(val);
-                    line[idx++] = static_cast<Py_UNICODE>(codepoint);
-                    ++codepoint;
-                }
-                else
-                {
-                    line[idx++] = static_cast<Py_UNICODE>(key_pos->second);
-                }
-            }
-            // else, shouldn't get here...
-        }
-        l.append(boost::python::object(
-                    boost::python::handle<>(
-                        PyUnicode_FromUnicode(line.get(), array_size))));
-    }
-}
-
-
-template <typename T>
-static void grid2utf(T const& grid_type, 
-    boost::python::list& l,
-    std::vector<typename T::lookup_type>& key_order,
-    unsigned int resolution)
-{
-    //typename T::data_type const& data = grid_type.data();
-    typename T::feature_key_type const& feature_keys = grid_type.get_feature_keys();
-    typename T::key_type keys;
-    typename T::key_type::const_iterator key_pos;
-    typename T::feature_key_type::const_iterator feature_pos;
-    // start counting at utf8 codepoint 32, aka space character
-    uint16_t codepoint = 32;
-
-    // TODO - use double?
-    unsigned array_size = static_cast<unsigned int>(grid_type.width()/resolution);
-    for (unsigned y = 0; y < grid_type.height(); y=y+resolution)
-    {
-        uint16_t idx = 0;
-        boost::scoped_array<Py_UNICODE> line(new Py_UNICODE[array_size]);
-        mapnik::grid::value_type const* row = grid_type.getRow(y);
-        for (unsigned x = 0; x < grid_type.width(); x=x+resolution)
-        {
-            feature_pos = feature_keys.find(row[x]);
-            if (feature_pos != feature_keys.end())
-            {
-                mapnik::grid::lookup_type val = feature_pos->second;
-                key_pos = keys.find(val);
-                if (key_pos == keys.end())
-                {
-                    // Create a new entry for this key. Skip the codepoints that
-                    // can't be encoded directly in JSON.
-                    if (codepoint == 34) ++codepoint;      // Skip "
-                    else if (codepoint == 92) ++codepoint; // Skip backslash
-                    keys[val] = codepoint;
-                    key_order.push_back(val);
-                    line[idx++] = static_cast<Py_UNICODE>(codepoint);
-                    ++codepoint;
-                }
-                else
-                {
-                    line[idx++] = static_cast<Py_UNICODE>(key_pos->second);
-                }
-            }
-            // else, shouldn't get here...
-        }
-        l.append(boost::python::object(
-                    boost::python::handle<>(
-                        PyUnicode_FromUnicode(line.get(), array_size))));
-    }
-}
-
-
-template <typename T>
-static void grid2utf2(T const& grid_type, 
-    boost::python::list& l,
-    std::vector<typename T::lookup_type>& key_order,
-    unsigned int resolution)
+// collects encoded grid rows as python unicode strings
+struct python_grid_rows
 {
-    typename T::data_type const& data = grid_type.data();
-    typename T::feature_key_type const& feature_keys = grid_type.get_feature_keys();
-    typename T::key_type keys;
-    typename T::key_type::const_iterator key_pos;
-    typename T::feature_key_type::const_iterator feature_pos;
-    // start counting at utf8 codepoint 32, aka space character
-    uint16_t codepoint = 32;
-
-    mapnik::grid::data_type target(data.width()/resolution,data.height()/resolution);
-    mapnik::scale_grid(target,grid_type.data(),0.0,0.0);
+    explicit python_grid_rows(boost::python::list & l)
+        : l_(l) {}
 
-    unsigned array_size = target.width();
-    for (unsigned y = 0; y < target.height(); ++y)
+    void operator() (unsigned const* row, unsigned width)
     {
-        uint16_t idx = 0;
-        boost::scoped_array<Py_UNICODE> line(new Py_UNICODE[array_size]);
-        mapnik::grid::value_type * row = target.getRow(y);
-        unsigned x;
-        for (x = 0; x < target.width(); ++x)
+        line_.resize(width > 0 ? width : 1);
+        for (unsigned i = 0; i < width; ++i)
         {
-            feature_pos = feature_keys.find(row[x]);
-            if (feature_pos != feature_keys.end())
-            {
-                mapnik::grid::lookup_type val = feature_pos->second;
-                key_pos = keys.find(val);
-                if (key_pos == keys.end())
-                {
-                    // Create a new entry for this key. Skip the codepoints that
-                    // can't be encoded directly in JSON.
-                    if (codepoint == 34) ++codepoint;      // Skip "
-                    else if (codepoint == 92) ++codepoint; // Skip backslash
-                    keys[val] = codepoint;
-                    key_order.push_back(val);
-                    line[idx++] = static_cast<Py_UNICODE>(codepoint);
-                    ++codepoint;
-                }
-                else
-                {
-                    line[idx++] = static_cast<Py_UNICODE>(key_pos->second);
-                }
-            }
-            // else, shouldn't get here...
+            line_[i] = static_cast<Py_UNICODE>(row[i]);
         }
-        l.append(boost::python::object(
+        l_.append(boost::python::object(
                     boost::python::handle<>(
-                        PyUnicode_FromUnicode(line.get(), array_size))));
+                        PyUnicode_FromUnicode(&line_[0], width))));
     }
-}
 
+    boost::python::list & l_;
+    std::vector<Py_UNICODE> line_;
+};
 
 template <typename T>
 static void write_features(T const& grid_type,
     boost::python::dict& feature_data,
     std::vector<typename T::lookup_type> const& key_order)
 {
-    std::string const& key = grid_type.get_key();
-    std::set<std::string> const& attributes = grid_type.property_names();
+    // grid memory only holds the requested attributes,
+    // so serialize them for every key visible in the grid
     typename T::feature_type const& g_features = grid_type.get_grid_features();
-    typename T::feature_type::const_iterator feat_itr = g_features.begin();
-    typename T::feature_type::const_iterator feat_end = g_features.end();
-    bool include_key = (attributes.find(key) != attributes.end());
-    for (; feat_itr != feat_end; ++feat_itr)
+    BOOST_FOREACH ( typename T::lookup_type const& key_id, key_order )
     {
-        std::map<std::string,mapnik::value> const& props = feat_itr->second;
-        std::map<std::string,mapnik::value>::const_iterator const& itr = props.find(key);
-        if (itr != props.end())
+        typename T::feature_type::const_iterator feat_itr = g_features.find(key_id);
+        if (feat_itr == g_features.end() || feat_itr->second.empty())
         {
-            typename T::lookup_type const& join_value = itr->second.to_string();
-    
-            // only serialize features visible in the grid
-            if(std::find(key_order.begin(), key_order.end(), join_value) != key_order.end()) {
-                boost::python::dict feat;
-                std::map<std::string,mapnik::value>::const_iterator it = props.begin();
-                std::map<std::string,mapnik::value>::const_iterator end = props.end();
-                bool found = false;
-                for (; it != end; ++it)
-                {
-                    std::string const& key_name = it->first;
-                    if (key_name == key) {
-                        // drop key unless requested
-                        if (include_key) {
-                            found = true;
-                            feat[it->first] = boost::python::object(
-                                boost::python::handle<>(
-                                    boost::apply_visitor(
-                                        boost::python::value_converter(),
-                                            it->second.base())));
-                        }
-                    }
-                    else if ( (attributes.find(key_name) != attributes.end()) )
-                    {
-                        found = true;
-                        feat[it->first] = boost::python::object(
-                            boost::python::handle<>(
-                                boost::apply_visitor(
-                                    boost::python::value_converter(),
-                                        it->second.base())));
-                    }
-                }
-                if (found)
-                {
-                    feature_data[feat_itr->first] = feat;
-                }
-            }
+            continue;
         }
-        else
+        boost::python::dict feat;
+        typename T::feature_properties_type::const_iterator it = feat_itr->second.begin();
+        typename T::feature_properties_type::const_iterator end = feat_itr->second.end();
+        for (; it != end; ++it)
         {
-            std::clog << "should not get here: key '" << key << "' not found in grid feature properties\n";
+            feat[it->first] = boost::python::object(
+                boost::python::handle<>(
+                    boost::apply_visitor(
+                        boost::python::value_converter(),
+                            it->second.base())));
         }
+        feature_data[feat_itr->first] = feat;
     }
 }
 
@@ -270,19 +100,10 @@ static void grid_encode_utf(T const& grid_type,
 {
     // convert buffer to utf and gather key order
     boost::python::list l;
-    std::vector<typename T::lookup_type> key_order;
-    
-    if (resolution != 1) {
-        // resample on the fly - faster, less accurate
-        mapnik::grid2utf<T>(grid_type,l,key_order,resolution);
-
-        // resample first - slower, more accurate
-        //mapnik::grid2utf2<T>(grid_type,l,key_order,resolution);
-    }
-    else
-    {
-        mapnik::grid2utf<T>(grid_type,l,key_order);    
-    }
+    mapnik::grid_key_table<T> keys(grid_type.get_feature_keys());
+    python_grid_rows rows(l);
+    mapnik::grid_encode_rows(grid_type, mapnik::grid_encode_step(grid_type, resolution), keys, rows);
+    std::vector<typename T::lookup_type> const& key_order = keys.keys();
 
     // convert key order to proper python list
     boost::python::list keys_a;
@@ -319,6 +140,35 @@ static boost::python::dict grid_encode( T const& grid, std::string format, bool
     }
 }
 
+template <typename T>
+static std::string grid_to_json(T const& grid, bool add_features, unsigned int resolution)
+{
+    std::ostringstream s;
+    mapnik::grid_encode_json(grid,s,add_features,resolution);
+    return s.str();
+}
+
+// push the requested field names into the grid, returns the number of fields
+static boost::python::ssize_t add_grid_fields(mapnik::grid& grid,
+    boost::python::list const& fields)
+{
+    // convert python list to std::vector
+    boost::python::ssize_t num_fields = boost::python::len(fields);
+    for(boost::python::ssize_t i=0; i<num_fields; i++) {
+        boost::python::extract<std::string> name(fields[i]);
+        if (name.check()) {
+            grid.add_property_name(name());
+        }
+        else
+        {
+          std::stringstream s;
+          s << "list of field names must be strings";
+          throw mapnik::value_error(s.str());    
+        }
+    }
+    return num_fields;
+}
+
 /* new approach: key comes from grid object
  * grid size should be same as the map
  * encoding, resizing handled as method on grid object
@@ -338,20 +188,8 @@ static void render_layer_for_grid(const mapnik::Map& map,
         throw std::runtime_error(s.str());
     }
 
-    // convert python list to std::vector
-    boost::python::ssize_t num_fields = boost::python::len(fields);
-    for(boost::python::ssize_t i=0; i<num_fields; i++) {
-        boost::python::extract<std::string> name(fields[i]);
-        if (name.check()) {
-            grid.add_property_name(name());
-        }
-        else
-        {
-          std::stringstream s;
-          s << "list of field names must be strings";
-          throw mapnik::value_error(s.str());    
-        }
-    }
+    // convert python list to grid field names
+    add_grid_fields(grid,fields);
 
     // copy property names
     std::set<std::string> attributes = grid.property_names();
@@ -381,6 +219,20 @@ static void render_layer_for_grid(const mapnik::Map& map,
     ren.apply(layer,attributes);
 }
 
+/* render all layers to the image and the grid of one layer in a single pass
+ * sharing datasource queries and filter evaluation
+ */
+static void render_with_grid(const mapnik::Map& map,
+    mapnik::image_32& image,
+    mapnik::grid& grid,
+    unsigned layer_idx,
+    boost::python::list const& fields)
+{
+    add_grid_fields(grid,fields);
+    mapnik::image_grid_renderer<mapnik::image_32> ren(map,image,grid,layer_idx,1.0,0,0);
+    ren.apply();
+}
+
 /* old, original impl - to be removed after further testing
  * grid object is created on the fly at potentially reduced size
  */
@@ -407,19 +259,7 @@ static boost::python::dict render_grid(const mapnik::Map& map,
     mapnik::grid grid(grid_width,grid_height,key,step);
     
     // convert python list to std::vector
-    boost::python::ssize_t num_fields = boost::python::len(fields);
-    for(boost::python::ssize_t i=0; i<num_fields; i++) {
-        boost::python::extract<std::string> name(fields[i]);
-        if (name.check()) {
-            grid.add_property_name(name());
-        }
-        else
-        {
-          std::stringstream s;
-          s << "list of field names must be strings";
-          throw mapnik::value_error(s.str());    
-        }
-    }
+    boost::python::ssize_t num_fields = add_grid_fields(grid,fields);
 
     // copy property names
     std::set<std::string> attributes = grid.property_names();
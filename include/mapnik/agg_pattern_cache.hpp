@@ -0,0 +1,205 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2010 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+//$Id$
+
+#ifndef MAPNIK_AGG_PATTERN_CACHE_HPP
+#define MAPNIK_AGG_PATTERN_CACHE_HPP
+
+// mapnik
+#include <mapnik/image_data.hpp>
+#include <mapnik/marker.hpp>
+#include <mapnik/marker_cache.hpp>
+#include <mapnik/agg_pattern_source.hpp>
+// boost
+#include <boost/utility.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+// agg
+#include "agg_color_rgba.h"
+#include "agg_pattern_filters_rgba.h"
+#include "agg_renderer_outline_image.h"
+// stl
+#include <map>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+namespace mapnik
+{
+
+/*
+ * Polygon pattern with every row repeated out to at least min_row_width
+ * pixels, so spans are filled with a few block copies instead of a
+ * wrapped fetch per pixel.
+ */
+class expanded_pattern : private boost::noncopyable
+{
+public:
+    static const unsigned min_row_width = 256;
+
+    explicit expanded_pattern(image_data_32 const& pattern)
+        : width_(pattern.width()),
+          height_(pattern.height()),
+          row_width_(width_ * std::max(1u, (min_row_width + width_ - 1) / width_)),
+          // same wrapping as agg::wrap_mode_repeat
+          add_x_(width_ * (0x3FFFFFFF / width_)),
+          add_y_(height_ * (0x3FFFFFFF / height_)),
+          data_(row_width_ * height_)
+    {
+        for (unsigned y = 0; y < height_; ++y)
+        {
+            boost::uint32_t * row = &data_[y * row_width_];
+            for (unsigned x = 0; x < row_width_; x += width_)
+            {
+                std::memcpy(row + x, pattern.getRow(y), width_ * sizeof(boost::uint32_t));
+            }
+        }
+    }
+
+    // copy len pixels starting at (x,y), wrapping in both directions
+    inline void fill_span(agg::rgba8 * span, int x, int y, unsigned len) const
+    {
+        unsigned sx = (unsigned(x) + add_x_) % width_;
+        unsigned sy = (unsigned(y) + add_y_) % height_;
+        boost::uint32_t const* row = &data_[sy * row_width_];
+        while (len > 0)
+        {
+            unsigned n = std::min(len, row_width_ - sx);
+            // rgba8 is four bytes in pixel order, copied as raw memory
+            std::memcpy(static_cast<void*>(span), row + sx, n * sizeof(boost::uint32_t));
+            span += n;
+            len -= n;
+            sx = 0;
+        }
+    }
+
+private:
+    unsigned width_;
+    unsigned height_;
+    unsigned row_width_;
+    unsigned add_x_;
+    unsigned add_y_;
+    std::vector<boost::uint32_t> data_;
+};
+
+/*
+ * Span generator over an expanded_pattern, produces the same spans as
+ * agg::span_pattern_rgba over an agg::image_accessor_wrap with repeat modes.
+ */
+class span_expanded_pattern
+{
+public:
+    typedef agg::rgba8 color_type;
+
+    span_expanded_pattern(expanded_pattern const& pattern,
+                          unsigned offset_x, unsigned offset_y)
+        : pattern_(pattern),
+          offset_x_(offset_x),
+          offset_y_(offset_y) {}
+
+    void prepare() {}
+
+    void generate(color_type * span, int x, int y, unsigned len)
+    {
+        x += offset_x_;
+        y += offset_y_;
+        pattern_.fill_span(span, x, y, len);
+    }
+
+private:
+    expanded_pattern const& pattern_;
+    unsigned offset_x_;
+    unsigned offset_y_;
+};
+
+/*
+ * Pattern images and their prepared fill and line patterns, built on first
+ * use and reused for every feature drawn by the same renderer.
+ */
+class agg_pattern_cache : private boost::noncopyable
+{
+public:
+    typedef agg::line_image_pattern<agg::pattern_filter_bilinear_rgba8> line_pattern_type;
+
+    boost::optional<image_ptr> find_image(std::string const& filename)
+    {
+        return lookup(filename).image;
+    }
+
+    expanded_pattern const* find_polygon_pattern(std::string const& filename)
+    {
+        entry & e = lookup(filename);
+        if (!e.image) return 0;
+        if (!e.polygon)
+        {
+            e.polygon.reset(new expanded_pattern(**e.image));
+        }
+        return e.polygon.get();
+    }
+
+    line_pattern_type const* find_line_pattern(std::string const& filename)
+    {
+        entry & e = lookup(filename);
+        if (!e.image) return 0;
+        if (!e.line)
+        {
+            pattern_source source(**e.image);
+            e.line.reset(new line_pattern_type(filter_, source));
+        }
+        return e.line.get();
+    }
+
+private:
+    struct entry
+    {
+        boost::optional<image_ptr> image;
+        boost::shared_ptr<expanded_pattern> polygon;
+        boost::shared_ptr<line_pattern_type> line;
+    };
+
+    entry & lookup(std::string const& filename)
+    {
+        std::map<std::string,entry>::iterator itr = entries_.find(filename);
+        if (itr != entries_.end()) return itr->second;
+        entry & e = entries_[filename];
+        boost::optional<marker_ptr> mark = marker_cache::instance()->find(filename, true);
+        if (mark && (*mark)->is_bitmap())
+        {
+            boost::optional<image_ptr> pat = (*mark)->get_bitmap_data();
+            if (pat && (*pat)->width() > 0 && (*pat)->height() > 0)
+            {
+                e.image = pat;
+            }
+        }
+        return e;
+    }
+
+    agg::pattern_filter_bilinear_rgba8 filter_;
+    std::map<std::string,entry> entries_;
+};
+
+}
+
+#endif //MAPNIK_AGG_PATTERN_CACHE_HPP
@@ -54,6 +54,7 @@ namespace mapnik {
 class marker;
    
 struct rasterizer;
+class agg_pattern_cache;
    
 template <typename T>
 class MAPNIK_DECL agg_renderer : public feature_style_processor<agg_renderer<T> >,
@@ -124,6 +125,7 @@ private:
     face_manager<freetype_engine> font_manager_;
     label_collision_detector4 detector_;
     boost::scoped_ptr<rasterizer> ras_ptr;
+    boost::scoped_ptr<agg_pattern_cache> pattern_cache_;
 };
 }
 
@@ -76,10 +76,35 @@ private:
     cairo_face_cache cache_;
 };
 
+// Font engine, FreeType faces and the Cairo faces created from them.
+// Passing the same cache to successive renderers avoids reloading fonts
+// and rebuilding Cairo faces for every map; a cache may be shared by
+// any number of renders, but only by one at a time.
+class MAPNIK_DECL cairo_font_cache : private boost::noncopyable
+{
+public:
+    cairo_font_cache();
+    face_manager<freetype_engine> & get_font_manager()
+    {
+        return font_manager_;
+    }
+    cairo_face_manager & get_face_manager()
+    {
+        return face_manager_;
+    }
+
+private:
+    boost::shared_ptr<freetype_engine> font_engine_;
+    face_manager<freetype_engine> font_manager_;
+    cairo_face_manager face_manager_;
+};
+
+typedef boost::shared_ptr<cairo_font_cache> cairo_font_cache_ptr;
+
 class MAPNIK_DECL cairo_renderer_base : private boost::noncopyable
 {
 protected:
-    cairo_renderer_base(Map const& m, Cairo::RefPtr<Cairo::Context> const& context, unsigned offset_x=0, unsigned offset_y=0);
+    cairo_renderer_base(Map const& m, Cairo::RefPtr<Cairo::Context> const& context, cairo_font_cache_ptr const& font_cache, unsigned offset_x=0, unsigned offset_y=0);
 public:
     ~cairo_renderer_base();
     void start_map_processing(Map const& map);
@@ -136,9 +161,9 @@ protected:
     Map const& m_;
     Cairo::RefPtr<Cairo::Context> context_;
     CoordTransform t_;
-    boost::shared_ptr<freetype_engine> font_engine_;
-    face_manager<freetype_engine> font_manager_;
-    cairo_face_manager face_manager_;
+    cairo_font_cache_ptr font_cache_;
+    face_manager<freetype_engine> & font_manager_;
+    cairo_face_manager & face_manager_;
     label_collision_detector4 detector_;
 };
 
@@ -148,6 +173,7 @@ class MAPNIK_DECL cairo_renderer : public feature_style_processor<cairo_renderer
 {
 public:
     cairo_renderer(Map const& m, Cairo::RefPtr<T> const& surface, unsigned offset_x=0, unsigned offset_y=0);
+    cairo_renderer(Map const& m, Cairo::RefPtr<T> const& surface, cairo_font_cache_ptr const& font_cache, unsigned offset_x=0, unsigned offset_y=0);
     void end_map_processing(Map const& map);
 };
 }
@@ -26,6 +26,7 @@
 #define CTRANS_HPP
 
 #include <algorithm>
+#include <cmath>
 
 #include <mapnik/box2d.hpp>
 #include <mapnik/vertex.hpp>
@@ -58,6 +59,83 @@ private:
     Geometry& geom_;
 };
 
+// Up to size vertices of a geometry, projected and transformed to screen
+// coordinates in one go. Runs are read straight out of the geometry's
+// storage and sent through proj_transform as arrays, so the transform
+// front ends below pay the projection and call overhead per run instead
+// of per vertex.
+template <typename Transform,typename Geometry>
+struct vertex_batch
+{
+    enum { size = 64 };
+
+    vertex_batch()
+        : all_ok(true),
+          count(0),
+          index(0) {}
+
+    // reads the vertices from pos on, returns how many were read
+    unsigned fill(Transform const& t,
+                  Geometry const& geom,
+                  proj_transform const& prj_trans,
+                  unsigned pos)
+    {
+        index = 0;
+        count = 0;
+        while (count < unsigned(size))
+        {
+            typename Geometry::value_type const* coords;
+            unsigned command;
+            unsigned n = geom.get_vertices(pos + count, &coords, &command);
+            if (n == 0) break;
+            n = std::min(n, unsigned(size) - count);
+            for (unsigned i = 0; i < n; ++i)
+            {
+                x[count + i] = coords[i << 1];
+                y[count + i] = coords[(i << 1) + 1];
+                cmd[count + i] = static_cast<unsigned char>(command);
+            }
+            count += n;
+        }
+        if (count == 0) return 0;
+
+        all_ok = prj_trans.equal();
+        if (!all_ok)
+        {
+            double z[size] = {0};
+            if (prj_trans.backward(x, y, z, count))
+            {
+                // proj marks the points it could not transform
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    ok[i] = x[i] != HUGE_VAL && y[i] != HUGE_VAL;
+                }
+            }
+            else
+            {
+                // the run failed as a whole, find the bad points one by one
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    geom.get_vertex(pos + i, &x[i], &y[i]);
+                    double z0 = 0;
+                    ok[i] = prj_trans.backward(x[i], y[i], z0);
+                }
+            }
+        }
+
+        t.forward(x, y, count);
+        return count;
+    }
+
+    double x[size];
+    double y[size];
+    unsigned char cmd[size];
+    bool ok[size];
+    bool all_ok;
+    unsigned count;
+    unsigned index;
+};
+
 template <typename Transform,typename Geometry>
 struct MAPNIK_DECL coord_transform2
 {
@@ -69,43 +147,27 @@ struct MAPNIK_DECL coord_transform2
                      proj_transform const& prj_trans)
         : t_(t), 
         geom_(geom), 
-        prj_trans_(prj_trans)  {}
+        prj_trans_(prj_trans),
+        pos_(0) {}
         
     unsigned vertex(double * x , double  * y) const
     {
-        unsigned command(SEG_MOVETO);
-        bool ok = false;
-        bool skipped_points = false;
-        while (!ok)
-        {
-            command = geom_.vertex(x,y);
-            double z=0;
-            ok = prj_trans_.backward(*x,*y,z);
-            if (!ok) {
-                skipped_points = true;
-            }
-            ok = ok || (command == SEG_END);
-        }
-        if (skipped_points && (command == SEG_LINETO))
+        if (batch_.all_ok && batch_.index < batch_.count)
         {
-            command = SEG_MOVETO;
+            unsigned i = batch_.index++;
+            *x = batch_.x[i];
+            *y = batch_.y[i];
+            return batch_.cmd[i];
         }
-        t_.forward(x,y);
-        return command;
+        return next_vertex(x, y);
     }
-
-    /*unsigned  vertex(double * x , double  * y) const
-    {
-        unsigned command = geom_.vertex(x,y);
-        double z=0;
-        prj_trans_.backward(*x,*y,z);
-        t_.forward(x,y);
-        return command;
-    }*/
         
     void rewind (unsigned pos)
     {
         geom_.rewind(pos);
+        pos_ = pos;
+        batch_.count = 0;
+        batch_.index = 0;
     }
 
     Geometry const& geom() const
@@ -114,9 +176,38 @@ struct MAPNIK_DECL coord_transform2
     }
         
 private:
+    // refills the batch and skips over vertices that could not be projected
+    unsigned next_vertex(double * x, double * y) const
+    {
+        bool skipped_points = false;
+        for (;;)
+        {
+            if (batch_.index == batch_.count)
+            {
+                pos_ += batch_.fill(t_, geom_, prj_trans_, pos_);
+                if (batch_.count == 0) return SEG_END;
+            }
+            unsigned i = batch_.index++;
+            if (batch_.all_ok || batch_.ok[i])
+            {
+                *x = batch_.x[i];
+                *y = batch_.y[i];
+                unsigned command = batch_.cmd[i];
+                if (skipped_points && (command == SEG_LINETO))
+                {
+                    command = SEG_MOVETO;
+                }
+                return command;
+            }
+            skipped_points = true;
+        }
+    }
+
     Transform const& t_;
     Geometry const& geom_;
     proj_transform const& prj_trans_;
+    mutable unsigned pos_;
+    mutable vertex_batch<Transform,Geometry> batch_;
 };
 
     
@@ -130,22 +221,28 @@ struct MAPNIK_DECL coord_transform3
         : t_(t), 
         geom_(geom), 
         prj_trans_(prj_trans),
-        dx_(dx), dy_(dy) {}
+        dx_(dx), dy_(dy),
+        pos_(0) {}
       
     unsigned  vertex(double * x , double  * y) const
     {
-        unsigned command = geom_.vertex(x,y);
-        double z=0;
-        prj_trans_.backward(*x,*y,z);
-        t_.forward(x,y);
-        *x+=dx_;
-        *y+=dy_;
-        return command;
+        if (batch_.index == batch_.count)
+        {
+            pos_ += batch_.fill(t_, geom_, prj_trans_, pos_);
+            if (batch_.count == 0) return SEG_END;
+        }
+        unsigned i = batch_.index++;
+        *x = batch_.x[i] + dx_;
+        *y = batch_.y[i] + dy_;
+        return batch_.cmd[i];
     }
       
     void rewind (unsigned pos)
     {
         geom_.rewind(pos);
+        pos_ = pos;
+        batch_.count = 0;
+        batch_.index = 0;
     }
       
 private:
@@ -154,6 +251,8 @@ private:
     proj_transform const& prj_trans_;
     int dx_;
     int dy_;
+    mutable unsigned pos_;
+    mutable vertex_batch<Transform,Geometry> batch_;
 };
    
 class CoordTransform
@@ -201,6 +300,17 @@ public:
         *y = (extent_.maxy() - *y) * sy_ - offset_y_;
     }
         
+    inline void forward(double * x, double * y, unsigned count) const
+    {
+        double minx = extent_.minx();
+        double maxy = extent_.maxy();
+        for (unsigned i = 0; i < count; ++i)
+        {
+            x[i] = (x[i] - minx) * sx_ - offset_x_;
+            y[i] = (maxy - y[i]) * sy_ - offset_y_;
+        }
+    }
+        
     inline void backward(double * x, double * y) const
     {
         *x = extent_.minx() + (*x + offset_x_)/sx_;
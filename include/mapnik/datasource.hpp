@@ -45,6 +45,24 @@ typedef MAPNIK_DECL boost::shared_ptr<Feature> feature_ptr;
 struct MAPNIK_DECL Featureset
 {
     virtual feature_ptr next()=0;
+
+    /*!
+     * @brief Fetch up to size features at once.
+     *
+     * Fills the caller provided buffer and returns the number of features
+     * stored, 0 once the featureset is exhausted. Datasources that can
+     * fetch several rows at once may override this.
+     */
+    virtual std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        std::size_t count = 0;
+        while (count < size && (features[count] = next()))
+        {
+            ++count;
+        }
+        return count;
+    }
+
     virtual ~Featureset() {};
 };
     
@@ -105,6 +123,16 @@ public:
     virtual featureset_ptr features_at_point(coord2d const& pt) const=0;
     virtual box2d<double> envelope() const=0;
     virtual layer_descriptor get_descriptor() const=0;
+
+    /*!
+     * @brief Get a counter that changes whenever the features of the datasource change.
+     *
+     * Datasources whose data can change after they were bound (e.g. in-memory
+     * datasources) override this so that cached envelopes can be refreshed.
+     *
+     * @return The current generation of the data, 0 for static datasources.
+     */
+    virtual unsigned generation() const { return 0; }
     virtual ~datasource() {};
 protected:
     parameters params_;
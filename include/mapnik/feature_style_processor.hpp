@@ -51,6 +51,12 @@ public:
      * @return apply renderer to a single layer, providing pre-populated set of query attribute names.
      */
     void apply(mapnik::layer const& lyr, std::set<std::string>& names);
+
+    /*!
+     * @return add query attribute names a processor needs for a layer on top of those its styles reference.
+     * Processors that need extra attributes hide this with their own version.
+     */
+    void collect_layer_attributes(mapnik::layer const& /*lyr*/, std::set<std::string>& /*names*/) {}
 private:
     /*!
      * @return initialize metawriters for a given map and projection.
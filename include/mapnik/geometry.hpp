@@ -27,6 +27,7 @@
 
 // mapnik
 #include <mapnik/vertex_vector.hpp>
+#include <mapnik/vertex_array.hpp>
 #include <mapnik/ctrans.hpp>
 #include <mapnik/geom_util.hpp>
 // boost
@@ -46,7 +47,7 @@ enum eGeomType {
 };
 
 
-template <typename T, template <typename> class Container=vertex_vector>
+template <typename T, template <typename> class Container=vertex_array>
 class geometry
 {
 public:
@@ -92,21 +93,30 @@ public:
     box2d<double> envelope() const
     {
         box2d<double> result;
-        double x(0);
-        double y(0);
-        rewind(0);
-        for (unsigned i=0;i<num_points();++i)
+        value_type const* coords;
+        unsigned command;
+        unsigned pos = 0;
+        unsigned count = cont_.get_vertices(pos, &coords, &command);
+        if (count == 0) return result;
+        double minx = coords[0];
+        double miny = coords[1];
+        double maxx = minx;
+        double maxy = miny;
+        while (count > 0)
         {
-            vertex(&x,&y);
-            if (i==0)
+            for (unsigned i = 0; i < count; ++i)
             {
-                result.init(x,y,x,y);
-            }
-            else
-            {
-                result.expand_to_include(x,y);
+                double x = coords[i << 1];
+                double y = coords[(i << 1) + 1];
+                if (x < minx) minx = x;
+                else if (x > maxx) maxx = x;
+                if (y < miny) miny = y;
+                else if (y > maxy) maxy = y;
             }
+            pos += count;
+            count = cont_.get_vertices(pos, &coords, &command);
         }
+        result.init(minx,miny,maxx,maxy);
         return result;
     }
 
@@ -359,6 +369,14 @@ public:
         return cont_.get_vertex(pos, x, y);
     }         
 
+    // Contiguous run of vertices from pos sharing one command, see
+    // vertex_array::get_vertices. Walking a geometry run by run avoids
+    // the per vertex call and command lookup of vertex()/get_vertex().
+    unsigned get_vertices(unsigned pos, value_type const** coords, unsigned* command) const
+    {
+        return cont_.get_vertices(pos, coords, command);
+    }
+
     void rewind(unsigned ) const
     {
         itr_=0;
@@ -406,7 +424,7 @@ public:
     }
 };
    
-typedef geometry<vertex2d,vertex_vector> geometry_type; 
+typedef geometry<vertex2d,vertex_array> geometry_type; 
 typedef boost::shared_ptr<geometry_type> geometry_ptr;
 typedef boost::ptr_vector<geometry_type> geometry_containter;
 
@@ -32,6 +32,7 @@
 #include <mapnik/box2d.hpp>
 #include <mapnik/image_view.hpp>
 #include <mapnik/global.hpp>
+#include <mapnik/image_blend_sse2.hpp>
 
 // stl
 #include <cmath>
@@ -45,10 +46,33 @@
 
 // boost
 #include <boost/optional/optional.hpp>
+#include <boost/cstdint.hpp>
 
 namespace mapnik
 {
 
+// Reciprocals for dividing by 1..255 with a multiply and a shift. The
+// result equals integer division for dividends below 2^24, which covers
+// every quotient taken by the blending loops below.
+extern MAPNIK_DECL boost::uint64_t blend_reciprocals[256];
+
+inline unsigned blend_div(unsigned n, unsigned d)
+{
+    // out of range operands only come from opacities above 1
+    if (d > 255 || n >= (1u << 24)) return n / d;
+    return unsigned((n * blend_reciprocals[d]) >> 32);
+}
+
+// source alpha scaled by opacity, computed once per blit
+// instead of with a float multiply per pixel
+inline void blend_opacity_table(float opacity, unsigned table[256])
+{
+    for (unsigned i = 0; i < 256; ++i)
+    {
+        table[i] = int(i * opacity);
+    }
+}
+
 struct Multiply
 {
     inline static void mergeRGB(unsigned const &r0, unsigned const &g0, unsigned const &b0,
@@ -58,6 +82,15 @@ struct Multiply
         g1 = g1*g0/255;
         b1 = b1*b0/255;
     }
+#ifdef MAPNIK_SSE2
+    inline static void mergeRGB(__m128i r0, __m128i g0, __m128i b0,
+                                __m128i &r1, __m128i &g1, __m128i &b1)
+    {
+        r1 = sse2::div255(sse2::mul(r1, r0));
+        g1 = sse2::div255(sse2::mul(g1, g0));
+        b1 = sse2::div255(sse2::mul(b1, b0));
+    }
+#endif
 };
 struct Multiply2
 {
@@ -71,6 +104,15 @@ struct Multiply2
         b1 = b1*b0/128;
         if (b1>255) b1=255;
     }
+#ifdef MAPNIK_SSE2
+    inline static void mergeRGB(__m128i r0, __m128i g0, __m128i b0,
+                                __m128i &r1, __m128i &g1, __m128i &b1)
+    {
+        r1 = sse2::min255(_mm_srli_epi32(sse2::mul(r1, r0), 7));
+        g1 = sse2::min255(_mm_srli_epi32(sse2::mul(g1, g0), 7));
+        b1 = sse2::min255(_mm_srli_epi32(sse2::mul(b1, b0), 7));
+    }
+#endif
 };
 struct Divide
 {
@@ -81,6 +123,16 @@ struct Divide
         g1 = g0*256/(g1+1);
         b1 = b0*256/(b1+1);
     }
+#ifdef MAPNIK_SSE2
+    inline static void mergeRGB(__m128i r0, __m128i g0, __m128i b0,
+                                __m128i &r1, __m128i &g1, __m128i &b1)
+    {
+        __m128i one = _mm_set1_epi32(1);
+        r1 = sse2::div(_mm_slli_epi32(r0, 8), _mm_add_epi32(r1, one));
+        g1 = sse2::div(_mm_slli_epi32(g0, 8), _mm_add_epi32(g1, one));
+        b1 = sse2::div(_mm_slli_epi32(b0, 8), _mm_add_epi32(b1, one));
+    }
+#endif
 };
 struct Divide2
 {
@@ -91,6 +143,16 @@ struct Divide2
         g1 = g0*128/(g1+1);
         b1 = b0*128/(b1+1);
     }
+#ifdef MAPNIK_SSE2
+    inline static void mergeRGB(__m128i r0, __m128i g0, __m128i b0,
+                                __m128i &r1, __m128i &g1, __m128i &b1)
+    {
+        __m128i one = _mm_set1_epi32(1);
+        r1 = sse2::div(_mm_slli_epi32(r0, 7), _mm_add_epi32(r1, one));
+        g1 = sse2::div(_mm_slli_epi32(g0, 7), _mm_add_epi32(g1, one));
+        b1 = sse2::div(_mm_slli_epi32(b0, 7), _mm_add_epi32(b1, one));
+    }
+#endif
 };
 struct Screen
 {
@@ -101,6 +163,16 @@ struct Screen
         g1 = 255 - (255-g0)*(255-g1)/255;
         b1 = 255 - (255-b0)*(255-b1)/255;
     }
+#ifdef MAPNIK_SSE2
+    inline static void mergeRGB(__m128i r0, __m128i g0, __m128i b0,
+                                __m128i &r1, __m128i &g1, __m128i &b1)
+    {
+        __m128i full = _mm_set1_epi32(255);
+        r1 = _mm_sub_epi32(full, sse2::div255(sse2::mul(_mm_sub_epi32(full, r0), _mm_sub_epi32(full, r1))));
+        g1 = _mm_sub_epi32(full, sse2::div255(sse2::mul(_mm_sub_epi32(full, g0), _mm_sub_epi32(full, g1))));
+        b1 = _mm_sub_epi32(full, sse2::div255(sse2::mul(_mm_sub_epi32(full, b0), _mm_sub_epi32(full, b1))));
+    }
+#endif
 };
 struct HardLight
 {
@@ -111,6 +183,24 @@ struct HardLight
         g1 = (g1>128)?255-(255-g0)*(255-2*(g1-128))/256:g0*g1*2/256;
         b1 = (b1>128)?255-(255-b0)*(255-2*(b1-128))/256:b0*b1*2/256;
     }
+#ifdef MAPNIK_SSE2
+    // c1 > 128 ? 255 - (255 - c0) * (511 - 2 * c1) / 256 : c0 * c1 * 2 / 256
+    inline static __m128i channel(__m128i c0, __m128i c1)
+    {
+        __m128i full = _mm_set1_epi32(255);
+        __m128i light = _mm_sub_epi32(full, _mm_srli_epi32(sse2::mul(_mm_sub_epi32(full, c0),
+            _mm_sub_epi32(_mm_set1_epi32(511), _mm_slli_epi32(c1, 1))), 8));
+        __m128i dark = _mm_srli_epi32(sse2::mul(c0, _mm_slli_epi32(c1, 1)), 8);
+        return sse2::select(_mm_cmpgt_epi32(c1, _mm_set1_epi32(128)), light, dark);
+    }
+    inline static void mergeRGB(__m128i r0, __m128i g0, __m128i b0,
+                                __m128i &r1, __m128i &g1, __m128i &b1)
+    {
+        r1 = channel(r0, r1);
+        g1 = channel(g0, g1);
+        b1 = channel(b0, b1);
+    }
+#endif
 };
 struct MergeGrain
 {
@@ -124,6 +214,21 @@ struct MergeGrain
         b1 = (b1+b0>128)?b1+b0-128:0;
         if (b1>255) b1=255;
     }
+#ifdef MAPNIK_SSE2
+    // sum > 128 ? min(sum - 128, 255) : 0
+    inline static __m128i channel(__m128i sum, int offset = 128)
+    {
+        __m128i o = _mm_set1_epi32(offset);
+        return sse2::min255(_mm_and_si128(_mm_cmpgt_epi32(sum, o), _mm_sub_epi32(sum, o)));
+    }
+    inline static void mergeRGB(__m128i r0, __m128i g0, __m128i b0,
+                                __m128i &r1, __m128i &g1, __m128i &b1)
+    {
+        r1 = channel(_mm_add_epi32(r1, r0));
+        g1 = channel(_mm_add_epi32(g1, g0));
+        b1 = channel(_mm_add_epi32(b1, b0));
+    }
+#endif
 };
 struct MergeGrain2
 {
@@ -137,6 +242,15 @@ struct MergeGrain2
         b1 = (2*b1+b0>256)?2*b1+b0-256:0;
         if (b1>255) b1=255;
     }
+#ifdef MAPNIK_SSE2
+    inline static void mergeRGB(__m128i r0, __m128i g0, __m128i b0,
+                                __m128i &r1, __m128i &g1, __m128i &b1)
+    {
+        r1 = MergeGrain::channel(_mm_add_epi32(_mm_slli_epi32(r1, 1), r0), 256);
+        g1 = MergeGrain::channel(_mm_add_epi32(_mm_slli_epi32(g1, 1), g0), 256);
+        b1 = MergeGrain::channel(_mm_add_epi32(_mm_slli_epi32(b1, 1), b0), 256);
+    }
+#endif
 };
 
 class MAPNIK_DECL image_32
@@ -319,7 +433,11 @@ public:
             {
                 unsigned int* row_to =  data_.getRow(y);
                 unsigned int const * row_from = data.getRow(y-y0);
-                for (int x = box.minx(); x < box.maxx(); ++x)
+                int x = box.minx();
+#ifdef MAPNIK_SSE2
+                x += sse2::blend_alpha(row_to + x, row_from + x - x0, box.maxx() - x);
+#endif
+                for (; x < box.maxx(); ++x)
                 {
                     unsigned rgba0 = row_to[x];
                     unsigned rgba1 = row_from[x-x0];
@@ -386,16 +504,28 @@ public:
         if (ext0.intersects(ext1))
         {
             box2d<int> box = ext0.intersect(ext1);
+            unsigned alpha[256];
+            blend_opacity_table(opacity, alpha);
+#ifdef MAPNIK_SSE2
+            // the kernels take source alphas up to 255 and skip
+            // the table for an opacity of 1
+            bool sse2_blend = alpha[255] <= 255;
+            unsigned const* sse2_table = (opacity == 1.0f) ? 0 : alpha;
+#endif
             for (int y = box.miny(); y < box.maxy(); ++y)
             {
                 unsigned int* row_to =  data_.getRow(y);
                 unsigned int const * row_from = data.getRow(y-y0);
-                for (int x = box.minx(); x < box.maxx(); ++x)
+                int x = box.minx();
+#ifdef MAPNIK_SSE2
+                if (sse2_blend) x += sse2::blend_alpha2(row_to + x, row_from + x - x0, box.maxx() - x, sse2_table);
+#endif
+                for (; x < box.maxx(); ++x)
                 {
                     unsigned rgba0 = row_to[x];
                     unsigned rgba1 = row_from[x-x0];
 #ifdef MAPNIK_BIG_ENDIAN
-                    unsigned a1 = int( (rgba1 & 0xff) * opacity );
+                    unsigned a1 = alpha[rgba1 & 0xff];
                     if (a1 == 0) continue;
                     if (a1 == 0xff)
                     {
@@ -414,15 +544,15 @@ public:
                     unsigned atmp = a1 + a0 - ((a1 * a0 + 255) >> 8);
                     if (atmp)
                     {
-                        r0 = byte((r1 * a1 + (r0 * a0) - ((r0 * a0 * a1 + 255) >> 8)) / atmp);
-                        g0 = byte((g1 * a1 + (g0 * a0) - ((g0 * a0 * a1 + 255) >> 8)) / atmp);
-                        b0 = byte((b1 * a1 + (b0 * a0) - ((b0 * a0 * a1 + 255) >> 8)) / atmp);
+                        r0 = byte(blend_div(r1 * a1 + (r0 * a0) - ((r0 * a0 * a1 + 255) >> 8), atmp));
+                        g0 = byte(blend_div(g1 * a1 + (g0 * a0) - ((g0 * a0 * a1 + 255) >> 8), atmp));
+                        b0 = byte(blend_div(b1 * a1 + (b0 * a0) - ((b0 * a0 * a1 + 255) >> 8), atmp));
                     }
                     a0 = byte(atmp);
 
                     row_to[x] = (a0)| (b0 << 8) |  (g0 << 16) | (r0 << 24) ;
 #else
-                    unsigned a1 = int( ((rgba1 >> 24) & 0xff) * opacity );
+                    unsigned a1 = alpha[(rgba1 >> 24) & 0xff];
                     if (a1 == 0) continue;
                     if (a1 == 0xff)
                     {
@@ -441,9 +571,9 @@ public:
                     unsigned atmp = a1 + a0 - ((a1 * a0 + 255) >> 8);
                     if (atmp)
                     {
-                        r0 = byte((r1 * a1 + (r0 * a0) - ((r0 * a0 * a1 + 255) >> 8)) / atmp);
-                        g0 = byte((g1 * a1 + (g0 * a0) - ((g0 * a0 * a1 + 255) >> 8)) / atmp);
-                        b0 = byte((b1 * a1 + (b0 * a0) - ((b0 * a0 * a1 + 255) >> 8)) / atmp);
+                        r0 = byte(blend_div(r1 * a1 + (r0 * a0) - ((r0 * a0 * a1 + 255) >> 8), atmp));
+                        g0 = byte(blend_div(g1 * a1 + (g0 * a0) - ((g0 * a0 * a1 + 255) >> 8), atmp));
+                        b0 = byte(blend_div(b1 * a1 + (b0 * a0) - ((b0 * a0 * a1 + 255) >> 8), atmp));
                     }
                     a0 = byte(atmp);
                     
@@ -463,16 +593,28 @@ public:
         if (ext0.intersects(ext1))
         {
             box2d<int> box = ext0.intersect(ext1);
+            unsigned alpha[256];
+            blend_opacity_table(opacity, alpha);
+#ifdef MAPNIK_SSE2
+            // the kernels take source alphas up to 255 and skip
+            // the table for an opacity of 1
+            bool sse2_blend = alpha[255] <= 255;
+            unsigned const* sse2_table = (opacity == 1.0f) ? 0 : alpha;
+#endif
             for (int y = box.miny(); y < box.maxy(); ++y)
             {
                 unsigned int* row_to =  data_.getRow(y);
                 unsigned int const * row_from = data.getRow(y-y0);
-                for (int x = box.minx(); x < box.maxx(); ++x)
+                int x = box.minx();
+#ifdef MAPNIK_SSE2
+                if (sse2_blend) x += sse2::merge<MergeMethod>(row_to + x, row_from + x - x0, box.maxx() - x, sse2_table);
+#endif
+                for (; x < box.maxx(); ++x)
                 {
                     unsigned rgba0 = row_to[x];
                     unsigned rgba1 = row_from[x-x0];
 #ifdef MAPNIK_BIG_ENDIAN
-                    unsigned a1 = int( (rgba1 & 0xff) * opacity );
+                    unsigned a1 = alpha[rgba1 & 0xff];
                     if (a1 == 0) continue;
                     unsigned r1 = (rgba1 >> 24)& 0xff;
                     unsigned g1 = (rgba1 >> 16 ) & 0xff;
@@ -487,13 +629,13 @@ public:
 
                     MergeMethod::mergeRGB(r0,g0,b0,r1,g1,b1);
 
-                    r0 = (r1*a1 + (((255 - a1) * a0 + 127)/255) * r0 + 127)/a;
-                    g0 = (g1*a1 + (((255 - a1) * a0 + 127)/255) * g0 + 127)/a;
-                    b0 = (b1*a1 + (((255 - a1) * a0 + 127)/255) * b0 + 127)/a;
+                    r0 = blend_div(r1*a1 + (((255 - a1) * a0 + 127)/255) * r0 + 127, a);
+                    g0 = blend_div(g1*a1 + (((255 - a1) * a0 + 127)/255) * g0 + 127, a);
+                    b0 = blend_div(b1*a1 + (((255 - a1) * a0 + 127)/255) * b0 + 127, a);
 
                     row_to[x] = (a)| (b0 << 8) |  (g0 << 16) | (r0 << 24) ;
 #else
-                    unsigned a1 = int( ((rgba1 >> 24) & 0xff) * opacity );
+                    unsigned a1 = alpha[(rgba1 >> 24) & 0xff];
                     if (a1 == 0) continue;
                     unsigned r1 = rgba1 & 0xff;
                     unsigned g1 = (rgba1 >> 8 ) & 0xff;
@@ -508,9 +650,9 @@ public:
 
                     MergeMethod::mergeRGB(r0,g0,b0,r1,g1,b1);
 
-                    r0 = (r1*a1 + (((255 - a1) * a0 + 127)/255) * r0 + 127)/a;
-                    g0 = (g1*a1 + (((255 - a1) * a0 + 127)/255) * g0 + 127)/a;
-                    b0 = (b1*a1 + (((255 - a1) * a0 + 127)/255) * b0 + 127)/a;
+                    r0 = blend_div(r1*a1 + (((255 - a1) * a0 + 127)/255) * r0 + 127, a);
+                    g0 = blend_div(g1*a1 + (((255 - a1) * a0 + 127)/255) * g0 + 127, a);
+                    b0 = blend_div(b1*a1 + (((255 - a1) * a0 + 127)/255) * b0 + 127, a);
 
                     row_to[x] = (a << 24)| (b0 << 16) |  (g0 << 8) | (r0) ;
 #endif
@@ -107,9 +107,14 @@ public:
 
     void add_feature(mapnik::Feature const& feature)
     {
+        // features are added once per symbolizer but the
+        // key and attributes only need to be captured once
+        if (f_keys_.find(feature.id()) != f_keys_.end())
+        {
+            return;
+        }
 
-        // copies feature props
-        std::map<std::string,value> fprops = feature.props();
+        std::map<std::string,value> const& props = feature.props();
         lookup_type lookup_value;
         if (key_ == id_name_)
         {
@@ -117,14 +122,11 @@ public:
             std::stringstream s;
             s << feature.id();
             lookup_value = s.str();
-            // add this as a proper feature so filtering works later on
-            fprops[id_name_] = feature.id();
-            //fprops[id_name_] = tr_->transcode(lookup_value));
         }
         else
         {
-            std::map<std::string,value>::const_iterator const& itr = fprops.find(key_);
-            if (itr != fprops.end())
+            std::map<std::string,value>::const_iterator const& itr = props.find(key_);
+            if (itr != props.end())
             {
                 lookup_value = itr->second.to_string();
             }
@@ -140,10 +142,28 @@ public:
             // TODO - consider shortcutting f_keys if feature_id == lookup_value
             // create a mapping between the pixel id and the feature key
             f_keys_.insert(std::make_pair(feature.id(),lookup_value));
-            // if extra fields have been supplied, push them into grid memory
-            if (!names_.empty()) {
+            // if extra fields have been supplied, push only those into grid memory
+            if (!names_.empty() && features_.find(lookup_value) == features_.end())
+            {
                 // TODO - add ability to push WKT/WKB of geometry into grid storage
-                features_.insert(std::make_pair(lookup_value,fprops));
+                feature_properties_type & fprops = features_[lookup_value];
+                std::set<std::string>::const_iterator name = names_.begin();
+                std::set<std::string>::const_iterator end = names_.end();
+                for (; name != end; ++name)
+                {
+                    if (key_ == id_name_ && *name == id_name_)
+                    {
+                        fprops[id_name_] = feature.id();
+                    }
+                    else
+                    {
+                        std::map<std::string,value>::const_iterator itr = props.find(*name);
+                        if (itr != props.end())
+                        {
+                            fprops.insert(*itr);
+                        }
+                    }
+                }
             }
         }
         else
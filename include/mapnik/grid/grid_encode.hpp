@@ -0,0 +1,284 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+//$Id$
+
+#ifndef MAPNIK_GRID_ENCODE_HPP
+#define MAPNIK_GRID_ENCODE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/value.hpp>
+
+// stl
+#include <map>
+#include <vector>
+#include <string>
+#include <ostream>
+
+namespace mapnik {
+
+/*
+ * Writes a UTF-8 string as a quoted and escaped JSON string.
+ */
+MAPNIK_DECL void write_json_string(std::ostream & out, std::string const& str);
+
+/*
+ * Writes a feature attribute as a JSON literal.
+ */
+MAPNIK_DECL void write_json_value(std::ostream & out, value const& val);
+
+/*
+ * Appends a single codepoint to a UTF-8 encoded string.
+ */
+inline void append_utf8(std::string & out, unsigned codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        out += static_cast<char>(codepoint);
+    }
+    else if (codepoint < 0x800)
+    {
+        out += static_cast<char>(0xc0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+    else if (codepoint < 0x10000)
+    {
+        out += static_cast<char>(0xe0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+    else
+    {
+        out += static_cast<char>(0xf0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+}
+
+/*
+ * Interned UTFGrid key table. Pixel ids are resolved to their feature
+ * key once and each distinct key is given a codepoint in the order it
+ * is first seen, starting at 32 (space) and skipping the codepoints
+ * that can't be encoded directly in JSON.
+ */
+template <typename T>
+class grid_key_table
+{
+public:
+    typedef typename T::value_type value_type;
+    typedef typename T::lookup_type lookup_type;
+    typedef typename T::feature_key_type feature_key_type;
+
+    explicit grid_key_table(feature_key_type const& feature_keys)
+        : feature_keys_(feature_keys),
+          codepoint_(32),
+          last_id_(0),
+          last_codepoint_(0),
+          has_last_(false) {}
+
+    inline unsigned operator() (value_type id)
+    {
+        // neighbouring pixels almost always belong to the same feature
+        if (has_last_ && id == last_id_) return last_codepoint_;
+        typename std::map<value_type,unsigned>::const_iterator itr = ids_.find(id);
+        unsigned codepoint;
+        if (itr != ids_.end())
+        {
+            codepoint = itr->second;
+        }
+        else
+        {
+            codepoint = intern(id);
+            ids_.insert(std::make_pair(id,codepoint));
+        }
+        last_id_ = id;
+        last_codepoint_ = codepoint;
+        has_last_ = true;
+        return codepoint;
+    }
+
+    std::vector<lookup_type> const& keys() const
+    {
+        return key_order_;
+    }
+
+private:
+    unsigned intern(value_type id)
+    {
+        typename feature_key_type::const_iterator feature_pos = feature_keys_.find(id);
+        if (feature_pos == feature_keys_.end())
+        {
+            // pixels burned by features that were never given a key
+            // are encoded like the background
+            feature_pos = feature_keys_.find(0);
+        }
+        lookup_type val;
+        if (feature_pos != feature_keys_.end())
+        {
+            val = feature_pos->second;
+        }
+        typename std::map<lookup_type,unsigned>::const_iterator key_pos = keys_.find(val);
+        if (key_pos != keys_.end())
+        {
+            return key_pos->second;
+        }
+        if (codepoint_ == 34) ++codepoint_;      // Skip "
+        else if (codepoint_ == 92) ++codepoint_; // Skip backslash
+        keys_.insert(std::make_pair(val,codepoint_));
+        key_order_.push_back(val);
+        return codepoint_++;
+    }
+
+    feature_key_type const& feature_keys_;
+    std::map<value_type,unsigned> ids_;
+    std::map<lookup_type,unsigned> keys_;
+    std::vector<lookup_type> key_order_;
+    unsigned codepoint_;
+    value_type last_id_;
+    unsigned last_codepoint_;
+    bool has_last_;
+};
+
+/*
+ * Returns the sampling step needed to encode a grid at `resolution`.
+ * Grids rendered at a reduced resolution are already downsampled,
+ * so only the remaining factor is applied when encoding.
+ */
+template <typename T>
+inline unsigned grid_encode_step(T const& grid, unsigned resolution)
+{
+    unsigned native = grid.get_resolution();
+    if (native == 0) native = 1;
+    if (resolution <= native) return 1;
+    return resolution / native;
+}
+
+/*
+ * Encodes the grid as rows of UTFGrid codepoints, sampling every `step`th
+ * pixel of every `step`th row. Each row is passed to `sink(row, length)`
+ * as soon as it is complete.
+ */
+template <typename T, typename Sink>
+void grid_encode_rows(T const& grid,
+                      unsigned step,
+                      grid_key_table<T> & keys,
+                      Sink & sink)
+{
+    if (step == 0) step = 1;
+    unsigned width = grid.width() / step;
+    std::vector<unsigned> line(width > 0 ? width : 1);
+    for (unsigned y = 0; y < grid.height(); y += step)
+    {
+        typename T::value_type const* row = grid.getRow(y);
+        for (unsigned i = 0, x = 0; i < width; ++i, x += step)
+        {
+            line[i] = keys(row[x]);
+        }
+        sink(&line[0], width);
+    }
+}
+
+namespace detail {
+
+struct json_row_writer
+{
+    explicit json_row_writer(std::ostream & out)
+        : out_(out),
+          first_(true) {}
+
+    void operator() (unsigned const* row, unsigned width)
+    {
+        buf_.clear();
+        if (!first_) buf_ += ',';
+        first_ = false;
+        // codepoints start at 32 and skip '"' and '\', so no escaping is needed
+        buf_ += '"';
+        for (unsigned i = 0; i < width; ++i)
+        {
+            append_utf8(buf_, row[i]);
+        }
+        buf_ += '"';
+        out_.write(buf_.data(), buf_.size());
+    }
+
+    std::ostream & out_;
+    std::string buf_;
+    bool first_;
+};
+
+}
+
+/*
+ * Streams the grid as a UTFGrid JSON document:
+ * {"grid":[...],"keys":[...],"data":{...}}
+ * Feature data is only written for keys visible in the encoded grid.
+ */
+template <typename T>
+void grid_encode_json(T const& grid,
+                      std::ostream & out,
+                      bool add_features,
+                      unsigned resolution)
+{
+    grid_key_table<T> keys(grid.get_feature_keys());
+    detail::json_row_writer writer(out);
+    out << "{\"grid\":[";
+    grid_encode_rows(grid, grid_encode_step(grid, resolution), keys, writer);
+    out << "],\"keys\":[";
+    std::vector<typename T::lookup_type> const& key_order = keys.keys();
+    for (std::size_t i = 0; i < key_order.size(); ++i)
+    {
+        if (i > 0) out << ',';
+        write_json_string(out, key_order[i]);
+    }
+    out << "],\"data\":{";
+    if (add_features)
+    {
+        typename T::feature_type const& features = grid.get_grid_features();
+        bool first = true;
+        for (std::size_t i = 0; i < key_order.size(); ++i)
+        {
+            typename T::feature_type::const_iterator feat = features.find(key_order[i]);
+            if (feat == features.end() || feat->second.empty()) continue;
+            if (!first) out << ',';
+            first = false;
+            write_json_string(out, feat->first);
+            out << ":{";
+            typename T::feature_properties_type::const_iterator itr = feat->second.begin();
+            typename T::feature_properties_type::const_iterator end = feat->second.end();
+            for (; itr != end; ++itr)
+            {
+                if (itr != feat->second.begin()) out << ',';
+                write_json_string(out, itr->first);
+                out << ':';
+                write_json_value(out, itr->second);
+            }
+            out << '}';
+        }
+    }
+    out << "}}";
+}
+
+}
+
+#endif // MAPNIK_GRID_ENCODE_HPP
@@ -0,0 +1,105 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+//$Id$
+
+#ifndef IMAGE_GRID_RENDERER_HPP
+#define IMAGE_GRID_RENDERER_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/feature_style_processor.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/grid/grid_renderer.hpp>
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/map.hpp>
+
+// boost
+#include <boost/utility.hpp>
+
+// stl
+#include <set>
+#include <string>
+
+namespace mapnik {
+
+/*!
+ * \brief Renders an image and the UTFGrid of one interactive layer in a single pass.
+ *
+ * Every layer is queried, filtered and rendered to the image once; features
+ * of the interactive layer are handed to the grid renderer at the same time
+ * instead of being queried again by a separate grid_renderer pass.
+ */
+template <typename T>
+class MAPNIK_DECL image_grid_renderer : public feature_style_processor<image_grid_renderer<T> >,
+                                        private boost::noncopyable
+{
+
+public:
+    image_grid_renderer(Map const& m, T & pixmap, grid & g, unsigned layer_idx,
+                        double scale_factor=1.0, unsigned offset_x=0, unsigned offset_y=0);
+    ~image_grid_renderer();
+    void start_map_processing(Map const& map);
+    void end_map_processing(Map const& map);
+    void start_layer_processing(layer const& lay);
+    void end_layer_processing(layer const& lay);
+    void collect_layer_attributes(layer const& lay, std::set<std::string>& names);
+
+    template <typename Symbolizer>
+    void process(Symbolizer const& sym,
+                 Feature const& feature,
+                 proj_transform const& prj_trans)
+    {
+        image_ren_.process(sym,feature,prj_trans);
+        if (grid_active_)
+        {
+            grid_ren_.process(sym,feature,prj_trans);
+        }
+    }
+
+    inline bool process(rule::symbolizers const& /*syms*/,
+                        Feature const& /*feature*/,
+                        proj_transform const& /*prj_trans*/)
+    {
+        // symbolizers are always dispatched one by one to both renderers.
+        return false;
+    };
+
+    void painted(bool painted)
+    {
+        image_ren_.painted(painted);
+        if (grid_active_)
+        {
+            grid_ren_.painted(painted);
+        }
+    }
+
+private:
+    agg_renderer<T> image_ren_;
+    grid_renderer<grid> grid_ren_;
+    grid & grid_;
+    layer const* grid_layer_;
+    bool grid_active_;
+};
+}
+
+#endif //IMAGE_GRID_RENDERER_HPP
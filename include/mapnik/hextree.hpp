@@ -116,9 +116,8 @@ class hextree : private boost::noncopyable
     std::vector<rgba> sorted_pal_;
     // index remaping of sorted_pal_ indexes to indexes of returned image palette
     std::vector<unsigned> pal_remap_;
-    // rgba hashtable for quantization
-    typedef boost::unordered_map<rgba, int, rgba::hash_func> rgba_hash_table;
-    mutable rgba_hash_table color_hashmap_;
+    // memoized nearest colour searches for quantization
+    mutable rgba_quantize_cache color_cache_;
     // gamma correction to prioritize dark colors (>1.0)
     double gamma_;
     // look up table for gamma correction
@@ -138,6 +137,7 @@ public:
           colors_(0),
           has_holes_(false),
           root_(new node()),
+          color_cache_(0),
           trans_mode_(FULL_TRANSPARENCY)
     {
         setGamma(g);
@@ -227,8 +227,7 @@ public:
         if (colors_ == 1)
             return pal_remap_[has_holes_?1:0];
 
-        rgba_hash_table::iterator it = color_hashmap_.find(c);
-        if (it == color_hashmap_.end())
+        if (!color_cache_.find(c, ind))
         {
             int dr, dg, db, da;
             int dist, newdist;
@@ -279,11 +278,9 @@ public:
                     dist = newdist;
                 }
             }
-            //put found index in hash map
-            color_hashmap_[c] = ind;
+            //put found index in cache
+            color_cache_.insert(c, ind);
         }
-        else
-            ind = it->second;
 
         return pal_remap_[ind];
     }
@@ -291,6 +288,8 @@ public:
     void create_palette(std::vector<rgba> & palette)
     {
         sorted_pal_.clear();
+        // at most one distinct colour per visible pixel is looked up
+        color_cache_.reset(root_->pixel_count);
         if (has_holes_)
         {
             max_colors_--;
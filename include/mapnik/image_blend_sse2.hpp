@@ -0,0 +1,283 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+//$Id$
+
+#ifndef IMAGE_BLEND_SSE2_HPP
+#define IMAGE_BLEND_SSE2_HPP
+
+// mapnik
+#include <mapnik/global.hpp>
+
+// SSE2 versions of the image_32 blending loops, four pixels at a time.
+// Every kernel produces exactly the bytes of the scalar loop it replaces;
+// quotients are taken in double precision, which is exact for the 32 bit
+// operands involved. A kernel returns how many pixels of the row it
+// blended and the caller finishes the rest with the scalar loop.
+#if !defined(MAPNIK_BIG_ENDIAN) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MAPNIK_SSE2
+#endif
+
+#ifdef MAPNIK_SSE2
+
+#include <emmintrin.h>
+
+namespace mapnik { namespace sse2 {
+
+// 32 bit lanes, one pixel per lane
+
+inline __m128i red(__m128i p)
+{
+    return _mm_and_si128(p, _mm_set1_epi32(0xff));
+}
+
+inline __m128i green(__m128i p)
+{
+    return _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xff));
+}
+
+inline __m128i blue(__m128i p)
+{
+    return _mm_and_si128(_mm_srli_epi32(p, 16), _mm_set1_epi32(0xff));
+}
+
+inline __m128i alpha(__m128i p)
+{
+    return _mm_srli_epi32(p, 24);
+}
+
+inline __m128i pack(__m128i r, __m128i g, __m128i b, __m128i a)
+{
+    return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                        _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+}
+
+inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+inline __m128i min255(__m128i v)
+{
+    __m128i full = _mm_set1_epi32(0xff);
+    return select(_mm_cmpgt_epi32(v, full), full, v);
+}
+
+// a * b for operands below 2^16
+inline __m128i mul(__m128i a, __m128i b)
+{
+    __m128i lo = _mm_mullo_epi16(a, b);
+    __m128i hi = _mm_mulhi_epu16(a, b);
+    return _mm_or_si128(lo, _mm_slli_epi32(hi, 16));
+}
+
+// n / d for operands below 2^31
+inline __m128i div(__m128i n, __m128i d)
+{
+    __m128d lo = _mm_div_pd(_mm_cvtepi32_pd(n), _mm_cvtepi32_pd(d));
+    __m128d hi = _mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(n, _MM_SHUFFLE(1,0,3,2))),
+                            _mm_cvtepi32_pd(_mm_shuffle_epi32(d, _MM_SHUFFLE(1,0,3,2))));
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+// n / 255 for n below 65790
+inline __m128i div255(__m128i n)
+{
+    n = _mm_add_epi32(n, _mm_set1_epi32(1));
+    return _mm_srli_epi32(_mm_add_epi32(n, _mm_srli_epi32(n, 8)), 8);
+}
+
+// source alpha, scaled through the opacity table unless it is null
+inline __m128i source_alpha(unsigned const* from, unsigned const* table)
+{
+    if (!table) return alpha(_mm_loadu_si128((__m128i const*)from));
+    return _mm_set_epi32(table[from[3] >> 24], table[from[2] >> 24],
+                         table[from[1] >> 24], table[from[0] >> 24]);
+}
+
+inline bool all(__m128i mask)
+{
+    return _mm_movemask_epi8(mask) == 0xffff;
+}
+
+// image_32::set_rectangle_alpha
+inline unsigned blend_alpha(unsigned * to, unsigned const* from, unsigned len)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const full = _mm_set1_epi32(0xff);
+    unsigned x = 0;
+    for (; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128((__m128i const*)(from + x));
+        __m128i a1 = alpha(s);
+        __m128i transparent = _mm_cmpeq_epi32(a1, zero);
+        __m128i opaque = _mm_cmpeq_epi32(a1, full);
+        if (all(transparent)) continue;
+        if (all(opaque))
+        {
+            _mm_storeu_si128((__m128i*)(to + x), s);
+            continue;
+        }
+        __m128i d = _mm_loadu_si128((__m128i const*)(to + x));
+        __m128i a0 = alpha(d);
+        // ((a1 + a0) << 8) - a0*a1, only zero in transparent lanes
+        __m128i a = _mm_sub_epi32(_mm_slli_epi32(_mm_add_epi32(a1, a0), 8), mul(a0, a1));
+        a = select(_mm_cmpeq_epi32(a, zero), _mm_set1_epi32(1), a);
+        // ((c1 << 8) - c0*a0) * a1 + (c0*a0 << 8) == (c1*a1 << 8) + c0*a0*(256 - a1)
+        __m128i a1_inv = _mm_sub_epi32(_mm_set1_epi32(256), a1);
+        __m128i r = div(_mm_add_epi32(_mm_slli_epi32(mul(red(s), a1), 8),
+                                      mul(mul(red(d), a0), a1_inv)), a);
+        __m128i g = div(_mm_add_epi32(_mm_slli_epi32(mul(green(s), a1), 8),
+                                      mul(mul(green(d), a0), a1_inv)), a);
+        __m128i b = div(_mm_add_epi32(_mm_slli_epi32(mul(blue(s), a1), 8),
+                                      mul(mul(blue(d), a0), a1_inv)), a);
+        __m128i out = pack(r, g, b, _mm_srli_epi32(a, 8));
+        out = select(opaque, s, select(transparent, d, out));
+        _mm_storeu_si128((__m128i*)(to + x), out);
+    }
+    return x;
+}
+
+// image_32::set_rectangle_alpha2, table as filled by blend_opacity_table()
+// with an opacity of at most 1, or null for an opacity of 1
+inline unsigned blend_alpha2(unsigned * to, unsigned const* from, unsigned len, unsigned const* table)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const full = _mm_set1_epi32(0xff);
+    unsigned x = 0;
+    for (; x + 4 <= len; x += 4)
+    {
+        __m128i a1 = source_alpha(from + x, table);
+        __m128i transparent = _mm_cmpeq_epi32(a1, zero);
+        if (all(transparent)) continue;
+        __m128i s = _mm_loadu_si128((__m128i const*)(from + x));
+        __m128i opaque = _mm_cmpeq_epi32(a1, full);
+        if (all(opaque))
+        {
+            _mm_storeu_si128((__m128i*)(to + x), s);
+            continue;
+        }
+        __m128i d = _mm_loadu_si128((__m128i const*)(to + x));
+        __m128i a0 = alpha(d);
+        __m128i const round = _mm_set1_epi32(255);
+        // a1 + a0 - ((a1 * a0 + 255) >> 8), only zero in transparent lanes
+        __m128i a = _mm_sub_epi32(_mm_add_epi32(a1, a0),
+                                  _mm_srli_epi32(_mm_add_epi32(mul(a1, a0), round), 8));
+        __m128i divisor = select(_mm_cmpeq_epi32(a, zero), _mm_set1_epi32(1), a);
+        // c1 * a1 + c0 * a0 - ((c0 * a0 * a1 + 255) >> 8)
+        __m128i c0 = mul(red(d), a0);
+        __m128i r = div(_mm_sub_epi32(_mm_add_epi32(mul(red(s), a1), c0),
+                                      _mm_srli_epi32(_mm_add_epi32(mul(c0, a1), round), 8)), divisor);
+        c0 = mul(green(d), a0);
+        __m128i g = div(_mm_sub_epi32(_mm_add_epi32(mul(green(s), a1), c0),
+                                      _mm_srli_epi32(_mm_add_epi32(mul(c0, a1), round), 8)), divisor);
+        c0 = mul(blue(d), a0);
+        __m128i b = div(_mm_sub_epi32(_mm_add_epi32(mul(blue(s), a1), c0),
+                                      _mm_srli_epi32(_mm_add_epi32(mul(c0, a1), round), 8)), divisor);
+        __m128i out = pack(_mm_and_si128(r, full), _mm_and_si128(g, full),
+                           _mm_and_si128(b, full), _mm_and_si128(a, full));
+        out = select(opaque, s, select(transparent, d, out));
+        _mm_storeu_si128((__m128i*)(to + x), out);
+    }
+    return x;
+}
+
+// image_32::merge_rectangle, MergeMethod needs a mergeRGB() taking __m128i
+template <typename MergeMethod>
+inline unsigned merge(unsigned * to, unsigned const* from, unsigned len, unsigned const* table)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const full = _mm_set1_epi32(0xff);
+    __m128i const round = _mm_set1_epi32(127);
+    unsigned x = 0;
+    for (; x + 4 <= len; x += 4)
+    {
+        __m128i a1 = source_alpha(from + x, table);
+        __m128i transparent = _mm_cmpeq_epi32(a1, zero);
+        if (all(transparent)) continue;
+        __m128i s = _mm_loadu_si128((__m128i const*)(from + x));
+        __m128i d = _mm_loadu_si128((__m128i const*)(to + x));
+        __m128i a0 = alpha(d);
+        // (255 - a1) * a0 + 127
+        __m128i da = _mm_add_epi32(mul(_mm_sub_epi32(full, a1), a0), round);
+        // (a1 * 255 + (255 - a1) * a0 + 127) / 255, only zero in transparent lanes
+        __m128i a = div255(_mm_add_epi32(mul(a1, full), da));
+        __m128i divisor = select(_mm_cmpeq_epi32(a, zero), _mm_set1_epi32(1), a);
+        da = div255(da);
+
+        __m128i r0 = red(d);
+        __m128i g0 = green(d);
+        __m128i b0 = blue(d);
+        __m128i r1 = red(s);
+        __m128i g1 = green(s);
+        __m128i b1 = blue(s);
+        MergeMethod::mergeRGB(r0, g0, b0, r1, g1, b1);
+
+        __m128i r = div(_mm_add_epi32(_mm_add_epi32(mul(r1, a1), mul(da, r0)), round), divisor);
+        __m128i g = div(_mm_add_epi32(_mm_add_epi32(mul(g1, a1), mul(da, g0)), round), divisor);
+        __m128i b = div(_mm_add_epi32(_mm_add_epi32(mul(b1, a1), mul(da, b0)), round), divisor);
+        __m128i out = select(transparent, d, pack(r, g, b, a));
+        _mm_storeu_si128((__m128i*)(to + x), out);
+    }
+    return x;
+}
+
+// composite() with src_over, as agg::comp_op_adaptor_rgba blends it with
+// a full cover: the source is premultiplied, then
+//   Dca' = Sca + ((Dca.(255 - Sa) + 255) >> 8)
+//   Da'  = Sa + Da - ((Sa.Da + 255) >> 8)
+// Works on 16 bit lanes, one channel per lane.
+inline __m128i src_over(__m128i s, __m128i d)
+{
+    __m128i const alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    __m128i const round = _mm_set1_epi16(255);
+    __m128i sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+    __m128i da = _mm_shufflehi_epi16(_mm_shufflelo_epi16(d, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+    __m128i sca = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(s, sa), round), 8);
+    __m128i dca = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(round, sa)), round), 8);
+    __m128i a = _mm_sub_epi16(_mm_add_epi16(sa, da),
+                              _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(sa, da), round), 8));
+    return _mm_and_si128(select(alpha_lanes, a, _mm_add_epi16(sca, dca)), _mm_set1_epi16(0xff));
+}
+
+inline unsigned src_over(unsigned * to, unsigned const* from, unsigned len)
+{
+    __m128i const zero = _mm_setzero_si128();
+    unsigned x = 0;
+    for (; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128((__m128i const*)(from + x));
+        // a transparent source leaves the destination as it is
+        if (all(_mm_cmpeq_epi32(alpha(s), zero))) continue;
+        __m128i d = _mm_loadu_si128((__m128i const*)(to + x));
+        __m128i lo = src_over(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = src_over(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i*)(to + x), _mm_packus_epi16(lo, hi));
+    }
+    return x;
+}
+
+}}
+
+#endif // MAPNIK_SSE2
+
+#endif // IMAGE_BLEND_SSE2_HPP
@@ -25,6 +25,9 @@
 #ifndef IMAGE_COMPOSITING_HPP
 #define IMAGE_COMPOSITING_HPP
 
+// mapnik
+#include <mapnik/image_blend_sse2.hpp>
+
 // agg
 #include "agg_rendering_buffer.h"
 #include "agg_rasterizer_scanline_aa.h"
@@ -32,6 +35,9 @@
 #include "agg_renderer_scanline.h"
 #include "agg_pixfmt_rgba.h"
 
+// stl
+#include <algorithm>
+
 namespace mapnik
 {
 
@@ -178,6 +184,20 @@ void composite(T1 & im, T2 & im2, composite_mode_e mode)
         break;
     
     }
+#ifdef MAPNIK_SSE2
+    if (mode == src_over)
+    {
+        // four pixels at a time, agg blends the rest of each row
+        unsigned width = std::min(im.width(), im2.width());
+        unsigned height = std::min(im.height(), im2.height());
+        for (unsigned y = 0; y < height; ++y)
+        {
+            unsigned x = sse2::src_over(im.getRow(y), im2.getRow(y), width);
+            if (x < width) pixf.blend_from(pixf_mask, x, y, x, y, width - x, 255);
+        }
+        return;
+    }
+#endif
     renderer_type ren(pixf);
     agg::renderer_base<pixfmt_type> rb(pixf);
     rb.blend_from(pixf_mask,0,0,0,255);
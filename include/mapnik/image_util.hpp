@@ -33,9 +33,11 @@
 // boost
 #include <boost/algorithm/string.hpp>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 
 // stl
 #include <string>
+#include <iosfwd>
 
 namespace mapnik {
 
@@ -57,9 +59,19 @@ public:
 };
 
 #if defined(HAVE_CAIRO)
+class cairo_font_cache;
+
+// type is one of "pdf", "svg", "ps", "ARGB32" or "RGB24" (written as png);
+// pass a font cache to reuse loaded fonts across calls
 MAPNIK_DECL void save_to_cairo_file(mapnik::Map const& map,
                                     std::string const& filename,
-                                    std::string const& type);
+                                    std::string const& type,
+                                    boost::shared_ptr<cairo_font_cache> const& font_cache = boost::shared_ptr<cairo_font_cache>());
+
+MAPNIK_DECL void save_to_cairo_stream(mapnik::Map const& map,
+                                      std::ostream & stream,
+                                      std::string const& type,
+                                      boost::shared_ptr<cairo_font_cache> const& font_cache = boost::shared_ptr<cairo_font_cache>());
 #endif
 
 template <typename T>
@@ -205,7 +217,7 @@ enum scaling_method_e
     SCALING_BLACKMAN=16
 };
 
-scaling_method_e get_scaling_method_by_name (std::string name);
+MAPNIK_DECL scaling_method_e get_scaling_method_by_name (std::string name);
 
 template <typename Image>
 void scale_image_agg (Image& target,const Image& source, scaling_method_e scaling_method, double scale_factor, double x_off_f=0, double y_off_f=0, double filter_radius=2, double ratio=1);
@@ -27,6 +27,9 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/datasource.hpp>
 
+// boost
+#include <boost/shared_ptr.hpp>
+
 // stl
 #include <vector>
 
@@ -194,11 +197,35 @@ public:
         
     /*!
      * @return the geographic envelope/bounding box of the data in the layer.
+     *
+     * The envelope is asked from the datasource once and kept until the
+     * datasource or srs of the layer changes, the datasource reports new
+     * data through datasource::generation() or reset_envelope() is called.
      */
     box2d<double> envelope() const;
+
+    /*!
+     * @brief Get the envelope reprojected into another srs.
+     *
+     * The result is cached per srs along with the envelope.
+     *
+     * @param srs The Proj.4 srs to reproject into, usually the map srs.
+     * @param ext Set to the reprojected envelope.
+     *
+     * @return false if the envelope could not be reprojected.
+     */
+    bool envelope(std::string const& srs, box2d<double> & ext) const;
+
+    /*!
+     * @brief Drop the cached envelopes, e.g. after the data of a
+     *        datasource that does not report its generation was changed.
+     */
+    void reset_envelope();
         
     ~layer();
 private:
+    struct envelope_cache;
+
     void swap(const layer& other);
 
     std::string name_;
@@ -214,6 +241,8 @@ private:
     bool cache_features_;
     std::vector<std::string>  styles_;
     datasource_ptr ds_;
+    // shared by copies of the layer until they change ds or srs
+    boost::shared_ptr<envelope_cache> envelope_cache_;
 };
 }
 
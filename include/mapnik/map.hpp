@@ -35,9 +35,11 @@
 #include <mapnik/layer.hpp>
 #include <mapnik/metawriter.hpp>
 #include <mapnik/params.hpp>
+#include <mapnik/point_query.hpp>
 
 // boost
 #include <boost/optional/optional.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace mapnik
 {
@@ -76,9 +78,17 @@ private:
     int buffer_size_;
     boost::optional<color> background_;
     boost::optional<std::string> background_image_;
-    std::map<std::string,feature_type_style> styles_;
-    std::map<std::string,metawriter_ptr> metawriters_;
-    std::map<std::string,font_set> fontsets_;
+    // styles, metawriters and fontsets are shared copy-on-write between
+    // copies of a Map, so that per-thread copies only duplicate the
+    // per-request state (size, extent, buffer)
+    boost::shared_ptr<std::map<std::string,feature_type_style> > styles_;
+    boost::shared_ptr<std::map<std::string,metawriter_ptr> > metawriters_;
+    boost::shared_ptr<std::map<std::string,font_set> > fontsets_;
+    // set once a non-const reference into styles_ or fontsets_ has been
+    // handed out; copies then get their own table, since writes through
+    // that reference would otherwise reach them
+    bool styles_leaked_;
+    bool fontsets_leaked_;
     std::vector<layer> layers_;
     aspect_fix_mode aspectFixMode_;
     box2d<double> current_extent_;
@@ -111,6 +121,11 @@ public:
     Map(int width, int height, std::string const& srs="+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs");
 
     /*! \brief Copy Constructur.
+     *
+     *  Styles, fontsets and metawriters are shared with rhs until
+     *  either map modifies them (copy-on-write), so copying a loaded
+     *  map for each rendering thread is cheap. Datasources are always
+     *  shared between the copies.
      *
      *  @param rhs Map to copy from.
      */
@@ -124,11 +139,17 @@ public:
     Map& operator=(const Map& rhs);
         
     /*! \brief Get all styles
+     *
+     *  The reference is only valid until the styles of this map are
+     *  next modified, which may move them to a table of their own.
      * @return Const reference to styles
      */
     std::map<std::string,feature_type_style> const& styles() const; 
         
     /*! \brief Get all styles 
+     *
+     *  Detaches the styles from any map copies sharing them. Maps
+     *  copied from this one afterwards get their own copy of the styles.
      * @return Non-constant reference to styles
      */
     std::map<std::string,feature_type_style> & styles();
@@ -167,6 +188,9 @@ public:
     void remove_style(const std::string& name);
 
     /*! \brief Find a style.
+     *
+     *  The style is only valid until the styles of this map are
+     *  next modified.
      *  @param name The name of the style.
      *  @return The style if found. If not found return the default map style.
      */
@@ -226,6 +250,9 @@ public:
     std::map<std::string,font_set> const& fontsets() const;
 
     /*! \brief Get all fontsets
+     *
+     *  Detaches the fontsets from any map copies sharing them. Maps
+     *  copied from this one afterwards get their own copy of the fontsets.
      * @return Non-constant reference to fontsets
      */
     std::map<std::string,font_set> & fontsets();
@@ -266,7 +293,7 @@ public:
      */
     std::vector<layer> & layers();
 
-    /*! \brief Remove all layers and styles from the map.
+    /*! \brief Remove all layers, styles, metawriters and fontsets from the map.
      */
     void remove_all();
 
@@ -416,6 +443,41 @@ public:
      */
     featureset_ptr query_map_point(unsigned index, double x, double y) const;
 
+    /*!
+     * @brief Query a Map layer (by layer index) for features at many points
+     *
+     * Groups nearby points (within the same 256 pixel cell) and issues
+     * one query per group, restricted to the requested fields and to the
+     * bounding box of the group, then hit tests each point through an
+     * in-memory spatial index over the returned features. If a cache is
+     * given, layers queried often enough are indexed once and answered
+     * from memory.
+     *
+     * @param index The index of the layer to query from.
+     * @param points The locations to query, in the coordinates of map projection.
+     * @param tolerance The hit tolerance in pixels.
+     * @param fields The attributes to return, all of them if empty.
+     * @param cache Optional cache of feature indexes for hot layers.
+     * @return One list of features per point.
+     */
+    point_query_results query_points(unsigned index,
+                                     std::vector<coord2d> const& points,
+                                     double tolerance,
+                                     std::vector<std::string> const& fields,
+                                     point_query_cache * cache = 0) const;
+
+    /*!
+     * @brief Query a Map layer (by layer index) for features at many points
+     *
+     * Same as query_points, with the locations in the coordinates of the
+     * pixmap or map surface.
+     */
+    point_query_results query_map_points(unsigned index,
+                                         std::vector<coord2d> const& points,
+                                         double tolerance,
+                                         std::vector<std::string> const& fields,
+                                         point_query_cache * cache = 0) const;
+
     /*!
      * @brief Resolve names to object references for metawriters.
      */
@@ -456,6 +518,10 @@ public:
 
 private:
     void fixAspectRatio();
+    template <typename T>
+    static T & detach(boost::shared_ptr<T> & shared);
+    template <typename T>
+    static boost::shared_ptr<T> share(boost::shared_ptr<T> const& shared, bool leaked);
 };
    
 DEFINE_ENUM(aspect_fix_mode_e,Map::aspect_fix_mode);
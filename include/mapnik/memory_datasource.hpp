@@ -27,10 +27,25 @@
 
 #include <mapnik/datasource.hpp>
 #include <mapnik/feature_layer_desc.hpp>
+#include <mapnik/quad_tree.hpp>
+// boost
+#include <boost/scoped_ptr.hpp>
+#include <boost/optional.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/mutex.hpp>
+#endif
+// stl
 #include <vector>
+#include <map>
 
 namespace mapnik {
-    
+
+// Features are kept in insertion order together with their geometry
+// envelopes, which are computed once on push() and indexed in a quad
+// tree, so queries only look at the features near the query box.
+// The index is rebuilt lazily on the next query when a feature falls
+// outside of it or after enough features have been removed. A feature
+// that is modified after being pushed has to be passed to update().
 class MAPNIK_DECL memory_datasource : public datasource
 {
     friend class memory_featureset;
@@ -38,17 +53,56 @@ public:
     memory_datasource();
     virtual ~memory_datasource();
     void push(feature_ptr feature);
+    // remove every feature with the given id, returns how many were removed
+    std::size_t remove(int id);
+    // replace the features sharing the id of feature (or push it)
+    void update(feature_ptr feature);
+    void clear();
     int type() const;
     featureset_ptr features(const query& q) const;
     featureset_ptr features_at_point(coord2d const& pt) const;
     box2d<double> envelope() const;
     layer_descriptor get_descriptor() const;
+    // bumped by push(), remove(), update() and clear()
+    unsigned generation() const;
     size_t size() const;
 private:
-    std::vector<feature_ptr> features_;
+    struct item
+    {
+        feature_ptr feature;
+        box2d<double> envelope;
+        // envelopes of the individual geometries, only kept
+        // for features with more than one geometry
+        std::vector<box2d<double> > parts;
+    };
+    typedef quad_tree<std::size_t> index_type;
+    typedef std::multimap<int,std::size_t> id_map;
+
+    void features_in_box(box2d<double> const& box, std::vector<feature_ptr> & result) const;
+    void do_push(feature_ptr const& feature);
+    std::size_t do_remove(int id);
+    void set_item(std::size_t pos, feature_ptr const& feature);
+    void update_index() const;
+    void update_extent() const;
+    void compact();
+
+    std::vector<item> items_;
+    id_map ids_;
+    // number of removed items and of index entries that no longer
+    // match their item, both dropped on the next compaction
+    std::size_t removed_;
+    std::size_t stale_;
+    unsigned generation_;
+    mutable boost::scoped_ptr<index_type> index_;
+    mutable boost::optional<box2d<double> > extent_;
+    mutable bool index_dirty_;
+    mutable bool extent_dirty_;
+#ifdef MAPNIK_THREADSAFE
+    mutable boost::mutex mutex_;
+#endif
     mapnik::layer_descriptor desc_;
-}; 
-   
+};
+
 // This class implements a simple way of displaying point-based data
 // TODO -- possible redesign, move into separate file
 //
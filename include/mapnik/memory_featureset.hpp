@@ -33,36 +33,34 @@ class memory_featureset : public Featureset, private boost::noncopyable
 {
 public:
     memory_featureset(box2d<double> const& bbox, memory_datasource const& ds)
-        : bbox_(bbox),
-          pos_(ds.features_.begin()),
-          end_(ds.features_.end())
-    {}
+    {
+        ds.features_in_box(bbox, features_);
+        pos_ = features_.begin();
+    }
     virtual ~memory_featureset() {}
-        
+
     feature_ptr next()
     {
-        while (pos_ != end_)
+        if (pos_ != features_.end())
         {
-            for  (unsigned i=0; i<(*pos_)->num_geometries();++i) {
-                geometry_type & geom = (*pos_)->get_geometry(i);
-#ifdef MAPNIK_DEBUG
-                std::clog << "bbox_=" << bbox_ << ", geom.envelope=" << geom.envelope() << "\n";
-#endif
-                if (bbox_.intersects(geom.envelope()))
-                {
-                    return *pos_++;
-                }
-            }
-            ++pos_;
+            return *pos_++;
         }
-           
         return feature_ptr();
     }
-        
+
+    std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        std::size_t count = 0;
+        while (count < size && pos_ != features_.end())
+        {
+            features[count++] = *pos_++;
+        }
+        return count;
+    }
+
 private:
-    box2d<double> bbox_;
+    std::vector<feature_ptr> features_;
     std::vector<feature_ptr>::const_iterator pos_;
-    std::vector<feature_ptr>::const_iterator end_; 
 };
 }
 
@@ -32,6 +32,7 @@
 // boost
 #include <boost/utility.hpp>
 #include <boost/unordered_map.hpp>
+#include <boost/cstdint.hpp>
 
 // stl
 #include <vector>
@@ -124,6 +125,78 @@ struct rgba
 typedef boost::unordered_map<unsigned, unsigned> rgba_hash_table;
 
 
+// Fixed size, direct mapped cache of palette indexes keyed on packed rgba
+// values, used to memoize nearest colour searches while quantizing. Unlike
+// a hash map it never allocates or rehashes, and a lookup is a multiply, a
+// shift and a single compare. Colliding colours simply evict each other.
+// The table starts small and grows while colours keep missing, up to the
+// number of colours expected and at most a slot for every pixel of a
+// 256x256 tile; smaller caches thrash on tiles with gradients.
+class rgba_quantize_cache
+{
+public:
+    enum { MIN_SLOT_BITS = 10, MAX_SLOT_BITS = 16 };
+
+    explicit rgba_quantize_cache(unsigned max_entries = 1 << MAX_SLOT_BITS)
+    {
+        reset(max_entries);
+    }
+
+    inline bool find(unsigned c, unsigned & index) const
+    {
+        boost::uint64_t entry = slots_[slot(c)];
+        // low word holds index + 1 so that an empty slot never matches
+        if ((entry >> 32) == c && (entry & 0xffffffff) != 0)
+        {
+            index = unsigned(entry & 0xffffffff) - 1;
+            return true;
+        }
+        return false;
+    }
+
+    inline void insert(unsigned c, unsigned index)
+    {
+        if (++inserts_ > slots_.size() && bits_ < max_bits_)
+        {
+            resize(std::min(bits_ + 2, max_bits_));
+        }
+        slots_[slot(c)] = (boost::uint64_t(c) << 32) | (index + 1);
+    }
+
+    void clear()
+    {
+        std::fill(slots_.begin(), slots_.end(), 0);
+        inserts_ = 0;
+    }
+
+    // empties the cache, which then grows up to the given number of colours
+    void reset(unsigned max_entries)
+    {
+        max_bits_ = MIN_SLOT_BITS;
+        while (max_bits_ < MAX_SLOT_BITS && (1u << max_bits_) < max_entries) ++max_bits_;
+        resize(MIN_SLOT_BITS);
+    }
+
+private:
+    inline unsigned slot(unsigned c) const
+    {
+        return (c * 2654435761u) >> (32 - bits_);
+    }
+
+    void resize(unsigned bits)
+    {
+        bits_ = bits;
+        slots_.assign(1 << bits, 0);
+        inserts_ = 0;
+    }
+
+    std::vector<boost::uint64_t> slots_;
+    unsigned bits_;
+    unsigned max_bits_;
+    unsigned inserts_;
+};
+
+
 class rgba_palette : private boost::noncopyable {
 public:
     enum palette_type { PALETTE_RGBA = 0, PALETTE_RGB = 1, PALETTE_ACT = 2 };
@@ -137,10 +210,10 @@ public:
     unsigned quantize(rgba const& c) const;
     inline unsigned quantize(unsigned const& c) const
     {
-        rgba_hash_table::const_iterator it = color_hashmap_.find(c);
-        if (it != color_hashmap_.end())
+        unsigned index;
+        if (cache_.find(c, index))
         {
-            return it->second;
+            return index;
         }
         else {
             return quantize(rgba(U2RED(c), U2GREEN(c), U2BLUE(c), U2ALPHA(c)));
@@ -154,7 +227,10 @@ private:
 
 private:
     std::vector<rgba> sorted_pal_;
-    mutable rgba_hash_table color_hashmap_;
+    // exact palette colours, filled once by parse()
+    rgba_hash_table color_hashmap_;
+    // nearest colour lookups, kept across images using this palette
+    mutable rgba_quantize_cache cache_;
 
     unsigned colors_;
     std::vector<rgb> rgb_pal_;
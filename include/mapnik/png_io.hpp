@@ -121,18 +121,27 @@ void reduce_8  (T const& in, image_data_8 & out, octree<rgb> trees[], unsigned l
     {
         mapnik::image_data_32::pixel_type const * row = in.getRow(y);
         mapnik::image_data_8::pixel_type  * row_out = out.getRow(y);
+        unsigned last_val = 0;
+        byte last_index = 0;
+        int last_idx = -1;
         for (unsigned x = 0; x < width; ++x)
         {
             unsigned val = row[x];
-            mapnik::rgb c(U2RED(val), U2GREEN(val), U2BLUE(val));
-            byte index = 0;
-            int idx = -1;
-            for(int j=levels-1; j>0; j--){
-                if (U2ALPHA(val)>=limits[j] && trees[j].colors()>0) {
-                    index = idx = trees[j].quantize(c);
-                    break;
+            if (x == 0 || val != last_val)
+            {
+                mapnik::rgb c(U2RED(val), U2GREEN(val), U2BLUE(val));
+                last_val = val;
+                last_index = 0;
+                last_idx = -1;
+                for(int j=levels-1; j>0; j--){
+                    if (U2ALPHA(val)>=limits[j] && trees[j].colors()>0) {
+                        last_index = last_idx = trees[j].quantize(c);
+                        break;
+                    }
                 }
             }
+            byte index = last_index;
+            int idx = last_idx;
             if (idx>=0 && idx<(int)alpha.size())
             {
                 alpha[idx]+=U2ALPHA(val);
@@ -166,19 +175,28 @@ void reduce_4 (T const& in, image_data_8 & out, octree<rgb> trees[], unsigned li
     {
         mapnik::image_data_32::pixel_type const * row = in.getRow(y);
         mapnik::image_data_8::pixel_type  * row_out = out.getRow(y);
+        unsigned last_val = 0;
+        byte last_index = 0;
+        int last_idx = -1;
 
         for (unsigned x = 0; x < width; ++x)
         {
             unsigned val = row[x];
-            mapnik::rgb c(U2RED(val), U2GREEN(val), U2BLUE(val));
-            byte index = 0;
-            int idx=-1;
-            for(int j=levels-1; j>0; j--){
-                if (U2ALPHA(val)>=limits[j] && trees[j].colors()>0) {
-                    index = idx = trees[j].quantize(c);
-                    break;
+            if (x == 0 || val != last_val)
+            {
+                mapnik::rgb c(U2RED(val), U2GREEN(val), U2BLUE(val));
+                last_val = val;
+                last_index = 0;
+                last_idx = -1;
+                for(int j=levels-1; j>0; j--){
+                    if (U2ALPHA(val)>=limits[j] && trees[j].colors()>0) {
+                        last_index = last_idx = trees[j].quantize(c);
+                        break;
+                    }
                 }
             }
+            byte index = last_index;
+            int idx = last_idx;
             if (idx>=0 && idx<(int)alpha.size())
             {
                 alpha[idx]+=U2ALPHA(val);
@@ -468,9 +486,18 @@ void save_as_png8(T1 & file, T2 const& image, T3 const & tree,
             mapnik::image_data_32::pixel_type const * row = image.getRow(y);
             mapnik::image_data_8::pixel_type  * row_out = reduced_image.getRow(y);
 
+            unsigned last_val = 0;
+            byte last_index = 0;
             for (unsigned x = 0; x < width; ++x)
             {
-                row_out[x] = tree.quantize(row[x]);
+                // tiles are mostly long runs of identical pixels
+                unsigned val = row[x];
+                if (x == 0 || val != last_val)
+                {
+                    last_val = val;
+                    last_index = tree.quantize(val);
+                }
+                row_out[x] = last_index;
             }
         }
         save_as_png(file, palette, reduced_image, width, height, 8, compression, strategy, alphaTable);
@@ -495,11 +522,18 @@ void save_as_png8(T1 & file, T2 const& image, T3 const & tree,
             mapnik::image_data_32::pixel_type const * row = image.getRow(y);
             mapnik::image_data_8::pixel_type  * row_out = reduced_image.getRow(y);
             byte index = 0;
+            unsigned last_val = 0;
+            byte last_index = 0;
 
             for (unsigned x = 0; x < width; ++x)
             {
-
-                index = tree.quantize(row[x]);
+                unsigned val = row[x];
+                if (x == 0 || val != last_val)
+                {
+                    last_val = val;
+                    last_index = tree.quantize(val);
+                }
+                index = last_index;
                 if (x%2 == 0) index = index<<4;
                 row_out[x>>1] |= index;
             }
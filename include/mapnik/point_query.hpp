@@ -0,0 +1,129 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_POINT_QUERY_HPP
+#define MAPNIK_POINT_QUERY_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/quad_tree.hpp>
+// boost
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/mutex.hpp>
+#endif
+// stl
+#include <string>
+#include <vector>
+#include <map>
+
+namespace mapnik
+{
+
+/*!
+ * @brief Features hit by a batched point query, one list per queried point.
+ */
+typedef std::vector<feature_ptr> point_query_result;
+typedef std::vector<point_query_result> point_query_results;
+
+/*!
+ * @brief In-memory spatial index over the features of a featureset.
+ *
+ * Features are kept in a quad tree keyed on their envelopes, so that
+ * each point of a batched query only hit tests the features near it.
+ */
+class MAPNIK_DECL feature_index : private boost::noncopyable
+{
+public:
+    feature_index(featureset_ptr const& fs, box2d<double> const& extent);
+
+    /*!
+     * @brief Append the features with a geometry within tol of (x,y).
+     */
+    void hit_test(double x, double y, double tol, point_query_result & result) const;
+
+    std::size_t size() const { return size_; }
+
+private:
+    struct entry
+    {
+        entry(box2d<double> const& box, feature_ptr const& feature)
+            : box(box), feature(feature) {}
+        box2d<double> box;
+        feature_ptr feature;
+    };
+    quad_tree<entry> tree_;
+    std::size_t size_;
+};
+
+typedef boost::shared_ptr<feature_index> feature_index_ptr;
+
+/*!
+ * @brief Lazily built feature indexes for frequently queried layers.
+ *
+ * Once a datasource has been point queried hot_threshold times with the
+ * same set of fields, all of its features are loaded into a feature_index
+ * which answers the following queries without touching the datasource.
+ * Indexes hold on to their features, so call invalidate() or clear()
+ * when the underlying data changes.
+ */
+class MAPNIK_DECL point_query_cache : private boost::noncopyable
+{
+public:
+    explicit point_query_cache(unsigned hot_threshold = 10);
+
+    /*!
+     * @brief Return the index for ds and fields, building it if the
+     * datasource has become hot, or a null pointer otherwise.
+     */
+    feature_index_ptr find(datasource_ptr const& ds,
+                           std::vector<std::string> const& fields);
+
+    void invalidate(datasource_ptr const& ds);
+    void clear();
+    std::size_t size() const;
+
+private:
+    struct entry
+    {
+        entry() : hits(0) {}
+        datasource_ptr ds;
+        unsigned hits;
+        feature_index_ptr index;
+    };
+    typedef std::map<std::pair<datasource const*, std::string>, entry> cache_type;
+
+    unsigned hot_threshold_;
+    cache_type cache_;
+#ifdef MAPNIK_THREADSAFE
+    mutable boost::mutex mutex_;
+#endif
+};
+
+}
+
+#endif // MAPNIK_POINT_QUERY_HPP
@@ -149,10 +149,25 @@ public:
 #endif
                 unusedPool_.push_back(*itr);
                 usedPool_.erase(itr);
-                return;
+                break;
             }
             ++itr;
         }
+        // drop idle objects gone bad (or expired) since they were returned,
+        // borrowObject() only gets to the ones in front of a good one
+        itr = unusedPool_.begin();
+        while (itr != unusedPool_.end())
+        {
+            if ((*itr)->isOK())
+            {
+                ++itr;
+                continue;
+            }
+#ifdef MAPNIK_DEBUG
+            std::clog<<"bad connection (erase)" << (*itr).get()<<"\n";
+#endif
+            itr = unusedPool_.erase(itr);
+        }
     }
          
     std::pair<unsigned,unsigned> size() const
@@ -164,5 +179,92 @@ public:
         return size;
     }
 };
+/*!
+ * @brief Idle timeout of a pooled object.
+ *
+ * Pooled objects derive from this to be dropped by the pool once they
+ * have sat unused for longer than the timeout (0 never expires): their
+ * isOK() reports false when expired(). Objects handed out by
+ * borrow_pooled() are touched when they are returned.
+ *
+ * The pool has no timer of its own, expired objects are closed the next
+ * time an object is borrowed from or returned to it.
+ */
+class pool_idle_timeout
+{
+public:
+    explicit pool_idle_timeout(unsigned idle_timeout)
+        : idle_timeout_(idle_timeout),
+          last_used_(std::time(0)) {}
+
+    bool expired() const
+    {
+        return idle_timeout_ != 0 &&
+            std::difftime(std::time(0), last_used_) >= idle_timeout_;
+    }
+
+    void touch()
+    {
+        last_used_ = std::time(0);
+    }
+
+private:
+    unsigned idle_timeout_;
+    std::time_t last_used_;
+};
+
+namespace detail {
+
+inline void touch_pooled(pool_idle_timeout * obj)
+{
+    obj->touch();
+}
+
+inline void touch_pooled(void const*) {}
+
+// deleter returning a borrowed object to its pool
+template <typename T, typename PoolT>
+class pooled_object_releaser
+{
+public:
+    pooled_object_releaser(boost::shared_ptr<PoolT> const& pool,
+                           boost::shared_ptr<T> const& obj)
+        : pool_(pool),
+          obj_(obj) {}
+
+    void operator()(T*)
+    {
+        touch_pooled(obj_.get());
+        pool_->returnObject(obj_);
+    }
+
+private:
+    boost::shared_ptr<PoolT> pool_;
+    boost::shared_ptr<T> obj_;
+};
+
+}
+
+/*!
+ * @brief Borrow an object from a pool for as long as it is referenced.
+ *
+ * The object goes back to the pool once the last copy of the returned
+ * pointer is gone, so it can be shared by the featuresets reading from
+ * it. When the pool is exhausted an object of its own is created with
+ * creator and closed when no longer referenced.
+ */
+template <typename T, template <typename> class Creator>
+boost::shared_ptr<T> borrow_pooled(boost::shared_ptr<Pool<T,Creator> > const& pool,
+                                   Creator<T> const& creator)
+{
+    boost::shared_ptr<T> obj = pool->borrowObject();
+    if (!obj)
+    {
+        return boost::shared_ptr<T>(creator());
+    }
+    return boost::shared_ptr<T>(obj.get(),
+        detail::pooled_object_releaser<T, Pool<T,Creator> >(pool, obj));
+}
+
 }
 #endif //POOL_HPP
@@ -123,6 +123,13 @@ public:
     {
         return query_result_.end();
     }
+
+    // same as query_in_box, but collects into the caller's result so
+    // that several threads can query the tree at once
+    void query_in_box(box2d<double> const& box, result_t & result) const
+    {
+        query_node(box,result,root_);
+    }
         
     const_iterator begin() const
     {
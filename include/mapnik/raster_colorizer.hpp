@@ -155,7 +155,7 @@ public:
     //!
     //! This can not be set as INHERIT, if you do, LINEAR will be used instead.
     //! \param[in] mode The default mode
-    void set_default_mode(const colorizer_mode mode) { default_mode_ = (mode == COLORIZER_INHERIT) ? COLORIZER_LINEAR:(colorizer_mode_enum)mode; };
+    void set_default_mode(const colorizer_mode mode) { default_mode_ = (mode == COLORIZER_INHERIT) ? COLORIZER_LINEAR:(colorizer_mode_enum)mode; update_table(); };
     void set_default_mode_enum(const colorizer_mode_enum mode) { set_default_mode(mode); };
     
     //! \brief Get the default mode
@@ -165,7 +165,7 @@ public:
     
     //! \brief Set the default color
     //! \param[in] color The default color
-    void set_default_color(const color& color) { default_color_ = color; };
+    void set_default_color(const color& color) { default_color_ = color; update_table(); };
     
     //! \brief Get the default color
     //! \return The default color
@@ -199,18 +199,24 @@ public:
 
     //! \brief Set the epsilon value for exact mode
     //! \param[in] e The epsilon value
-    inline void set_epsilon(const float e) { if(e > 0) epsilon_ = e; };
+    inline void set_epsilon(const float e) { if(e > 0) { epsilon_ = e; update_table(); } };
     
     //! \brief Get the epsilon value for exact mode
     //! \return The epsilon value
     inline float get_epsilon(void) const { return epsilon_; };
 
 private:
+    class compiled_table;
+
+    //! \brief Rebuild the lookup table from the stops and defaults
+    void update_table();
+
     colorizer_stops stops_;         //!< The vector of stops
     
     colorizer_mode default_mode_;   //!< The default mode inherited by stops
     color default_color_;           //!< The default color
     float epsilon_;                 //!< The epsilon value for exact mode
+    boost::shared_ptr<compiled_table const> table_; //!< Lookup table, rebuilt whenever the above change
 };
 
 
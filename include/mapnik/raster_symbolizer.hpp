@@ -32,26 +32,63 @@
 
 namespace mapnik
 {
+
+// how a rendered raster is composited onto the map image
+enum raster_mode_e
+{
+    RASTER_MODE_NORMAL = 0,
+    RASTER_MODE_GRAIN_MERGE,
+    RASTER_MODE_GRAIN_MERGE2,
+    RASTER_MODE_MULTIPLY,
+    RASTER_MODE_MULTIPLY2,
+    RASTER_MODE_DIVIDE,
+    RASTER_MODE_DIVIDE2,
+    RASTER_MODE_SCREEN,
+    RASTER_MODE_HARD_LIGHT,
+    // unrecognized modes are copied over the map image
+    RASTER_MODE_COPY
+};
+
+inline raster_mode_e get_raster_mode_by_name(std::string const& name)
+{
+    if (name == "normal") return RASTER_MODE_NORMAL;
+    else if (name == "grain_merge") return RASTER_MODE_GRAIN_MERGE;
+    else if (name == "grain_merge2") return RASTER_MODE_GRAIN_MERGE2;
+    else if (name == "multiply") return RASTER_MODE_MULTIPLY;
+    else if (name == "multiply2") return RASTER_MODE_MULTIPLY2;
+    else if (name == "divide") return RASTER_MODE_DIVIDE;
+    else if (name == "divide2") return RASTER_MODE_DIVIDE2;
+    else if (name == "screen") return RASTER_MODE_SCREEN;
+    else if (name == "hard_light") return RASTER_MODE_HARD_LIGHT;
+    return RASTER_MODE_COPY;
+}
+
 struct MAPNIK_DECL raster_symbolizer : public symbolizer_base 
 {
     
     raster_symbolizer()
         : symbolizer_base(),
         mode_("normal"),
+        raster_mode_(RASTER_MODE_NORMAL),
         scaling_("fast"),
+        scaling_method_(SCALING_NEAR),
         opacity_(1.0),
         colorizer_(),
         filter_factor_(-1),
-        mesh_size_(16) {}
+        mesh_size_(16),
+        warp_threads_(1) {}
 
     raster_symbolizer(const raster_symbolizer &rhs)
         : symbolizer_base(rhs),
         mode_(rhs.get_mode()),
+        raster_mode_(rhs.raster_mode_),
         scaling_(rhs.get_scaling()),
+        scaling_method_(rhs.scaling_method_),
         opacity_(rhs.get_opacity()),
         colorizer_(rhs.colorizer_),
         filter_factor_(rhs.filter_factor_),
-        mesh_size_(rhs.mesh_size_) {}
+        mesh_size_(rhs.mesh_size_),
+        warp_threads_(rhs.warp_threads_) {}
     
     std::string const& get_mode() const
     {
@@ -60,6 +97,12 @@ struct MAPNIK_DECL raster_symbolizer : public symbolizer_base
     void set_mode(std::string const& mode)
     {
         mode_ = mode;
+        raster_mode_ = get_raster_mode_by_name(mode);
+    }
+    // composite mode resolved from the mode name
+    raster_mode_e get_raster_mode() const
+    {
+        return raster_mode_;
     }
     std::string const& get_scaling() const
     {
@@ -68,6 +111,12 @@ struct MAPNIK_DECL raster_symbolizer : public symbolizer_base
     void set_scaling(std::string const& scaling)
     {
         scaling_ = scaling;
+        scaling_method_ = get_scaling_method_by_name(scaling);
+    }
+    // scaling method resolved from the scaling name
+    scaling_method_e get_scaling_method() const
+    {
+        return scaling_method_;
     }
     void set_opacity(float opacity)
     {
@@ -102,7 +151,7 @@ struct MAPNIK_DECL raster_symbolizer : public symbolizer_base
         } else {
             // No filter factor specified, calculate a sensible default value
             // based on the scaling algorithm being employed.
-            scaling_method_e scaling = get_scaling_method_by_name (scaling_);
+            scaling_method_e scaling = scaling_method_;
             
             double ff = 1.0;
             
@@ -147,15 +196,27 @@ struct MAPNIK_DECL raster_symbolizer : public symbolizer_base
     {
         mesh_size_=mesh_size;
     }
+    // threads used to warp large reprojected rasters, 1 warps serially
+    unsigned get_warp_threads() const
+    {
+        return warp_threads_;
+    }
+    void set_warp_threads(unsigned warp_threads)
+    {
+        warp_threads_=warp_threads;
+    }
     
     
 private:
     std::string mode_;
+    raster_mode_e raster_mode_;
     std::string scaling_;
+    scaling_method_e scaling_method_;
     float opacity_;
     raster_colorizer_ptr colorizer_;
     double filter_factor_;
     unsigned mesh_size_;
+    unsigned warp_threads_;
 };
 }
 
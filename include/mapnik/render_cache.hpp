@@ -0,0 +1,235 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+//$Id$
+
+#ifndef MAPNIK_RENDER_CACHE_HPP
+#define MAPNIK_RENDER_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/params.hpp>
+// boost
+#include <boost/utility.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/optional.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/mutex.hpp>
+#endif
+// stl
+#include <string>
+#include <vector>
+#include <list>
+#include <set>
+
+namespace mapnik
+{
+
+class Map;
+class datasource;
+
+/*!
+ * @brief Identity of a rendered result.
+ *
+ * Combines a caller supplied map identity (for example the stylesheet
+ * name and version) with the extent, size, buffer size, scale factor
+ * and output format of the request.
+ */
+class MAPNIK_DECL render_cache_key
+{
+public:
+    render_cache_key(std::string const& map_id,
+                     Map const& map,
+                     double scale_factor,
+                     std::string const& format);
+    render_cache_key(std::string const& map_id,
+                     box2d<double> const& extent,
+                     unsigned width,
+                     unsigned height,
+                     double scale_factor,
+                     std::string const& format,
+                     int buffer_size = 0);
+    std::string const& str() const { return key_; }
+private:
+    void init(std::string const& map_id,
+              box2d<double> const& extent,
+              unsigned width,
+              unsigned height,
+              int buffer_size,
+              double scale_factor,
+              std::string const& format);
+    std::string key_;
+};
+
+/*!
+ * @brief Abstract cache of encoded render results.
+ *
+ * Every entry carries a list of dependency keys (see layer_dependency()
+ * and datasource_dependency()) so that a data update only expires the
+ * entries that were rendered from the affected layers or datasources.
+ */
+class MAPNIK_DECL render_cache : private boost::noncopyable
+{
+public:
+    typedef std::vector<std::string> dependencies;
+
+    render_cache();
+    virtual ~render_cache() {}
+
+    virtual boost::optional<std::string> find(render_cache_key const& key) = 0;
+    /*!
+     * @brief Store data under key.
+     *
+     * generation is the value of generation() from before the data was
+     * rendered. If the cache has been invalidated or cleared since, the
+     * data may already be stale and is not stored.
+     */
+    virtual void insert(render_cache_key const& key,
+                        std::string const& data,
+                        dependencies const& deps,
+                        unsigned generation) = 0;
+    /*!
+     * @brief Expire all entries depending on the given dependency key.
+     */
+    virtual void invalidate(std::string const& dependency) = 0;
+    virtual void clear() = 0;
+
+    /*!
+     * @brief Count of invalidate() and clear() calls so far.
+     */
+    unsigned generation() const;
+
+    void invalidate_layer(std::string const& name);
+    void invalidate_datasource(datasource const& ds);
+
+    static std::string layer_dependency(std::string const& name);
+    static std::string datasource_dependency(parameters const& params);
+
+    /*!
+     * @brief Dependency keys of the layers a render of the map would use.
+     *
+     * Collects the layer and datasource keys of all active layers
+     * visible at the current scale.
+     */
+    static dependencies map_dependencies(Map const& map, double scale_factor = 1.0);
+
+protected:
+    // called by invalidate() and clear() with the lock insert() takes held
+    void next_generation();
+
+private:
+    unsigned generation_;
+#ifdef MAPNIK_THREADSAFE
+    mutable boost::mutex generation_mutex_;
+#endif
+};
+
+typedef boost::shared_ptr<render_cache> render_cache_ptr;
+
+/*!
+ * @brief In-memory least recently used render cache bounded in bytes.
+ */
+class MAPNIK_DECL memory_render_cache : public render_cache
+{
+public:
+    explicit memory_render_cache(std::size_t max_bytes = 64 * 1024 * 1024);
+    boost::optional<std::string> find(render_cache_key const& key);
+    void insert(render_cache_key const& key,
+                std::string const& data,
+                dependencies const& deps,
+                unsigned generation);
+    void invalidate(std::string const& dependency);
+    void clear();
+    std::size_t size() const;
+    std::size_t bytes() const;
+private:
+    struct entry
+    {
+        std::string key;
+        std::string data;
+        dependencies deps;
+    };
+    typedef std::list<entry> entry_list;
+    typedef boost::unordered_map<std::string, entry_list::iterator> entry_map;
+    // keys of the entries depending on each dependency
+    typedef boost::unordered_map<std::string, std::set<std::string> > dependency_map;
+
+    void erase(entry_list::iterator itr);
+
+    std::size_t max_bytes_;
+    std::size_t bytes_;
+    entry_list entries_;
+    entry_map index_;
+    dependency_map dependents_;
+#ifdef MAPNIK_THREADSAFE
+    mutable boost::mutex mutex_;
+#endif
+};
+
+/*!
+ * @brief Render cache storing one file per entry in a directory.
+ *
+ * Entries survive process restarts. Invalidation scans the entry
+ * headers, which is acceptable as it only happens on data updates.
+ * Entries are written to a temporary file and renamed into place, so
+ * lookups read them without taking a lock.
+ */
+class MAPNIK_DECL file_render_cache : public render_cache
+{
+public:
+    explicit file_render_cache(std::string const& directory);
+    boost::optional<std::string> find(render_cache_key const& key);
+    void insert(render_cache_key const& key,
+                std::string const& data,
+                dependencies const& deps,
+                unsigned generation);
+    void invalidate(std::string const& dependency);
+    void clear();
+private:
+    std::string filename(render_cache_key const& key) const;
+    std::string temp_filename(std::string const& name);
+    std::string directory_;
+    unsigned temp_count_;
+#ifdef MAPNIK_THREADSAFE
+    mutable boost::mutex mutex_;
+#endif
+};
+
+/*!
+ * @brief Render the map with the agg renderer through the cache.
+ *
+ * Returns the cached encoded image if present, otherwise renders,
+ * encodes (see save_to_string()) and caches the result unless the
+ * cache was invalidated while rendering.
+ */
+MAPNIK_DECL std::string render_to_string_cached(Map const& map,
+                                                render_cache & cache,
+                                                std::string const& map_id,
+                                                std::string const& format,
+                                                double scale_factor = 1.0);
+
+}
+
+#endif // MAPNIK_RENDER_CACHE_HPP
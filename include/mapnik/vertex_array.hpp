@@ -0,0 +1,127 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef VERTEX_ARRAY_HPP
+#define VERTEX_ARRAY_HPP
+// mapnik
+#include <mapnik/vertex.hpp>
+// boost
+#include <boost/utility.hpp>
+// stl
+#include <vector>
+#include <algorithm>
+
+namespace mapnik
+{
+
+// Geometry storage for features that are decoded once and read many times.
+// Coordinates are kept as interleaved x,y pairs in one contiguous array and
+// commands as runs (a MOVETO followed by LINETOs is two runs, however long
+// the line). set_capacity() sizes the array exactly, so datasources that
+// know the vertex count up front allocate once; otherwise the array grows
+// geometrically.
+template <typename T>
+class vertex_array : private boost::noncopyable
+{
+    typedef typename T::type value_type;
+
+    struct command_run
+    {
+        unsigned end;
+        unsigned char command;
+    };
+
+    struct run_end_less
+    {
+        bool operator()(unsigned pos, command_run const& run) const
+        {
+            return pos < run.end;
+        }
+    };
+
+    std::vector<value_type> coords_;
+    std::vector<command_run> runs_;
+
+public:
+    vertex_array() {}
+
+    unsigned size() const
+    {
+        return coords_.size() >> 1;
+    }
+
+    void push_back (value_type x,value_type y,unsigned command)
+    {
+        coords_.push_back(x);
+        coords_.push_back(y);
+        if (runs_.empty() || runs_.back().command != command)
+        {
+            command_run run;
+            run.end = size();
+            run.command = static_cast<unsigned char>(command);
+            runs_.push_back(run);
+        }
+        else
+        {
+            ++runs_.back().end;
+        }
+    }
+
+    unsigned get_vertex(unsigned pos,double* x,double* y) const
+    {
+        if (pos >= size()) return SEG_END;
+        *x = coords_[pos << 1];
+        *y = coords_[(pos << 1) + 1];
+        return runs_[find_run(pos)].command;
+    }
+
+    // Run of vertices from pos that share one command: interleaved x,y
+    // pairs in *coords and the command in *command. Returns the length
+    // of the run, or 0 when pos is past the end.
+    unsigned get_vertices(unsigned pos, value_type const** coords, unsigned* command) const
+    {
+        if (pos >= size()) return 0;
+        unsigned run = find_run(pos);
+        *coords = &coords_[pos << 1];
+        *command = runs_[run].command;
+        return runs_[run].end - pos;
+    }
+
+    void set_capacity(size_t size)
+    {
+        coords_.reserve(size * 2);
+    }
+
+private:
+    // no lookup state is kept, geometries are read from several
+    // threads at once (memory datasource, feature and render caches)
+    unsigned find_run(unsigned pos) const
+    {
+        if (pos < runs_[0].end) return 0;
+        return std::upper_bound(runs_.begin() + 1, runs_.end(), pos, run_end_less()) - runs_.begin();
+    }
+};
+
+}
+
+#endif //VERTEX_ARRAY_HPP
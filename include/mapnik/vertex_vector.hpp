@@ -38,6 +38,7 @@
 // stl
 #include <vector>
 #include <cstring>
+#include <algorithm>
 
 namespace mapnik
 {
@@ -110,6 +111,24 @@ public:
         *y = (*vertex);
         return commands_[block] [pos & block_mask];
     }
+
+    // Run of vertices from pos that share one command: interleaved x,y
+    // pairs in *coords and the command in *command. Returns the length of
+    // the run, which ends at the end of pos's block at the latest, or 0
+    // when pos is past the end.
+    unsigned get_vertices(unsigned pos, value_type const** coords, unsigned* command) const
+    {
+        if (pos >= pos_) return 0;
+        unsigned block = pos >> block_shift;
+        unsigned offset = pos & block_mask;
+        unsigned char const* commands = commands_[block] + offset;
+        unsigned count = std::min(pos_ - pos, unsigned(block_size) - offset);
+        unsigned len = 1;
+        while (len < count && commands[len] == commands[0]) ++len;
+        *coords = vertexs_[block] + (offset << 1);
+        *command = commands[0];
+        return len;
+    }
                 
     void set_capacity(size_t)
     {
@@ -35,7 +35,8 @@ void reproject_raster(raster &target, raster const& source,
                       unsigned mesh_size,
                       double filter_radius,
                       double scale_factor,
-                      std::string scaling_method_name);
+                      std::string scaling_method_name,
+                      unsigned threads = 1);
 
 }
 #endif //WARP_HPP
@@ -0,0 +1,180 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// mapnik
+#include <mapnik/mapped_memory_cache.hpp>
+
+// boost
+#include <boost/filesystem/operations.hpp>
+#include <boost/make_shared.hpp>
+
+// stl
+#include <iostream>
+
+#include "csv_datasource.hpp"
+#include "csv_featureset.hpp"
+
+using mapnik::datasource;
+using mapnik::parameters;
+
+DATASOURCE_PLUGIN(csv_datasource)
+
+using mapnik::query;
+using mapnik::featureset_ptr;
+using mapnik::layer_descriptor;
+using mapnik::attribute_descriptor;
+using mapnik::datasource_exception;
+using mapnik::box2d;
+using mapnik::coord2d;
+
+csv_datasource::csv_datasource(parameters const& params, bool bind)
+    : datasource(params),
+      desc_(*params_.get<std::string>("type"), *params_.get<std::string>("encoding","utf-8"))
+{
+    boost::optional<std::string> file = params_.get<std::string>("file");
+    if (!file) throw datasource_exception("CSV Plugin: missing <file> parameter");
+
+    boost::optional<std::string> base = params_.get<std::string>("base");
+    if (base)
+        file_ = *base + "/" + *file;
+    else
+        file_ = *file;
+
+    std::string separator = *params_.get<std::string>("separator",",");
+    std::string quote = *params_.get<std::string>("quote","\"");
+    if (separator.size() != 1 || quote.size() != 1)
+    {
+        throw datasource_exception("CSV Plugin: <separator> and <quote> must be single characters");
+    }
+    options_.separator = separator[0];
+    options_.quote = quote[0];
+    options_.wkt_field = *params_.get<std::string>("wkt_field","");
+    options_.x_field = *params_.get<std::string>("x_field","");
+    options_.y_field = *params_.get<std::string>("y_field","");
+
+    if (bind)
+    {
+        this->bind();
+    }
+}
+
+csv_datasource::~csv_datasource() {}
+
+void csv_datasource::bind() const
+{
+    if (is_bound_) return;
+
+    if (!boost::filesystem::exists(file_))
+    {
+        throw datasource_exception("CSV Plugin: file '" + file_ + "' does not exist");
+    }
+
+    // the file is only mapped while parsing and not kept in the
+    // mapped memory cache, so that a refreshed file is read again
+    // by the next datasource created for it
+    boost::optional<mapnik::mapped_region_ptr> region = mapnik::mapped_memory_cache::find(file_, false);
+    boost::shared_ptr<csv_table> table = boost::make_shared<csv_table>();
+    if (region)
+    {
+        char const* data = static_cast<char const*>((*region)->get_address());
+        table->parse(data, data + (*region)->get_size(), options_);
+    }
+    else if (boost::filesystem::file_size(file_) != 0)
+    {
+        throw datasource_exception("CSV Plugin: could not map file '" + file_ + "'");
+    }
+
+    for (unsigned column = 0; column < table->num_columns(); ++column)
+    {
+        if (int(column) == table->wkt_column()) continue;
+        desc_.add_descriptor(attribute_descriptor(table->headers()[column], table->types()[column]));
+    }
+
+#ifdef MAPNIK_DEBUG
+    std::clog << "CSV Plugin: " << table->size() << " features in '" << file_
+              << "', extent=" << table->extent() << std::endl;
+#endif
+
+    table_ = table;
+    is_bound_ = true;
+}
+
+std::string csv_datasource::name()
+{
+    return "csv";
+}
+
+int csv_datasource::type() const
+{
+    return datasource::Vector;
+}
+
+box2d<double> csv_datasource::envelope() const
+{
+    if (!is_bound_) bind();
+
+    return table_->extent();
+}
+
+layer_descriptor csv_datasource::get_descriptor() const
+{
+    if (!is_bound_) bind();
+
+    return desc_;
+}
+
+featureset_ptr csv_datasource::features(query const& q) const
+{
+    if (!is_bound_) bind();
+
+    std::set<std::string> const& names = q.property_names();
+    std::vector<unsigned> columns;
+    for (unsigned column = 0; column < table_->num_columns(); ++column)
+    {
+        if (int(column) != table_->wkt_column() && names.count(table_->headers()[column]))
+        {
+            columns.push_back(column);
+        }
+    }
+    return features_in_box(q.get_bbox(), columns);
+}
+
+featureset_ptr csv_datasource::features_at_point(coord2d const& pt) const
+{
+    if (!is_bound_) bind();
+
+    std::vector<unsigned> columns;
+    for (unsigned column = 0; column < table_->num_columns(); ++column)
+    {
+        if (int(column) != table_->wkt_column()) columns.push_back(column);
+    }
+    return features_in_box(box2d<double>(pt.x, pt.y, pt.x, pt.y), columns);
+}
+
+featureset_ptr csv_datasource::features_in_box(box2d<double> const& box,
+                                               std::vector<unsigned> const& columns) const
+{
+    std::vector<unsigned> rows;
+    table_->query(box, rows);
+    return boost::make_shared<csv_featureset>(table_, boost::ref(rows), columns, desc_.get_encoding());
+}
@@ -0,0 +1,58 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef CSV_DATASOURCE_HPP
+#define CSV_DATASOURCE_HPP
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/feature_layer_desc.hpp>
+
+// boost
+#include <boost/shared_ptr.hpp>
+
+#include "csv_table.hpp"
+
+class csv_datasource : public mapnik::datasource
+{
+public:
+    csv_datasource(mapnik::parameters const& params, bool bind=true);
+    virtual ~csv_datasource();
+    int type() const;
+    static std::string name();
+    mapnik::featureset_ptr features(mapnik::query const& q) const;
+    mapnik::featureset_ptr features_at_point(mapnik::coord2d const& pt) const;
+    mapnik::box2d<double> envelope() const;
+    mapnik::layer_descriptor get_descriptor() const;
+    void bind() const;
+private:
+    mapnik::featureset_ptr features_in_box(mapnik::box2d<double> const& box,
+                                           std::vector<unsigned> const& columns) const;
+
+    std::string file_;
+    csv_options options_;
+    mutable mapnik::layer_descriptor desc_;
+    mutable boost::shared_ptr<csv_table> table_;
+};
+
+#endif // CSV_DATASOURCE_HPP
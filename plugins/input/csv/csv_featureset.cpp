@@ -0,0 +1,93 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// mapnik
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/wkt/wkt_factory.hpp>
+
+// stl
+#include <cstdlib>
+
+#include "csv_featureset.hpp"
+
+using mapnik::feature_ptr;
+using mapnik::feature_factory;
+using mapnik::geometry_type;
+using mapnik::transcoder;
+
+csv_featureset::csv_featureset(boost::shared_ptr<csv_table const> const& table,
+                               std::vector<unsigned> & rows,
+                               std::vector<unsigned> const& columns,
+                               std::string const& encoding)
+    : table_(table),
+      columns_(columns),
+      tr_(new transcoder(encoding))
+{
+    rows_.swap(rows);
+    pos_ = rows_.begin();
+}
+
+csv_featureset::~csv_featureset() {}
+
+feature_ptr csv_featureset::next()
+{
+    csv_table const& table = *table_;
+    while (pos_ != rows_.end())
+    {
+        unsigned row = *pos_++;
+        feature_ptr feature(feature_factory::create(table.id(row)));
+        if (table.wkt_column() >= 0)
+        {
+            std::string wkt(table.field(row, table.wkt_column()), table.field_size(row, table.wkt_column()));
+            if (!mapnik::from_wkt(wkt, feature->paths())) continue;
+        }
+        else
+        {
+            mapnik::box2d<double> const& box = table.envelope(row);
+            geometry_type * pt = new geometry_type(mapnik::Point);
+            pt->move_to(box.minx(), box.miny());
+            feature->add_geometry(pt);
+        }
+
+        for (std::vector<unsigned>::const_iterator itr = columns_.begin(); itr != columns_.end(); ++itr)
+        {
+            char const* value = table.field(row, *itr);
+            std::string const& name = table.headers()[*itr];
+            switch (table.types()[*itr])
+            {
+            case mapnik::Integer:
+                if (*value) boost::put(*feature, name, int(std::strtol(value, 0, 10)));
+                break;
+            case mapnik::Double:
+                if (*value) boost::put(*feature, name, std::strtod(value, 0));
+                break;
+            default:
+                boost::put(*feature, name, tr_->transcode(value, table.field_size(row, *itr)));
+                break;
+            }
+        }
+        return feature;
+    }
+    return feature_ptr();
+}
@@ -0,0 +1,474 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/wkt/wkt_factory.hpp>
+
+// boost
+#include <boost/algorithm/string.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#endif
+
+// stl
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <cmath>
+#include <iostream>
+
+#include "csv_table.hpp"
+
+using mapnik::box2d;
+using mapnik::datasource_exception;
+
+namespace {
+
+// smaller files are parsed by a single thread
+const std::size_t parallel_min_bytes = 4 * 1024 * 1024;
+
+// Parse the record starting at pos, appending the unescaped text of its
+// fields to text, each followed by '\0', and their offsets to offsets.
+// Quotes are only special at the start of a field. Returns the start of
+// the next record.
+char const* parse_record(char const* pos, char const* end,
+                         char separator, char quote,
+                         std::string & text,
+                         std::vector<std::size_t> & offsets)
+{
+    for (;;)
+    {
+        offsets.push_back(text.size());
+        if (pos != end && *pos == quote)
+        {
+            ++pos;
+            for (;;)
+            {
+                char const* closing = static_cast<char const*>(std::memchr(pos, quote, end - pos));
+                if (!closing)
+                {
+                    text.append(pos, end);
+                    pos = end;
+                    break;
+                }
+                text.append(pos, closing);
+                pos = closing + 1;
+                if (pos == end || *pos != quote) break;
+                // doubled quote
+                text.push_back(quote);
+                ++pos;
+            }
+        }
+        char const* stop = pos;
+        while (stop != end && *stop != separator && *stop != '\n') ++stop;
+        char const* value_end = stop;
+        if (value_end != pos && *(value_end - 1) == '\r' && (stop == end || *stop == '\n')) --value_end;
+        text.append(pos, value_end);
+        text.push_back('\0');
+        if (stop == end) return end;
+        if (*stop == '\n') return stop + 1;
+        pos = stop + 1;
+    }
+}
+
+bool parse_double(char const* str, double & result)
+{
+    char * end;
+    result = std::strtod(str, &end);
+    if (end == str) return false;
+    while (*end == ' ' || *end == '\t') ++end;
+    return *end == '\0';
+}
+
+bool is_integer(char const* str)
+{
+    char * end;
+    errno = 0;
+    long result = std::strtol(str, &end, 10);
+    if (end == str || errno == ERANGE || result < INT_MIN || result > INT_MAX) return false;
+    while (*end == ' ' || *end == '\t') ++end;
+    return *end == '\0';
+}
+
+bool is_finite(double value)
+{
+    return std::fabs(value) <= std::numeric_limits<double>::max();
+}
+
+int find_column(std::vector<std::string> const& headers, std::string const& name)
+{
+    for (unsigned i = 0; i < headers.size(); ++i)
+    {
+        if (boost::iequals(headers[i], name)) return i;
+    }
+    return -1;
+}
+
+int find_column(std::vector<std::string> const& headers, char const** names)
+{
+    for (; *names; ++names)
+    {
+        int column = find_column(headers, *names);
+        if (column >= 0) return column;
+    }
+    return -1;
+}
+
+// The rows of a part of the file, parsed on their own and appended
+// to the table afterwards.
+struct csv_chunk
+{
+    csv_chunk()
+        : begin(0), end(0), file_end(0), stop(0),
+          separator(','), quote('"'),
+          num_columns(0), wkt_column(-1), x_column(-1), y_column(-1),
+          num_records(0) {}
+
+    char const* begin;
+    char const* end;
+    char const* file_end;
+    // where the last record parsed ended, which is end unless
+    // the chunk did not start at a record boundary
+    char const* stop;
+    char separator;
+    char quote;
+    unsigned num_columns;
+    int wkt_column;
+    int x_column;
+    int y_column;
+
+    std::string text;
+    std::vector<std::size_t> offsets;
+    std::vector<int> ids;
+    std::vector<box2d<double> > envelopes;
+    std::vector<char> has_value;
+    std::vector<char> is_int;
+    std::vector<char> is_double;
+    int num_records;
+
+    void init(char const* chunk_begin, char const* chunk_end, char const* data_end,
+              csv_options const& options, unsigned columns,
+              int wkt, int x, int y)
+    {
+        begin = chunk_begin;
+        end = chunk_end;
+        file_end = data_end;
+        separator = options.separator;
+        quote = options.quote;
+        num_columns = columns;
+        wkt_column = wkt;
+        x_column = x;
+        y_column = y;
+    }
+
+    void parse()
+    {
+        has_value.assign(num_columns, 0);
+        is_int.assign(num_columns, 1);
+        is_double.assign(num_columns, 1);
+        char const* pos = begin;
+        while (pos < end)
+        {
+            // blank lines are not records
+            if (*pos == '\n')
+            {
+                ++pos;
+                continue;
+            }
+            if (*pos == '\r' && pos + 1 != file_end && pos[1] == '\n')
+            {
+                pos += 2;
+                continue;
+            }
+            ++num_records;
+            std::size_t text_size = text.size();
+            std::size_t first = offsets.size();
+            pos = parse_record(pos, file_end, separator, quote, text, offsets);
+            std::size_t num_fields = offsets.size() - first;
+            if (num_fields > num_columns)
+            {
+                text.resize(offsets[first + num_columns]);
+                offsets.resize(first + num_columns);
+            }
+            for (; num_fields < num_columns; ++num_fields)
+            {
+                offsets.push_back(text.size());
+                text.push_back('\0');
+            }
+
+            box2d<double> box;
+            if (!record_envelope(first, box))
+            {
+#ifdef MAPNIK_DEBUG
+                std::clog << "CSV Plugin: skipping record " << num_records << " of chunk without a valid geometry\n";
+#endif
+                text.resize(text_size);
+                offsets.resize(first);
+                continue;
+            }
+            ids.push_back(num_records);
+            envelopes.push_back(box);
+
+            for (unsigned column = 0; column < num_columns; ++column)
+            {
+                char const* value = text.data() + offsets[first + column];
+                if (*value == '\0' || int(column) == wkt_column) continue;
+                has_value[column] = 1;
+                if (is_int[column] && !is_integer(value)) is_int[column] = 0;
+                double number;
+                if (is_double[column] && !parse_double(value, number)) is_double[column] = 0;
+            }
+        }
+        stop = pos;
+    }
+
+    bool record_envelope(std::size_t first, box2d<double> & box) const
+    {
+        if (wkt_column >= 0)
+        {
+            boost::ptr_vector<mapnik::geometry_type> paths;
+            if (!mapnik::from_wkt(std::string(text.data() + offsets[first + wkt_column]), paths) || paths.empty())
+            {
+                return false;
+            }
+            box = paths[0].envelope();
+            for (unsigned i = 1; i < paths.size(); ++i)
+            {
+                box.expand_to_include(paths[i].envelope());
+            }
+            return true;
+        }
+        double x, y;
+        if (!parse_double(text.data() + offsets[first + x_column], x) ||
+            !parse_double(text.data() + offsets[first + y_column], y) ||
+            !is_finite(x) || !is_finite(y))
+        {
+            return false;
+        }
+        box.init(x, y, x, y);
+        return true;
+    }
+};
+
+void parse_chunks(std::vector<csv_chunk> & chunks)
+{
+#ifdef MAPNIK_THREADSAFE
+    if (chunks.size() > 1)
+    {
+        boost::thread_group threads;
+        for (unsigned i = 0; i < chunks.size(); ++i)
+        {
+            threads.create_thread(boost::bind(&csv_chunk::parse, &chunks[i]));
+        }
+        threads.join_all();
+        return;
+    }
+#endif
+    for (unsigned i = 0; i < chunks.size(); ++i)
+    {
+        chunks[i].parse();
+    }
+}
+
+}
+
+csv_table::csv_table()
+    : wkt_column_(-1),
+      x_column_(-1),
+      y_column_(-1) {}
+
+void csv_table::parse(char const* begin, char const* end, csv_options const& options)
+{
+    // utf-8 byte order mark
+    if (end - begin >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0) begin += 3;
+
+    std::string header_text;
+    std::vector<std::size_t> header_offsets;
+    char const* data_begin = parse_record(begin, end, options.separator, options.quote,
+                                          header_text, header_offsets);
+    for (unsigned i = 0; i < header_offsets.size(); ++i)
+    {
+        headers_.push_back(boost::trim_copy(std::string(header_text.data() + header_offsets[i])));
+    }
+
+    static char const* wkt_names[] = { "wkt", "geom", "geometry", 0 };
+    static char const* x_names[] = { "x", "lon", "lng", "long", "longitude", 0 };
+    static char const* y_names[] = { "y", "lat", "latitude", 0 };
+    wkt_column_ = options.wkt_field.empty() ? find_column(headers_, wkt_names)
+                                            : find_column(headers_, options.wkt_field);
+    if (wkt_column_ < 0)
+    {
+        x_column_ = options.x_field.empty() ? find_column(headers_, x_names)
+                                            : find_column(headers_, options.x_field);
+        y_column_ = options.y_field.empty() ? find_column(headers_, y_names)
+                                            : find_column(headers_, options.y_field);
+        if (x_column_ < 0 || y_column_ < 0)
+        {
+            throw datasource_exception("CSV Plugin: could not detect a wkt column or x/y (lon/lat) columns in the header");
+        }
+    }
+
+    // Split the data into chunks starting at record boundaries. A newline
+    // ends a record when it is preceded by an even number of quotes, so
+    // quoted fields spanning several lines are never cut.
+    unsigned num_chunks = 1;
+#ifdef MAPNIK_THREADSAFE
+    if (std::size_t(end - data_begin) >= parallel_min_bytes)
+    {
+        num_chunks = std::max(1u, boost::thread::hardware_concurrency());
+    }
+#endif
+    if (options.chunks > 0) num_chunks = options.chunks;
+    std::vector<char const*> starts(num_chunks + 1, end);
+    starts[0] = data_begin;
+    std::size_t piece = (end - data_begin) / num_chunks;
+    std::size_t quotes = 0;
+    char const* counted = data_begin;
+    for (unsigned i = 1; i < num_chunks; ++i)
+    {
+        char const* pos = data_begin + i * piece;
+        quotes += std::count(counted, pos, options.quote);
+        counted = pos;
+        bool quoted = quotes % 2 != 0;
+        for (; pos != end; ++pos)
+        {
+            if (*pos == options.quote) quoted = !quoted;
+            else if (*pos == '\n' && !quoted) break;
+        }
+        starts[i] = (pos == end) ? end : pos + 1;
+    }
+
+    std::vector<csv_chunk> chunks(num_chunks);
+    for (unsigned i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].init(starts[i], std::max(starts[i], starts[i + 1]), end, options,
+                       headers_.size(), wkt_column_, x_column_, y_column_);
+    }
+    parse_chunks(chunks);
+
+    // a quote inside an unquoted field upsets the boundary search,
+    // in which case the file is parsed again in one go
+    for (unsigned i = 0; i < num_chunks; ++i)
+    {
+        if (chunks[i].stop != chunks[i].end)
+        {
+            chunks.assign(1, csv_chunk());
+            chunks[0].init(data_begin, end, end, options,
+                           headers_.size(), wkt_column_, x_column_, y_column_);
+            chunks[0].parse();
+            break;
+        }
+    }
+
+    std::size_t text_size = 0;
+    std::size_t num_rows = 0;
+    for (unsigned i = 0; i < chunks.size(); ++i)
+    {
+        text_size += chunks[i].text.size();
+        num_rows += chunks[i].ids.size();
+    }
+    text_.reserve(text_size);
+    offsets_.reserve(num_rows * headers_.size() + 1);
+    ids_.reserve(num_rows);
+    envelopes_.reserve(num_rows);
+
+    std::vector<char> has_value(headers_.size(), 0);
+    std::vector<char> is_int(headers_.size(), 1);
+    std::vector<char> is_double(headers_.size(), 1);
+    int num_records = 0;
+    for (unsigned i = 0; i < chunks.size(); ++i)
+    {
+        csv_chunk & chunk = chunks[i];
+        std::size_t base = text_.size();
+        text_.append(chunk.text);
+        for (std::vector<std::size_t>::const_iterator itr = chunk.offsets.begin(); itr != chunk.offsets.end(); ++itr)
+        {
+            offsets_.push_back(base + *itr);
+        }
+        for (std::vector<int>::const_iterator itr = chunk.ids.begin(); itr != chunk.ids.end(); ++itr)
+        {
+            ids_.push_back(num_records + *itr);
+        }
+        envelopes_.insert(envelopes_.end(), chunk.envelopes.begin(), chunk.envelopes.end());
+        for (unsigned column = 0; column < headers_.size(); ++column)
+        {
+            has_value[column] |= chunk.has_value[column];
+            is_int[column] &= chunk.is_int[column];
+            is_double[column] &= chunk.is_double[column];
+        }
+        num_records += chunk.num_records;
+        // release the chunk as soon as it has been copied
+        std::string().swap(chunk.text);
+        std::vector<std::size_t>().swap(chunk.offsets);
+    }
+    offsets_.push_back(text_.size());
+
+    for (unsigned column = 0; column < headers_.size(); ++column)
+    {
+        if (has_value[column] && is_int[column]) types_.push_back(mapnik::Integer);
+        else if (has_value[column] && is_double[column]) types_.push_back(mapnik::Double);
+        else types_.push_back(mapnik::String);
+    }
+
+    if (envelopes_.empty()) return;
+    extent_ = envelopes_[0];
+    for (unsigned row = 1; row < envelopes_.size(); ++row)
+    {
+        extent_.expand_to_include(envelopes_[row]);
+    }
+    index_.reset(new index_type(extent_));
+    for (unsigned row = 0; row < envelopes_.size(); ++row)
+    {
+        index_->insert(row, envelopes_[row]);
+    }
+}
+
+void csv_table::query(box2d<double> const& box, std::vector<unsigned> & rows) const
+{
+    if (!index_) return;
+    if (box.contains(extent_))
+    {
+        rows.reserve(envelopes_.size());
+        for (unsigned row = 0; row < envelopes_.size(); ++row)
+        {
+            rows.push_back(row);
+        }
+        return;
+    }
+    index_type::result_t candidates;
+    index_->query_in_box(box, candidates);
+    rows.reserve(candidates.size());
+    for (index_type::query_iterator itr = candidates.begin(); itr != candidates.end(); ++itr)
+    {
+        if (box.intersects(envelopes_[*itr])) rows.push_back(*itr);
+    }
+    // keep the order of the file
+    std::sort(rows.begin(), rows.end());
+}
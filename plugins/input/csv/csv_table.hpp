@@ -0,0 +1,114 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef CSV_TABLE_HPP
+#define CSV_TABLE_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/quad_tree.hpp>
+#include <mapnik/attribute_descriptor.hpp>
+
+// boost
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+// stl
+#include <string>
+#include <vector>
+
+struct csv_options
+{
+    csv_options()
+        : separator(','),
+          quote('"'),
+          chunks(0) {}
+
+    char separator;
+    char quote;
+    // number of parts the rows are split into and parsed in, chosen
+    // from the file size and the number of cores when 0
+    unsigned chunks;
+    // geometry columns, detected from the header when empty
+    std::string wkt_field;
+    std::string x_field;
+    std::string y_field;
+};
+
+// All rows of a CSV file with a usable geometry, kept in file order.
+// The unescaped text of the fields is stored back to back, each field
+// followed by a '\0', so that numbers can be converted in place and
+// attributes are only turned into values when a query asks for them.
+class csv_table : private boost::noncopyable
+{
+public:
+    typedef mapnik::quad_tree<unsigned> index_type;
+
+    csv_table();
+
+    // parse the file contents in [begin, end), using several threads
+    // for large files; throws mapnik::datasource_exception when no
+    // geometry column can be found
+    void parse(char const* begin, char const* end, csv_options const& options);
+
+    std::vector<std::string> const& headers() const { return headers_; }
+    std::vector<mapnik::eAttributeType> const& types() const { return types_; }
+    unsigned num_columns() const { return headers_.size(); }
+    unsigned size() const { return ids_.size(); }
+
+    int wkt_column() const { return wkt_column_; }
+
+    // feature id of a row, its record number in the file
+    int id(unsigned row) const { return ids_[row]; }
+    mapnik::box2d<double> const& envelope(unsigned row) const { return envelopes_[row]; }
+    mapnik::box2d<double> const& extent() const { return extent_; }
+
+    char const* field(unsigned row, unsigned column) const
+    {
+        return text_.data() + offsets_[row * headers_.size() + column];
+    }
+
+    std::size_t field_size(unsigned row, unsigned column) const
+    {
+        std::size_t pos = row * headers_.size() + column;
+        return offsets_[pos + 1] - offsets_[pos] - 1;
+    }
+
+    // rows whose envelope intersects box, in file order
+    void query(mapnik::box2d<double> const& box, std::vector<unsigned> & rows) const;
+
+private:
+    std::vector<std::string> headers_;
+    std::vector<mapnik::eAttributeType> types_;
+    int wkt_column_;
+    int x_column_;
+    int y_column_;
+    std::string text_;
+    std::vector<std::size_t> offsets_;
+    std::vector<int> ids_;
+    std::vector<mapnik::box2d<double> > envelopes_;
+    mapnik::box2d<double> extent_;
+    boost::scoped_ptr<index_type> index_;
+};
+
+#endif // CSV_TABLE_HPP
@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2007 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef GDAL_DATASET_HPP
+#define GDAL_DATASET_HPP
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/pool.hpp>
+
+// boost
+#include <boost/utility.hpp>
+
+// stl
+#include <string>
+
+// gdal
+#include <gdal_priv.h>
+
+// An open GDALDataset kept in a gdal_datasource's pool. Handles that have
+// sat unused for longer than the idle timeout report themselves as not OK
+// so that the pool drops (and closes) them on the next borrow or return.
+class gdal_dataset_handle : public mapnik::pool_idle_timeout,
+                            private boost::noncopyable
+{
+public:
+    gdal_dataset_handle(GDALDataset * dataset, unsigned idle_timeout)
+        : mapnik::pool_idle_timeout(idle_timeout),
+          dataset_(dataset) {}
+
+    ~gdal_dataset_handle()
+    {
+#ifdef MAPNIK_DEBUG
+        std::clog << "GDAL Plugin: closing dataset = " << dataset_ << std::endl;
+#endif
+        if (dataset_) GDALClose(dataset_);
+    }
+
+    bool isOK() const
+    {
+        return dataset_ != 0 && !expired();
+    }
+
+    GDALDataset & dataset()
+    {
+        return *dataset_;
+    }
+
+private:
+    GDALDataset * dataset_;
+};
+
+
+// Opens the dataset handles pooled by each gdal datasource
+template <typename T>
+class gdal_dataset_creator
+{
+public:
+    gdal_dataset_creator(std::string const& dataset_name,
+                         unsigned idle_timeout)
+        : dataset_name_(dataset_name),
+          idle_timeout_(idle_timeout) {}
+
+    T* operator()() const
+    {
+#ifdef MAPNIK_DEBUG
+        std::clog << "GDAL Plugin: opening: " << dataset_name_ << std::endl;
+#endif
+
+        // not GDALOpenShared, which would give every handle opened on
+        // a thread the same dataset
+        GDALDataset *dataset = reinterpret_cast<GDALDataset*>(GDALOpen((dataset_name_).c_str(),GA_ReadOnly));
+
+        if (! dataset) throw mapnik::datasource_exception(CPLGetLastErrorMsg());
+        return new T(dataset, idle_timeout_);
+    }
+
+    std::string id() const
+    {
+        return dataset_name_;
+    }
+
+private:
+    std::string dataset_name_;
+    unsigned idle_timeout_;
+};
+
+#endif // GDAL_DATASET_HPP
@@ -28,6 +28,9 @@
 #include <mapnik/ptree_helpers.hpp>
 #include <mapnik/geom_util.hpp>
 
+// boost
+#include <boost/make_shared.hpp>
+
 using mapnik::datasource;
 using mapnik::parameters;
 
@@ -41,31 +44,6 @@ using mapnik::layer_descriptor;
 using mapnik::datasource_exception;
 
 
-/*
- * Opens a GDALDataset and returns a pointer to it.
- * Caller is responsible for calling GDALClose on it
- */
-inline GDALDataset *gdal_datasource::open_dataset() const
-{
-
-#ifdef MAPNIK_DEBUG
-    std::clog << "GDAL Plugin: opening: " << dataset_name_ << std::endl;
-#endif
-
-    GDALDataset *dataset;
-#if GDAL_VERSION_NUM >= 1600
-    if (shared_dataset_)
-        dataset = reinterpret_cast<GDALDataset*>(GDALOpenShared((dataset_name_).c_str(),GA_ReadOnly));
-    else
-#endif
-        dataset = reinterpret_cast<GDALDataset*>(GDALOpen((dataset_name_).c_str(),GA_ReadOnly));
-
-    if (! dataset) throw datasource_exception(CPLGetLastErrorMsg());
-    return dataset;
-}
-
-
-
 gdal_datasource::gdal_datasource(parameters const& params, bool bind)
     : datasource(params),
       desc_(*params.get<std::string>("type"),"utf-8"),
@@ -75,6 +53,8 @@ gdal_datasource::gdal_datasource(parameters const& params, bool bind)
     std::clog << "GDAL Plugin: Initializing..." << std::endl;
 #endif
 
+    // the size of the block cache is global to GDAL and is left to its
+    // GDAL_CACHEMAX configuration option rather than set per datasource
     GDALAllRegister();
 
     boost::optional<std::string> file = params.get<std::string>("file");
@@ -96,10 +76,24 @@ void gdal_datasource::bind() const
 {
     if (is_bound_) return;
     
-    shared_dataset_ = *params_.get<mapnik::boolean>("shared",false);
+#ifdef MAPNIK_DEBUG
+    if (*params_.get<mapnik::boolean>("shared",false))
+    {
+        std::clog << "GDAL Plugin: 'shared' is ignored, datasets are pooled" << std::endl;
+    }
+#endif
     band_ = *params_.get<int>("band", -1);
 
-    GDALDataset *dataset = open_dataset();
+    // datasets are kept open in a pool and handed out one per featureset,
+    // so tiles do not pay for re-opening the file (and any VRT sources)
+    creator_ = boost::make_shared<gdal_dataset_creator<gdal_dataset_handle> >(
+        dataset_name_, *params_.get<unsigned>("idle_timeout",0));
+    pool_ = boost::make_shared<pool_type>(*creator_,
+                                          *params_.get<int>("initial_size",1),
+                                          *params_.get<int>("max_size",10));
+
+    boost::shared_ptr<gdal_dataset_handle> handle = borrow_dataset();
+    GDALDataset *dataset = &handle->dataset();
    
     nbands_ = dataset->GetRasterCount();
     width_ = dataset->GetRasterXSize();
@@ -166,7 +160,6 @@ void gdal_datasource::bind() const
         
         extent_.init(x0,y0,x1,y1);
     }
-    GDALClose(dataset);
    
 #ifdef MAPNIK_DEBUG
     std::clog << "GDAL Plugin: Raster Size=" << width_ << "," << height_ << std::endl;
@@ -202,13 +195,18 @@ layer_descriptor gdal_datasource::get_descriptor() const
     return desc_;
 }
 
+boost::shared_ptr<gdal_dataset_handle> gdal_datasource::borrow_dataset() const
+{
+    return mapnik::borrow_pooled(pool_, *creator_);
+}
+
 featureset_ptr gdal_datasource::features(query const& q) const
 {
     if (!is_bound_) bind();
 
     gdal_query gq = q;
     // TODO - move to boost::make_shared, but must reduce # of args to <= 9
-    return featureset_ptr(new gdal_featureset(*open_dataset(), band_, gq, extent_, width_, height_, nbands_, dx_, dy_, filter_factor_));
+    return featureset_ptr(new gdal_featureset(borrow_dataset(), band_, gq, extent_, width_, height_, nbands_, dx_, dy_, filter_factor_));
 }
 
 featureset_ptr gdal_datasource::features_at_point(coord2d const& pt) const
@@ -216,6 +214,6 @@ featureset_ptr gdal_datasource::features_at_point(coord2d const& pt) const
     if (!is_bound_) bind();
 
     gdal_query gq = pt;
-    return featureset_ptr(new gdal_featureset(*open_dataset(), band_, gq, extent_, width_, height_, nbands_, dx_, dy_,  filter_factor_));
+    return featureset_ptr(new gdal_featureset(borrow_dataset(), band_, gq, extent_, width_, height_, nbands_, dx_, dy_,  filter_factor_));
 }
 
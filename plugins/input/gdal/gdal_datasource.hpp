@@ -26,12 +26,12 @@
 
 // mapnik
 #include <mapnik/datasource.hpp>
+#include <mapnik/pool.hpp>
 
 // boost
 #include <boost/shared_ptr.hpp>
 
-// gdal
-#include <gdal_priv.h>
+#include "gdal_dataset.hpp"
 
 class gdal_datasource : public mapnik::datasource 
 {
@@ -46,6 +46,8 @@ class gdal_datasource : public mapnik::datasource
         mapnik::layer_descriptor get_descriptor() const;
         void bind() const;
     private:
+        typedef mapnik::Pool<gdal_dataset_handle,gdal_dataset_creator> pool_type;
+        boost::shared_ptr<gdal_dataset_handle> borrow_dataset() const;
         mutable mapnik::box2d<double> extent_;
         std::string dataset_name_;
         mutable int band_;
@@ -55,9 +57,9 @@ class gdal_datasource : public mapnik::datasource
         mutable double dx_;
         mutable double dy_;
         mutable int nbands_;
-        mutable bool shared_dataset_;
         double filter_factor_;
-        inline GDALDataset *open_dataset() const;
+        mutable boost::shared_ptr<gdal_dataset_creator<gdal_dataset_handle> > creator_;
+        mutable boost::shared_ptr<pool_type> pool_;
 };
 
 
@@ -25,6 +25,7 @@
 #include <mapnik/feature_factory.hpp>
 
 #include "gdal_featureset.hpp"
+#include "gdal_dataset.hpp"
 #include <gdal_priv.h>
 
 // boost
@@ -41,10 +42,11 @@ using mapnik::datasource_exception;
 using mapnik::feature_factory;
 
 
-gdal_featureset::gdal_featureset(GDALDataset & dataset, int band, gdal_query q, 
+gdal_featureset::gdal_featureset(boost::shared_ptr<gdal_dataset_handle> const& handle, int band, gdal_query q, 
       mapnik::box2d<double> extent, double width, double height, int nbands, 
       double dx, double dy, double filter_factor)
-    : dataset_(dataset),
+    : handle_(handle),
+      dataset_(handle->dataset()),
       band_(band),
       gquery_(q),
       raster_extent_(extent),
@@ -61,9 +63,8 @@ gdal_featureset::gdal_featureset(GDALDataset & dataset, int band, gdal_query q,
 gdal_featureset::~gdal_featureset()
 {
 #ifdef MAPNIK_DEBUG
-    std::clog << "GDAL Plugin: closing dataset = " << &dataset_ << std::endl;
+    std::clog << "GDAL Plugin: releasing dataset = " << &dataset_ << std::endl;
 #endif
-    GDALClose(&dataset_);
 }
 
 feature_ptr gdal_featureset::next()
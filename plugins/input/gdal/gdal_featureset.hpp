@@ -29,16 +29,18 @@
 
 // boost
 #include <boost/variant.hpp>
+#include <boost/shared_ptr.hpp>
 
 class GDALDataset;
 class GDALRasterBand;
+class gdal_dataset_handle;
 
 typedef boost::variant<mapnik::query,mapnik::coord2d> gdal_query;
 
 class gdal_featureset : public mapnik::Featureset
 {
     public:
-        gdal_featureset(GDALDataset & dataset, int band, gdal_query q, 
+        gdal_featureset(boost::shared_ptr<gdal_dataset_handle> const& handle, int band, gdal_query q, 
         mapnik::box2d<double> extent, double width, double height, int nbands, 
         double dx, double dy, double filter_factor);
         virtual ~gdal_featureset();
@@ -49,6 +51,7 @@ class gdal_featureset : public mapnik::Featureset
 #ifdef MAPNIK_DEBUG
         void get_overview_meta(GDALRasterBand * band);
 #endif
+        boost::shared_ptr<gdal_dataset_handle> handle_;
         GDALDataset & dataset_;
         int band_;
         gdal_query gquery_;
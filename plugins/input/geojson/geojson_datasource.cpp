@@ -0,0 +1,156 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// boost
+#include <boost/filesystem/operations.hpp>
+#include <boost/make_shared.hpp>
+
+// stl
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "geojson_datasource.hpp"
+#include "geojson_featureset.hpp"
+
+using mapnik::datasource;
+using mapnik::parameters;
+
+DATASOURCE_PLUGIN(geojson_datasource)
+
+using mapnik::query;
+using mapnik::featureset_ptr;
+using mapnik::layer_descriptor;
+using mapnik::attribute_descriptor;
+using mapnik::datasource_exception;
+using mapnik::box2d;
+using mapnik::coord2d;
+
+geojson_datasource::geojson_datasource(parameters const& params, bool bind)
+    : datasource(params),
+      desc_(*params_.get<std::string>("type"), *params_.get<std::string>("encoding","utf-8"))
+{
+    boost::optional<std::string> file = params_.get<std::string>("file");
+    if (!file) throw datasource_exception("GeoJSON Plugin: missing <file> parameter");
+
+    boost::optional<std::string> base = params_.get<std::string>("base");
+    if (base)
+        file_ = *base + "/" + *file;
+    else
+        file_ = *file;
+
+    if (bind)
+    {
+        this->bind();
+    }
+}
+
+geojson_datasource::~geojson_datasource() {}
+
+void geojson_datasource::bind() const
+{
+    if (is_bound_) return;
+
+    if (!boost::filesystem::exists(file_))
+    {
+        throw datasource_exception("GeoJSON Plugin: file '" + file_ + "' does not exist");
+    }
+
+    std::ifstream in(file_.c_str(), std::ios::in | std::ios::binary);
+    if (!in)
+    {
+        throw datasource_exception("GeoJSON Plugin: could not open '" + file_ + "'");
+    }
+    std::string json;
+    json.reserve(boost::filesystem::file_size(file_));
+    json.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    boost::shared_ptr<geojson_store> store = boost::make_shared<geojson_store>();
+    store->parse(json);
+
+    geojson_store::fields_type const& fields = store->fields();
+    for (geojson_store::fields_type::const_iterator itr = fields.begin(); itr != fields.end(); ++itr)
+    {
+        desc_.add_descriptor(attribute_descriptor(itr->first, itr->second));
+    }
+
+#ifdef MAPNIK_DEBUG
+    std::clog << "GeoJSON Plugin: " << store->size() << " features in '" << file_
+              << "', extent=" << store->extent() << std::endl;
+#endif
+
+    store_ = store;
+    is_bound_ = true;
+}
+
+std::string geojson_datasource::name()
+{
+    return "geojson";
+}
+
+int geojson_datasource::type() const
+{
+    return datasource::Vector;
+}
+
+box2d<double> geojson_datasource::envelope() const
+{
+    if (!is_bound_) bind();
+
+    return store_->extent();
+}
+
+layer_descriptor geojson_datasource::get_descriptor() const
+{
+    if (!is_bound_) bind();
+
+    return desc_;
+}
+
+featureset_ptr geojson_datasource::features(query const& q) const
+{
+    if (!is_bound_) bind();
+
+    return features_in_box(q.get_bbox(), q.property_names());
+}
+
+featureset_ptr geojson_datasource::features_at_point(coord2d const& pt) const
+{
+    if (!is_bound_) bind();
+
+    std::set<std::string> names;
+    geojson_store::fields_type const& fields = store_->fields();
+    for (geojson_store::fields_type::const_iterator itr = fields.begin(); itr != fields.end(); ++itr)
+    {
+        names.insert(itr->first);
+    }
+    return features_in_box(box2d<double>(pt.x, pt.y, pt.x, pt.y), names);
+}
+
+featureset_ptr geojson_datasource::features_in_box(box2d<double> const& box,
+                                                   std::set<std::string> const& names) const
+{
+    std::vector<unsigned> features;
+    store_->query(box, features);
+    return boost::make_shared<geojson_featureset>(store_, boost::ref(features), names, desc_.get_encoding());
+}
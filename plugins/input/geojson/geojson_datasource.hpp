@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef GEOJSON_DATASOURCE_HPP
+#define GEOJSON_DATASOURCE_HPP
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/feature_layer_desc.hpp>
+
+// boost
+#include <boost/shared_ptr.hpp>
+
+#include "geojson_store.hpp"
+
+class geojson_datasource : public mapnik::datasource
+{
+public:
+    geojson_datasource(mapnik::parameters const& params, bool bind=true);
+    virtual ~geojson_datasource();
+    int type() const;
+    static std::string name();
+    mapnik::featureset_ptr features(mapnik::query const& q) const;
+    mapnik::featureset_ptr features_at_point(mapnik::coord2d const& pt) const;
+    mapnik::box2d<double> envelope() const;
+    mapnik::layer_descriptor get_descriptor() const;
+    void bind() const;
+private:
+    mapnik::featureset_ptr features_in_box(mapnik::box2d<double> const& box,
+                                           std::set<std::string> const& names) const;
+
+    std::string file_;
+    mutable mapnik::layer_descriptor desc_;
+    mutable boost::shared_ptr<geojson_store> store_;
+};
+
+#endif // GEOJSON_DATASOURCE_HPP
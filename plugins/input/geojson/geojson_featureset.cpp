@@ -0,0 +1,56 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// mapnik
+#include <mapnik/feature_factory.hpp>
+
+#include "geojson_featureset.hpp"
+
+using mapnik::feature_ptr;
+using mapnik::feature_factory;
+using mapnik::transcoder;
+
+geojson_featureset::geojson_featureset(boost::shared_ptr<geojson_store const> const& store,
+                                       std::vector<unsigned> & features,
+                                       std::set<std::string> const& names,
+                                       std::string const& encoding)
+    : store_(store),
+      names_(names),
+      tr_(new transcoder(encoding))
+{
+    features_.swap(features);
+    pos_ = features_.begin();
+}
+
+geojson_featureset::~geojson_featureset() {}
+
+feature_ptr geojson_featureset::next()
+{
+    if (pos_ == features_.end()) return feature_ptr();
+
+    unsigned index = *pos_++;
+    feature_ptr feature(feature_factory::create(store_->id(index)));
+    store_->add_geometries(index, *feature);
+    store_->add_properties(index, names_, *tr_, *feature);
+    return feature;
+}
@@ -0,0 +1,61 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef GEOJSON_FEATURESET_HPP
+#define GEOJSON_FEATURESET_HPP
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/unicode.hpp>
+
+// boost
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+// stl
+#include <set>
+#include <vector>
+
+#include "geojson_store.hpp"
+
+// Turns the features found by a query into mapnik features, decoding
+// only the requested properties.
+class geojson_featureset : public mapnik::Featureset
+{
+public:
+    geojson_featureset(boost::shared_ptr<geojson_store const> const& store,
+                       std::vector<unsigned> & features,
+                       std::set<std::string> const& names,
+                       std::string const& encoding);
+    virtual ~geojson_featureset();
+    mapnik::feature_ptr next();
+
+private:
+    boost::shared_ptr<geojson_store const> store_;
+    std::vector<unsigned> features_;
+    std::set<std::string> names_;
+    std::vector<unsigned>::const_iterator pos_;
+    boost::scoped_ptr<mapnik::transcoder> tr_;
+};
+
+#endif // GEOJSON_FEATURESET_HPP
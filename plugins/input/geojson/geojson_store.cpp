@@ -0,0 +1,705 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// mapnik
+#include <mapnik/datasource.hpp>
+
+// boost
+#include <boost/lexical_cast.hpp>
+
+// stl
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#include "geojson_store.hpp"
+
+using mapnik::box2d;
+using mapnik::datasource_exception;
+
+namespace {
+
+// Forward only reader over a JSON document. Strings are returned as
+// ranges of the document and only unescaped on request, so skipping
+// over values does not allocate. Comments and trailing commas, which
+// hand written files tend to have, are accepted.
+class json_reader
+{
+public:
+    typedef std::pair<char const*, char const*> range;
+
+    json_reader(char const* begin, char const* pos)
+        : begin_(begin),
+          pos_(pos) {}
+
+    char const* pos() const { return pos_; }
+    void seek(char const* pos) { pos_ = pos; }
+
+    char peek()
+    {
+        skip_ws();
+        return *pos_;
+    }
+
+    void expect(char c)
+    {
+        if (peek() != c) error(std::string("expected '") + c + "'");
+        ++pos_;
+    }
+
+    void begin_object()
+    {
+        expect('{');
+    }
+
+    // Read the key of the next member, leaving the reader on its value.
+    // Returns false at the end of the object. first tracks whether the
+    // separating comma is due, so that nested objects can be iterated.
+    bool next_member(range & key, bool & first)
+    {
+        char c = peek();
+        if (c == '}')
+        {
+            ++pos_;
+            return false;
+        }
+        if (!first)
+        {
+            expect(',');
+            if (peek() == '}')
+            {
+                ++pos_;
+                return false;
+            }
+        }
+        first = false;
+        key = string_range();
+        expect(':');
+        skip_ws();
+        return true;
+    }
+
+    bool next_element(bool & first)
+    {
+        char c = peek();
+        if (c == ']')
+        {
+            ++pos_;
+            return false;
+        }
+        if (!first)
+        {
+            expect(',');
+            if (peek() == ']')
+            {
+                ++pos_;
+                return false;
+            }
+        }
+        first = false;
+        skip_ws();
+        return true;
+    }
+
+    // the raw contents of a string value, without the quotes
+    range string_range()
+    {
+        expect('"');
+        char const* begin = pos_;
+        while (*pos_ != '"')
+        {
+            if (*pos_ == '\\') ++pos_;
+            if (*pos_ == '\0') error("unterminated string");
+            ++pos_;
+        }
+        return range(begin, pos_++);
+    }
+
+    double number()
+    {
+        skip_ws();
+        char * end;
+        double value = std::strtod(pos_, &end);
+        if (end == pos_) error("expected a number");
+        pos_ = end;
+        return value;
+    }
+
+    bool is_null()
+    {
+        if (peek() == 'n' && std::strncmp(pos_, "null", 4) == 0)
+        {
+            pos_ += 4;
+            return true;
+        }
+        return false;
+    }
+
+    void skip_value()
+    {
+        bool first = true;
+        range key;
+        switch (peek())
+        {
+        case '{':
+            ++pos_;
+            while (next_member(key, first)) skip_value();
+            break;
+        case '[':
+            ++pos_;
+            while (next_element(first)) skip_value();
+            break;
+        case '"':
+            string_range();
+            break;
+        case '\0':
+            error("unexpected end of document");
+            break;
+        default:
+            // numbers, true, false and null
+            while (*pos_ != '\0' && !std::strchr(",:]} \t\r\n/", *pos_)) ++pos_;
+            break;
+        }
+    }
+
+    void skip_ws()
+    {
+        for (;;)
+        {
+            while (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r' || *pos_ == '\n') ++pos_;
+            if (pos_[0] != '/') return;
+            if (pos_[1] == '*')
+            {
+                char const* end = std::strstr(pos_ + 2, "*/");
+                if (!end) error("unterminated comment");
+                pos_ = end + 2;
+            }
+            else if (pos_[1] == '/')
+            {
+                while (*pos_ != '\0' && *pos_ != '\n') ++pos_;
+            }
+            else
+            {
+                return;
+            }
+        }
+    }
+
+    void error(std::string const& message) const
+    {
+        throw datasource_exception("GeoJSON Plugin: " + message + " at offset " +
+                                   boost::lexical_cast<std::string>(pos_ - begin_));
+    }
+
+protected:
+    char const* begin_;
+    char const* pos_;
+};
+
+bool equals(json_reader::range const& key, char const* name)
+{
+    std::size_t size = key.second - key.first;
+    return std::strlen(name) == size && std::memcmp(key.first, name, size) == 0;
+}
+
+void append_utf8(std::string & out, unsigned code)
+{
+    if (code < 0x80)
+    {
+        out += char(code);
+    }
+    else if (code < 0x800)
+    {
+        out += char(0xC0 | (code >> 6));
+        out += char(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        out += char(0xE0 | (code >> 12));
+        out += char(0x80 | ((code >> 6) & 0x3F));
+        out += char(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        out += char(0xF0 | (code >> 18));
+        out += char(0x80 | ((code >> 12) & 0x3F));
+        out += char(0x80 | ((code >> 6) & 0x3F));
+        out += char(0x80 | (code & 0x3F));
+    }
+}
+
+unsigned parse_hex4(char const* str)
+{
+    char buffer[5] = { 0 };
+    std::strncpy(buffer, str, 4);
+    return std::strtoul(buffer, 0, 16);
+}
+
+// resolve the escape sequences of a string range into utf-8
+void unescape(json_reader::range const& str, std::string & out)
+{
+    out.clear();
+    out.reserve(str.second - str.first);
+    for (char const* pos = str.first; pos < str.second; ++pos)
+    {
+        if (*pos != '\\')
+        {
+            out += *pos;
+            continue;
+        }
+        if (++pos == str.second) break;
+        switch (*pos)
+        {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u':
+        {
+            if (str.second - pos < 5) return;
+            unsigned code = parse_hex4(pos + 1);
+            pos += 4;
+            // surrogate pair
+            if (code >= 0xD800 && code < 0xDC00 && str.second - pos >= 7 && pos[1] == '\\' && pos[2] == 'u')
+            {
+                unsigned low = parse_hex4(pos + 3);
+                if (low >= 0xDC00 && low < 0xE000)
+                {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                }
+            }
+            append_utf8(out, code);
+            break;
+        }
+        default:
+            // \" \\ \/
+            out += *pos;
+            break;
+        }
+    }
+}
+
+// Integer for numbers without fraction or exponent that fit an int
+mapnik::eAttributeType number_type(json_reader::range const& number)
+{
+    for (char const* pos = number.first; pos != number.second; ++pos)
+    {
+        if (*pos == '.' || *pos == 'e' || *pos == 'E') return mapnik::Double;
+    }
+    double value = std::strtod(number.first, 0);
+    return (value >= INT_MIN && value <= INT_MAX) ? mapnik::Integer : mapnik::Double;
+}
+
+}
+
+class geojson_store::parser : public json_reader
+{
+public:
+    explicit parser(geojson_store & store)
+        : json_reader(store.json_.c_str(), store.json_.c_str()),
+          store_(store) {}
+
+    void parse_document()
+    {
+        parse_feature();
+        if (peek() != '\0') error("unexpected content after the document");
+    }
+
+private:
+    // A Feature, or the FeatureCollection holding them
+    void parse_feature()
+    {
+        std::size_t properties_begin = 0;
+        std::size_t properties_end = 0;
+        unsigned first_part = store_.parts_.size();
+        unsigned end_part = first_part;
+        std::size_t first_coord = store_.coords_.size();
+        bool first = true;
+        range key;
+        begin_object();
+        while (next_member(key, first))
+        {
+            if (equals(key, "geometry"))
+            {
+                first_part = store_.parts_.size();
+                first_coord = store_.coords_.size();
+                parse_geometry();
+                end_part = store_.parts_.size();
+            }
+            else if (equals(key, "properties") && peek() == '{')
+            {
+                properties_begin = pos_ - begin_;
+                scan_properties();
+                properties_end = pos_ - begin_;
+            }
+            else if (equals(key, "features") && peek() == '[')
+            {
+                bool first_feature = true;
+                ++pos_;
+                while (next_element(first_feature)) parse_feature();
+            }
+            else
+            {
+                skip_value();
+            }
+        }
+        // empty geometries such as {"type":"Polygon","coordinates":[]} add
+        // parts without rings, so the coordinates of the parts are found
+        // from the size of the store rather than through its rings
+        if (end_part == first_part) return;
+        std::size_t end_coord = store_.coords_.size();
+        if (first_coord == end_coord) return;
+
+        feature_entry entry;
+        entry.id = store_.features_.size() + 1;
+        entry.first_part = first_part;
+        entry.end_part = end_part;
+        entry.properties_begin = properties_begin;
+        entry.properties_end = properties_end;
+        std::vector<double> const& coords = store_.coords_;
+        entry.envelope.init(coords[first_coord], coords[first_coord + 1],
+                            coords[first_coord], coords[first_coord + 1]);
+        for (std::size_t i = first_coord + 2; i < end_coord; i += 2)
+        {
+            entry.envelope.expand_to_include(coords[i], coords[i + 1]);
+        }
+        store_.features_.push_back(entry);
+    }
+
+    // collect the names and value types of the properties
+    void scan_properties()
+    {
+        bool first = true;
+        range key;
+        ++pos_;
+        while (next_member(key, first))
+        {
+            mapnik::eAttributeType type;
+            char const* value = pos_;
+            switch (*pos_)
+            {
+            case '"': type = mapnik::String; break;
+            case 't':
+            case 'f': type = mapnik::Boolean; break;
+            case 'n': skip_value(); continue;
+            case '{':
+            case '[': type = mapnik::String; break;
+            default: type = mapnik::Double; break;
+            }
+            skip_value();
+            if (type == mapnik::Double) type = number_type(range(value, pos_));
+            add_field(key, type);
+        }
+    }
+
+    void add_field(range const& key, mapnik::eAttributeType type)
+    {
+        if (std::memchr(key.first, '\\', key.second - key.first))
+        {
+            unescape(key, name_);
+        }
+        else
+        {
+            name_.assign(key.first, key.second);
+        }
+        std::map<std::string, unsigned>::const_iterator itr = field_index_.find(name_);
+        if (itr == field_index_.end())
+        {
+            field_index_.insert(std::make_pair(name_, unsigned(store_.fields_.size())));
+            store_.fields_.push_back(std::make_pair(name_, type));
+            return;
+        }
+        mapnik::eAttributeType & current = store_.fields_[itr->second].second;
+        if (current == type) return;
+        if ((current == mapnik::Integer || current == mapnik::Double) &&
+            (type == mapnik::Integer || type == mapnik::Double))
+        {
+            current = mapnik::Double;
+        }
+        else
+        {
+            current = mapnik::String;
+        }
+    }
+
+    void parse_geometry()
+    {
+        if (is_null()) return;
+        range type(0, 0);
+        char const* coordinates = 0;
+        char const* geometries = 0;
+        bool first = true;
+        range key;
+        begin_object();
+        while (next_member(key, first))
+        {
+            if (equals(key, "type"))
+            {
+                type = string_range();
+            }
+            else if (equals(key, "coordinates"))
+            {
+                // parsed right away unless the type comes later
+                if (type.first) parse_coordinates(type);
+                else
+                {
+                    coordinates = pos_;
+                    skip_value();
+                }
+            }
+            else if (equals(key, "geometries"))
+            {
+                geometries = pos_;
+                skip_value();
+            }
+            else
+            {
+                skip_value();
+            }
+        }
+        if (!type.first) return;
+        char const* end = pos_;
+        if (coordinates)
+        {
+            pos_ = coordinates;
+            parse_coordinates(type);
+        }
+        else if (geometries && equals(type, "GeometryCollection"))
+        {
+            pos_ = geometries;
+            bool first_geometry = true;
+            expect('[');
+            while (next_element(first_geometry)) parse_geometry();
+        }
+        pos_ = end;
+    }
+
+    void parse_coordinates(range const& type)
+    {
+        if (equals(type, "Point")) point_part();
+        else if (equals(type, "LineString")) line_part();
+        else if (equals(type, "Polygon")) polygon_part();
+        else if (equals(type, "MultiPoint")) parse_array(&parser::point_part);
+        else if (equals(type, "MultiLineString")) parse_array(&parser::line_part);
+        else if (equals(type, "MultiPolygon")) parse_array(&parser::polygon_part);
+        else skip_value();
+    }
+
+    void parse_array(void (parser::*element)())
+    {
+        bool first = true;
+        expect('[');
+        while (next_element(first)) (this->*element)();
+    }
+
+    void begin_part(mapnik::eGeomType type)
+    {
+        part p;
+        p.type = type;
+        p.first_ring = store_.rings_.size();
+        store_.parts_.push_back(p);
+    }
+
+    void begin_ring()
+    {
+        store_.rings_.push_back(store_.coords_.size() / 2);
+    }
+
+    void point_part()
+    {
+        begin_part(mapnik::Point);
+        begin_ring();
+        position();
+    }
+
+    void line_part()
+    {
+        begin_part(mapnik::LineString);
+        ring();
+    }
+
+    void polygon_part()
+    {
+        begin_part(mapnik::Polygon);
+        parse_array(&parser::ring);
+    }
+
+    void ring()
+    {
+        begin_ring();
+        parse_array(&parser::position);
+    }
+
+    // [x, y] with any further ordinates ignored
+    void position()
+    {
+        bool first = true;
+        expect('[');
+        next_element(first);
+        double x = number();
+        if (!next_element(first)) error("expected a position");
+        double y = number();
+        while (next_element(first)) number();
+        store_.coords_.push_back(x);
+        store_.coords_.push_back(y);
+    }
+
+    geojson_store & store_;
+    std::map<std::string, unsigned> field_index_;
+    std::string name_;
+};
+
+geojson_store::geojson_store() {}
+
+void geojson_store::parse(std::string & json)
+{
+    json_.swap(json);
+    parser p(*this);
+    p.parse_document();
+
+    // closing entries so that the last ring and part have an end
+    rings_.push_back(coords_.size() / 2);
+    part sentinel;
+    sentinel.type = mapnik::Point;
+    sentinel.first_ring = rings_.size() - 1;
+    parts_.push_back(sentinel);
+
+    if (features_.empty()) return;
+    extent_ = features_[0].envelope;
+    for (unsigned i = 1; i < features_.size(); ++i)
+    {
+        extent_.expand_to_include(features_[i].envelope);
+    }
+    index_.reset(new index_type(extent_));
+    for (unsigned i = 0; i < features_.size(); ++i)
+    {
+        index_->insert(i, features_[i].envelope);
+    }
+}
+
+void geojson_store::add_geometries(unsigned feature, mapnik::Feature & result) const
+{
+    feature_entry const& entry = features_[feature];
+    for (unsigned p = entry.first_part; p < entry.end_part; ++p)
+    {
+        unsigned first_ring = parts_[p].first_ring;
+        unsigned end_ring = parts_[p + 1].first_ring;
+        unsigned num_points = rings_[end_ring] - rings_[first_ring];
+        if (num_points == 0) continue;
+        mapnik::geometry_type * geom = new mapnik::geometry_type(parts_[p].type);
+        geom->set_capacity(num_points);
+        for (unsigned r = first_ring; r < end_ring; ++r)
+        {
+            unsigned first_point = rings_[r];
+            unsigned end_point = rings_[r + 1];
+            if (first_point == end_point) continue;
+            geom->move_to(coords_[2 * first_point], coords_[2 * first_point + 1]);
+            for (unsigned i = first_point + 1; i < end_point; ++i)
+            {
+                geom->line_to(coords_[2 * i], coords_[2 * i + 1]);
+            }
+        }
+        result.add_geometry(geom);
+    }
+}
+
+void geojson_store::add_properties(unsigned feature, std::set<std::string> const& names,
+                                   mapnik::transcoder const& tr, mapnik::Feature & result) const
+{
+    feature_entry const& entry = features_[feature];
+    if (names.empty() || entry.properties_begin == entry.properties_end) return;
+
+    char const* begin = json_.c_str();
+    json_reader reader(begin, begin + entry.properties_begin);
+    std::string name;
+    std::string text;
+    bool first = true;
+    json_reader::range key;
+    reader.begin_object();
+    while (reader.next_member(key, first))
+    {
+        if (std::memchr(key.first, '\\', key.second - key.first)) unescape(key, name);
+        else name.assign(key.first, key.second);
+        if (!names.count(name) || reader.is_null())
+        {
+            reader.skip_value();
+            continue;
+        }
+        char const* value = reader.pos();
+        switch (*value)
+        {
+        case '"':
+            unescape(reader.string_range(), text);
+            boost::put(result, name, tr.transcode(text.c_str(), text.size()));
+            break;
+        case 't':
+        case 'f':
+            reader.skip_value();
+            boost::put(result, name, *value == 't');
+            break;
+        case '{':
+        case '[':
+            // nested values are passed on as their json text
+            reader.skip_value();
+            boost::put(result, name, tr.transcode(value, reader.pos() - value));
+            break;
+        default:
+        {
+            reader.skip_value();
+            json_reader::range number(value, reader.pos());
+            if (number_type(number) == mapnik::Integer)
+                boost::put(result, name, int(std::strtod(value, 0)));
+            else
+                boost::put(result, name, std::strtod(value, 0));
+            break;
+        }
+        }
+    }
+}
+
+void geojson_store::query(box2d<double> const& box, std::vector<unsigned> & features) const
+{
+    if (!index_) return;
+    if (box.contains(extent_))
+    {
+        features.reserve(features_.size());
+        for (unsigned i = 0; i < features_.size(); ++i)
+        {
+            features.push_back(i);
+        }
+        return;
+    }
+    index_type::result_t candidates;
+    index_->query_in_box(box, candidates);
+    features.reserve(candidates.size());
+    for (index_type::query_iterator itr = candidates.begin(); itr != candidates.end(); ++itr)
+    {
+        if (box.intersects(features_[*itr].envelope)) features.push_back(*itr);
+    }
+    // keep the order of the document
+    std::sort(features.begin(), features.end());
+}
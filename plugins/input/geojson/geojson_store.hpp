@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef GEOJSON_STORE_HPP
+#define GEOJSON_STORE_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/quad_tree.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/attribute_descriptor.hpp>
+
+// boost
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+// stl
+#include <set>
+#include <string>
+#include <vector>
+
+// The features of a GeoJSON document. Coordinates of all features are
+// kept in one array and properties are left in the document text, with
+// only the byte range of each feature's "properties" object recorded,
+// so that values are decoded when a query asks for them.
+class geojson_store : private boost::noncopyable
+{
+public:
+    typedef mapnik::quad_tree<unsigned> index_type;
+    typedef std::vector<std::pair<std::string, mapnik::eAttributeType> > fields_type;
+
+    geojson_store();
+
+    // parse a FeatureCollection or a single Feature, taking over the
+    // contents of json; throws mapnik::datasource_exception on errors
+    void parse(std::string & json);
+
+    unsigned size() const { return features_.size(); }
+    int id(unsigned feature) const { return features_[feature].id; }
+    mapnik::box2d<double> const& envelope(unsigned feature) const { return features_[feature].envelope; }
+    mapnik::box2d<double> const& extent() const { return extent_; }
+
+    // property names in order of appearance, typed after their values
+    fields_type const& fields() const { return fields_; }
+
+    void add_geometries(unsigned feature, mapnik::Feature & result) const;
+    void add_properties(unsigned feature, std::set<std::string> const& names,
+                        mapnik::transcoder const& tr, mapnik::Feature & result) const;
+
+    // features whose envelope intersects box, in document order
+    void query(mapnik::box2d<double> const& box, std::vector<unsigned> & features) const;
+
+private:
+    class parser;
+
+    struct part
+    {
+        mapnik::eGeomType type;
+        unsigned first_ring;
+    };
+
+    struct feature_entry
+    {
+        int id;
+        unsigned first_part;
+        unsigned end_part;
+        std::size_t properties_begin;
+        std::size_t properties_end;
+        mapnik::box2d<double> envelope;
+    };
+
+    std::string json_;
+    // x,y pairs; ring i covers the points [rings_[i], rings_[i+1])
+    // and part i the rings [parts_[i].first_ring, parts_[i+1].first_ring)
+    std::vector<double> coords_;
+    std::vector<unsigned> rings_;
+    std::vector<part> parts_;
+    std::vector<feature_entry> features_;
+    fields_type fields_;
+    mapnik::box2d<double> extent_;
+    boost::scoped_ptr<index_type> index_;
+};
+
+#endif // GEOJSON_STORE_HPP
@@ -62,8 +62,52 @@ using mapnik::featureset_ptr;
 using mapnik::layer_descriptor;
 using mapnik::attribute_descriptor;
 using mapnik::datasource_exception;
-using mapnik::filter_in_box;
-using mapnik::filter_at_point;
+
+
+namespace {
+
+// query shapes are built from coordinates, the geometry
+// takes ownership of the coordinate sequences
+GEOSGeometry* make_rectangle(box2d<double> const& box)
+{
+    GEOSCoordSequence* cs = GEOSCoordSeq_create(5, 2);
+    if (cs == NULL) return NULL;
+    const double x[5] = { box.minx(), box.maxx(), box.maxx(), box.minx(), box.minx() };
+    const double y[5] = { box.miny(), box.miny(), box.maxy(), box.maxy(), box.miny() };
+    for (unsigned int i = 0; i < 5; ++i)
+    {
+        GEOSCoordSeq_setX(cs, i, x[i]);
+        GEOSCoordSeq_setY(cs, i, y[i]);
+    }
+    GEOSGeometry* shell = GEOSGeom_createLinearRing(cs);
+    if (shell == NULL) return NULL;
+    return GEOSGeom_createPolygon(shell, NULL, 0);
+}
+
+GEOSGeometry* make_point(coord2d const& pt)
+{
+    GEOSCoordSequence* cs = GEOSCoordSeq_create(1, 2);
+    if (cs == NULL) return NULL;
+    GEOSCoordSeq_setX(cs, 0, pt.x);
+    GEOSCoordSeq_setY(cs, 0, pt.y);
+    return GEOSGeom_createPoint(cs);
+}
+
+boost::shared_ptr<std::string const> to_wkb(GEOSGeometry* geometry)
+{
+    if (geometry == NULL || GEOSisEmpty(geometry))
+    {
+        return boost::shared_ptr<std::string const>();
+    }
+    geos_wkb_ptr wkb(geometry);
+    if (! wkb.is_valid())
+    {
+        return boost::shared_ptr<std::string const>();
+    }
+    return boost::make_shared<std::string>(wkb.data(), wkb.size());
+}
+
+}
 
 
 void geos_notice(const char* fmt, ...)
@@ -97,7 +141,9 @@ geos_datasource::geos_datasource(parameters const& params, bool bind)
      desc_(*params.get<std::string>("type"), *params.get<std::string>("encoding","utf-8")),
      geometry_data_(""),
      geometry_data_name_("name"),
-     geometry_id_(1)
+     geometry_id_(1),
+     polygonal_(false),
+     clip_buffer_(*params_.get<double>("clip_buffer",16.0))
 {
     boost::optional<std::string> geometry = params.get<std::string>("wkt");
     if (!geometry) throw datasource_exception("missing <wkt> parameter");
@@ -129,6 +175,7 @@ geos_datasource::~geos_datasource()
 {
     if (is_bound_) 
     {
+        prepared_.set_geometry(0);
         geometry_.set_feature(0);
 
         finishGEOS();
@@ -221,6 +268,18 @@ void geos_datasource::bind() const
 
     if (! extent_initialized_)
         throw datasource_exception("GEOS Plugin: cannot determine extent for <wkt> geometry");
+
+    // queries are answered with the prepared geometry, and queries
+    // covering the whole extent with the WKB converted here
+    prepared_.set_geometry(*geometry_);
+    if (*prepared_ == NULL)
+    {
+        throw datasource_exception("GEOS Plugin: cannot prepare <wkt> geometry");
+    }
+    wkb_ = to_wkb(*geometry_);
+
+    const int type = GEOSGeomTypeId(*geometry_);
+    polygonal_ = (type == GEOS_POLYGON || type == GEOS_MULTIPOLYGON);
    
     is_bound_ = true;
 }
@@ -253,47 +312,82 @@ featureset_ptr geos_datasource::features(query const& q) const
 {
     if (!is_bound_) bind();
 
-    const mapnik::box2d<double> extent = q.get_bbox();
+    // clip to the query box grown by clip_buffer pixels, so that the
+    // outlines the clipping adds and the ends of clipped lines are
+    // drawn outside of the rendered area
+    mapnik::box2d<double> extent = q.get_bbox();
+    const double resolution = boost::get<0>(q.resolution());
+    if (resolution > 0 && clip_buffer_ > 0)
+    {
+        const double buffer = clip_buffer_ / resolution;
+        extent.init(extent.minx() - buffer, extent.miny() - buffer,
+                    extent.maxx() + buffer, extent.maxy() + buffer);
+    }
 
-    std::ostringstream s;
-    s << "POLYGON(("
-      << extent.minx() << " " << extent.miny() << ","
-      << extent.maxx() << " " << extent.miny() << ","
-      << extent.maxx() << " " << extent.maxy() << ","
-      << extent.minx() << " " << extent.maxy() << ","
-      << extent.minx() << " " << extent.miny()
-      << "))";
+    if (! extent.intersects(extent_))
+    {
+        return featureset_ptr();
+    }
+    if (extent.contains(extent_))
+    {
+        return make_featureset(wkb_);
+    }
 
 #ifdef MAPNIK_DEBUG
-    clog << "GEOS Plugin: using extent: " << s.str() << endl;
+    clog << "GEOS Plugin: using extent: " << extent << endl;
 #endif
 
-    return boost::make_shared<geos_featureset>(*geometry_,
-                                               GEOSGeomFromWKT(s.str().c_str()),
-                                               geometry_id_,
-                                               geometry_data_,
-                                               geometry_data_name_,
-                                               desc_.get_encoding(),
-                                               multiple_geometries_);
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+
+    geos_feature_ptr rectangle(make_rectangle(extent));
+    if (*rectangle == NULL || ! GEOSPreparedIntersects(*prepared_, *rectangle))
+    {
+        return featureset_ptr();
+    }
+
+    // a rectangle inside a polygon clips it to the rectangle itself
+    if (polygonal_ && GEOSPreparedContainsProperly(*prepared_, *rectangle))
+    {
+        return make_featureset(to_wkb(*rectangle));
+    }
+
+    geos_feature_ptr clipped(GEOSIntersection(*geometry_, *rectangle));
+    return make_featureset(to_wkb(*clipped));
 }
 
 featureset_ptr geos_datasource::features_at_point(coord2d const& pt) const
 {
     if (!is_bound_) bind();
 
-    std::ostringstream s;
-    s << "POINT(" << pt.x << " " << pt.y << ")";
+    if (! extent_.contains(pt))
+    {
+        return featureset_ptr();
+    }
 
 #ifdef MAPNIK_DEBUG
-    clog << "GEOS Plugin: using point: " << s.str() << endl;
+    clog << "GEOS Plugin: using point: " << pt.x << " " << pt.y << endl;
+#endif
+
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
 #endif
 
-    return boost::make_shared<geos_featureset>(*geometry_,
-                                               GEOSGeomFromWKT(s.str().c_str()),
+    geos_feature_ptr point(make_point(pt));
+    if (*point == NULL || ! GEOSPreparedIntersects(*prepared_, *point))
+    {
+        return featureset_ptr();
+    }
+    return make_featureset(wkb_);
+}
+
+featureset_ptr geos_datasource::make_featureset(boost::shared_ptr<std::string const> const& wkb) const
+{
+    return boost::make_shared<geos_featureset>(wkb,
                                                geometry_id_,
                                                geometry_data_,
                                                geometry_data_name_,
                                                desc_.get_encoding(),
                                                multiple_geometries_);
 }
-
@@ -31,6 +31,12 @@
 
 // boost
 #include <boost/shared_ptr.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/mutex.hpp>
+#endif
+
+// stl
+#include <string>
 
 #include "geos_feature_ptr.hpp"
 
@@ -47,16 +53,27 @@ class geos_datasource : public mapnik::datasource
         mapnik::layer_descriptor get_descriptor() const;
         void bind() const;
     private:
+        mapnik::featureset_ptr make_featureset(boost::shared_ptr<std::string const> const& wkb) const;
+
         mutable mapnik::box2d<double> extent_;
         mutable bool extent_initialized_;
         int type_;
         mutable mapnik::layer_descriptor desc_;
         mutable geos_feature_ptr geometry_;
+        mutable geos_prepared_ptr prepared_;
+        // WKB of the whole geometry, empty if the geometry is empty
+        mutable boost::shared_ptr<std::string const> wkb_;
+        mutable bool polygonal_;
+#ifdef MAPNIK_THREADSAFE
+        mutable boost::mutex mutex_;
+#endif
         mutable std::string geometry_data_;
         mutable std::string geometry_data_name_;
         mutable int geometry_id_;
         std::string geometry_string_;
         bool multiple_geometries_;
+        // pixels added around the query box before clipping
+        double clip_buffer_;
 };
 
 
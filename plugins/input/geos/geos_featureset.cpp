@@ -52,16 +52,14 @@ using mapnik::transcoder;
 using mapnik::feature_factory;
 
 
-geos_featureset::geos_featureset(GEOSGeometry* geometry,
-                                 GEOSGeometry* extent,
+geos_featureset::geos_featureset(boost::shared_ptr<std::string const> const& wkb,
                                  int identifier,
                                  const std::string& field,
                                  const std::string& field_name,
                                  const std::string& encoding,
                                  bool multiple_geometries)
-   : geometry_(geometry),
+   : wkb_(wkb),
      tr_(new transcoder(encoding)),
-     extent_(extent),
      identifier_(identifier),
      field_(field),
      field_name_(field_name),
@@ -80,62 +78,23 @@ feature_ptr geos_featureset::next()
     {
         already_rendered_ = true;
         
-        if (GEOSisValid(geometry_) && ! GEOSisEmpty(geometry_))
+        if (wkb_ && ! wkb_->empty())
         {
-            bool render_geometry = true;
-            
-            if (*extent_ != NULL && GEOSisValid(*extent_) && !GEOSisEmpty(*extent_))
-            {
-                const int type = GEOSGeomTypeId(*extent_);
-                render_geometry = false;
+            feature_ptr feature(feature_factory::create(identifier_));
 
-                switch ( type )
-                {
-                case GEOS_POINT:
-                    if (GEOSIntersects(*extent_, geometry_))
-                    {
-                        render_geometry = true;
-                    }
-                    break;
-                case GEOS_POLYGON:
-                    if (GEOSContains(*extent_, geometry_)
-                        || GEOSWithin(geometry_, *extent_)
-                        || GEOSEquals(geometry_, *extent_))
-                    {
-                        render_geometry = true;
-                    }
-                    break;
-               default:
-#ifdef MAPNIK_DEBUG
-                    clog << "GEOS Plugin: unknown extent geometry_type=" << type << endl;
-#endif
-                    break;
-               }
-            }
+            geometry_utils::from_wkb(feature->paths(),
+                                     wkb_->data(),
+                                     wkb_->size(),
+                                     multiple_geometries_);
 
-            if (render_geometry)
+            if (field_ != "")
             {
-                geos_wkb_ptr wkb(geometry_);
-                if (wkb.is_valid())
-                {
-                    feature_ptr feature(feature_factory::create(identifier_));
-
-                    geometry_utils::from_wkb(feature->paths(),
-                                             wkb.data(),
-                                             wkb.size(),
-                                             multiple_geometries_);
-
-                    if (field_ != "")
-                    {
-                        boost::put(*feature, field_name_, tr_->transcode(field_.c_str()));
-                    }
-                    
-                    return feature;
-                }
+                boost::put(*feature, field_name_, tr_->transcode(field_.c_str()));
             }
+                    
+            return feature;
         }
     }
 
     return feature_ptr();
 }
-
@@ -31,17 +31,18 @@
 
 // boost
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
-// geos
-#include <geos_c.h>
+// stl
+#include <string>
 
-#include "geos_feature_ptr.hpp"
-  
+// Returns the single feature of a geos datasource, from the WKB of its
+// geometry (clipped to the query by the datasource), or nothing if wkb
+// is empty.
 class geos_featureset : public mapnik::Featureset
 {
 public:
-      geos_featureset(GEOSGeometry* geometry,
-                      GEOSGeometry* extent,
+      geos_featureset(boost::shared_ptr<std::string const> const& wkb,
                       int identifier,
                       const std::string& field,
                       const std::string& field_name,
@@ -51,9 +52,8 @@ public:
       mapnik::feature_ptr next();
 
 private:
-      GEOSGeometry* geometry_;
+      boost::shared_ptr<std::string const> wkb_;
       boost::scoped_ptr<mapnik::transcoder> tr_;
-      geos_feature_ptr extent_;
       int identifier_;
       std::string field_;
       std::string field_name_;
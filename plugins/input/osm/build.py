@@ -31,6 +31,7 @@ osm_src = Split(
   osm.cpp
   osm_datasource.cpp
   osm_featureset.cpp 
+  osm_store.cpp
   dataset_deliverer.cpp
   basiccurl.cpp
   """
@@ -40,6 +41,10 @@ libraries = [ 'xml2' ]
 libraries.append('curl')
 libraries.append('mapnik2')
 libraries.append(env['ICU_LIB_NAME'])
+libraries.append('boost_system%s' % env['BOOST_APPEND'])
+libraries.append('boost_filesystem%s' % env['BOOST_APPEND'])
+if env['THREADING'] == 'multi':
+    libraries.append('boost_thread%s' % env['BOOST_APPEND'])
 
 input_plugin = plugin_env.SharedLibrary('../osm', source=osm_src, SHLIBPREFIX='', SHLIBSUFFIX='.input', LIBS=libraries, LINKFLAGS=env['CUSTOM_LDFLAGS'])
 
@@ -21,17 +21,22 @@
  *****************************************************************************/
 
 // mapnik
-#include <mapnik/geom_util.hpp>
 #include <mapnik/query.hpp>
 
 // boost
+#include <boost/filesystem/operations.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/weak_ptr.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/mutex.hpp>
+#endif
 
 // stl
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
 #include <set>
+#include <map>
 
 #include "osm_datasource.hpp"
 #include "osm_featureset.hpp"
@@ -45,10 +50,19 @@ using mapnik::String;
 using mapnik::Double;
 using mapnik::Integer;
 using mapnik::datasource_exception;
-using mapnik::filter_in_box;
-using mapnik::filter_at_point;
 using mapnik::attribute_descriptor;
 
+namespace {
+
+// stores of the files loaded by this process, shared by datasources
+// reading the same file for as long as one of them is alive
+std::map<std::string, boost::weak_ptr<osm_store const> > loaded_stores;
+#ifdef MAPNIK_THREADSAFE
+boost::mutex loaded_stores_mutex;
+#endif
+
+}
+
 osm_datasource::osm_datasource(const parameters &params, bool bind)
    : datasource (params),
      type_(datasource::Vector),
@@ -64,13 +78,11 @@ void osm_datasource::bind() const
 {
     if (is_bound_) return;
 
-    osm_data_ = NULL;
     std::string osm_filename= *params_.get<std::string>("file","");
     std::string parser = *params_.get<std::string>("parser","libxml2");
     std::string url = *params_.get<std::string>("url","");
     std::string bbox = *params_.get<std::string>("bbox","");
-    
-    bool do_process=false;
+    std::string cache_file = *params_.get<std::string>("cache_file","");
 
     // load the data
     // if we supplied a filename, load from file
@@ -80,53 +92,110 @@ void osm_datasource::bind() const
 #ifdef MAPNIK_DEBUG
     cerr<<"loading_from_url: url="<<url << " bbox="<<bbox<<endl;
 #endif
-        if((osm_data_=dataset_deliverer::load_from_url
-            (url,bbox,parser))==NULL)
+        osm_dataset * data = dataset_deliverer::load_from_url(url,bbox,parser);
+        if (data == NULL)
         {
             throw datasource_exception("Error loading from URL");
         }
-        do_process=true;
+        boost::shared_ptr<osm_store> store = boost::make_shared<osm_store>();
+        store->build(*data);
+        store_ = store;
     }
     else if(osm_filename!="")
     {
-        if ((osm_data_=
-            dataset_deliverer::load_from_file(osm_filename,parser))==NULL)
-        {
-            throw datasource_exception("Error loading from file");
-        }
-        do_process=true;
+        store_ = load_file(osm_filename, parser, cache_file);
     }
 
-    if(do_process==true)
+    if (store_)
     {
         osm_tag_types tagtypes;
         tagtypes.add_type("maxspeed",mapnik::Integer);
         tagtypes.add_type("z_order",mapnik::Integer);
 
-        osm_data_->rewind();
-        // Need code to get the attributes of all the data
-        std::set<std::string> keys= osm_data_->get_keys();
-
         // Add the attributes to the datasource descriptor - assume they are
         // all of type String
+        std::set<std::string> keys = store_->keys();
         for(std::set<std::string>::iterator i=keys.begin(); i!=keys.end(); i++)
           desc_.add_descriptor(attribute_descriptor(*i,tagtypes.get_type(*i)));
 
-        // Get the bounds of the data and set extent_ accordingly
-        bounds b = osm_data_->get_bounds();
-        extent_ =  box2d<double>(b.w,b.s,b.e,b.n);
+        extent_ = store_->extent();
     }
     
     is_bound_ = true;
 }
 
+boost::shared_ptr<osm_store const> osm_datasource::load_file(std::string const& file,
+                                                             std::string const& parser,
+                                                             std::string const& cache_file)
+{
+    if (!boost::filesystem::exists(file))
+    {
+        throw datasource_exception("OSM Plugin: file '" + file + "' does not exist");
+    }
+    osm_store::source_stamp stamp;
+    stamp.size = boost::filesystem::file_size(file);
+    stamp.modified = boost::filesystem::last_write_time(file);
+
+    {
+#ifdef MAPNIK_THREADSAFE
+        boost::mutex::scoped_lock lock(loaded_stores_mutex);
+#endif
+        boost::shared_ptr<osm_store const> loaded = loaded_stores[file].lock();
+        if (loaded && loaded->source().size == stamp.size && loaded->source().modified == stamp.modified)
+        {
+            return loaded;
+        }
+    }
+
+    // parse without holding the lock so that datasources for other files
+    // are not held up; concurrent loads of the same file may both parse it
+    boost::shared_ptr<osm_store> store = boost::make_shared<osm_store>();
+    if (cache_file.empty() || !store->load(cache_file) ||
+        store->source().size != stamp.size || store->source().modified != stamp.modified)
+    {
+        osm_dataset data;
+        if (!data.load(file.c_str(), parser))
+        {
+            throw datasource_exception("Error loading from file");
+        }
+        store->build(data);
+        store->set_source(stamp);
+        if (!cache_file.empty())
+        {
+            try
+            {
+                store->save(cache_file);
+            }
+            catch (datasource_exception const& ex)
+            {
+                // the data is usable without the cache
+                std::clog << ex.what() << std::endl;
+            }
+        }
+    }
+#ifdef MAPNIK_DEBUG
+    else
+    {
+        std::clog << "OSM Plugin: read '" << file << "' from cache '" << cache_file << "'" << std::endl;
+    }
+#endif
 
-osm_datasource::~osm_datasource() 
-{ 
-    // Do not do as is now static variable and cleaned up at exit
-    //delete osm_data_; 
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(loaded_stores_mutex);
+#endif
+    // keep the store published by a concurrent load, if any
+    boost::shared_ptr<osm_store const> loaded = loaded_stores[file].lock();
+    if (loaded && loaded->source().size == stamp.size && loaded->source().modified == stamp.modified)
+    {
+        return loaded;
+    }
+    loaded_stores[file] = store;
+    return store;
 }
 
+
+osm_datasource::~osm_datasource() {}
+
 std::string osm_datasource::name()
 {
    return "osm";
@@ -146,20 +215,13 @@ featureset_ptr osm_datasource::features(const query& q) const
 {
     if (!is_bound_) bind();  
     
-    filter_in_box filter(q.get_bbox());
-    // so we need to filter osm features by bbox here...
-    
-    return boost::make_shared<osm_featureset<filter_in_box> >(filter,
-                                              osm_data_,
-                                              q.property_names(),
-                                              desc_.get_encoding());
+    return features_in_box(q.get_bbox(), q.property_names());
 }
 
 featureset_ptr osm_datasource::features_at_point(coord2d const& pt) const
 {
    if (!is_bound_) bind();
     
-   filter_at_point filter(pt);
    // collect all attribute names
    std::vector<attribute_descriptor> const& desc_vector = 
         desc_.get_descriptors();
@@ -173,10 +235,22 @@ featureset_ptr osm_datasource::features_at_point(coord2d const& pt) const
       ++itr;
    }
     
-    return boost::make_shared<osm_featureset<filter_at_point> >(filter,
-                                                osm_data_,
-                                                names,
-                                                desc_.get_encoding());
+   return features_in_box(box2d<double>(pt.x, pt.y, pt.x, pt.y), names);
+}
+
+featureset_ptr osm_datasource::features_in_box(box2d<double> const& box,
+                                               std::set<std::string> const& names) const
+{
+    if (!store_) return featureset_ptr();
+
+    std::vector<unsigned> items;
+    std::vector<unsigned> keys;
+    store_->query(box, items);
+    store_->lookup(names, keys);
+    return boost::make_shared<osm_featureset>(store_,
+                                              boost::ref(items),
+                                              keys,
+                                              desc_.get_encoding());
 }
 
 box2d<double> osm_datasource::envelope() const
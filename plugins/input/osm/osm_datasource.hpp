@@ -28,7 +28,9 @@
 #include <mapnik/datasource.hpp>
 #include <mapnik/box2d.hpp>
 
-#include "osm.h"
+#include <boost/shared_ptr.hpp>
+
+#include "osm_store.hpp"
 
 
 using mapnik::datasource;
@@ -56,9 +58,14 @@ class osm_datasource : public datasource
    private:
       osm_datasource(const osm_datasource&);
       osm_datasource& operator=(const osm_datasource&);
+      featureset_ptr features_in_box(box2d<double> const& box,
+                                     std::set<std::string> const& names) const;
+      static boost::shared_ptr<osm_store const> load_file(std::string const& file,
+                                                          std::string const& parser,
+                                                          std::string const& cache_file);
    private:
       mutable box2d<double> extent_;
-      mutable osm_dataset * osm_data_;
+      mutable boost::shared_ptr<osm_store const> store_;
     int type_;
     mutable layer_descriptor desc_;
 };
@@ -24,37 +24,33 @@
 #define OSM_FS_HH
 
 #include <boost/scoped_ptr.hpp>
-#include <mapnik/geom_util.hpp>
-#include "osm.h"
+#include <boost/shared_ptr.hpp>
 #include <mapnik/feature.hpp>
-#include <mapnik/query.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/datasource.hpp>
-#include <set>
+#include <vector>
+
+#include "osm_store.hpp"
 
 using mapnik::Featureset;
-using mapnik::box2d;
 using mapnik::feature_ptr;
 using mapnik::transcoder;
 
-template <typename filterT>
 class osm_featureset : public Featureset
 {
-      filterT filter_;
-      box2d<double> query_ext_;
+      boost::shared_ptr<osm_store const> store_;
+      std::vector<unsigned> items_;
+      std::vector<unsigned>::const_iterator pos_;
+      std::vector<unsigned> keys_;
       boost::scoped_ptr<transcoder> tr_;
-      std::vector<int> attr_ids_;
-      mutable box2d<double> feature_ext_;
-      mutable int total_geom_size;
-      mutable int feature_id_;
-      osm_dataset *dataset_;
-      std::set<std::string> attribute_names_;
 
    public:
-      osm_featureset(const filterT& filter, 
-                       osm_dataset *dataset, 
-                       const std::set<std::string>& attribute_names,
-                       std::string const& encoding);
+      // items are the store's items matching the query, keys the
+      // string ids of the requested attribute names
+      osm_featureset(boost::shared_ptr<osm_store const> const& store,
+                     std::vector<unsigned> & items,
+                     std::vector<unsigned> const& keys,
+                     std::string const& encoding);
       virtual ~osm_featureset();
       feature_ptr next();
    private:
@@ -0,0 +1,378 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/unicode.hpp>
+
+// boost
+#include <boost/unordered_map.hpp>
+
+// stl
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "osm_store.hpp"
+
+using mapnik::box2d;
+using mapnik::geometry_type;
+
+namespace {
+
+const char cache_magic[8] = { 'M', 'O', 'S', 'M', 'S', 'T', 'O', '1' };
+const boost::uint32_t cache_byte_order = 0x01020304;
+
+class string_table
+{
+public:
+    explicit string_table(std::vector<std::string> & strings)
+        : strings_(strings) {}
+
+    boost::uint32_t intern(std::string const& str)
+    {
+        boost::unordered_map<std::string, boost::uint32_t>::const_iterator itr = ids_.find(str);
+        if (itr != ids_.end()) return itr->second;
+        boost::uint32_t id = strings_.size();
+        strings_.push_back(str);
+        ids_.insert(std::make_pair(str, id));
+        return id;
+    }
+
+private:
+    std::vector<std::string> & strings_;
+    boost::unordered_map<std::string, boost::uint32_t> ids_;
+};
+
+template <typename T>
+void write_value(std::ostream & out, T const& value)
+{
+    out.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_value(std::istream & in, T & value)
+{
+    return !in.read(reinterpret_cast<char*>(&value), sizeof(T)).fail();
+}
+
+template <typename T>
+void write_array(std::ostream & out, std::vector<T> const& values)
+{
+    write_value(out, boost::uint64_t(values.size()));
+    if (!values.empty()) out.write(reinterpret_cast<char const*>(&values[0]), sizeof(T) * values.size());
+}
+
+template <typename T>
+bool read_array(std::istream & in, std::vector<T> & values, boost::uint64_t max_size)
+{
+    boost::uint64_t size;
+    if (!read_value(in, size) || size > max_size) return false;
+    values.resize(size);
+    return size == 0 || !in.read(reinterpret_cast<char*>(&values[0]), sizeof(T) * size).fail();
+}
+
+}
+
+osm_store::osm_store()
+    : extent_(-180, -90, 180, 90)
+{
+    source_.size = 0;
+    source_.modified = 0;
+}
+
+void osm_store::build(osm_dataset & data)
+{
+    string_table table(strings_);
+
+    items_.clear();
+    coords_.clear();
+    tags_.clear();
+    strings_.clear();
+
+    data.rewind_nodes();
+    bool first = true;
+    while (osm_node * node = data.next_node())
+    {
+        item entry;
+        entry.kind = Node;
+        entry.first_point = coords_.size() / 2;
+        coords_.push_back(node->lon);
+        coords_.push_back(node->lat);
+        entry.end_point = entry.first_point + 1;
+        entry.envelope.init(node->lon, node->lat, node->lon, node->lat);
+        if (first)
+        {
+            extent_ = entry.envelope;
+            first = false;
+        }
+        else
+        {
+            extent_.expand_to_include(node->lon, node->lat);
+        }
+        entry.first_tag = tags_.size();
+        for (std::map<std::string,std::string>::const_iterator itr = node->keyvals.begin();
+             itr != node->keyvals.end(); ++itr)
+        {
+            tag t;
+            t.key = table.intern(itr->first);
+            t.value = table.intern(itr->second);
+            tags_.push_back(t);
+        }
+        entry.end_tag = tags_.size();
+        items_.push_back(entry);
+    }
+
+    data.rewind_ways();
+    while (osm_way * way = data.next_way())
+    {
+        if (way->nodes.empty()) continue;
+        item entry;
+        entry.kind = way->is_polygon() ? Area : Way;
+        entry.first_point = coords_.size() / 2;
+        std::vector<osm_node*>::const_iterator itr = way->nodes.begin();
+        entry.envelope.init((*itr)->lon, (*itr)->lat, (*itr)->lon, (*itr)->lat);
+        for (; itr != way->nodes.end(); ++itr)
+        {
+            coords_.push_back((*itr)->lon);
+            coords_.push_back((*itr)->lat);
+            entry.envelope.expand_to_include((*itr)->lon, (*itr)->lat);
+        }
+        entry.end_point = coords_.size() / 2;
+        entry.first_tag = tags_.size();
+        for (std::map<std::string,std::string>::const_iterator tag_itr = way->keyvals.begin();
+             tag_itr != way->keyvals.end(); ++tag_itr)
+        {
+            tag t;
+            t.key = table.intern(tag_itr->first);
+            t.value = table.intern(tag_itr->second);
+            tags_.push_back(t);
+        }
+        entry.end_tag = tags_.size();
+        items_.push_back(entry);
+    }
+
+    build_index();
+}
+
+void osm_store::build_index()
+{
+    index_.reset(new index_type(extent_));
+    for (unsigned i = 0; i < items_.size(); ++i)
+    {
+        index_->insert(i, items_[i].envelope);
+    }
+
+    std::vector<bool> is_key(strings_.size(), false);
+    for (std::vector<tag>::const_iterator itr = tags_.begin(); itr != tags_.end(); ++itr)
+    {
+        is_key[itr->key] = true;
+    }
+    keys_.clear();
+    for (unsigned i = 0; i < strings_.size(); ++i)
+    {
+        if (is_key[i]) keys_.push_back(std::make_pair(strings_[i], i));
+    }
+    std::sort(keys_.begin(), keys_.end());
+}
+
+bool osm_store::load(std::string const& file)
+{
+    std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+    if (!in) return false;
+
+    char magic[8];
+    boost::uint32_t byte_order;
+    boost::uint32_t sizes[3];
+    double extent[4];
+    if (!in.read(magic, 8) || std::memcmp(magic, cache_magic, 8) != 0 ||
+        !read_value(in, byte_order) || byte_order != cache_byte_order ||
+        !read_value(in, sizes) ||
+        sizes[0] != sizeof(item) || sizes[1] != sizeof(tag) || sizes[2] != sizeof(double) ||
+        !read_value(in, source_) || !read_value(in, extent))
+    {
+        return false;
+    }
+
+    in.seekg(0, std::ios::end);
+    boost::uint64_t file_size = in.tellg();
+    in.seekg(8 + sizeof(byte_order) + sizeof(sizes) + sizeof(source_) + sizeof(extent), std::ios::beg);
+
+    std::vector<char> text;
+    std::vector<boost::uint32_t> offsets;
+    if (!read_array(in, items_, file_size / sizeof(item)) ||
+        !read_array(in, coords_, file_size / sizeof(double)) ||
+        !read_array(in, tags_, file_size / sizeof(tag)) ||
+        !read_array(in, offsets, file_size / sizeof(boost::uint32_t)) ||
+        !read_array(in, text, file_size) ||
+        offsets.empty() || offsets.back() != text.size())
+    {
+        return false;
+    }
+
+    strings_.clear();
+    strings_.reserve(offsets.size() - 1);
+    for (unsigned i = 0; i + 1 < offsets.size(); ++i)
+    {
+        if (offsets[i] > offsets[i + 1]) return false;
+        strings_.push_back(std::string(text.begin() + offsets[i], text.begin() + offsets[i + 1]));
+    }
+
+    // reject references out of range so that a damaged file cannot crash queries
+    unsigned num_points = coords_.size() / 2;
+    for (std::vector<item>::const_iterator itr = items_.begin(); itr != items_.end(); ++itr)
+    {
+        if (itr->first_point >= itr->end_point || itr->end_point > num_points ||
+            itr->first_tag > itr->end_tag || itr->end_tag > tags_.size())
+        {
+            return false;
+        }
+    }
+    for (std::vector<tag>::const_iterator itr = tags_.begin(); itr != tags_.end(); ++itr)
+    {
+        if (itr->key >= strings_.size() || itr->value >= strings_.size()) return false;
+    }
+
+    extent_.init(extent[0], extent[1], extent[2], extent[3]);
+    build_index();
+    return true;
+}
+
+void osm_store::save(std::string const& file) const
+{
+    std::ofstream out(file.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out)
+    {
+        throw mapnik::datasource_exception("OSM Plugin: cannot write cache file '" + file + "'");
+    }
+
+    boost::uint32_t sizes[3] = { sizeof(item), sizeof(tag), sizeof(double) };
+    double extent[4] = { extent_.minx(), extent_.miny(), extent_.maxx(), extent_.maxy() };
+    out.write(cache_magic, 8);
+    write_value(out, cache_byte_order);
+    write_value(out, sizes);
+    write_value(out, source_);
+    write_value(out, extent);
+
+    std::vector<char> text;
+    std::vector<boost::uint32_t> offsets;
+    offsets.reserve(strings_.size() + 1);
+    offsets.push_back(0);
+    for (std::vector<std::string>::const_iterator itr = strings_.begin(); itr != strings_.end(); ++itr)
+    {
+        text.insert(text.end(), itr->begin(), itr->end());
+        offsets.push_back(text.size());
+    }
+
+    write_array(out, items_);
+    write_array(out, coords_);
+    write_array(out, tags_);
+    write_array(out, offsets);
+    write_array(out, text);
+
+    if (!out)
+    {
+        throw mapnik::datasource_exception("OSM Plugin: failed writing cache file '" + file + "'");
+    }
+}
+
+std::set<std::string> osm_store::keys() const
+{
+    std::set<std::string> result;
+    for (unsigned i = 0; i < keys_.size(); ++i)
+    {
+        result.insert(result.end(), keys_[i].first);
+    }
+    return result;
+}
+
+void osm_store::lookup(std::set<std::string> const& names, std::vector<unsigned> & ids) const
+{
+    ids.clear();
+    for (std::set<std::string>::const_iterator itr = names.begin(); itr != names.end(); ++itr)
+    {
+        std::vector<std::pair<std::string, unsigned> >::const_iterator pos =
+            std::lower_bound(keys_.begin(), keys_.end(), std::make_pair(*itr, 0u));
+        if (pos != keys_.end() && pos->first == *itr) ids.push_back(pos->second);
+    }
+    std::sort(ids.begin(), ids.end());
+}
+
+void osm_store::query(box2d<double> const& box, std::vector<unsigned> & items) const
+{
+    if (!index_) return;
+    if (box.contains(extent_))
+    {
+        items.reserve(items_.size());
+        for (unsigned i = 0; i < items_.size(); ++i)
+        {
+            items.push_back(i);
+        }
+        return;
+    }
+    index_type::result_t candidates;
+    index_->query_in_box(box, candidates);
+    items.reserve(candidates.size());
+    for (index_type::query_iterator itr = candidates.begin(); itr != candidates.end(); ++itr)
+    {
+        if (box.intersects(items_[*itr].envelope)) items.push_back(*itr);
+    }
+    std::sort(items.begin(), items.end());
+}
+
+void osm_store::add_geometry(unsigned index, mapnik::Feature & feature) const
+{
+    item const& entry = items_[index];
+    geometry_type * geom;
+    switch (entry.kind)
+    {
+    case Node: geom = new geometry_type(mapnik::Point); break;
+    case Area: geom = new geometry_type(mapnik::Polygon); break;
+    default: geom = new geometry_type(mapnik::LineString); break;
+    }
+    geom->set_capacity(entry.end_point - entry.first_point);
+    double const* coords = &coords_[2 * entry.first_point];
+    geom->move_to(coords[0], coords[1]);
+    for (unsigned i = 1; i < entry.end_point - entry.first_point; ++i)
+    {
+        geom->line_to(coords[2 * i], coords[2 * i + 1]);
+    }
+    feature.add_geometry(geom);
+}
+
+void osm_store::add_tags(unsigned index, std::vector<unsigned> const& keys,
+                         mapnik::transcoder const& tr, mapnik::Feature & feature) const
+{
+    if (keys.empty()) return;
+    item const& entry = items_[index];
+    for (unsigned i = entry.first_tag; i < entry.end_tag; ++i)
+    {
+        tag const& t = tags_[i];
+        if (std::binary_search(keys.begin(), keys.end(), t.key))
+        {
+            std::string const& value = strings_[t.value];
+            feature[strings_[t.key]] = tr.transcode(value.c_str(), value.size());
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef OSM_STORE_HPP
+#define OSM_STORE_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/quad_tree.hpp>
+
+// boost
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+// stl
+#include <set>
+#include <string>
+#include <vector>
+
+#include "osm.h"
+
+// Compact, read only copy of an osm_dataset: way node references are
+// resolved into coordinate arrays, tag keys and values are interned into
+// one string table and items are indexed by their envelopes. The store
+// can be saved to and loaded from a cache file so that the XML does not
+// have to be parsed again.
+class osm_store : private boost::noncopyable
+{
+public:
+    typedef mapnik::quad_tree<unsigned> index_type;
+
+    enum item_kind
+    {
+        Node = 0,
+        Way = 1,
+        Area = 2
+    };
+
+    struct source_stamp
+    {
+        boost::int64_t size;
+        boost::int64_t modified;
+    };
+
+    osm_store();
+
+    // copy the nodes and ways of data; ways without nodes are dropped
+    void build(osm_dataset & data);
+
+    // stamp of the file the data was read from, used to validate caches
+    void set_source(source_stamp const& stamp) { source_ = stamp; }
+    source_stamp const& source() const { return source_; }
+
+    // returns false if file is missing, damaged or written by an
+    // incompatible build
+    bool load(std::string const& file);
+    // throws mapnik::datasource_exception if file cannot be written
+    void save(std::string const& file) const;
+
+    unsigned size() const { return items_.size(); }
+    mapnik::box2d<double> const& extent() const { return extent_; }
+    // every tag key, sorted
+    std::set<std::string> keys() const;
+
+    // the string table ids of names; names that never occur are left out
+    void lookup(std::set<std::string> const& names, std::vector<unsigned> & ids) const;
+
+    // items whose envelope intersects box, nodes before ways
+    void query(mapnik::box2d<double> const& box, std::vector<unsigned> & items) const;
+
+    // geometry and the tags whose key id is in keys (sorted)
+    void add_geometry(unsigned item, mapnik::Feature & feature) const;
+    void add_tags(unsigned item, std::vector<unsigned> const& keys,
+                  mapnik::transcoder const& tr, mapnik::Feature & feature) const;
+
+private:
+    struct item
+    {
+        boost::uint32_t kind;
+        boost::uint32_t first_point;
+        boost::uint32_t end_point;
+        boost::uint32_t first_tag;
+        boost::uint32_t end_tag;
+        mapnik::box2d<double> envelope;
+    };
+
+    struct tag
+    {
+        boost::uint32_t key;
+        boost::uint32_t value;
+    };
+
+    // index the items and the tag keys
+    void build_index();
+
+    std::vector<item> items_;
+    std::vector<double> coords_;
+    std::vector<tag> tags_;
+    std::vector<std::string> strings_;
+    // (key, string id), sorted by key
+    std::vector<std::pair<std::string, unsigned> > keys_;
+    mapnik::box2d<double> extent_;
+    source_stamp source_;
+    boost::scoped_ptr<index_type> index_;
+};
+
+#endif // OSM_STORE_HPP
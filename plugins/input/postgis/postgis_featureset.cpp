@@ -65,131 +65,159 @@ postgis_featureset::postgis_featureset(boost::shared_ptr<IResultSet> const& rs,
 feature_ptr postgis_featureset::next()
 {
     if (rs_->next())
-    { 
-        // new feature
-        feature_ptr feature;
+    {
+        return read_feature();
+    }
+    rs_->close();
+    return feature_ptr();
+}
+
+std::size_t postgis_featureset::next_batch(feature_ptr * features, std::size_t size)
+{
+    // the cursor fetches rows in blocks, decode as many as fit in one
+    // call instead of one Featureset::next() call per feature
+    std::size_t count = 0;
+    while (count < size)
+    {
+        if (!rs_->next())
+        {
+            rs_->close();
+            break;
+        }
+        features[count++] = read_feature();
+    }
+    return count;
+}
+
+feature_ptr postgis_featureset::read_feature()
+{
+    if (names_.empty())
+    {
+        for (unsigned pos = 0; pos < num_attrs_ + 1; ++pos)
+        {
+            names_.push_back(rs_->getFieldName(pos));
+            oids_.push_back(rs_->getTypeOID(pos));
+        }
+    }
 
-        unsigned pos = 1;
+    // new feature
+    feature_ptr feature;
 
-        if (key_field_) {
-            // create feature with user driven id from attribute
-            int oid = rs_->getTypeOID(pos);
+    unsigned pos = 1;
+
+    if (key_field_) {
+        // create feature with user driven id from attribute
+        int oid = oids_[pos];
+        const char* buf = rs_->getValue(pos);
+        std::string const& name = names_[pos];
+        // validation happens of this type at bind()
+        int val;
+        if (oid == 20)
+        {
+            val = int8net(buf);
+        }
+        else if (oid == 21)
+        {
+            val = int2net(buf);
+        }
+        else
+        {
+            val = int4net(buf);
+        }
+        feature = feature_factory::create(val);
+        // TODO - extend feature class to know
+        // that its id is also an attribute to avoid
+        // this duplication
+        boost::put(*feature,name,val);
+        ++pos;
+    } else {
+        // fallback to auto-incrementing id
+        feature = feature_factory::create(feature_id_);
+        ++feature_id_;
+    }
+
+    // parse geometry
+    int size = rs_->getFieldLength(0);
+    const char *data = rs_->getValue(0);
+    geometry_utils::from_wkb(feature->paths(),data,size,multiple_geometries_);
+    totalGeomSize_+=size;
+      
+    for ( ;pos<num_attrs_+1;++pos)
+    {
+        std::string const& name = names_[pos];
+
+        if (rs_->isNull(pos))
+        {
+            boost::put(*feature,name,mapnik::value_null());
+        }
+        else
+        {
             const char* buf = rs_->getValue(pos);
-            std::string name = rs_->getFieldName(pos);
-            // validation happens of this type at bind()
-            int val;
-            if (oid == 20)
+            int oid = oids_[pos];
+       
+            if (oid==16) //bool
             {
-                val = int8net(buf);
+                boost::put(*feature,name,buf[0] != 0);
             }
-            else if (oid == 21)
+            else if (oid==23) //int4
             {
-                val = int2net(buf);
+                int val = int4net(buf);
+                boost::put(*feature,name,val);
             }
-            else
+            else if (oid==21) //int2
             {
-                val = int4net(buf);
+                int val = int2net(buf);
+                boost::put(*feature,name,val);
             }
-            feature = feature_factory::create(val);
-            // TODO - extend feature class to know
-            // that its id is also an attribute to avoid
-            // this duplication
-            boost::put(*feature,name,val);
-            ++pos;
-        } else {
-            // fallback to auto-incrementing id
-            feature = feature_factory::create(feature_id_);
-            ++feature_id_;
-        }
-
-        // parse geometry
-        int size = rs_->getFieldLength(0);
-        const char *data = rs_->getValue(0);
-        geometry_utils::from_wkb(feature->paths(),data,size,multiple_geometries_);
-        totalGeomSize_+=size;
-          
-        for ( ;pos<num_attrs_+1;++pos)
-        {
-            std::string name = rs_->getFieldName(pos);
-
-            if (rs_->isNull(pos))
+            else if (oid==20) //int8/BigInt
             {
-                boost::put(*feature,name,mapnik::value_null());
+                int val = int8net(buf);
+                boost::put(*feature,name,val);
             }
-            else
+            else if (oid == 700) // float4
             {
-                const char* buf = rs_->getValue(pos);
-                int oid = rs_->getTypeOID(pos);
-           
-                if (oid==16) //bool
-                {
-                    boost::put(*feature,name,buf[0] != 0);
-                }
-                else if (oid==23) //int4
-                {
-                    int val = int4net(buf);
-                    boost::put(*feature,name,val);
-                }
-                else if (oid==21) //int2
-                {
-                    int val = int2net(buf);
-                    boost::put(*feature,name,val);
-                }
-                else if (oid==20) //int8/BigInt
-                {
-                    int val = int8net(buf);
-                    boost::put(*feature,name,val);
-                }
-                else if (oid == 700) // float4
-                {
-                    float val;
-                    float4net(val,buf);
-                    boost::put(*feature,name,val);
-                }
-                else if (oid == 701) // float8
+                float val;
+                float4net(val,buf);
+                boost::put(*feature,name,val);
+            }
+            else if (oid == 701) // float8
+            {
+                double val;
+                float8net(val,buf);
+                boost::put(*feature,name,val);
+            }
+            else if (oid==25 || oid==1043) // text or varchar
+            {
+                UnicodeString ustr = tr_->transcode(buf);
+                boost::put(*feature,name,ustr);
+            }
+            else if (oid==1042)
+            {
+                UnicodeString ustr = tr_->transcode(trim_copy(std::string(buf)).c_str()); // bpchar
+                boost::put(*feature,name,ustr);
+            }
+            else if (oid == 1700) // numeric
+            {
+                std::string str = mapnik::numeric2string(buf);
+                try 
                 {
-                    double val;
-                    float8net(val,buf);
+                    double val = boost::lexical_cast<double>(str);
                     boost::put(*feature,name,val);
                 }
-                else if (oid==25 || oid==1043) // text or varchar
-                {
-                    UnicodeString ustr = tr_->transcode(buf);
-                    boost::put(*feature,name,ustr);
-                }
-                else if (oid==1042)
+                catch (boost::bad_lexical_cast & ex)
                 {
-                    UnicodeString ustr = tr_->transcode(trim_copy(std::string(buf)).c_str()); // bpchar
-                    boost::put(*feature,name,ustr);
+                    std::clog << ex.what() << "\n"; 
                 }
-                else if (oid == 1700) // numeric
-                {
-                    std::string str = mapnik::numeric2string(buf);
-                    try 
-                    {
-                        double val = boost::lexical_cast<double>(str);
-                        boost::put(*feature,name,val);
-                    }
-                    catch (boost::bad_lexical_cast & ex)
-                    {
-                        std::clog << ex.what() << "\n"; 
-                    }
-                }
-                else 
-                {
+            }
+            else 
+            {
 #ifdef MAPNIK_DEBUG
-                    std::clog << "Postgis Plugin: uknown OID = " << oid << " FIXME " << std::endl;
+                std::clog << "Postgis Plugin: uknown OID = " << oid << " FIXME " << std::endl;
 #endif
-                }
             }
         }
-        return feature;
-    }
-    else
-    {
-        rs_->close();
-        return feature_ptr();
     }
+    return feature;
 }
 
 
@@ -33,6 +33,10 @@
 
 #include <boost/scoped_ptr.hpp>
 
+// stl
+#include <string>
+#include <vector>
+
 using mapnik::Featureset;
 using mapnik::box2d;
 using mapnik::feature_ptr;
@@ -50,6 +54,9 @@ private:
     int totalGeomSize_;
     int feature_id_;
     bool key_field_;
+    // column names and type oids, the same for every row
+    std::vector<std::string> names_;
+    std::vector<int> oids_;
 public:
     postgis_featureset(boost::shared_ptr<IResultSet> const& rs,
                        std::string const& encoding,
@@ -57,8 +64,10 @@ public:
                        bool key_field,
                        unsigned num_attrs);
     mapnik::feature_ptr next();
+    std::size_t next_batch(mapnik::feature_ptr * features, std::size_t size);
     ~postgis_featureset();
 private:
+    mapnik::feature_ptr read_feature();
     postgis_featureset(const postgis_featureset&);
     const postgis_featureset& operator=(const postgis_featureset&);
 };
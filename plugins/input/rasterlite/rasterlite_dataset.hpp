@@ -0,0 +1,123 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2007 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef RASTERLITE_DATASET_HPP
+#define RASTERLITE_DATASET_HPP
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/pool.hpp>
+
+// boost
+#include <boost/utility.hpp>
+
+// stl
+#include <string>
+
+#include "rasterlite_include.hpp"
+
+// An open Rasterlite handle kept in a rasterlite_datasource's pool. Handles
+// that have sat unused for longer than the idle timeout report themselves as
+// not OK so that the pool drops (and closes) them on the next borrow or
+// return.
+class rasterlite_dataset_handle : public mapnik::pool_idle_timeout,
+                                  private boost::noncopyable
+{
+public:
+    rasterlite_dataset_handle(void * dataset, unsigned idle_timeout)
+        : mapnik::pool_idle_timeout(idle_timeout),
+          dataset_(dataset) {}
+
+    ~rasterlite_dataset_handle()
+    {
+#ifdef MAPNIK_DEBUG
+        std::clog << "Rasterlite Plugin: closing dataset = " << dataset_ << std::endl;
+#endif
+        if (dataset_) rasterliteClose(dataset_);
+    }
+
+    bool isOK() const
+    {
+        return dataset_ != 0 && !expired();
+    }
+
+    void * dataset()
+    {
+        return dataset_;
+    }
+
+private:
+    void * dataset_;
+};
+
+
+// Opens the dataset handles pooled by each rasterlite datasource
+template <typename T>
+class rasterlite_dataset_creator
+{
+public:
+    rasterlite_dataset_creator(std::string const& dataset_name,
+                               std::string const& table_name,
+                               unsigned idle_timeout)
+        : dataset_name_(dataset_name),
+          table_name_(table_name),
+          idle_timeout_(idle_timeout) {}
+
+    T* operator()() const
+    {
+#ifdef MAPNIK_DEBUG
+        std::clog << "Rasterlite Plugin: opening: " << dataset_name_ << std::endl;
+#endif
+
+        void *dataset = rasterliteOpen(dataset_name_.c_str(), table_name_.c_str());
+
+        if (! dataset) throw mapnik::datasource_exception("Rasterlite Plugin: Error opening dataset");
+
+        if (rasterliteIsError(dataset))
+        {
+            std::string error(rasterliteGetLastError(dataset));
+
+            rasterliteClose(dataset);
+
+            throw mapnik::datasource_exception(error);
+        }
+
+        // these are per handle, so set them once rather than per query
+        rasterliteSetBackgroundColor(dataset, 255, 0, 255);
+        rasterliteSetTransparentColor(dataset, 255, 0, 255);
+
+        return new T(dataset, idle_timeout_);
+    }
+
+    std::string id() const
+    {
+        return dataset_name_ + ":" + table_name_;
+    }
+
+private:
+    std::string dataset_name_;
+    std::string table_name_;
+    unsigned idle_timeout_;
+};
+
+#endif // RASTERLITE_DATASET_HPP
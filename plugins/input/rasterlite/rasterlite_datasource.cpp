@@ -28,6 +28,9 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/make_shared.hpp>
 
+// stl
+#include <algorithm>
+
 // mapnik
 #include <mapnik/ptree_helpers.hpp>
 #include <mapnik/geom_util.hpp>
@@ -46,33 +49,10 @@ using mapnik::datasource_exception;
 
 
 
-/*
- * Opens a GDALDataset and returns a pointer to it.
- * Caller is responsible for calling GDALClose on it
- */
-inline void *rasterlite_datasource::open_dataset() const
-{
-    void *dataset = rasterliteOpen (dataset_name_.c_str(), table_name_.c_str());
-   
-    if (! dataset) throw datasource_exception("Rasterlite Plugin: Error opening dataset");
-
-    if (rasterliteIsError (dataset))
-    {
-        std::string error (rasterliteGetLastError(dataset));
-
-        rasterliteClose (dataset);
-   
-        throw datasource_exception(error);
-    }
-
-    return dataset;
-}
-
-
-
 rasterlite_datasource::rasterlite_datasource(parameters const& params, bool bind)
     : datasource(params),
-      desc_(*params.get<std::string>("type"),"utf-8")
+      desc_(*params.get<std::string>("type"),"utf-8"),
+      tile_size_(*params.get<unsigned>("tile_size",256))
 {
 #ifdef MAPNIK_DEBUG
     std::clog << "Rasterlite Plugin: Initializing..." << std::endl;
@@ -92,6 +72,16 @@ rasterlite_datasource::rasterlite_datasource(parameters const& params, bool bind
     else
         dataset_name_ = *file;
 
+    if (tile_size_ == 0) throw datasource_exception("Rasterlite Plugin: <tile_size> must be positive");
+
+    // decoded blocks are shared by every query against this datasource;
+    // cache_max is in megabytes and 0 turns the cache off
+    unsigned cache_max = *params.get<unsigned>("cache_max",16);
+    if (cache_max > 0)
+    {
+        tile_cache_ = boost::make_shared<rasterlite_tile_cache>(std::size_t(cache_max) * 1024 * 1024);
+    }
+
     if (bind)
     {
         this->bind();
@@ -104,19 +94,44 @@ void rasterlite_datasource::bind() const
     
     if (!boost::filesystem::exists(dataset_name_)) throw datasource_exception(dataset_name_ + " does not exist");
 
-    void *dataset = open_dataset();
+    // handles are kept open in a pool and handed out one per featureset,
+    // so tiles do not pay for re-opening the sqlite database
+    creator_ = boost::make_shared<rasterlite_dataset_creator<rasterlite_dataset_handle> >(
+        dataset_name_, table_name_, *params_.get<unsigned>("idle_timeout",0));
+    pool_ = boost::make_shared<pool_type>(*creator_,
+                                          *params_.get<int>("initial_size",1),
+                                          *params_.get<int>("max_size",10));
+
+    boost::shared_ptr<rasterlite_dataset_handle> handle = borrow_dataset();
+    void *dataset = handle->dataset();
    
     double x0, y0, x1, y1;
     if (rasterliteGetExtent (dataset, &x0, &y0, &x1, &y1) != RASTERLITE_OK)
     {
-        std::string error (rasterliteGetLastError(dataset));
-
-        rasterliteClose (dataset);
-   
-        throw datasource_exception(error);
+        throw datasource_exception(rasterliteGetLastError(dataset));
     }
 
     extent_.init(x0,y0,x1,y1);
+
+    // pixel sizes of the pyramid levels, finest first
+    int levels = rasterliteGetLevels (dataset);
+    for (int i = 0; i < levels; i++)
+    {
+        double pixel_x_size, pixel_y_size;
+        int tile_count;
+        if (rasterliteGetResolution(dataset, i, &pixel_x_size, &pixel_y_size, &tile_count) == RASTERLITE_OK
+            && pixel_x_size > 0)
+        {
+#ifdef MAPNIK_DEBUG
+            std::clog << "Rasterlite Plugin: Level=" << i
+                << " x=" << pixel_x_size << " y=" << pixel_y_size << " tiles=" << tile_count << std::endl;
+#endif
+            levels_.push_back(pixel_x_size);
+        }
+    }
+    std::sort(levels_.begin(), levels_.end());
+
+    if (levels_.empty()) throw datasource_exception("Rasterlite Plugin: no pyramid levels in " + table_name_);
    
 #ifdef MAPNIK_DEBUG
     int srid, auth_srid;
@@ -124,17 +139,9 @@ void rasterlite_datasource::bind() const
     const char *ref_sys_name;
     const char *proj4text;
 
-    int tile_count;
-    double pixel_x_size, pixel_y_size;
-    int levels = rasterliteGetLevels (dataset);
-
     if (rasterliteGetSrid(dataset, &srid, &auth_name, &auth_srid, &ref_sys_name, &proj4text) != RASTERLITE_OK)
     { 
-        std::string error (rasterliteGetLastError(dataset));
-
-        rasterliteClose (dataset);
-   
-        throw datasource_exception(error);
+        throw datasource_exception(rasterliteGetLastError(dataset));
     }
 
     std::clog << "Rasterlite Plugin: Data Source=" << rasterliteGetTablePrefix(dataset) << std::endl;
@@ -145,19 +152,8 @@ void rasterlite_datasource::bind() const
     std::clog << "Rasterlite Plugin: Proj4Text=" << proj4text << std::endl;
     std::clog << "Rasterlite Plugin: Extent(" << x0 << "," << y0 << " " << x1 << "," << y1 << ")" << std::endl;
     std::clog << "Rasterlite Plugin: Levels=" << levels << std::endl;
-   
-    for (int i = 0; i < levels; i++)
-    {
-        if (rasterliteGetResolution(dataset, i, &pixel_x_size, &pixel_y_size, &tile_count) == RASTERLITE_OK)
-        {
-            std::clog << "Rasterlite Plugin: Level=" << i
-                << " x=" << pixel_x_size << " y=" << pixel_y_size << " tiles=" << tile_count << std::endl;
-        }
-    }
 #endif
 
-    rasterliteClose(dataset);
-   
     is_bound_ = true;
 }
 
@@ -187,12 +183,18 @@ layer_descriptor rasterlite_datasource::get_descriptor() const
     return desc_;
 }
 
+boost::shared_ptr<rasterlite_dataset_handle> rasterlite_datasource::borrow_dataset() const
+{
+    return mapnik::borrow_pooled(pool_, *creator_);
+}
+
 featureset_ptr rasterlite_datasource::features(query const& q) const
 {
     if (!is_bound_) bind();
 
     rasterlite_query gq = q;
-    return boost::make_shared<rasterlite_featureset>(open_dataset(), gq);
+    return boost::make_shared<rasterlite_featureset>(borrow_dataset(), tile_cache_,
+                                                     levels_, extent_, tile_size_, gq);
 }
 
 featureset_ptr rasterlite_datasource::features_at_point(coord2d const& pt) const
@@ -200,6 +202,7 @@ featureset_ptr rasterlite_datasource::features_at_point(coord2d const& pt) const
     if (!is_bound_) bind();
    
     rasterlite_query gq = pt;
-    return boost::make_shared<rasterlite_featureset>(open_dataset(), gq);
+    return boost::make_shared<rasterlite_featureset>(borrow_dataset(), tile_cache_,
+                                                     levels_, extent_, tile_size_, gq);
 }
 
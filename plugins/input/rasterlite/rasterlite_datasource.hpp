@@ -25,9 +25,14 @@
 #define RASTERLITE_DATASOURCE_HPP
 
 #include <mapnik/datasource.hpp>
+#include <mapnik/pool.hpp>
 #include <boost/shared_ptr.hpp>
 
-#include "rasterlite_include.hpp"
+// stl
+#include <vector>
+
+#include "rasterlite_dataset.hpp"
+#include "rasterlite_tile_cache.hpp"
 
 class rasterlite_datasource : public mapnik::datasource 
 {
@@ -42,13 +47,19 @@ class rasterlite_datasource : public mapnik::datasource
         mapnik::layer_descriptor get_descriptor() const;
         void bind() const;
     private:
-        inline void *open_dataset() const;
+        typedef mapnik::Pool<rasterlite_dataset_handle,rasterlite_dataset_creator> pool_type;
+        boost::shared_ptr<rasterlite_dataset_handle> borrow_dataset() const;
         mutable mapnik::box2d<double> extent_;
         std::string dataset_name_;
         std::string table_name_;
         mapnik::layer_descriptor desc_;
         unsigned width_;
         unsigned height_;
+        unsigned tile_size_;
+        mutable std::vector<double> levels_;
+        mutable boost::shared_ptr<rasterlite_dataset_creator<rasterlite_dataset_handle> > creator_;
+        mutable boost::shared_ptr<pool_type> pool_;
+        boost::shared_ptr<rasterlite_tile_cache> tile_cache_;
 };
 
 #endif // RASTERLITE_DATASOURCE_HPP
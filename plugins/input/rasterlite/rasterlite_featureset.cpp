@@ -22,6 +22,7 @@
 //$Id$
 
 #include "rasterlite_featureset.hpp"
+#include "rasterlite_dataset.hpp"
 
 // mapnik
 #include <mapnik/image_util.hpp>
@@ -30,6 +31,11 @@
 // boost
 #include <boost/make_shared.hpp>
 
+// stl
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
 
 using mapnik::query;
 using mapnik::coord2d;
@@ -40,24 +46,31 @@ using mapnik::CoordTransform;
 using mapnik::geometry_type;
 using mapnik::query;
 using mapnik::feature_factory;
-
-
-rasterlite_featureset::rasterlite_featureset(void* dataset, rasterlite_query q)
-   : dataset_(dataset),
+using mapnik::image_data_32;
+
+
+rasterlite_featureset::rasterlite_featureset(boost::shared_ptr<rasterlite_dataset_handle> const& handle,
+                                             boost::shared_ptr<rasterlite_tile_cache> const& tile_cache,
+                                             std::vector<double> const& levels,
+                                             box2d<double> const& extent,
+                                             unsigned tile_size,
+                                             rasterlite_query q)
+   : handle_(handle),
+     dataset_(handle->dataset()),
+     tile_cache_(tile_cache),
+     levels_(levels),
+     raster_extent_(extent),
+     tile_size_(tile_size),
      gquery_(q),
      first_(true)
 {
-    rasterliteSetBackgroundColor(dataset_, 255, 0, 255);
-    rasterliteSetTransparentColor(dataset_, 255, 0, 255);
 }
 
 rasterlite_featureset::~rasterlite_featureset()
 {
 #ifdef MAPNIK_DEBUG
-    std::clog << "Rasterlite Plugin: closing dataset" << std::endl;
+    std::clog << "Rasterlite Plugin: releasing dataset = " << dataset_ << std::endl;
 #endif
-
-    rasterliteClose(dataset_);
 }
 
 feature_ptr rasterlite_featureset::next()
@@ -86,70 +99,125 @@ feature_ptr rasterlite_featureset::get_feature(mapnik::query const& q)
     std::clog << "Rasterlite Plugin: get_feature" << std::endl;
 #endif
 
-    feature_ptr feature(feature_factory::create(1));
+    box2d<double> intersect = raster_extent_.intersect(q.get_bbox());
+    const double resolution = boost::get<0>(q.resolution());
 
-    double x0, y0, x1, y1;
-    rasterliteGetExtent (dataset_, &x0, &y0, &x1, &y1);
+    if (resolution <= 0 || intersect.width() <= 0 || intersect.height() <= 0)
+    {
+        return feature_ptr();
+    }
 
-    box2d<double> raster_extent(x0,y0,x1,y1); 
-    box2d<double> intersect = raster_extent.intersect(q.get_bbox());
+    // read the level at its native pixel size, so rasterlite does not
+    // resample and the decoded blocks can be reused by other queries
+    const unsigned level = rasterlite_select_level(levels_, resolution);
+    const double pixel_size = levels_[level];
 
-    const int width = static_cast<int>(boost::get<0>(q.resolution()) * intersect.width() + 0.5);
-    const int height = static_cast<int>(boost::get<0>(q.resolution()) * intersect.height() + 0.5);
+    // pixel window of the intersection in the level's grid,
+    // anchored at the top left corner of the raster
+    const double x0 = raster_extent_.minx();
+    const double y1 = raster_extent_.maxy();
+    const int max_x = static_cast<int>(std::ceil(raster_extent_.width() / pixel_size - 1e-9));
+    const int max_y = static_cast<int>(std::ceil(raster_extent_.height() / pixel_size - 1e-9));
+    const int px0 = std::max(0, static_cast<int>(std::floor((intersect.minx() - x0) / pixel_size + 1e-9)));
+    const int px1 = std::min(max_x, static_cast<int>(std::ceil((intersect.maxx() - x0) / pixel_size - 1e-9)));
+    const int py0 = std::max(0, static_cast<int>(std::floor((y1 - intersect.maxy()) / pixel_size + 1e-9)));
+    const int py1 = std::min(max_y, static_cast<int>(std::ceil((y1 - intersect.miny()) / pixel_size - 1e-9)));
 
-    const double pixel_size = (intersect.width() >= intersect.height()) ?
-        (intersect.width() / (double) width) : (intersect.height() / (double) height);
+    const int width = px1 - px0;
+    const int height = py1 - py0;
+
+    box2d<double> image_extent(x0 + px0 * pixel_size, y1 - py1 * pixel_size,
+                               x0 + px1 * pixel_size, y1 - py0 * pixel_size);
 
 #ifdef MAPNIK_DEBUG         
-    std::clog << "Rasterlite Plugin: Raster extent=" << raster_extent << std::endl;
+    std::clog << "Rasterlite Plugin: Raster extent=" << raster_extent_ << std::endl;
     std::clog << "Rasterlite Plugin: View extent=" << q.get_bbox() << std::endl;
     std::clog << "Rasterlite Plugin: Intersect extent=" << intersect << std::endl;
     std::clog << "Rasterlite Plugin: Query resolution=" << boost::get<0>(q.resolution()) 
         << "," << boost::get<1>(q.resolution())  << std::endl;
+    std::clog << "Rasterlite Plugin: Level=" << level << " Pixel Size=" << pixel_size << std::endl;
     std::clog << "Rasterlite Plugin: Size=" << width << " " << height << std::endl;
-    std::clog << "Rasterlite Plugin: Pixel Size=" << pixel_size << std::endl;
+    std::clog << "Rasterlite Plugin: Image extent=" << image_extent << std::endl;
 #endif
 
     if (width > 0 && height > 0)
     {
-        int size = 0;
-        void *raster = 0;
+        feature_ptr feature(feature_factory::create(1));
+
+        image_data_32 image(width, height);
+        image.set(0);
 
-        if (rasterliteGetRawImageByRect(dataset_,
-            intersect.minx(), intersect.miny(), intersect.maxx(), intersect.maxy(),
-            pixel_size, width, height, GAIA_RGBA_ARRAY, &raster, &size) == RASTERLITE_OK)
+        const int tile_size = static_cast<int>(tile_size_);
+        for (int row = py0 / tile_size; row <= (py1 - 1) / tile_size; ++row)
         {
-            if (size > 0)
+            for (int col = px0 / tile_size; col <= (px1 - 1) / tile_size; ++col)
             {
-                mapnik::image_data_32 image(width, height);
-                image.set(0xffffffff);
-
-                unsigned char* raster_data = static_cast<unsigned char*>(raster);
-                unsigned char* image_data = image.getBytes();
-
-                memcpy (image_data, raster_data, size);
-
-                feature->set_raster(boost::make_shared<mapnik::raster>(intersect,image));
+                rasterlite_tile_ptr tile = get_tile(level, col, row);
+                if (!tile) continue;
+
+                const int xs = std::max(px0, col * tile_size);
+                const int xe = std::min(px1, (col + 1) * tile_size);
+                const int ys = std::max(py0, row * tile_size);
+                const int ye = std::min(py1, (row + 1) * tile_size);
+                for (int y = ys; y < ye; ++y)
+                {
+                    std::memcpy(image.getRow(y - py0) + (xs - px0),
+                                tile->getRow(y - row * tile_size) + (xs - col * tile_size),
+                                (xe - xs) * sizeof(image_data_32::pixel_type));
+                }
+            }
+        }
 
-                free (raster);
+        feature->set_raster(boost::make_shared<mapnik::raster>(image_extent,image));
 
 #ifdef MAPNIK_DEBUG         
-                std::clog << "Rasterlite Plugin: done" << std::endl;
+        std::clog << "Rasterlite Plugin: done" << std::endl;
 #endif
-            }
-            else
-            {
-#ifdef MAPNIK_DEBUG         
-                std::clog << "Rasterlite Plugin: error=" << rasterliteGetLastError (dataset_) << std::endl;
-#endif
-            }
-        }
-      
         return feature;
     }
     return feature_ptr();
 }
 
+rasterlite_tile_ptr rasterlite_featureset::get_tile(unsigned level, int col, int row)
+{
+    rasterlite_tile_key key(level, col, row);
+    rasterlite_tile_ptr tile;
+    if (tile_cache_ && tile_cache_->find(key, tile)) return tile;
+
+    const double pixel_size = levels_[level];
+    const double span = tile_size_ * pixel_size;
+    const double minx = raster_extent_.minx() + col * span;
+    const double maxy = raster_extent_.maxy() - row * span;
+
+    int size = 0;
+    void *raster = 0;
+
+    if (rasterliteGetRawImageByRect(dataset_,
+        minx, maxy - span, minx + span, maxy,
+        pixel_size, tile_size_, tile_size_, GAIA_RGBA_ARRAY, &raster, &size) == RASTERLITE_OK
+        && size > 0)
+    {
+        boost::shared_ptr<image_data_32> data = boost::make_shared<image_data_32>(tile_size_, tile_size_);
+        const std::size_t bytes = std::min(static_cast<std::size_t>(size),
+                                           tile_size_ * tile_size_ * sizeof(image_data_32::pixel_type));
+        std::memcpy(data->getBytes(), raster, bytes);
+        tile = data;
+    }
+    else
+    {
+#ifdef MAPNIK_DEBUG         
+        std::clog << "Rasterlite Plugin: error=" << rasterliteGetLastError (dataset_) << std::endl;
+#endif
+    }
+
+    // a failed block is cached for a short while as well, see rasterlite_tile_cache
+    if (tile_cache_) tile_cache_->insert(key, tile);
+
+    if (raster) free (raster);
+
+    return tile;
+}
+
 
 feature_ptr rasterlite_featureset::get_feature_at_point(mapnik::coord2d const& pt)
 {
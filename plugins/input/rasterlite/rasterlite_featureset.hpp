@@ -26,21 +26,39 @@
 
 #include <mapnik/datasource.hpp>
 #include <boost/variant.hpp>
+#include <boost/shared_ptr.hpp>
+
+// stl
+#include <vector>
 
 #include "rasterlite_include.hpp"
+#include "rasterlite_tile_cache.hpp"
+
+class rasterlite_dataset_handle;
 
 typedef boost::variant<mapnik::query,mapnik::coord2d> rasterlite_query;
 
 class rasterlite_featureset : public mapnik::Featureset
 {
     public:
-        rasterlite_featureset(void* dataset, rasterlite_query q);
+        rasterlite_featureset(boost::shared_ptr<rasterlite_dataset_handle> const& handle,
+                              boost::shared_ptr<rasterlite_tile_cache> const& tile_cache,
+                              std::vector<double> const& levels,
+                              mapnik::box2d<double> const& extent,
+                              unsigned tile_size,
+                              rasterlite_query q);
         virtual ~rasterlite_featureset();
         mapnik::feature_ptr next();
     private:
         mapnik::feature_ptr get_feature(mapnik::query const& q);
         mapnik::feature_ptr get_feature_at_point(mapnik::coord2d const& p);
+        rasterlite_tile_ptr get_tile(unsigned level, int col, int row);
+        boost::shared_ptr<rasterlite_dataset_handle> handle_;
         void* dataset_;
+        boost::shared_ptr<rasterlite_tile_cache> tile_cache_;
+        std::vector<double> levels_;
+        mapnik::box2d<double> raster_extent_;
+        unsigned tile_size_;
         rasterlite_query gquery_;
         bool first_;
 };
@@ -0,0 +1,189 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2007 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+#ifndef RASTERLITE_TILE_CACHE_HPP
+#define RASTERLITE_TILE_CACHE_HPP
+
+// mapnik
+#include <mapnik/image_data.hpp>
+
+// boost
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/mutex.hpp>
+#endif
+
+// stl
+#include <list>
+#include <map>
+#include <vector>
+#include <ctime>
+
+// Position of a decoded block in the block grid of one pyramid level
+struct rasterlite_tile_key
+{
+    rasterlite_tile_key(unsigned level, int col, int row)
+        : level(level), col(col), row(row) {}
+
+    bool operator<(rasterlite_tile_key const& other) const
+    {
+        if (level != other.level) return level < other.level;
+        if (row != other.row) return row < other.row;
+        return col < other.col;
+    }
+
+    unsigned level;
+    int col;
+    int row;
+};
+
+typedef boost::shared_ptr<mapnik::image_data_32 const> rasterlite_tile_ptr;
+
+// Index of the coarsest pyramid level (levels hold pixel sizes from the
+// finest up) that still has at least the requested resolution, in pixels
+// per map unit, at its native pixel size
+inline unsigned rasterlite_select_level(std::vector<double> const& levels, double resolution)
+{
+    const double wanted = 1.0 / resolution;
+    unsigned level = 0;
+    while (level + 1 < levels.size() && levels[level + 1] <= wanted * (1.0 + 1e-9))
+    {
+        ++level;
+    }
+    return level;
+}
+
+// Least recently used cache of decoded RGBA blocks, shared by all
+// featuresets of a rasterlite datasource and bounded by its size in bytes.
+// Blocks that failed to read are kept as null tiles for failed_ttl seconds,
+// so a hole in the coverage is not requested from the database on every
+// query while a transient failure (a locked database) is retried soon.
+class rasterlite_tile_cache : private boost::noncopyable
+{
+public:
+    explicit rasterlite_tile_cache(std::size_t max_bytes, unsigned failed_ttl = 10)
+        : max_bytes_(max_bytes),
+          bytes_(0),
+          failed_ttl_(failed_ttl) {}
+
+    // false if the block is not cached, otherwise true with tile set to
+    // the block or to null if it failed to read
+    bool find(rasterlite_tile_key const& key, rasterlite_tile_ptr & tile)
+    {
+#ifdef MAPNIK_THREADSAFE
+        boost::mutex::scoped_lock lock(mutex_);
+#endif
+        entry_map::iterator itr = index_.find(key);
+        if (itr == index_.end()) return false;
+        if (!itr->second->tile && std::time(0) >= itr->second->expires)
+        {
+            erase(itr);
+            return false;
+        }
+        // move to front of the lru list
+        entries_.splice(entries_.begin(), entries_, itr->second);
+        tile = itr->second->tile;
+        return true;
+    }
+
+    // tile may be null to record a block that failed to read
+    void insert(rasterlite_tile_key const& key, rasterlite_tile_ptr const& tile)
+    {
+        std::size_t size = tile_bytes(tile);
+        if (size > max_bytes_) return;
+#ifdef MAPNIK_THREADSAFE
+        boost::mutex::scoped_lock lock(mutex_);
+#endif
+        entry_map::iterator itr = index_.find(key);
+        if (itr != index_.end())
+        {
+            erase(itr);
+        }
+        entry e;
+        e.key = key;
+        e.tile = tile;
+        e.expires = std::time(0) + failed_ttl_;
+        entries_.push_front(e);
+        index_.insert(std::make_pair(key, entries_.begin()));
+        bytes_ += size;
+
+        while (bytes_ > max_bytes_ && !entries_.empty())
+        {
+            erase(index_.find(entries_.back().key));
+        }
+    }
+
+    std::size_t size() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        boost::mutex::scoped_lock lock(mutex_);
+#endif
+        return index_.size();
+    }
+
+    std::size_t bytes() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        boost::mutex::scoped_lock lock(mutex_);
+#endif
+        return bytes_;
+    }
+
+private:
+    struct entry
+    {
+        entry() : key(0, 0, 0), expires(0) {}
+        rasterlite_tile_key key;
+        rasterlite_tile_ptr tile;
+        // only used by null tiles
+        std::time_t expires;
+    };
+    typedef std::list<entry> entry_list;
+    typedef std::map<rasterlite_tile_key, entry_list::iterator> entry_map;
+
+    // failed blocks are charged the size of their entry
+    static std::size_t tile_bytes(rasterlite_tile_ptr const& tile)
+    {
+        if (!tile) return sizeof(entry_list::value_type) + sizeof(entry_map::value_type);
+        return tile->width() * tile->height() * sizeof(mapnik::image_data_32::pixel_type);
+    }
+
+    void erase(entry_map::iterator itr)
+    {
+        bytes_ -= tile_bytes(itr->second->tile);
+        entries_.erase(itr->second);
+        index_.erase(itr);
+    }
+
+    std::size_t max_bytes_;
+    std::size_t bytes_;
+    unsigned failed_ttl_;
+    entry_list entries_;
+    entry_map index_;
+#ifdef MAPNIK_THREADSAFE
+    mutable boost::mutex mutex_;
+#endif
+};
+
+#endif // RASTERLITE_TILE_CACHE_HPP
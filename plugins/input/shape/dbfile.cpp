@@ -28,16 +28,161 @@
 
 // boost
 #include <boost/algorithm/string.hpp>
-#include <boost/spirit/include/qi.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <mapnik/mapped_memory_cache.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/mutex.hpp>
+#endif
 // stl
 #include <string>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <algorithm>
+#include <ctime>
+
+const char dbf_file::COLUMNS_MAGIC[8] = { 'M', 'D', 'B', 'F', 'C', 'O', 'L', '1' };
+
+namespace {
+
+inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+                         1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+// Parse the numeric fields of a record without copying them. Values with
+// more digits than fit exactly or with exponents go through strtol/strtod.
+int parse_int_fallback(const char* start, const char* end)
+{
+    std::string text(start, end);
+    long val = std::strtol(text.c_str(), 0, 10);
+    if (val > std::numeric_limits<int>::max()) return std::numeric_limits<int>::max();
+    if (val < std::numeric_limits<int>::min()) return std::numeric_limits<int>::min();
+    return static_cast<int>(val);
+}
 
+double parse_double_fallback(const char* start, const char* end)
+{
+    std::string text(start, end);
+    return std::strtod(text.c_str(), 0);
+}
+
+int parse_int(const char* itr, const char* end)
+{
+    const char* start = itr;
+    while (itr != end && is_blank(*itr)) ++itr;
+    bool negative = false;
+    if (itr != end && (*itr == '-' || *itr == '+'))
+    {
+        negative = (*itr == '-');
+        ++itr;
+    }
+    const char* digits = itr;
+    int val = 0;
+    while (itr != end && *itr >= '0' && *itr <= '9' && itr - digits < 9)
+    {
+        val = val * 10 + (*itr - '0');
+        ++itr;
+    }
+    if (itr != end && *itr >= '0' && *itr <= '9')
+    {
+        return parse_int_fallback(start, end);
+    }
+    return negative ? -val : val;
+}
+
+double parse_double(const char* itr, const char* end)
+{
+    const char* start = itr;
+    while (itr != end && is_blank(*itr)) ++itr;
+    bool negative = false;
+    if (itr != end && (*itr == '-' || *itr == '+'))
+    {
+        negative = (*itr == '-');
+        ++itr;
+    }
+    // at most 15 significant digits, so the mantissa is exact as a double
+    boost::int64_t mantissa = 0;
+    int num_digits = 0;
+    int decimals = 0;
+    bool digits = false;
+    bool point = false;
+    for (; itr != end; ++itr)
+    {
+        if (*itr >= '0' && *itr <= '9')
+        {
+            digits = true;
+            if (mantissa > 0 || *itr != '0')
+            {
+                if (++num_digits > 15) return parse_double_fallback(start, end);
+            }
+            mantissa = mantissa * 10 + (*itr - '0');
+            if (point) ++decimals;
+        }
+        else if (*itr == '.' && !point)
+        {
+            point = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (decimals > 15 || (itr != end && (!digits || *itr == 'e' || *itr == 'E')))
+    {
+        return parse_double_fallback(start, end);
+    }
+    // both operands are exact, so the quotient is correctly rounded
+    double val = static_cast<double>(mantissa) / pow10[decimals];
+    return negative ? -val : val;
+}
+
+// Whether the column sidecar of a dbf is at least as new as the dbf,
+// remembered along with the modification time of the dbf it was checked
+// against. While the dbf is unchanged only the dbf itself is stat'ed.
+struct columns_check
+{
+    std::time_t dbf_time;
+    bool current;
+};
+
+std::map<std::string, columns_check> checked_columns;
+#ifdef MAPNIK_THREADSAFE
+boost::mutex checked_columns_mutex;
+#endif
+
+bool columns_are_current(std::string const& columns_name, std::string const& file_name)
+{
+    if (!boost::filesystem::exists(file_name)) return false;
+    std::time_t dbf_time = boost::filesystem::last_write_time(file_name);
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(checked_columns_mutex);
+#endif
+    std::map<std::string, columns_check>::const_iterator itr = checked_columns.find(columns_name);
+    if (itr != checked_columns.end() && itr->second.dbf_time == dbf_time) return itr->second.current;
+    columns_check check;
+    check.dbf_time = dbf_time;
+    check.current = boost::filesystem::exists(columns_name) &&
+        boost::filesystem::last_write_time(columns_name) >= dbf_time;
+    checked_columns[columns_name] = check;
+    return check.current;
+}
+
+}
 
 dbf_file::dbf_file()
     : num_records_(0),
       num_fields_(0),
       record_length_(0),
+#ifdef SHAPE_MEMORY_MAPPED_FILE
+      data_(0),
+      size_(0),
+#endif
+      index_(0),
       record_(0) {}
 
 dbf_file::dbf_file(std::string const& file_name)
@@ -46,9 +191,12 @@ dbf_file::dbf_file(std::string const& file_name)
      record_length_(0),
 #ifdef SHAPE_MEMORY_MAPPED_FILE
      file_(),
+     data_(0),
+     size_(0),
 #else
      file_(file_name.c_str() ,std::ios::in | std::ios::binary),
 #endif
+     index_(0),
      record_(0)
 {
 
@@ -56,20 +204,20 @@ dbf_file::dbf_file(std::string const& file_name)
     boost::optional<mapnik::mapped_region_ptr> memory = mapnik::mapped_memory_cache::find(file_name.c_str(),true);
     if (memory)
     {
-        file_.buffer(static_cast<char*>((*memory)->get_address()),(*memory)->get_size());
+        data_ = static_cast<const char*>((*memory)->get_address());
+        size_ = (*memory)->get_size();
+        file_.buffer(const_cast<char*>(data_),size_);
     }
 #endif 
     if (file_)
     {
         read_header();
+        read_columns(file_name);
     }
 }
 
 
-dbf_file::~dbf_file()
-{
-    ::operator delete(record_);
-}
+dbf_file::~dbf_file() {}
 
 
 bool dbf_file::is_open()
@@ -95,20 +243,43 @@ int dbf_file::num_fields() const
 
 void dbf_file::move_to(int index)
 {
+    // the record itself is fetched when a column needs it
     if (index>0 && index<=num_records_)
     {
-        std::streampos pos=(num_fields_<<5)+34+(index-1)*(record_length_+1);
-        file_.seekg(pos,std::ios::beg);
-        file_.read(record_,record_length_);
+        index_ = index;
+        record_ = 0;
     }
 }
 
 
-std::string dbf_file::string_value(int col) const
+const char* dbf_file::record()
 {
-    if (col>=0 && col<num_fields_)
+    if (record_ || index_ == 0 || record_length_ == 0) return record_;
+
+    std::size_t pos=(num_fields_<<5)+34+(index_-1)*(record_length_+1);
+#ifdef SHAPE_MEMORY_MAPPED_FILE
+    if (pos + record_length_ <= size_)
+    {
+        record_ = data_ + pos;
+    }
+#else
+    file_.clear();
+    file_.seekg(pos,std::ios::beg);
+    if (file_.read(&buffer_[0],record_length_))
     {
-        return std::string(record_+fields_[col].offset_,fields_[col].length_);
+        record_ = &buffer_[0];
+    }
+#endif
+    return record_;
+}
+
+
+std::string dbf_file::string_value(int col)
+{
+    const char* data = record();
+    if (data && col>=0 && col<num_fields_)
+    {
+        return std::string(data+fields_[col].offset_,fields_[col].length_);
     }
     return "";
 }
@@ -121,56 +292,156 @@ const field_descriptor& dbf_file::descriptor(int col) const
 }
 
 
-void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, Feature const& f) const throw()
+bool dbf_file::has_column_data(int col) const
+{
+    return col>=0 && col<num_fields_ && columns_[col].type_ != 0;
+}
+
+
+void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, Feature const& f) throw()
 {
-    using namespace boost::spirit;
+    if (col<0 || col>=num_fields_ || index_ == 0) return;
 
-    if (col>=0 && col<num_fields_)
+    std::string const& name=fields_[col].name_;
+
+    column_data const& column = columns_[col];
+    if (column.type_ != 0)
     {
-        std::string name=fields_[col].name_;
-        
-        switch (fields_[col].type_)
+        switch (column.type_)
+        {
+        case 'i':
+        {
+            boost::int32_t val;
+            boost::put(f,name,int(mapnik::read_int32_ndr(column.data_ + 4 * (index_ - 1), val)));
+            break;
+        }
+        case 'd':
+        {
+            double val;
+            boost::put(f,name,mapnik::read_double_ndr(column.data_ + 8 * (index_ - 1), val));
+            break;
+        }
+        default:
         {
-        case 'C':
-        case 'D'://todo handle date?
-        case 'M':
-        case 'L':
+            boost::int32_t begin, end;
+            mapnik::read_int32_ndr(column.data_ + 4 * (index_ - 1), begin);
+            mapnik::read_int32_ndr(column.data_ + 4 * index_, end);
+            const char* text = column.data_ + 4 * (num_records_ + 1);
+            f[name] = tr.transcode(text + begin, end - begin);
+            break;
+        }
+        }
+        return;
+    }
+
+    const char* data = record();
+    if (!data) return;
+    const char* itr = data + fields_[col].offset_;
+    const char* end = itr + fields_[col].length_;
+
+    switch (fields_[col].type_)
+    {
+    case 'C':
+    case 'D'://todo handle date?
+    case 'M':
+    case 'L':
+    {
+        // text ends at the first NUL, as with the c string it used to be read as
+        const char* nul = static_cast<const char*>(std::memchr(itr, '\0', end - itr));
+        if (nul) end = nul;
+        while (itr != end && is_blank(*itr)) ++itr;
+        while (end != itr && is_blank(*(end - 1))) --end;
+        f[name] = tr.transcode(itr, end - itr);
+        break;
+    }
+    case 'N':
+    case 'F':
+    {
+        if (*itr == '*')
         {
-            // FIXME - avoid constructing std::string on stack
-            std::string str(record_+fields_[col].offset_,fields_[col].length_);
-            boost::trim(str);
-            f[name] = tr.transcode(str.c_str()); 
+            boost::put(f,name,0);
             break;
         }
-        case 'N':
-        case 'F':
+        if ( fields_[col].dec_>0 )
+        {
+            boost::put(f,name,parse_double(itr,end));
+        }
+        else
+        {
+            boost::put(f,name,parse_int(itr,end));
+        }
+        break;
+    }
+    }
+}
+
+
+void dbf_file::read_columns(std::string const& file_name)
+{
+    columns_.resize(num_fields_);
+    for (int i = 0; i < num_fields_; ++i)
+    {
+        columns_[i].type_ = 0;
+        columns_[i].data_ = 0;
+    }
+
+    std::string columns_name = file_name;
+    if (boost::algorithm::iends_with(columns_name, ".dbf"))
+    {
+        columns_name.erase(columns_name.size() - 4);
+    }
+    columns_name += ".dbc";
+    if (!columns_are_current(columns_name, file_name)) return;
+
+    boost::optional<mapnik::mapped_region_ptr> region = mapnik::mapped_memory_cache::find(columns_name, true);
+    if (!region) return;
+    const char* data = static_cast<const char*>((*region)->get_address());
+    std::size_t size = (*region)->get_size();
+
+    boost::int32_t num_records, record_length, num_columns;
+    if (size < 20 || std::memcmp(data, COLUMNS_MAGIC, 8) != 0 ||
+        mapnik::read_int32_ndr(data + 8, num_records) != num_records_ ||
+        mapnik::read_int32_ndr(data + 12, record_length) != boost::int32_t(record_length_) ||
+        mapnik::read_int32_ndr(data + 16, num_columns) < 0 ||
+        20 + std::size_t(num_columns) * 16 > size)
+    {
+#ifdef MAPNIK_DEBUG
+        std::clog << "Shape Plugin: ignoring column file '" << columns_name << "'" << std::endl;
+#endif
+        return;
+    }
+
+    for (int i = 0; i < num_columns; ++i)
+    {
+        const char* entry = data + 20 + i * 16;
+        std::string name(entry, std::find(entry, entry + 11, '\0'));
+        char type = entry[11];
+        boost::int32_t offset;
+        mapnik::read_int32_ndr(entry + 12, offset);
+
+        std::size_t length = 0;
+        if (type == 'i') length = 4 * std::size_t(num_records);
+        else if (type == 'd') length = 8 * std::size_t(num_records);
+        else if (type == 's') length = 4 * (std::size_t(num_records) + 1);
+        if (length == 0 || offset < 0 || std::size_t(offset) + length > size) continue;
+        if (type == 's')
         {
-            
-            if (record_[fields_[col].offset_] == '*')
+            boost::int32_t text_length;
+            mapnik::read_int32_ndr(data + offset + 4 * num_records, text_length);
+            if (text_length < 0 || std::size_t(offset) + length + text_length > size) continue;
+        }
+
+        for (int col = 0; col < num_fields_; ++col)
+        {
+            if (fields_[col].name_ == name)
             {
-                boost::put(f,name,0);
+                columns_[col].type_ = type;
+                columns_[col].data_ = data + offset;
                 break;
             }
-            if ( fields_[col].dec_>0 )
-            {   
-                double val = 0.0;
-                const char *itr = record_+fields_[col].offset_;
-                const char *end = itr + fields_[col].length_;
-                qi::phrase_parse(itr,end,double_,ascii::space,val);
-                boost::put(f,name,val); 
-            }
-            else
-            {
-                int val = 0; 
-                const char *itr = record_+fields_[col].offset_;
-                const char *end = itr + fields_[col].length_;
-                qi::phrase_parse(itr,end,int_,ascii::space,val);
-                boost::put(f,name,val); 
-            }
-            break;
-        }
         }
     }
+    columns_region_ = *region;
 }
 
 void dbf_file::read_header()
@@ -206,10 +477,9 @@ void dbf_file::read_header()
             fields_.push_back(desc);
         }
         record_length_=offset;
-        if (record_length_>0)
-        {
-            record_=static_cast<char*>(::operator new (sizeof(char)*record_length_));
-        }
+#ifndef SHAPE_MEMORY_MAPPED_FILE
+        buffer_.resize(record_length_);
+#endif
     }
 }
 
@@ -24,6 +24,7 @@
 #define DBFFILE_HPP
 
 #include <mapnik/feature.hpp>
+#include <mapnik/mapped_memory_cache.hpp>
 // boost
 #include <boost/utility.hpp>
 #include <boost/interprocess/streams/bufferstream.hpp>
@@ -48,20 +49,48 @@ struct field_descriptor
 };
 
 
+// Records are read in place when the file is memory mapped
+// (SHAPE_MEMORY_MAPPED_FILE) and only fetched when a column that is not
+// in the column sidecar is requested.
+//
+// The sidecar <name>.dbc, written by 'shapeindex --columns', holds
+// selected columns already converted, all values little endian:
+//
+//   "MDBFCOL1" | int32 num_records | int32 record_length | int32 num_columns
+//   per column: char name[11] | char type | int32 data offset
+//   'i' columns: int32[num_records], 'd' columns: double[num_records]
+//   's' columns: int32 offsets[num_records+1] into the trimmed text following them
+//
+// It is ignored unless it matches the dbf header and is newer than the dbf,
+// which is checked once per process.
 class dbf_file : private boost::noncopyable
 {
 private:
+    struct column_data
+    {
+        char type_;
+        const char* data_;
+    };
+
     int num_records_;
     int num_fields_;
     std::size_t record_length_;
     std::vector<field_descriptor> fields_;
 #ifdef SHAPE_MEMORY_MAPPED_FILE
     boost::interprocess::ibufferstream file_;
+    const char* data_;
+    std::size_t size_;
 #else
     std::ifstream file_;
+    std::vector<char> buffer_;
 #endif
-    char* record_;
+    int index_;
+    const char* record_;
+    std::vector<column_data> columns_;
+    mapnik::mapped_region_ptr columns_region_;
 public:
+    static const char COLUMNS_MAGIC[8];
+
     dbf_file();
     dbf_file(const std::string& file_name);
     ~dbf_file();
@@ -70,10 +99,13 @@ public:
     int num_fields() const;
     field_descriptor const& descriptor(int col) const;
     void move_to(int index);
-    std::string string_value(int col) const;
-    void add_attribute(int col, transcoder const& tr, Feature const& f) const throw();
+    std::string string_value(int col);
+    void add_attribute(int col, transcoder const& tr, Feature const& f) throw();
+    bool has_column_data(int col) const;
 private:
+    const char* record();
     void read_header();
+    void read_columns(std::string const& file_name);
     int read_short();
     int read_int();
     void skip(int bytes);
@@ -34,6 +34,7 @@
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
+#include <algorithm>
 
 #include "shape_datasource.hpp"
 #include "shape_featureset.hpp"
@@ -138,6 +139,7 @@ void shape_datasource::bind() const
         // for indexed shapefiles we keep open the file descriptor for fast reads
         if (indexed_) {
             shape_ = shape_ref;
+            init_lods();
         }
 
     }
@@ -224,6 +226,43 @@ void  shape_datasource::init(shape_io& shape) const
 
 }
 
+void shape_datasource::init_lods() const
+{
+    // levels of detail written by 'shapeindex --lod', one
+    // "<tolerance> <suffix>" line per level
+    std::ifstream file((shape_name_ + ".lod").c_str());
+    double tolerance;
+    std::string suffix;
+    while (file >> tolerance >> suffix)
+    {
+        try
+        {
+            boost::shared_ptr<shape_io> lod = boost::make_shared<shape_io>(shape_name_, true, shape_name_ + suffix);
+            if (lod->has_index())
+            {
+                lods_.push_back(std::make_pair(tolerance, lod));
+            }
+        }
+        catch (const datasource_exception& ex)
+        {
+            std::clog << "Shape Plugin: ignoring level of detail '" << suffix << "', " << ex.what() << std::endl;
+        }
+    }
+    std::sort(lods_.begin(), lods_.end());
+}
+
+shape_io & shape_datasource::select_lod(const query& q) const
+{
+    // use the most generalized geometries deviating less than a pixel
+    double pixel_size = 1.0 / q.resolution().get<0>();
+    shape_io * shape = shape_.get();
+    for (unsigned i = 0; i < lods_.size() && lods_[i].first <= pixel_size; ++i)
+    {
+        shape = lods_[i].second.get();
+    }
+    return *shape;
+}
+
 std::string shape_datasource::name()
 {
     return "shape";
@@ -247,11 +286,12 @@ featureset_ptr shape_datasource::features(const query& q) const
     filter_in_box filter(q.get_bbox());
     if (indexed_)
     {
-        shape_->shp().seek(0);
+        shape_io & shape = select_lod(q);
+        shape.shp().seek(0);
         // TODO - use boost::make_shared - #760
         return featureset_ptr
             (new shape_index_featureset<filter_in_box>(filter,
-                                                       *shape_,
+                                                       shape,
                                                        q.property_names(),
                                                        desc_.get_encoding(),
                                                        shape_name_,
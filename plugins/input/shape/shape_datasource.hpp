@@ -30,6 +30,9 @@
 
 #include <boost/shared_ptr.hpp>
 
+// stl
+#include <vector>
+
 #include "shape_io.hpp"
 
 using mapnik::datasource;
@@ -56,10 +59,14 @@ private:
     shape_datasource(const shape_datasource&);
     shape_datasource& operator=(const shape_datasource&);
     void init(shape_io& shape) const;
+    void init_lods() const;
+    shape_io & select_lod(const query& q) const;
 private:
     int type_;
     std::string shape_name_;
     mutable boost::shared_ptr<shape_io> shape_;
+    // generalized geometries by ascending tolerance (layer units)
+    mutable std::vector<std::pair<double, boost::shared_ptr<shape_io> > > lods_;
     mutable long file_length_;
     mutable box2d<double> extent_;
     mutable bool indexed_;
@@ -88,6 +88,25 @@ shape_featureset<filterT>::shape_featureset(const filterT& filter,
 
 template <typename filterT>
 feature_ptr shape_featureset<filterT>::next()
+{
+    return read_feature();
+}
+
+template <typename filterT>
+std::size_t shape_featureset<filterT>::next_batch(feature_ptr * features, std::size_t size)
+{
+    // records are read one after the other without a
+    // Featureset::next() call per feature
+    std::size_t count = 0;
+    while (count < size && (features[count] = read_feature()))
+    {
+        ++count;
+    }
+    return count;
+}
+
+template <typename filterT>
+feature_ptr shape_featureset<filterT>::read_feature()
 {
     if (row_limit_ && count_ > row_limit_)
         return feature_ptr();
@@ -284,7 +303,7 @@ feature_ptr shape_featureset<filterT>::next()
             {
                 for (;itr!=end;++itr)
                 {                    
-                    shape_.dbf().add_attribute(*itr,*tr_,*feature);//TODO optimize!!!
+                    shape_.dbf().add_attribute(*itr,*tr_,*feature);
                 }
             }
             catch (...)
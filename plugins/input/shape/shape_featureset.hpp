@@ -61,8 +61,10 @@ class shape_featureset : public Featureset
                        int row_limit);
       virtual ~shape_featureset();
       feature_ptr next();
+      std::size_t next_batch(feature_ptr * features, std::size_t size);
 
    private:
+      feature_ptr read_feature();
       shape_featureset(const shape_featureset&);
       const shape_featureset& operator=(const shape_featureset&);
       
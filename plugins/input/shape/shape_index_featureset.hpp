@@ -59,8 +59,10 @@ class shape_index_featureset : public Featureset
                              int row_limit);
       virtual ~shape_index_featureset();
       feature_ptr next();
+      std::size_t next_batch(feature_ptr * features, std::size_t size);
 
    private:
+      feature_ptr read_feature();
       //no copying
       shape_index_featureset(const shape_index_featureset&);
       shape_index_featureset& operator=(const shape_index_featureset&);
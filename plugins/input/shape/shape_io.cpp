@@ -37,9 +37,9 @@ const std::string shape_io::SHP = ".shp";
 const std::string shape_io::DBF = ".dbf";
 const std::string shape_io::INDEX = ".index";
 
-shape_io::shape_io(const std::string& shape_name, bool open_index)
+shape_io::shape_io(const std::string& shape_name, bool open_index, const std::string& geometry_name)
    : type_(shape_null),
-     shp_(shape_name + SHP),
+     shp_((geometry_name.empty() ? shape_name : geometry_name) + SHP),
      dbf_(shape_name + DBF),
      reclength_(0),
      id_(0)
@@ -54,12 +54,12 @@ shape_io::shape_io(const std::string& shape_name, bool open_index)
         try 
         {
             
-            index_= boost::make_shared<shape_file>(shape_name + INDEX);
+            index_= boost::make_shared<shape_file>((geometry_name.empty() ? shape_name : geometry_name) + INDEX);
         }
         catch (...)
         {
 #ifdef MAPNIK_DEBUG 
-            std::clog << "Shape Plugin: warning - could not open index: '" + shape_name + INDEX + "'" << std::endl;
+            std::clog << "Shape Plugin: warning - could not open index: '" + (geometry_name.empty() ? shape_name : geometry_name) + INDEX + "'" << std::endl;
 #endif
         }
     }
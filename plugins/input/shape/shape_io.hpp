@@ -65,7 +65,9 @@ public:
         shape_multipatch = 31
     };
 
-    shape_io(const std::string& shape_name, bool open_index=true);
+    // geometry_name selects a generalized copy of the geometries
+    // (see shapeindex --lod) read alongside the original dbf
+    shape_io(const std::string& shape_name, bool open_index=true, const std::string& geometry_name="");
     ~shape_io();
     shape_file& shp();
     //shape_file& shx();
@@ -74,7 +74,8 @@ sqlite_datasource::sqlite_datasource(parameters const& params, bool bind)
      row_offset_(*params_.get<int>("row_offset",0)),
      row_limit_(*params_.get<int>("row_limit",0)),
      desc_(*params_.get<std::string>("type"), *params_.get<std::string>("encoding","utf-8")),
-     format_(mapnik::wkbGeneric)
+     format_(mapnik::wkbGeneric),
+     use_index_join_(false)
 {
     // TODO
     // - change param from 'file' to 'dbname'
@@ -577,6 +578,17 @@ void sqlite_datasource::bind() const
           << " - either set the table 'extent' or create an rtree spatial index";
         throw datasource_exception(s.str());
     }
+
+    // plain tables are joined against the rtree so that rows are
+    // streamed in index order, subqueries filter on the index ids
+    use_index_join_ = has_spatial_index_ && !using_subquery_ && table_ == geometry_table_;
+
+    // queries run on pooled read-only connections, one per thread at a time
+    creator_ = boost::make_shared<sqlite_connection_creator<sqlite_connection> >(
+        dataset_name_, init_statements_, *params_.get<int>("mmap_size",268435456));
+    pool_ = boost::make_shared<pool_type>(*creator_,
+                                          *params_.get<int>("initial_size",1),
+                                          *params_.get<int>("max_size",10));
     
     is_bound_ = true;
 }
@@ -611,17 +623,32 @@ layer_descriptor sqlite_datasource::get_descriptor() const
    return desc_;
 }
 
-featureset_ptr sqlite_datasource::features(query const& q) const
+boost::shared_ptr<sqlite_connection> sqlite_datasource::borrow_connection() const
 {
-   if (!is_bound_) bind();
-   if (dataset_)
-   {
-        mapnik::box2d<double> const& e = q.get_bbox();
+    return mapnik::borrow_pooled(pool_, *creator_);
+}
 
-        std::ostringstream s;
-        
+std::string sqlite_datasource::features_sql(std::set<std::string> const& props) const
+{
+    std::ostringstream s;
+
+    if (use_index_join_)
+    {
+        s << "SELECT t." << geometry_field_ << ",t." << key_field_;
+        std::set<std::string>::const_iterator pos = props.begin();
+        std::set<std::string>::const_iterator end = props.end();
+        while (pos != end)
+        {
+            s << ",t.\"" << *pos << "\" AS \"" << *pos << "\"";
+            ++pos;
+        }
+        s << " FROM " << index_table_ << " i CROSS JOIN " << table_ << " t";
+        s << " WHERE t." << key_field_ << "=i.pkid";
+        s << " AND i.xmax>=?1 AND i.xmin<=?2 AND i.ymax>=?3 AND i.ymin<=?4";
+    }
+    else
+    {
         s << "SELECT " << geometry_field_ << "," << key_field_;
-        std::set<std::string> const& props = q.property_names();
         std::set<std::string>::const_iterator pos = props.begin();
         std::set<std::string>::const_iterator end = props.end();
         while (pos != end)
@@ -646,10 +673,8 @@ featureset_ptr sqlite_datasource::features(query const& q) const
               then a btree to pull the records for those ids.        
            */
            std::ostringstream spatial_sql;
-           spatial_sql << std::setprecision(16);
            spatial_sql << " WHERE " << key_field_ << " IN (SELECT pkid FROM " << index_table_;
-           spatial_sql << " WHERE xmax>=" << e.minx() << " AND xmin<=" << e.maxx() ;
-           spatial_sql << " AND ymax>=" << e.miny() << " AND ymin<=" << e.maxy() << ")";
+           spatial_sql << " WHERE xmax>=?1 AND xmin<=?2 AND ymax>=?3 AND ymin<=?4)";
            if (boost::algorithm::ifind_first(query, "WHERE"))
            {
               boost::algorithm::ireplace_first(query, "WHERE", spatial_sql.str() + " AND ");
@@ -661,23 +686,54 @@ featureset_ptr sqlite_datasource::features(query const& q) const
         }
         
         s << query ;
+    }
         
-        if (row_limit_ > 0) {
-            s << " LIMIT " << row_limit_;
-        }
+    if (row_limit_ > 0) {
+        s << " LIMIT " << row_limit_;
+    }
 
-        if (row_offset_ > 0) {
-            s << " OFFSET " << row_offset_;
-        }
+    if (row_offset_ > 0) {
+        s << " OFFSET " << row_offset_;
+    }
 
 #ifdef MAPNIK_DEBUG
-        std::clog << "Sqlite Plugin: table_: " << table_ << "\n\n";
-        std::clog << "Sqlite Plugin: query:" << s.str() << "\n\n";
+    std::clog << "Sqlite Plugin: table_: " << table_ << "\n\n";
+    std::clog << "Sqlite Plugin: query:" << s.str() << "\n\n";
 #endif
 
-        boost::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
+    return s.str();
+}
+
+featureset_ptr sqlite_datasource::execute_bbox_query(std::string const& sql, box2d<double> const& e) const
+{
+    boost::shared_ptr<sqlite_connection> conn = borrow_connection();
+
+    // the statement is prepared once per connection, only the extent changes
+    sqlite3_stmt* stmt = conn->prepare_cached(sql);
+    if (sqlite3_bind_parameter_count(stmt) > 0)
+    {
+        if ((sqlite3_bind_double(stmt, 1, e.minx()) != SQLITE_OK) ||
+            (sqlite3_bind_double(stmt, 2, e.maxx()) != SQLITE_OK) ||
+            (sqlite3_bind_double(stmt, 3, e.miny()) != SQLITE_OK) ||
+            (sqlite3_bind_double(stmt, 4, e.maxy()) != SQLITE_OK))
+        {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            conn->throw_sqlite_error(sql);
+        }
+    }
+
+    boost::shared_ptr<sqlite_resultset> rs = boost::make_shared<sqlite_resultset>(stmt, false);
+
+    return boost::make_shared<sqlite_featureset>(conn, rs, desc_.get_encoding(), format_, multiple_geometries_, using_subquery_);
+}
 
-        return boost::make_shared<sqlite_featureset>(rs, desc_.get_encoding(), format_, multiple_geometries_, using_subquery_);
+featureset_ptr sqlite_datasource::features(query const& q) const
+{
+   if (!is_bound_) bind();
+   if (pool_)
+   {
+        return execute_bbox_query(features_sql(q.property_names()), q.get_bbox());
    }
 
    return featureset_ptr();
@@ -687,61 +743,23 @@ featureset_ptr sqlite_datasource::features_at_point(coord2d const& pt) const
 {
    if (!is_bound_) bind();
 
-   if (dataset_)
+   if (pool_)
    {
         // TODO - need tolerance
         mapnik::box2d<double> const e(pt.x,pt.y,pt.x,pt.y);
 
-        std::ostringstream s;
-        s << "SELECT " << geometry_field_ << "," << key_field_;
+        std::set<std::string> names;
         std::vector<attribute_descriptor>::const_iterator itr = desc_.get_descriptors().begin();
         std::vector<attribute_descriptor>::const_iterator end = desc_.get_descriptors().end();
         while (itr != end)
         {
             std::string fld_name = itr->get_name();
             if (fld_name != key_field_)
-                s << ",\"" << itr->get_name() << "\"";
+                names.insert(fld_name);
             ++itr;
         }
-        
-        s << " FROM "; 
-        
-        std::string query (table_); 
-        
-        if (has_spatial_index_)
-        {
-           std::ostringstream spatial_sql;
-           spatial_sql << std::setprecision(16);
-           spatial_sql << " WHERE " << key_field_ << " IN (SELECT pkid FROM " << index_table_;
-           spatial_sql << " WHERE xmax>=" << e.minx() << " AND xmin<=" << e.maxx() ;
-           spatial_sql << " AND ymax>=" << e.miny() << " AND ymin<=" << e.maxy() << ")";
-           if (boost::algorithm::ifind_first(query, "WHERE"))
-           {
-              boost::algorithm::ireplace_first(query, "WHERE", spatial_sql.str() + " AND ");
-           }
-           else if (boost::algorithm::ifind_first(query, geometry_table_))  
-           {
-              boost::algorithm::ireplace_first(query, table_, table_ + " " + spatial_sql.str());
-           }
-        }
-        
-        s << query ;
-        
-        if (row_limit_ > 0) {
-            s << " LIMIT " << row_limit_;
-        }
-
-        if (row_offset_ > 0) {
-            s << " OFFSET " << row_offset_;
-        }
-
-#ifdef MAPNIK_DEBUG
-        std::clog << "Sqlite Plugin: " << s.str() << std::endl;
-#endif
-
-        boost::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
 
-        return boost::make_shared<sqlite_featureset>(rs, desc_.get_encoding(), format_, multiple_geometries_, using_subquery_);
+        return execute_bbox_query(features_sql(names), e);
    }
       
    return featureset_ptr();
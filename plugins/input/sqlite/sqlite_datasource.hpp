@@ -29,6 +29,7 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/feature_layer_desc.hpp>
 #include <mapnik/wkb.hpp> 
+#include <mapnik/pool.hpp>
 
 // boost
 #include <boost/shared_ptr.hpp>
@@ -50,6 +51,12 @@ class sqlite_datasource : public mapnik::datasource
       mapnik::layer_descriptor get_descriptor() const;
       void bind() const;
    private:
+      typedef mapnik::Pool<sqlite_connection,sqlite_connection_creator> pool_type;
+
+      boost::shared_ptr<sqlite_connection> borrow_connection() const;
+      std::string features_sql(std::set<std::string> const& props) const;
+      mapnik::featureset_ptr execute_bbox_query(std::string const& sql, mapnik::box2d<double> const& e) const;
+
       mutable mapnik::box2d<double> extent_;
       mutable bool extent_initialized_;
       int type_;
@@ -71,6 +78,9 @@ class sqlite_datasource : public mapnik::datasource
       mutable bool has_spatial_index_;
       mutable bool using_subquery_;
       mutable std::vector<std::string> init_statements_;
+      mutable boost::shared_ptr<sqlite_connection_creator<sqlite_connection> > creator_;
+      mutable boost::shared_ptr<pool_type> pool_;
+      mutable bool use_index_join_;
       
       // Fill init_statements with any statements
       // needed to attach auxillary databases
@@ -46,12 +46,14 @@ using mapnik::geometry_utils;
 using mapnik::transcoder;
 using mapnik::feature_factory;
 
-sqlite_featureset::sqlite_featureset(boost::shared_ptr<sqlite_resultset> rs,
+sqlite_featureset::sqlite_featureset(boost::shared_ptr<sqlite_connection> const& conn,
+                                     boost::shared_ptr<sqlite_resultset> rs,
                                      std::string const& encoding,
                                      mapnik::wkbFormat format,
                                      bool multiple_geometries,
                                      bool using_subquery)
-   : rs_(rs),
+   : conn_(conn),
+     rs_(rs),
      tr_(new transcoder(encoding)),
      format_(format),
      multiple_geometries_(multiple_geometries),
@@ -91,114 +93,102 @@ feature_ptr sqlite_featureset::next()
 {
     if (rs_->is_valid () && rs_->step_next ())
     {
-        int size;
-        const char* data = (const char *) rs_->column_blob (0, size);
-        if (!data)
-            return feature_ptr();
-        int feature_id = rs_->column_integer (1);   
-
-        feature_ptr feature(feature_factory::create(feature_id));
-        geometry_utils::from_wkb(feature->paths(),data,size,multiple_geometries_,format_);
-        
-        for (int i = 2; i < rs_->column_count (); ++i)
-        {
-            const int type_oid = rs_->column_type (i);
-            const char* fld_name = rs_->column_name(i);
+        return read_feature();
+    }
 
-            if (!fld_name)
-                continue;
+    return feature_ptr();
+}
 
-            if (!using_subquery_)
-            {
-                switch (type_oid)
-                {
-                  case SQLITE_INTEGER:
-                  {
-                     boost::put(*feature,fld_name,rs_->column_integer (i));
-                     break;
-                  }
-                  
-                  case SQLITE_FLOAT:
-                  {
-                     boost::put(*feature,fld_name,rs_->column_double (i));
-                     break;
-                  }
-                  
-                  case SQLITE_TEXT:
-                  {
-                     int text_size;
-                     const char * data = rs_->column_text(i,text_size);
-                     UnicodeString ustr = tr_->transcode(data,text_size);
-                     boost::put(*feature,fld_name,ustr);
-                     break;
-                  }
-    
-                  case SQLITE_NULL:
-                  {
-                     boost::put(*feature,fld_name,mapnik::value_null());
-                     break;                 
-                  }
-                  
-                  case SQLITE_BLOB:
-                     break;
-                     
-                  default:
-    #ifdef MAPNIK_DEBUG
-                     std::clog << "Sqlite Plugin: unhandled type_oid=" << type_oid << std::endl;
-    #endif
-                     break;
-                }
-            }
-            else
+std::size_t sqlite_featureset::next_batch(feature_ptr * features, std::size_t size)
+{
+    // step through as many rows as fit in one call instead of one
+    // Featureset::next() call per feature
+    std::size_t count = 0;
+    if (!rs_->is_valid ()) return count;
+    while (count < size && rs_->step_next ())
+    {
+        if (!(features[count] = read_feature())) break;
+        ++count;
+    }
+    return count;
+}
+
+feature_ptr sqlite_featureset::read_feature()
+{
+    int size;
+    const char* data = (const char *) rs_->column_blob (0, size);
+    if (!data)
+        return feature_ptr();
+    int feature_id = rs_->column_integer (1);   
+
+    feature_ptr feature(feature_factory::create(feature_id));
+    geometry_utils::from_wkb(feature->paths(),data,size,multiple_geometries_,format_);
+
+    if (names_.empty())
+    {
+        for (int i = 0; i < rs_->column_count (); ++i)
+        {
+            const char* fld_name = rs_->column_name(i);
+            std::string name = fld_name ? fld_name : "";
+            if (using_subquery_ && !name.empty())
             {
                 // subqueries in sqlite lead to field double quoting which we need to strip
-                char fld_name2[strlen(fld_name)];
-                strcpy(fld_name2,fld_name);
-                sqlite_dequote(fld_name2);
-                switch (type_oid)
-                {
-                  case SQLITE_INTEGER:
-                  {
-                     boost::put(*feature,fld_name2,rs_->column_integer (i));
-                     break;
-                  }
-                  
-                  case SQLITE_FLOAT:
-                  {
-                     boost::put(*feature,fld_name2,rs_->column_double (i));
-                     break;
-                  }
-                  
-                  case SQLITE_TEXT:
-                  {
-                     int text_size;
-                     const char * data = rs_->column_text(i,text_size);
-                     UnicodeString ustr = tr_->transcode(data,text_size);
-                     boost::put(*feature,fld_name2,ustr);
-                     break;
-                  }
-    
-                  case SQLITE_NULL:
-                  {
-                     boost::put(*feature,fld_name2,mapnik::value_null());
-                     break;                 
-                  }
-                  
-                  case SQLITE_BLOB:
-                     break;
-                     
-                  default:
-    #ifdef MAPNIK_DEBUG
-                     std::clog << "Sqlite Plugin: unhandled type_oid=" << type_oid << std::endl;
-    #endif
-                     break;
-                }
+                std::vector<char> dequoted(name.begin(), name.end());
+                dequoted.push_back('\0');
+                sqlite_dequote(&dequoted[0]);
+                name = &dequoted[0];
             }
+            names_.push_back(name);
         }
+    }
+    
+    for (int i = 2; i < rs_->column_count (); ++i)
+    {
+        const int type_oid = rs_->column_type (i);
+        std::string const& fld_name = names_[i];
 
-        return feature;
+        if (fld_name.empty())
+            continue;
+
+        switch (type_oid)
+        {
+          case SQLITE_INTEGER:
+          {
+             boost::put(*feature,fld_name,rs_->column_integer (i));
+             break;
+          }
+          
+          case SQLITE_FLOAT:
+          {
+             boost::put(*feature,fld_name,rs_->column_double (i));
+             break;
+          }
+          
+          case SQLITE_TEXT:
+          {
+             int text_size;
+             const char * data = rs_->column_text(i,text_size);
+             UnicodeString ustr = tr_->transcode(data,text_size);
+             boost::put(*feature,fld_name,ustr);
+             break;
+          }
+
+          case SQLITE_NULL:
+          {
+             boost::put(*feature,fld_name,mapnik::value_null());
+             break;                 
+          }
+          
+          case SQLITE_BLOB:
+             break;
+             
+          default:
+#ifdef MAPNIK_DEBUG
+             std::clog << "Sqlite Plugin: unhandled type_oid=" << type_oid << std::endl;
+#endif
+             break;
+        }
     }
 
-    return feature_ptr();
+    return feature;
 }
-
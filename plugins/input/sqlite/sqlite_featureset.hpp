@@ -33,6 +33,10 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+// stl
+#include <string>
+#include <vector>
+
 // sqlite
 #include "sqlite_types.hpp"
   
@@ -40,19 +44,27 @@
 class sqlite_featureset : public mapnik::Featureset
 {
    public:
-      sqlite_featureset(boost::shared_ptr<sqlite_resultset> rs,
+      sqlite_featureset(boost::shared_ptr<sqlite_connection> const& conn,
+                        boost::shared_ptr<sqlite_resultset> rs,
                         std::string const& encoding,
                         mapnik::wkbFormat format,
                         bool multiple_geometries,
                         bool using_subquery);
       virtual ~sqlite_featureset();
       mapnik::feature_ptr next();
+      std::size_t next_batch(mapnik::feature_ptr * features, std::size_t size);
    private:
+      mapnik::feature_ptr read_feature();
+
+      // the resultset is destroyed before its connection is released
+      boost::shared_ptr<sqlite_connection> conn_;
       boost::shared_ptr<sqlite_resultset> rs_;
       boost::scoped_ptr<mapnik::transcoder> tr_;
       mapnik::wkbFormat format_;
       bool multiple_geometries_;
       bool using_subquery_;
+      // column names, dequoted for subqueries, the same for every row
+      std::vector<std::string> names_;
 };
 
 #endif // SQLITE_FEATURESET_HPP
@@ -30,6 +30,10 @@
 // boost
 #include <boost/shared_ptr.hpp>
 
+// stl
+#include <map>
+#include <vector>
+
 // sqlite
 extern "C" {
   #include <sqlite3.h>
@@ -40,15 +44,28 @@ class sqlite_resultset
 {
 public:
 
-    sqlite_resultset (sqlite3_stmt* stmt)
-        : stmt_(stmt)
+    // statements not owned by the resultset (cached by their
+    // connection) are reset for reuse instead of finalized
+    sqlite_resultset (sqlite3_stmt* stmt, bool owns_statement = true)
+        : stmt_(stmt),
+          owns_statement_(owns_statement)
     {
     }
 
     ~sqlite_resultset ()
     {
         if (stmt_)
-            sqlite3_finalize (stmt_);
+        {
+            if (owns_statement_)
+            {
+                sqlite3_finalize (stmt_);
+            }
+            else
+            {
+                sqlite3_reset (stmt_);
+                sqlite3_clear_bindings (stmt_);
+            }
+        }
     }
 
     bool is_valid ()
@@ -131,6 +148,7 @@ public:
 private:
 
     sqlite3_stmt* stmt_;
+    bool owns_statement_;
 };
 
 
@@ -165,12 +183,39 @@ public:
         //sqlite3_enable_load_extension(db_, 1);
     }
 
+    sqlite_connection (const std::string& file, int flags)
+        : db_(0)
+    {
+        #if SQLITE_VERSION_NUMBER >= 3006018
+        if (sqlite3_open_v2 (file.c_str(), &db_, flags, NULL))
+        #else
+        if (sqlite3_open (file.c_str(), &db_))
+        #endif
+        {
+            std::ostringstream s;
+            s << "Sqlite Plugin: " << sqlite3_errmsg (db_);
+            sqlite3_close (db_);
+            db_ = 0;
+            throw mapnik::datasource_exception (s.str());
+        }
+    }
+
     ~sqlite_connection ()
     {
+        std::map<std::string, sqlite3_stmt*>::iterator itr = statements_.begin();
+        for (; itr != statements_.end(); ++itr)
+        {
+            sqlite3_finalize (itr->second);
+        }
         if (db_)
             sqlite3_close (db_);
     }
 
+    bool isOK() const
+    {
+        return db_ != 0;
+    }
+
     void throw_sqlite_error(const std::string& sql)
     {
       std::ostringstream s;
@@ -197,6 +242,26 @@ public:
         return new sqlite_resultset (stmt);
     }
   
+    // Prepare sql once per connection, the statement stays owned by the
+    // connection and must be reset before it is prepared again
+    sqlite3_stmt* prepare_cached(const std::string& sql)
+    {
+        std::map<std::string, sqlite3_stmt*>::const_iterator itr = statements_.find(sql);
+        if (itr != statements_.end())
+        {
+            return itr->second;
+        }
+
+        sqlite3_stmt* stmt = 0;
+        int rc = sqlite3_prepare_v2 (db_, sql.c_str(), -1, &stmt, 0);
+        if (rc != SQLITE_OK)
+        {
+           throw_sqlite_error(sql);
+        }
+        statements_.insert(std::make_pair(sql, stmt));
+        return stmt;
+    }
+  
     void execute(const std::string& sql)
     {
         int rc=sqlite3_exec(db_, sql.c_str(), 0, 0, 0);
@@ -220,6 +285,62 @@ public:
 private:
 
     sqlite3* db_;
+    std::map<std::string, sqlite3_stmt*> statements_;
+};
+
+
+// Opens the read-only connections pooled by each sqlite datasource
+template <typename T>
+class sqlite_connection_creator
+{
+public:
+    sqlite_connection_creator(std::string const& file,
+                              std::vector<std::string> const& init_statements,
+                              int mmap_size)
+        : file_(file),
+          init_statements_(init_statements),
+          mmap_size_(mmap_size) {}
+
+    T* operator()() const
+    {
+        #if SQLITE_VERSION_NUMBER >= 3006018
+        T* conn = new T(file_, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX);
+        #else
+        T* conn = new T(file_);
+        #endif
+        try
+        {
+            #if SQLITE_VERSION_NUMBER >= 3007017
+            if (mmap_size_ > 0)
+            {
+                std::ostringstream s;
+                s << "PRAGMA mmap_size=" << mmap_size_;
+                conn->execute(s.str());
+            }
+            #endif
+            for (std::vector<std::string>::const_iterator itr = init_statements_.begin();
+                 itr != init_statements_.end(); ++itr)
+            {
+                conn->execute(*itr);
+            }
+        }
+        catch (...)
+        {
+            delete conn;
+            throw;
+        }
+        return conn;
+    }
+
+    std::string id() const
+    {
+        return file_;
+    }
+
+private:
+    std::string file_;
+    std::vector<std::string> init_statements_;
+    int mmap_size_;
 };
 
 #endif //SQLITE_TYPES_HPP
@@ -24,6 +24,7 @@
 // mapnik
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/agg_rasterizer.hpp>
+#include <mapnik/agg_pattern_cache.hpp>
 #include <mapnik/marker_cache.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/placement_finder.hpp>
@@ -84,32 +85,6 @@
 
 namespace mapnik
 {
-class pattern_source : private boost::noncopyable
-{
-public:
-    pattern_source(image_data_32 const& pattern)
-        : pattern_(pattern) {}
-
-    unsigned int width() const
-    {
-        return pattern_.width();
-    }
-    unsigned int height() const
-    {
-        return pattern_.height();
-    }
-    agg::rgba8 pixel(int x, int y) const
-    {
-        unsigned c = pattern_(x,y);
-        return agg::rgba8(c & 0xff,
-                          (c >> 8) & 0xff,
-                          (c >> 16) & 0xff,
-                          (c >> 24) & 0xff);
-    }
-private:
-    image_data_32 const& pattern_;
-};
-
 
 template <typename T>
 agg_renderer<T>::agg_renderer(Map const& m, T & pixmap, double scale_factor, unsigned offset_x, unsigned offset_y)
@@ -122,7 +97,8 @@ agg_renderer<T>::agg_renderer(Map const& m, T & pixmap, double scale_factor, uns
       font_engine_(),
       font_manager_(font_engine_),
       detector_(box2d<double>(-m.buffer_size(), -m.buffer_size(), m.width() + m.buffer_size() ,m.height() + m.buffer_size())),
-      ras_ptr(new rasterizer)
+      ras_ptr(new rasterizer),
+      pattern_cache_(new agg_pattern_cache)
 {
     boost::optional<color> const& bg = m.background();
     if (bg) pixmap_.set_background(*bg);
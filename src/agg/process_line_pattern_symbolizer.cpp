@@ -24,9 +24,8 @@
 // mapnik
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/agg_rasterizer.hpp>
-#include <mapnik/agg_pattern_source.hpp>
+#include <mapnik/agg_pattern_cache.hpp>
 #include <mapnik/expression_evaluator.hpp>
-#include <mapnik/marker_cache.hpp>
 
 // agg
 #include "agg_basics.h"
@@ -50,7 +49,7 @@ void  agg_renderer<T>::process(line_pattern_symbolizer const& sym,
                                proj_transform const& prj_trans)
 {
     typedef  coord_transform2<CoordTransform,geometry_type> path_type;
-    typedef agg::line_image_pattern<agg::pattern_filter_bilinear_rgba8> pattern_type;
+    typedef agg_pattern_cache::line_pattern_type pattern_type;
     typedef agg::renderer_base<agg::pixfmt_rgba32_plain> renderer_base;
     typedef agg::renderer_outline_image<renderer_base, pattern_type> renderer_type;
     typedef agg::rasterizer_outline_aa<renderer_type> rasterizer_type;
@@ -60,18 +59,12 @@ void  agg_renderer<T>::process(line_pattern_symbolizer const& sym,
     
     std::string filename = path_processor_type::evaluate( *sym.get_filename(), feature);
 
-    boost::optional<marker_ptr> mark = marker_cache::instance()->find(filename,true);
-    if (!mark || !(*mark)->is_bitmap()) return;
-
-    boost::optional<image_ptr> pat = (*mark)->get_bitmap_data();
-
-    if (!pat) return;
+    // filtered and dilated once per render, not per feature
+    pattern_type const* pattern = pattern_cache_->find_line_pattern(filename);
+    if (!pattern) return;
       
     renderer_base ren_base(pixf);
-    agg::pattern_filter_bilinear_rgba8 filter;
-    pattern_source source(*(*pat));
-    pattern_type pattern (filter,source);
-    renderer_type ren(ren_base, pattern);
+    renderer_type ren(ren_base, *pattern);
     // TODO - should be sensitive to buffer size
     ren.clip_box(0,0,width_,height_);
     rasterizer_type ras(ren);
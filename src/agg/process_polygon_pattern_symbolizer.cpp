@@ -24,7 +24,7 @@
 // mapnik
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/agg_rasterizer.hpp>
-#include <mapnik/marker_cache.hpp>
+#include <mapnik/agg_pattern_cache.hpp>
 #include <mapnik/expression_evaluator.hpp>
 
 // agg
@@ -36,8 +36,6 @@
 // for polygon_pattern_symbolizer
 #include "agg_renderer_scanline.h"
 #include "agg_span_allocator.h"
-#include "agg_span_pattern_rgba.h"
-#include "agg_image_accessors.h"
 
 
 
@@ -50,16 +48,7 @@ void agg_renderer<T>::process(polygon_pattern_symbolizer const& sym,
 {
     typedef coord_transform2<CoordTransform,geometry_type> path_type;
     typedef agg::renderer_base<agg::pixfmt_rgba32_plain> ren_base;
-    typedef agg::wrap_mode_repeat wrap_x_type;
-    typedef agg::wrap_mode_repeat wrap_y_type;
-    typedef agg::pixfmt_alpha_blend_rgba<agg::blender_rgba32_plain,
-        agg::row_accessor<agg::int8u>, agg::pixel32_type> rendering_buffer;
-    typedef agg::image_accessor_wrap<rendering_buffer,
-        wrap_x_type,
-        wrap_y_type> img_source_type;
-
-    typedef agg::span_pattern_rgba<img_source_type> span_gen_type;
-
+    typedef span_expanded_pattern span_gen_type;
     typedef agg::renderer_scanline_aa<ren_base,
         agg::span_allocator<agg::rgba8>,
         span_gen_type> renderer_type;
@@ -74,30 +63,20 @@ void agg_renderer<T>::process(polygon_pattern_symbolizer const& sym,
     ras_ptr->gamma(agg::gamma_linear(0.0, sym.get_gamma()));
 
     std::string filename = path_processor_type::evaluate( *sym.get_filename(), feature);
-    boost::optional<mapnik::marker_ptr> marker;
+    expanded_pattern const* pattern = 0;
     if ( !filename.empty() )
     {
-        marker = marker_cache::instance()->find(filename, true);
+        // prepared once per render and shared by all features using this file
+        pattern = pattern_cache_->find_polygon_pattern(filename);
     }
     else
     {
         std::clog << "### Warning: file not found: " << filename << "\n";
     }
 
-    if (!marker || !(*marker)->is_bitmap()) return;
-    
+    if (!pattern) return;
 
-    boost::optional<image_ptr> pat = (*marker)->get_bitmap_data();
-
-    if (!pat) return;
-    
-    unsigned w=(*pat)->width();
-    unsigned h=(*pat)->height();
-    agg::row_accessor<agg::int8u> pattern_rbuf((agg::int8u*)(*pat)->getBytes(),w,h,w*4);
     agg::span_allocator<agg::rgba8> sa;
-    agg::pixfmt_alpha_blend_rgba<agg::blender_rgba32_plain,
-        agg::row_accessor<agg::int8u>, agg::pixel32_type> pixf_pattern(pattern_rbuf);
-    img_source_type img_src(pixf_pattern);
     
     unsigned num_geometries = feature.num_geometries();
 
@@ -117,7 +96,7 @@ void agg_renderer<T>::process(polygon_pattern_symbolizer const& sym,
         offset_y = unsigned(height_-y0);    
     }
     
-    span_gen_type sg(img_src, offset_x, offset_y);
+    span_gen_type sg(*pattern, offset_x, offset_y);
     renderer_type rp(renb,sa, sg);
     metawriter_with_properties writer = sym.get_metawriter();
     for (unsigned i=0;i<num_geometries;++i)
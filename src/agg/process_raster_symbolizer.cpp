@@ -37,6 +37,58 @@
 
 namespace mapnik {
 
+namespace {
+
+template <typename T>
+void composite_raster(T & pixmap, raster_symbolizer const& sym,
+                      image_data_32 const& data, int x, int y)
+{
+    double opacity = sym.get_opacity();
+    switch (sym.get_raster_mode())
+    {
+    case RASTER_MODE_NORMAL:
+        if (opacity == 1.0) {
+            pixmap.set_rectangle_alpha(x,y,data);
+        } else {
+            pixmap.set_rectangle_alpha2(data,x,y,opacity);
+        }
+        break;
+    case RASTER_MODE_GRAIN_MERGE:
+        pixmap.template merge_rectangle<MergeGrain> (data,x,y,opacity);
+        break;
+    case RASTER_MODE_GRAIN_MERGE2:
+        pixmap.template merge_rectangle<MergeGrain2> (data,x,y,opacity);
+        break;
+    case RASTER_MODE_MULTIPLY:
+        pixmap.template merge_rectangle<Multiply> (data,x,y,opacity);
+        break;
+    case RASTER_MODE_MULTIPLY2:
+        pixmap.template merge_rectangle<Multiply2> (data,x,y,opacity);
+        break;
+    case RASTER_MODE_DIVIDE:
+        pixmap.template merge_rectangle<Divide> (data,x,y,opacity);
+        break;
+    case RASTER_MODE_DIVIDE2:
+        pixmap.template merge_rectangle<Divide2> (data,x,y,opacity);
+        break;
+    case RASTER_MODE_SCREEN:
+        pixmap.template merge_rectangle<Screen> (data,x,y,opacity);
+        break;
+    case RASTER_MODE_HARD_LIGHT:
+        pixmap.template merge_rectangle<HardLight> (data,x,y,opacity);
+        break;
+    default:
+        if (opacity == 1.0) {
+            pixmap.set_rectangle(x,y,data);
+        } else {
+            pixmap.set_rectangle_alpha2(data,x,y,opacity);
+        }
+        break;
+    }
+    // TODO: other modes? (add,diff,sub,...)
+}
+
+}
 
 template <typename T>
 void agg_renderer<T>::process(raster_symbolizer const& sym,
@@ -66,7 +118,21 @@ void agg_renderer<T>::process(raster_symbolizer const& sym,
         
         if (raster_width > 0 && raster_height > 0)
         {
-            double scale_factor = ext.width() / source->data_.width();
+            image_data_32 const& source_data = source->data_;
+            if (prj_trans.equal() &&
+                ext.width() == source_data.width() &&
+                ext.height() == source_data.height() &&
+                err_offs_x == 0.0 && err_offs_y == 0.0 &&
+                sym.get_scaling_method() == SCALING_NEAR &&
+                sym.get_scaling() != "bilinear8")
+            {
+                // the raster is already aligned with the map pixels,
+                // composite it without resampling into a copy
+                composite_raster(pixmap_, sym, source_data, start_x, start_y);
+                return;
+            }
+
+            double scale_factor = ext.width() / source_data.width();
             image_data_32 target_data(raster_width,raster_height);
             raster target(target_ext, target_data);
 
@@ -74,38 +140,10 @@ void agg_renderer<T>::process(raster_symbolizer const& sym,
                              sym.get_mesh_size(),
                              sym.calculate_filter_factor(),
                              scale_factor,
-                             sym.get_scaling());
-            
-            if (sym.get_mode() == "normal"){
-                if (sym.get_opacity() == 1.0) {
-                    pixmap_.set_rectangle_alpha(start_x,start_y,target.data_);
-                } else {
-                    pixmap_.set_rectangle_alpha2(target.data_,start_x,start_y, sym.get_opacity());
-                }
-            } else if (sym.get_mode() == "grain_merge"){
-                pixmap_.template merge_rectangle<MergeGrain> (target.data_,start_x,start_y, sym.get_opacity());
-            } else if (sym.get_mode() == "grain_merge2"){
-                pixmap_.template merge_rectangle<MergeGrain2> (target.data_,start_x,start_y, sym.get_opacity());
-            } else if (sym.get_mode() == "multiply"){
-                pixmap_.template merge_rectangle<Multiply> (target.data_,start_x,start_y, sym.get_opacity());
-            } else if (sym.get_mode() == "multiply2"){
-                pixmap_.template merge_rectangle<Multiply2> (target.data_,start_x,start_y, sym.get_opacity());
-            } else if (sym.get_mode() == "divide"){
-                pixmap_.template merge_rectangle<Divide> (target.data_,start_x,start_y, sym.get_opacity());
-            } else if (sym.get_mode() == "divide2"){
-                pixmap_.template merge_rectangle<Divide2> (target.data_,start_x,start_y, sym.get_opacity());
-            } else if (sym.get_mode() == "screen"){
-                pixmap_.template merge_rectangle<Screen> (target.data_,start_x,start_y, sym.get_opacity());
-            } else if (sym.get_mode() == "hard_light"){
-                pixmap_.template merge_rectangle<HardLight> (target.data_,start_x,start_y, sym.get_opacity());
-            } else {
-                if (sym.get_opacity() == 1.0){
-                    pixmap_.set_rectangle(start_x,start_y,target.data_);
-                } else {
-                    pixmap_.set_rectangle_alpha2(target.data_,start_x,start_y, sym.get_opacity());
-                }
-            }
-            // TODO: other modes? (add,diff,sub,...)
+                             sym.get_scaling(),
+                             sym.get_warp_threads());
+
+            composite_raster(pixmap_, sym, target.data_, start_x, start_y);
         }
     }
 }
@@ -147,6 +147,8 @@ source = Split(
     metawriter_inmem.cpp
     metawriter_factory.cpp
     mapped_memory_cache.cpp
+    render_cache.cpp
+    point_query.cpp
     marker_cache.cpp
     svg_parser.cpp
     svg_path_parser.cpp
@@ -233,7 +235,9 @@ if env['RUNTIME_LINK'] == "static":
 # grid backend
 source += Split(
     """
+    grid/grid_encode.cpp
     grid/grid_renderer.cpp
+    grid/image_grid_renderer.cpp
     grid/process_building_symbolizer.cpp
     grid/process_glyph_symbolizer.cpp
     grid/process_line_pattern_symbolizer.cpp
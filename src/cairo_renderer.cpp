@@ -256,6 +256,13 @@ cairo_face_ptr cairo_face_manager::get_face(face_ptr face)
     return entry;
 }
 
+cairo_font_cache::cairo_font_cache()
+    : font_engine_(new freetype_engine()),
+      font_manager_(*font_engine_),
+      face_manager_(font_engine_,font_manager_)
+{
+}
+
 class cairo_context : private boost::noncopyable
 {
 public:
@@ -654,13 +661,13 @@ private:
     Cairo::RefPtr<Cairo::Context> context_;
 };
 
-cairo_renderer_base::cairo_renderer_base(Map const& m, Cairo::RefPtr<Cairo::Context> const& context, unsigned offset_x, unsigned offset_y)
+cairo_renderer_base::cairo_renderer_base(Map const& m, Cairo::RefPtr<Cairo::Context> const& context, cairo_font_cache_ptr const& font_cache, unsigned offset_x, unsigned offset_y)
     : m_(m),
       context_(context),
       t_(m.width(),m.height(),m.get_current_extent(),offset_x,offset_y),
-      font_engine_(new freetype_engine()),
-      font_manager_(*font_engine_),
-      face_manager_(font_engine_,font_manager_),
+      font_cache_(font_cache ? font_cache : cairo_font_cache_ptr(new cairo_font_cache())),
+      font_manager_(font_cache_->get_font_manager()),
+      face_manager_(font_cache_->get_face_manager()),
       detector_(box2d<double>(-m.buffer_size() ,-m.buffer_size() , m.width() + m.buffer_size() ,m.height() + m.buffer_size()))
 {
 #ifdef MAPNIK_DEBUG
@@ -671,14 +678,28 @@ cairo_renderer_base::cairo_renderer_base(Map const& m, Cairo::RefPtr<Cairo::Cont
 template <>
 cairo_renderer<Cairo::Context>::cairo_renderer(Map const& m, Cairo::RefPtr<Cairo::Context> const& context, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<cairo_renderer>(m),
-      cairo_renderer_base(m,context,offset_x,offset_y)
+      cairo_renderer_base(m,context,cairo_font_cache_ptr(),offset_x,offset_y)
+{
+}
+
+template <>
+cairo_renderer<Cairo::Context>::cairo_renderer(Map const& m, Cairo::RefPtr<Cairo::Context> const& context, cairo_font_cache_ptr const& font_cache, unsigned offset_x, unsigned offset_y)
+    : feature_style_processor<cairo_renderer>(m),
+      cairo_renderer_base(m,context,font_cache,offset_x,offset_y)
 {
 }
 
 template <>
 cairo_renderer<Cairo::Surface>::cairo_renderer(Map const& m, Cairo::RefPtr<Cairo::Surface> const& surface, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<cairo_renderer>(m),
-      cairo_renderer_base(m,Cairo::Context::create(surface),offset_x,offset_y)
+      cairo_renderer_base(m,Cairo::Context::create(surface),cairo_font_cache_ptr(),offset_x,offset_y)
+{
+}
+
+template <>
+cairo_renderer<Cairo::Surface>::cairo_renderer(Map const& m, Cairo::RefPtr<Cairo::Surface> const& surface, cairo_font_cache_ptr const& font_cache, unsigned offset_x, unsigned offset_y)
+    : feature_style_processor<cairo_renderer>(m),
+      cairo_renderer_base(m,Cairo::Context::create(surface),font_cache,offset_x,offset_y)
 {
 }
 
@@ -1410,7 +1431,8 @@ void cairo_renderer_base::process(raster_symbolizer const& sym,
                              sym.get_mesh_size(),
                              sym.calculate_filter_factor(),
                              scale_factor,
-                             sym.get_scaling());
+                             sym.get_scaling(),
+                             sym.get_warp_threads());
             
             cairo_context context(context_);
             //TODO -- support for advanced image merging
@@ -35,6 +35,7 @@
 
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/grid/grid_renderer.hpp>
+#include <mapnik/grid/image_grid_renderer.hpp>
 
 // boost
 #include <boost/foreach.hpp>
@@ -86,6 +87,38 @@ struct feature_style_processor<Processor>::symbol_dispatch : public boost::stati
     proj_transform const& prj_trans_;
 };
 
+// Pulls features from a featureset in batches; the shape, postgis,
+// sqlite and memory featuresets fill a batch in one call instead of
+// a virtual next() call per feature
+class featureset_batch_reader : private boost::noncopyable
+{
+public:
+    explicit featureset_batch_reader(featureset_ptr const& fs)
+        : fs_(fs),
+          pos_(0),
+          size_(0) {}
+
+    feature_ptr next()
+    {
+        if (pos_ == size_)
+        {
+            pos_ = 0;
+            size_ = fs_->next_batch(batch_, batch_size);
+            if (size_ == 0) return feature_ptr();
+        }
+        feature_ptr feature;
+        feature.swap(batch_[pos_++]);
+        return feature;
+    }
+
+private:
+    static const std::size_t batch_size = 64;
+    featureset_ptr fs_;
+    feature_ptr batch_[batch_size];
+    std::size_t pos_;
+    std::size_t size_;
+};
+
 template <typename Processor>
 feature_style_processor<Processor>::feature_style_processor(Map const& m, double scale_factor)
     : m_(m), scale_factor_(scale_factor)
@@ -246,7 +279,8 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
         return;
     }
     // next try intersection of layer extent back projected into map srs
-    else if (prj_trans.backward(layer_ext, PROJ_ENVELOPE_POINTS) && map_ext.intersects(layer_ext))
+    // (the projected layer extent is cached by the layer)
+    else if (lay.envelope(m_.srs(), layer_ext) && map_ext.intersects(layer_ext))
     {
         layer_ext.clip(map_ext);
         // forward project layer extent back into native projection
@@ -271,7 +305,11 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
 
     query q(layer_ext,res,scale_denom);
 
-    std::vector<feature_type_style*> active_styles;
+    p.collect_layer_attributes(lay, names);
+
+    // the styles stay in the map's style table, which m_ keeps alive and
+    // which is only read here, so plain const pointers into it are safe
+    std::vector<feature_type_style const*> active_styles;
     attribute_collector collector(names);
     double filt_factor = 1;
     directive_collector d_collector(&filt_factor);
@@ -304,7 +342,7 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
         }
         if (active_rules)
         {
-            active_styles.push_back(const_cast<feature_type_style*>(&(*style)));
+            active_styles.push_back(&(*style));
         }
     }
 
@@ -324,7 +362,7 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
         layer_timer.discard();
     }
     #endif
-    BOOST_FOREACH (feature_type_style * style, active_styles)
+    BOOST_FOREACH (feature_type_style const* style, active_styles)
     {
         #if defined(RENDERING_STATS)
         std::string s_name = style_names[style_index];
@@ -337,9 +375,9 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
         style_index++;
         #endif
 
-        std::vector<rule*> if_rules;
-        std::vector<rule*> else_rules;
-        std::vector<rule*> also_rules;
+        std::vector<rule const*> if_rules;
+        std::vector<rule const*> else_rules;
+        std::vector<rule const*> also_rules;
 
         std::vector<rule> const& rules=style->get_rules();
 
@@ -354,15 +392,15 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
             {
                 if (r.has_else_filter())
                 {
-                    else_rules.push_back(const_cast<rule*>(&r));
+                    else_rules.push_back(&r);
                 }
                 else if (r.has_also_filter())
                 {
-                    also_rules.push_back(const_cast<rule*>(&r));
+                    also_rules.push_back(&r);
                 }
                 else
                 {
-                    if_rules.push_back(const_cast<rule*>(&r));
+                    if_rules.push_back(&r);
                 }
 
                 if ( (ds->type() == datasource::Raster) &&
@@ -397,8 +435,9 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
 
         if (fs)
         {
+            featureset_batch_reader reader(fs);
             feature_ptr feature;
-            while ((feature = fs->next()))
+            while ((feature = reader.next()))
             {
 
                 #if defined(RENDERING_STATS)
@@ -414,7 +453,7 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
                     cache.push(feature);
                 }
 
-                BOOST_FOREACH(rule * r, if_rules )
+                BOOST_FOREACH(rule const* r, if_rules )
                 {
                     expression_ptr const& expr=r->get_filter();
                     value_type result = boost::apply_visitor(evaluate<Feature,value_type>(*feature),*expr);
@@ -451,7 +490,7 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
                 }
                 if (do_else)
                 {
-                    BOOST_FOREACH( rule * r, else_rules )
+                    BOOST_FOREACH( rule const* r, else_rules )
                     {
                         #if defined(RENDERING_STATS)
                         feat_processed = true;
@@ -475,7 +514,7 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
                 }
                 if (do_also)
                 {
-                    BOOST_FOREACH( rule * r, also_rules )
+                    BOOST_FOREACH( rule const* r, also_rules )
                     {
                         #if defined(RENDERING_STATS)
                         feat_processed = true;
@@ -550,6 +589,7 @@ template class feature_style_processor<svg_renderer<std::ostream_iterator<char>
 
 template class feature_style_processor<grid_renderer<grid> >;
 template class feature_style_processor<agg_renderer<image_32> >;
+template class feature_style_processor<image_grid_renderer<image_32> >;
 
 }
 
@@ -37,6 +37,27 @@
 
 namespace mapnik
 {
+
+boost::uint64_t blend_reciprocals[256];
+
+namespace {
+
+struct blend_reciprocals_init
+{
+    blend_reciprocals_init()
+    {
+        blend_reciprocals[0] = 0;
+        for (unsigned d = 1; d < 256; ++d)
+        {
+            blend_reciprocals[d] = (boost::uint64_t(1) << 32) / d + 1;
+        }
+    }
+};
+
+blend_reciprocals_init init_blend_reciprocals;
+
+}
+
 image_32::image_32(int width,int height)
     :width_(width),
      height_(height),
@@ -0,0 +1,120 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// mapnik
+#include <mapnik/grid/grid_encode.hpp>
+
+// boost
+#include <boost/math/special_functions/fpclassify.hpp>
+
+// stl
+#include <cstdio>
+
+namespace mapnik
+{
+
+void write_json_string(std::ostream & out, std::string const& str)
+{
+    out << '"';
+    std::string::const_iterator itr = str.begin();
+    std::string::const_iterator end = str.end();
+    for (; itr != end; ++itr)
+    {
+        unsigned char c = static_cast<unsigned char>(*itr);
+        switch (c)
+        {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (c < 0x20)
+            {
+                char buf[8];
+                std::sprintf(buf, "\\u%04x", c);
+                out << buf;
+            }
+            else
+            {
+                // multibyte UTF-8 sequences pass through unchanged
+                out << *itr;
+            }
+        }
+    }
+    out << '"';
+}
+
+namespace {
+
+struct json_value_writer : public boost::static_visitor<>
+{
+    explicit json_value_writer(std::ostream & out)
+        : out_(out) {}
+
+    void operator() (value_null const&) const
+    {
+        out_ << "null";
+    }
+
+    void operator() (bool val) const
+    {
+        out_ << (val ? "true" : "false");
+    }
+
+    void operator() (int val) const
+    {
+        out_ << val;
+    }
+
+    void operator() (double val) const
+    {
+        // JSON has no representation for nan or infinity
+        if (!(boost::math::isfinite)(val))
+        {
+            out_ << "null";
+            return;
+        }
+        std::streamsize precision = out_.precision(16);
+        out_ << val;
+        out_.precision(precision);
+    }
+
+    void operator() (UnicodeString const& val) const
+    {
+        std::string utf8;
+        to_utf8(val,utf8);
+        write_json_string(out_, utf8);
+    }
+
+    std::ostream & out_;
+};
+
+}
+
+void write_json_value(std::ostream & out, value const& val)
+{
+    boost::apply_visitor(json_value_writer(out), val.base());
+}
+
+}
@@ -0,0 +1,117 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+//$Id$
+
+// mapnik
+#include <mapnik/grid/image_grid_renderer.hpp>
+#include <mapnik/graphics.hpp>
+#include <mapnik/layer.hpp>
+
+// stl
+#include <sstream>
+#include <stdexcept>
+
+namespace mapnik
+{
+
+template <typename T>
+image_grid_renderer<T>::image_grid_renderer(Map const& m, T & pixmap, grid & g, unsigned layer_idx,
+                                            double scale_factor, unsigned offset_x, unsigned offset_y)
+    : feature_style_processor<image_grid_renderer>(m, scale_factor),
+      image_ren_(m, pixmap, scale_factor, offset_x, offset_y),
+      grid_ren_(m, g, scale_factor, offset_x, offset_y),
+      grid_(g),
+      grid_layer_(0),
+      grid_active_(false)
+{
+    std::vector<layer> const& layers = m.layers();
+    if (layer_idx >= layers.size())
+    {
+        std::ostringstream s;
+        s << "Zero-based layer index '" << layer_idx << "' not valid, only '"
+          << layers.size() << "' layers are in map\n";
+        throw std::runtime_error(s.str());
+    }
+    grid_layer_ = &layers[layer_idx];
+}
+
+template <typename T>
+image_grid_renderer<T>::~image_grid_renderer() {}
+
+template <typename T>
+void image_grid_renderer<T>::start_map_processing(Map const& map)
+{
+    image_ren_.start_map_processing(map);
+    grid_ren_.start_map_processing(map);
+}
+
+template <typename T>
+void image_grid_renderer<T>::end_map_processing(Map const& map)
+{
+    image_ren_.end_map_processing(map);
+    grid_ren_.end_map_processing(map);
+}
+
+template <typename T>
+void image_grid_renderer<T>::start_layer_processing(layer const& lay)
+{
+    image_ren_.start_layer_processing(lay);
+    grid_active_ = (&lay == grid_layer_);
+    if (grid_active_)
+    {
+        grid_ren_.start_layer_processing(lay);
+    }
+}
+
+template <typename T>
+void image_grid_renderer<T>::end_layer_processing(layer const& lay)
+{
+    image_ren_.end_layer_processing(lay);
+    if (grid_active_)
+    {
+        grid_ren_.end_layer_processing(lay);
+        grid_active_ = false;
+    }
+}
+
+template <typename T>
+void image_grid_renderer<T>::collect_layer_attributes(layer const& lay, std::set<std::string>& names)
+{
+    if (&lay != grid_layer_) return;
+
+    // the interactive layer also needs the grid key and the fields to encode
+    std::set<std::string> const& fields = grid_.property_names();
+    names.insert(fields.begin(), fields.end());
+    std::string const& key = grid_.get_key();
+    if (key == grid_.id_name_)
+    {
+        // __id__ is the feature id, not a datasource attribute
+        names.erase(key);
+    }
+    else
+    {
+        names.insert(key);
+    }
+}
+
+template class image_grid_renderer<image_32>;
+}
@@ -46,6 +46,9 @@ extern "C"
 
 #ifdef HAVE_CAIRO
 #include <mapnik/cairo_renderer.hpp>
+#include <cairo-pdf.h>
+#include <cairo-svg.h>
+#include <cairo-ps.h>
 #endif
 
 #include <boost/foreach.hpp>
@@ -375,48 +378,81 @@ void save_to_cairo_file(mapnik::Map const& map, std::string const& filename)
     }
 }
 
+namespace {
+
+cairo_status_t write_to_stream(void * closure, unsigned char const* data, unsigned int length)
+{
+    std::ostream * stream = static_cast<std::ostream *>(closure);
+    stream->write(reinterpret_cast<char const*>(data), length);
+    return stream->good() ? CAIRO_STATUS_SUCCESS : CAIRO_STATUS_WRITE_ERROR;
+}
+
+void check_cairo_status(cairo_status_t status)
+{
+    if (status != CAIRO_STATUS_SUCCESS)
+    {
+        throw ImageWriterException(std::string("Cairo: ") + cairo_status_to_string(status));
+    }
+}
+
+}
+
 void save_to_cairo_file(mapnik::Map const& map,
                         std::string const& filename,
-                        std::string const& type)
+                        std::string const& type,
+                        cairo_font_cache_ptr const& font_cache)
 {
     std::ofstream file (filename.c_str(), std::ios::out|std::ios::trunc|std::ios::binary);
     if (file)
     {
-        Cairo::RefPtr<Cairo::Surface> surface;
-        unsigned width = map.width();
-        unsigned height = map.height();
-        if (type == "pdf")
-            surface = Cairo::PdfSurface::create(filename,width,height);
-        else if (type == "svg")
-            surface = Cairo::SvgSurface::create(filename,width,height);
-        else if (type == "ps")
-            surface = Cairo::PsSurface::create(filename,width,height);
-        else if (type == "ARGB32")
-            surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32,width,height);
-        else if (type == "RGB24")
-            surface = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24,width,height);
-        else 
-            throw ImageWriterException("unknown file type: " + type);    
-        Cairo::RefPtr<Cairo::Context> context = Cairo::Context::create(surface);
-    
-        // TODO - expose as user option
-        /*
-          if (type == "ARGB32" || type == "RGB24") 
-          { 
-          context->set_antialias(Cairo::ANTIALIAS_NONE); 
-          }
-        */
-          
-    
-        mapnik::cairo_renderer<Cairo::Context> ren(map, context);
-        ren.apply();
-    
-        if (type == "ARGB32" || type == "RGB24") 
-        { 
-            surface->write_to_png(filename);
-        }
-        surface->finish();
+        save_to_cairo_stream(map, file, type, font_cache);
+    }
+    else throw ImageWriterException("Could not write file to " + filename );
+}
+
+void save_to_cairo_stream(mapnik::Map const& map,
+                          std::ostream & stream,
+                          std::string const& type,
+                          cairo_font_cache_ptr const& font_cache)
+{
+    // vector surfaces stream their output through write_to_stream
+    // as pages are emitted, so nothing is buffered in a temporary file
+    cairo_surface_t * c_surface = 0;
+    unsigned width = map.width();
+    unsigned height = map.height();
+    if (type == "pdf")
+        c_surface = cairo_pdf_surface_create_for_stream(write_to_stream, &stream, width, height);
+    else if (type == "svg")
+        c_surface = cairo_svg_surface_create_for_stream(write_to_stream, &stream, width, height);
+    else if (type == "ps")
+        c_surface = cairo_ps_surface_create_for_stream(write_to_stream, &stream, width, height);
+    else if (type == "ARGB32")
+        c_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    else if (type == "RGB24")
+        c_surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    else
+        throw ImageWriterException("unknown file type: " + type);
+    Cairo::RefPtr<Cairo::Surface> surface(new Cairo::Surface(c_surface, true));
+    check_cairo_status(cairo_surface_status(c_surface));
+    Cairo::RefPtr<Cairo::Context> context = Cairo::Context::create(surface);
+
+    // TODO - expose as user option
+    /*
+      if (type == "ARGB32" || type == "RGB24")
+      {
+      context->set_antialias(Cairo::ANTIALIAS_NONE);
+      }
+    */
+
+    mapnik::cairo_renderer<Cairo::Context> ren(map, context, font_cache);
+    ren.apply();
+
+    if (type == "ARGB32" || type == "RGB24")
+    {
+        check_cairo_status(cairo_surface_write_to_png_stream(c_surface, write_to_stream, &stream));
     }
+    surface->finish();
+    check_cairo_status(cairo_surface_status(c_surface));
 }
 
 #endif
@@ -24,17 +24,46 @@
 
 // mapnik
 #include <mapnik/layer.hpp>
+#include <mapnik/config.hpp>
 
 #include <mapnik/datasource.hpp>
 #include <mapnik/datasource_cache.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+
+// boost
+#include <boost/make_shared.hpp>
+#include <boost/optional.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/mutex.hpp>
+#endif
 
 // stl
 #include <string>
 #include <iostream>
+#include <map>
 
 
 namespace mapnik
 {   
+
+struct layer::envelope_cache
+{
+    envelope_cache()
+        : valid(false),
+          generation(0) {}
+
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex mutex;
+#endif
+    bool valid;
+    // datasource::generation() the envelope was read at
+    unsigned generation;
+    box2d<double> envelope;
+    // by target srs, empty where reprojection failed
+    std::map<std::string, boost::optional<box2d<double> > > projected;
+};
+
 layer::layer(std::string const& name, std::string const& srs)
     : name_(name),
       title_(""),
@@ -46,7 +75,8 @@ layer::layer(std::string const& name, std::string const& srs)
       queryable_(false),
       clear_label_cache_(false),
       cache_features_(false),
-      ds_() {}
+      ds_(),
+      envelope_cache_(boost::make_shared<envelope_cache>()) {}
     
 layer::layer(const layer& rhs)
     : name_(rhs.name_),
@@ -60,7 +90,8 @@ layer::layer(const layer& rhs)
       clear_label_cache_(rhs.clear_label_cache_),
       cache_features_(rhs.cache_features_),
       styles_(rhs.styles_),
-      ds_(rhs.ds_) {}
+      ds_(rhs.ds_),
+      envelope_cache_(rhs.envelope_cache_) {}
     
 layer& layer::operator=(const layer& rhs)
 {
@@ -88,6 +119,7 @@ void layer::swap(const layer& rhs)
     cache_features_ = rhs.cache_features_;
     styles_=rhs.styles_;
     ds_=rhs.ds_;
+    envelope_cache_=rhs.envelope_cache_;
 }
 
 layer::~layer() {}
@@ -125,6 +157,7 @@ std::string const& layer::abstract() const
 void layer::set_srs(std::string const& srs)
 {
     srs_ = srs;
+    reset_envelope();
 }
     
 std::string const& layer::srs() const
@@ -200,12 +233,61 @@ datasource_ptr layer::datasource() const
 void layer::set_datasource(datasource_ptr const& ds)
 {
     ds_ = ds;
+    reset_envelope();
 }
     
 box2d<double> layer::envelope() const
 {
-    if (ds_) return ds_->envelope();
-    return box2d<double>();
+    if (!ds_) return box2d<double>();
+
+    envelope_cache & cache = *envelope_cache_;
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(cache.mutex);
+#endif
+    // datasources whose features change report it through their
+    // generation, which drops the envelope and its reprojections
+    unsigned generation = ds_->generation();
+    if (!cache.valid || cache.generation != generation)
+    {
+        cache.envelope = ds_->envelope();
+        cache.generation = generation;
+        cache.projected.clear();
+        cache.valid = true;
+    }
+    return cache.envelope;
+}
+
+bool layer::envelope(std::string const& srs, box2d<double> & ext) const
+{
+    box2d<double> layer_ext = envelope();
+    if (!ds_) return false;
+
+    envelope_cache & cache = *envelope_cache_;
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(cache.mutex);
+#endif
+    std::map<std::string, boost::optional<box2d<double> > >::const_iterator itr = cache.projected.find(srs);
+    if (itr == cache.projected.end())
+    {
+        projection proj0(srs);
+        projection proj1(srs_);
+        proj_transform prj_trans(proj0, proj1);
+        boost::optional<box2d<double> > projected;
+        if (prj_trans.backward(layer_ext, PROJ_ENVELOPE_POINTS))
+        {
+            projected = layer_ext;
+        }
+        itr = cache.projected.insert(std::make_pair(srs, projected)).first;
+    }
+    if (!itr->second) return false;
+    ext = *itr->second;
+    return true;
+}
+
+void layer::reset_envelope()
+{
+    // copies sharing the old cache keep it
+    envelope_cache_ = boost::make_shared<envelope_cache>();
 }
     
 void layer::set_clear_label_cache(bool clear)
@@ -1884,7 +1884,7 @@ void map_parser::parse_building_symbolizer( rule & rule, ptree const & sym )
 void map_parser::parse_raster_symbolizer( rule & rule, ptree const & sym )
 {
     // no support for meta-writer,meta-output
-    ensure_attrs(sym, "RasterSymbolizer", "mode,scaling,opacity,filter-factor,mesh-size");
+    ensure_attrs(sym, "RasterSymbolizer", "mode,scaling,opacity,filter-factor,mesh-size,warp-threads");
     try
     {
         raster_symbolizer raster_sym;
@@ -1909,6 +1909,10 @@ void map_parser::parse_raster_symbolizer( rule & rule, ptree const & sym )
         optional<unsigned> mesh_size = get_opt_attr<unsigned>(sym, "mesh-size");
         if (mesh_size) raster_sym.set_mesh_size(*mesh_size);
 
+        // warp-threads
+        optional<unsigned> warp_threads = get_opt_attr<unsigned>(sym, "warp-threads");
+        if (warp_threads) raster_sym.set_warp_threads(*warp_threads);
+
 
         ptree::const_iterator cssIter = sym.begin();
         ptree::const_iterator endCss = sym.end();
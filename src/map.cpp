@@ -28,10 +28,15 @@
 #include <mapnik/filter_featureset.hpp>
 #include <mapnik/hit_test_filter.hpp>
 #include <mapnik/scale_denominator.hpp>
+#include <mapnik/query.hpp>
 
 // icu
 #include <unicode/uversion.h>
 
+// stl
+#include <cmath>
+#include <map>
+
 namespace mapnik
 {
 
@@ -67,6 +72,11 @@ Map::Map()
       height_(400),
       srs_("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs"),
       buffer_size_(0),
+      styles_(new std::map<std::string,feature_type_style>),
+      metawriters_(new std::map<std::string,metawriter_ptr>),
+      fontsets_(new std::map<std::string,font_set>),
+      styles_leaked_(false),
+      fontsets_leaked_(false),
       aspectFixMode_(GROW_BBOX),
       base_path_("") {}
     
@@ -75,6 +85,11 @@ Map::Map(int width,int height, std::string const& srs)
       height_(height),
       srs_(srs),
       buffer_size_(0),
+      styles_(new std::map<std::string,feature_type_style>),
+      metawriters_(new std::map<std::string,metawriter_ptr>),
+      fontsets_(new std::map<std::string,font_set>),
+      styles_leaked_(false),
+      fontsets_leaked_(false),
       aspectFixMode_(GROW_BBOX),
       base_path_("") {}
    
@@ -85,8 +100,11 @@ Map::Map(const Map& rhs)
       buffer_size_(rhs.buffer_size_),
       background_(rhs.background_),
       background_image_(rhs.background_image_),
-      styles_(rhs.styles_),
+      styles_(share(rhs.styles_, rhs.styles_leaked_)),
       metawriters_(rhs.metawriters_),
+      fontsets_(share(rhs.fontsets_, rhs.fontsets_leaked_)),
+      styles_leaked_(false),
+      fontsets_leaked_(false),
       layers_(rhs.layers_),
       aspectFixMode_(rhs.aspectFixMode_),
       current_extent_(rhs.current_extent_),
@@ -103,8 +121,11 @@ Map& Map::operator=(const Map& rhs)
     buffer_size_ = rhs.buffer_size_;
     background_=rhs.background_;
     background_image_=rhs.background_image_;
-    styles_=rhs.styles_;
+    styles_ = share(rhs.styles_, rhs.styles_leaked_);
     metawriters_ = rhs.metawriters_;
+    fontsets_ = share(rhs.fontsets_, rhs.fontsets_leaked_);
+    styles_leaked_ = false;
+    fontsets_leaked_ = false;
     layers_=rhs.layers_;
     aspectFixMode_=rhs.aspectFixMode_;
     maximum_extent_=rhs.maximum_extent_;
@@ -112,51 +133,78 @@ Map& Map::operator=(const Map& rhs)
     extra_attr_=rhs.extra_attr_;
     return *this;
 }
+
+template <typename T>
+T & Map::detach(boost::shared_ptr<T> & shared)
+{
+    // only the owner can raise the use count of a unique
+    // pointer, so no other map can start sharing it meanwhile
+    if (!shared.unique())
+    {
+        shared.reset(new T(*shared));
+    }
+    return *shared;
+}
+
+template <typename T>
+boost::shared_ptr<T> Map::share(boost::shared_ptr<T> const& shared, bool leaked)
+{
+    if (leaked)
+    {
+        return boost::shared_ptr<T>(new T(*shared));
+    }
+    return shared;
+}
    
 std::map<std::string,feature_type_style> const& Map::styles() const
 {
-    return styles_;
+    return *styles_;
 }
    
 std::map<std::string,feature_type_style> & Map::styles()
 {
-    return styles_;
+    styles_leaked_ = true;
+    return detach(styles_);
 }
    
 Map::style_iterator Map::begin_styles()
 {
-    return styles_.begin();
+    styles_leaked_ = true;
+    return detach(styles_).begin();
 }
     
 Map::style_iterator Map::end_styles()
 {
-    return styles_.end();
+    styles_leaked_ = true;
+    return detach(styles_).end();
 }
     
 Map::const_style_iterator  Map::begin_styles() const
 {
-    return styles_.begin();
+    return styles_->begin();
 }
     
 Map::const_style_iterator  Map::end_styles() const
 {
-    return styles_.end();
+    return styles_->end();
 }
     
 bool Map::insert_style(std::string const& name,feature_type_style const& style) 
 {
-    return styles_.insert(make_pair(name,style)).second;
+    if (styles_->find(name) != styles_->end()) return false;
+    return detach(styles_).insert(make_pair(name,style)).second;
 }
     
 void Map::remove_style(std::string const& name) 
 {
-    styles_.erase(name);
+    if (styles_->find(name) == styles_->end()) return;
+    detach(styles_).erase(name);
 }
 
 boost::optional<feature_type_style const&> Map::find_style(std::string const& name) const
 {
-    std::map<std::string,feature_type_style>::const_iterator itr = styles_.find(name);
-    if (itr != styles_.end())
+    std::map<std::string,feature_type_style>::const_iterator itr = styles_->find(name);
+    if (itr != styles_->end())
         return boost::optional<feature_type_style const&>(itr->second);
     else
         return boost::optional<feature_type_style const&>() ;
@@ -164,18 +212,20 @@ boost::optional<feature_type_style const&> Map::find_style(std::string const& na
 
 bool Map::insert_metawriter(std::string const& name, metawriter_ptr const& writer)
 {
-    return metawriters_.insert(make_pair(name, writer)).second;
+    if (metawriters_->find(name) != metawriters_->end()) return false;
+    return detach(metawriters_).insert(make_pair(name, writer)).second;
 }
 
 void Map::remove_metawriter(std::string const& name)
 {
-    metawriters_.erase(name);
+    if (metawriters_->find(name) == metawriters_->end()) return;
+    detach(metawriters_).erase(name);
 }
 
 metawriter_ptr Map::find_metawriter(std::string const& name) const
 {
-    std::map<std::string, metawriter_ptr>::const_iterator itr = metawriters_.find(name);
-    if (itr != metawriters_.end())
+    std::map<std::string, metawriter_ptr>::const_iterator itr = metawriters_->find(name);
+    if (itr != metawriters_->end())
         return itr->second;
     else
         return metawriter_ptr();
@@ -183,28 +233,29 @@ metawriter_ptr Map::find_metawriter(std::string const& name) const
 
 std::map<std::string,metawriter_ptr> const& Map::metawriters() const
 {
-    return metawriters_;
+    return *metawriters_;
 }
 
 Map::const_metawriter_iterator Map::begin_metawriters() const
 {
-    return metawriters_.begin();
+    return metawriters_->begin();
 }
 
 Map::const_metawriter_iterator Map::end_metawriters() const
 {
-    return metawriters_.end();
+    return metawriters_->end();
 }
 
 bool Map::insert_fontset(std::string const& name, font_set const& fontset) 
 {
-    return fontsets_.insert(make_pair(name, fontset)).second;
+    if (fontsets_->find(name) != fontsets_->end()) return false;
+    return detach(fontsets_).insert(make_pair(name, fontset)).second;
 }
          
 font_set const& Map::find_fontset(std::string const& name) const
 {
-    std::map<std::string,font_set>::const_iterator itr = fontsets_.find(name);
-    if (itr!=fontsets_.end())
+    std::map<std::string,font_set>::const_iterator itr = fontsets_->find(name);
+    if (itr!=fontsets_->end())
         return itr->second;
     static font_set default_fontset;
     return default_fontset;
@@ -212,12 +263,13 @@ font_set const& Map::find_fontset(std::string const& name) const
 
 std::map<std::string,font_set> const& Map::fontsets() const
 {
-    return fontsets_;
+    return *fontsets_;
 }
 
 std::map<std::string,font_set> & Map::fontsets()
 {
-    return fontsets_;
+    fontsets_leaked_ = true;
+    return detach(fontsets_);
 }
 
 size_t Map::layer_count() const
@@ -238,8 +290,11 @@ void Map::removeLayer(size_t index)
 void Map::remove_all() 
 {
     layers_.clear();
-    styles_.clear();
-    metawriters_.clear();
+    styles_.reset(new std::map<std::string,feature_type_style>);
+    metawriters_.reset(new std::map<std::string,metawriter_ptr>);
+    fontsets_.reset(new std::map<std::string,font_set>);
+    styles_leaked_ = false;
+    fontsets_leaked_ = false;
 }
     
 const layer& Map::getLayer(size_t index) const
@@ -382,7 +437,6 @@ void Map::zoom_all()
     {
         try 
         {
-            projection proj0(srs_);
             box2d<double> ext;
             bool success = false;
             bool first = true;
@@ -392,14 +446,9 @@ void Map::zoom_all()
             {
                 if (itr->isActive())
                 {
-                    std::string const& layer_srs = itr->srs();
-                    projection proj1(layer_srs);
-                    
-                    proj_transform prj_trans(proj0,proj1);
-                        
-                    box2d<double> layer_ext = itr->envelope();
-                    // TODO - consider using more robust method: http://trac.mapnik.org/ticket/751
-                    if (prj_trans.backward(layer_ext))
+                    // cached by the layer, reprojected with PROJ_ENVELOPE_POINTS
+                    box2d<double> layer_ext;
+                    if (itr->envelope(srs_, layer_ext))
                     {
                         success = true;
             #ifdef MAPNIK_DEBUG
@@ -633,13 +682,141 @@ featureset_ptr Map::query_map_point(unsigned index, double x, double y) const
     return featureset_ptr();
 }
 
+point_query_results Map::query_points(unsigned index,
+                                      std::vector<coord2d> const& points,
+                                      double tolerance,
+                                      std::vector<std::string> const& fields,
+                                      point_query_cache * cache) const
+{
+    point_query_results results(points.size());
+    if (index >= layers_.size() || points.empty()) return results;
+
+    mapnik::layer const& layer = layers_[index];
+    mapnik::datasource_ptr ds = layer.datasource();
+    if (!ds) return results;
+
+    try
+    {
+        mapnik::projection dest(srs_);
+        mapnik::projection source(layer.srs());
+        proj_transform prj_trans(source,dest);
+        double z = 0;
+
+        double minx = current_extent_.minx();
+        double miny = current_extent_.miny();
+        double maxx = current_extent_.maxx();
+        double maxy = current_extent_.maxy();
+
+        prj_trans.backward(minx,miny,z);
+        prj_trans.backward(maxx,maxy,z);
+        double tol = (maxx - minx) / width_ * tolerance;
+
+        std::vector<coord2d> layer_points(points);
+        for (unsigned i = 0; i < layer_points.size(); ++i)
+        {
+            prj_trans.backward(layer_points[i].x,layer_points[i].y,z);
+        }
+
+        std::vector<std::string> names(fields);
+        if (names.empty())
+        {
+            std::vector<attribute_descriptor> const& desc = ds->get_descriptor().get_descriptors();
+            for (unsigned i = 0; i < desc.size(); ++i)
+            {
+                names.push_back(desc[i].get_name());
+            }
+        }
+
+        feature_index_ptr features;
+        if (cache) features = cache->find(ds, names);
+        if (features)
+        {
+            for (unsigned i = 0; i < layer_points.size(); ++i)
+            {
+                features->hit_test(layer_points[i].x, layer_points[i].y, tol, results[i]);
+            }
+            return results;
+        }
+
+        // group the points into cells of 256 map pixels and query each
+        // group on its own, so that points far apart do not load all the
+        // features in between
+        double cell = (maxx - minx) / width_ * 256;
+        typedef std::map<std::pair<long,long>, std::vector<unsigned> > cluster_map;
+        cluster_map clusters;
+        for (unsigned i = 0; i < layer_points.size(); ++i)
+        {
+            std::pair<long,long> key(0,0);
+            if (cell > 0)
+            {
+                key.first = long(std::floor(layer_points[i].x / cell));
+                key.second = long(std::floor(layer_points[i].y / cell));
+            }
+            clusters[key].push_back(i);
+        }
+
+        query::resolution_type res(width_ / (maxx - minx), height_ / (maxy - miny));
+        cluster_map::const_iterator itr = clusters.begin();
+        for (; itr != clusters.end(); ++itr)
+        {
+            std::vector<unsigned> const& members = itr->second;
+            coord2d const& first = layer_points[members[0]];
+            box2d<double> bbox(first.x, first.y, first.x, first.y);
+            for (unsigned i = 1; i < members.size(); ++i)
+            {
+                bbox.expand_to_include(layer_points[members[i]]);
+            }
+            bbox.init(bbox.minx() - tol, bbox.miny() - tol, bbox.maxx() + tol, bbox.maxy() + tol);
+#ifdef MAPNIK_DEBUG
+            std::clog << " query " << members.size() << " points tol = " << tol << " in " << bbox << "\n";
+#endif
+            query q(bbox, res);
+            for (unsigned i = 0; i < names.size(); ++i)
+            {
+                q.add_property_name(names[i]);
+            }
+            feature_index index(ds->features(q), bbox);
+            for (unsigned i = 0; i < members.size(); ++i)
+            {
+                coord2d const& pt = layer_points[members[i]];
+                index.hit_test(pt.x, pt.y, tol, results[members[i]]);
+            }
+        }
+    }
+    catch (...)
+    {
+#ifdef MAPNIK_DEBUG
+        std::clog << "exception caught in \"query_points\"\n";
+#endif
+    }
+    return results;
+}
+
+point_query_results Map::query_map_points(unsigned index,
+                                          std::vector<coord2d> const& points,
+                                          double tolerance,
+                                          std::vector<std::string> const& fields,
+                                          point_query_cache * cache) const
+{
+    CoordTransform tr = view_transform();
+    std::vector<coord2d> map_points(points);
+    for (unsigned i = 0; i < map_points.size(); ++i)
+    {
+        tr.backward(&map_points[i].x, &map_points[i].y);
+    }
+    return query_points(index, map_points, tolerance, fields, cache);
+}
+
 Map::~Map() {}
 
 void Map::init_metawriters()
 {
     metawriter_cache_dispatch d(*this);
-    Map::style_iterator styIter = begin_styles();
-    Map::style_iterator styEnd = end_styles();
+    // detach without marking the styles as leaked, no reference into
+    // them outlives this call
+    std::map<std::string,feature_type_style> & styles = detach(styles_);
+    Map::style_iterator styIter = styles.begin();
+    Map::style_iterator styEnd = styles.end();
     for (; styIter!=styEnd; ++styIter) {
         std::vector<rule>& rules = styIter->second.get_rules_nonconst();
         std::vector<rule>::iterator ruleIter = rules.begin();
@@ -25,55 +25,271 @@
 #include <mapnik/memory_datasource.hpp>
 #include <mapnik/memory_featureset.hpp>
 #include <mapnik/feature_factory.hpp>
+// boost
+#include <boost/next_prior.hpp>
 // stl
 #include <algorithm>
 
 namespace mapnik {
-    
-struct accumulate_extent
-{
-    accumulate_extent(box2d<double> & ext)
-        : ext_(ext),first_(true) {}
-        
-    void operator() (feature_ptr feat)
-    {
-        for (unsigned i=0;i<feat->num_geometries();++i)
-        {
-            geometry_type & geom = feat->get_geometry(i);
-            if ( first_ ) 
-            {
-                first_ = false;
-                ext_ = geom.envelope();
-            }
-            else
-            {
-                ext_.expand_to_include(geom.envelope());
-            }
-        }
-    }
-        
-    box2d<double> & ext_;
-    bool first_;
-};
-    
+
 memory_datasource::memory_datasource()
     : datasource(parameters()),
+      removed_(0),
+      stale_(0),
+      generation_(0),
+      index_dirty_(false),
+      extent_dirty_(false),
       desc_("in-memory datasource","utf-8") {}
 
 memory_datasource::~memory_datasource() {}
-    
+
 void memory_datasource::push(feature_ptr feature)
 {
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
     // TODO - collect attribute descriptors?
     //desc_.add_descriptor(attribute_descriptor(fld_name,mapnik::Integer));
-    features_.push_back(feature);
+    do_push(feature);
+    ++generation_;
 }
-    
+
+std::size_t memory_datasource::remove(int id)
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    std::size_t count = do_remove(id);
+    if (count > 0) ++generation_;
+    return count;
+}
+
+void memory_datasource::update(feature_ptr feature)
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    std::pair<id_map::iterator,id_map::iterator> range = ids_.equal_range(feature->id());
+    if (range.first != range.second && boost::next(range.first) == range.second)
+    {
+        // keep the feature at its place in the drawing order; its old
+        // index entry goes stale and is skipped by features_in_box().
+        // The feature may have moved, so the extent is recomputed
+        // lazily rather than grown to cover its old and new place.
+        extent_dirty_ = true;
+        set_item(range.first->second, feature);
+        ++stale_;
+        if (stale_ * 2 > items_.size()) compact();
+    }
+    else
+    {
+        do_remove(feature->id());
+        do_push(feature);
+    }
+    ++generation_;
+}
+
+void memory_datasource::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    items_.clear();
+    ids_.clear();
+    removed_ = 0;
+    stale_ = 0;
+    index_.reset();
+    extent_.reset();
+    index_dirty_ = false;
+    extent_dirty_ = false;
+    ++generation_;
+}
+
+void memory_datasource::do_push(feature_ptr const& feature)
+{
+    std::size_t pos = items_.size();
+    items_.push_back(item());
+    ids_.insert(std::make_pair(feature->id(), pos));
+    set_item(pos, feature);
+}
+
+std::size_t memory_datasource::do_remove(int id)
+{
+    std::pair<id_map::iterator,id_map::iterator> range = ids_.equal_range(id);
+    std::size_t count = 0;
+    for (id_map::iterator itr = range.first; itr != range.second; ++itr)
+    {
+        item & entry = items_[itr->second];
+        entry.feature.reset();
+        entry.parts.clear();
+        ++count;
+    }
+    if (count > 0)
+    {
+        ids_.erase(range.first, range.second);
+        removed_ += count;
+        stale_ += count;
+        extent_dirty_ = true;
+        if (stale_ * 2 > items_.size()) compact();
+    }
+    return count;
+}
+
+void memory_datasource::set_item(std::size_t pos, feature_ptr const& feature)
+{
+    item & entry = items_[pos];
+    entry.feature = feature;
+    entry.envelope = box2d<double>();
+    entry.parts.clear();
+    unsigned num_geometries = feature->num_geometries();
+    for (unsigned i = 0; i < num_geometries; ++i)
+    {
+        box2d<double> box = feature->get_geometry(i).envelope();
+        if (i == 0) entry.envelope = box;
+        else entry.envelope.expand_to_include(box);
+        if (num_geometries > 1) entry.parts.push_back(box);
+    }
+    // features without geometries never match a query
+    if (num_geometries == 0) return;
+
+    if (!extent_dirty_)
+    {
+        if (extent_) extent_->expand_to_include(entry.envelope);
+        else extent_ = entry.envelope;
+    }
+    if (index_ && !index_dirty_ && index_->extent().contains(entry.envelope))
+    {
+        index_->insert(pos, entry.envelope);
+    }
+    else
+    {
+        index_dirty_ = true;
+    }
+}
+
+void memory_datasource::compact()
+{
+    std::vector<item> items;
+    items.reserve(items_.size() - removed_);
+    ids_.clear();
+    for (std::vector<item>::iterator itr = items_.begin(); itr != items_.end(); ++itr)
+    {
+        if (itr->feature)
+        {
+            ids_.insert(std::make_pair(itr->feature->id(), items.size()));
+            items.push_back(item());
+            items.back().feature = itr->feature;
+            items.back().envelope = itr->envelope;
+            items.back().parts.swap(itr->parts);
+        }
+    }
+    items_.swap(items);
+    removed_ = 0;
+    stale_ = 0;
+    index_dirty_ = true;
+    extent_dirty_ = true;
+}
+
+void memory_datasource::update_extent() const
+{
+    if (!extent_dirty_) return;
+    extent_.reset();
+    for (std::vector<item>::const_iterator itr = items_.begin(); itr != items_.end(); ++itr)
+    {
+        if (itr->feature && itr->feature->num_geometries() > 0)
+        {
+            if (extent_) extent_->expand_to_include(itr->envelope);
+            else extent_ = itr->envelope;
+        }
+    }
+    extent_dirty_ = false;
+}
+
+void memory_datasource::update_index() const
+{
+    if (index_ && !index_dirty_) return;
+    update_extent();
+    index_.reset();
+    index_dirty_ = false;
+    if (!extent_) return;
+    index_.reset(new index_type(*extent_));
+    for (std::size_t pos = 0; pos < items_.size(); ++pos)
+    {
+        item const& entry = items_[pos];
+        if (entry.feature && entry.feature->num_geometries() > 0)
+        {
+            index_->insert(pos, entry.envelope);
+        }
+    }
+}
+
+namespace {
+
+template <typename Item>
+bool item_intersects(Item const& entry, box2d<double> const& box)
+{
+    // a feature replaced by update() may have lost its geometries
+    if (!entry.feature || entry.feature->num_geometries() == 0) return false;
+    if (!box.intersects(entry.envelope)) return false;
+    if (entry.parts.empty()) return true;
+    for (std::vector<box2d<double> >::const_iterator part = entry.parts.begin(); part != entry.parts.end(); ++part)
+    {
+        if (box.intersects(*part)) return true;
+    }
+    return false;
+}
+
+}
+
+void memory_datasource::features_in_box(box2d<double> const& box, std::vector<feature_ptr> & result) const
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    update_extent();
+    if (!extent_) return;
+    if (box.contains(*extent_))
+    {
+        // everything matches, as when replaying the feature cache
+        // of a layer, so there is no need to build the index
+        for (std::vector<item>::const_iterator itr = items_.begin(); itr != items_.end(); ++itr)
+        {
+            if (itr->feature && itr->feature->num_geometries() > 0)
+            {
+                result.push_back(itr->feature);
+            }
+        }
+        return;
+    }
+
+    update_index();
+    index_type::result_t candidates;
+    index_->query_in_box(box, candidates);
+    std::vector<std::size_t> positions;
+    positions.reserve(candidates.size());
+    for (index_type::query_iterator itr = candidates.begin(); itr != candidates.end(); ++itr)
+    {
+        positions.push_back(*itr);
+    }
+    // return features in the order they were pushed, once each
+    std::sort(positions.begin(), positions.end());
+    positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+    for (std::vector<std::size_t>::const_iterator itr = positions.begin(); itr != positions.end(); ++itr)
+    {
+        item const& entry = items_[*itr];
+        if (item_intersects(entry, box))
+        {
+            result.push_back(entry.feature);
+        }
+    }
+}
+
 int memory_datasource::type() const
 {
     return datasource::Vector;
 }
-    
+
 featureset_ptr memory_datasource::features(const query& q) const
 {
     return featureset_ptr(new memory_featureset(q.get_bbox(),*this));
@@ -91,20 +307,32 @@ featureset_ptr memory_datasource::features_at_point(coord2d const& pt) const
     
 box2d<double> memory_datasource::envelope() const
 {
-    box2d<double> ext;
-    accumulate_extent func(ext);
-    std::for_each(features_.begin(),features_.end(),func);
-    return ext;      
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    update_extent();
+    return extent_ ? *extent_ : box2d<double>();
 }
     
 layer_descriptor memory_datasource::get_descriptor() const
 {
     return desc_;
 }
+
+unsigned memory_datasource::generation() const
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    return generation_;
+}
     
 size_t memory_datasource::size() const
 {
-    return features_.size();
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    return items_.size() - removed_;
 }
 
 // point_datasource
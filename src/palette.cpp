@@ -78,7 +78,12 @@ unsigned rgba_palette::quantize(rgba const& c) const
     unsigned index = 0;
     if (colors_ == 1) return index;
 
-    rgba_hash_table::iterator it = color_hashmap_.find(c);
+    if (cache_.find(c, index))
+    {
+        return index;
+    }
+
+    rgba_hash_table::const_iterator it = color_hashmap_.find(c);
     if (it != color_hashmap_.end())
     {
         index = it->second;
@@ -135,10 +140,10 @@ unsigned rgba_palette::quantize(rgba const& c) const
             }
         }
 
-        // Cache found index for the color c into the hashmap.
-        color_hashmap_[c] = index;
     }
 
+    // Cache found index for the color c.
+    cache_.insert(c, index);
     return index;
 }
 
@@ -160,6 +165,7 @@ void rgba_palette::parse(std::string const& pal, palette_type type)
 
     sorted_pal_.clear();
     color_hashmap_.clear();
+    cache_.clear();
     rgb_pal_.clear();
     alpha_pal_.clear();
 
@@ -0,0 +1,193 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/point_query.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/feature_layer_desc.hpp>
+
+// stl
+#include <cmath>
+#include <sstream>
+
+namespace mapnik
+{
+
+namespace {
+
+// Same test as geometry::hit_test, but reading vertices by position
+// instead of through the geometry's shared iterator, so that indexed
+// features can be tested from several threads at once.
+bool hit_test(geometry_type const& geom, double x, double y, double tol)
+{
+    unsigned size = geom.num_points();
+    if (size == 1)
+    {
+        double x0, y0;
+        geom.get_vertex(0, &x0, &y0);
+        return std::sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) <= std::fabs(tol);
+    }
+    else if (size > 1)
+    {
+        bool inside = false;
+        double x0 = 0;
+        double y0 = 0;
+        geom.get_vertex(0, &x0, &y0);
+        for (unsigned pos = 1; pos < size; ++pos)
+        {
+            double x1, y1;
+            unsigned command = geom.get_vertex(pos, &x1, &y1);
+            if (command == SEG_MOVETO)
+            {
+                x0 = x1;
+                y0 = y1;
+                continue;
+            }
+            if ((((y1 <= y) && (y < y0)) ||
+                 ((y0 <= y) && (y < y1))) &&
+                ( x < (x0 - x1) * (y - y1)/ (y0 - y1) + x1))
+                inside = !inside;
+            x0 = x1;
+            y0 = y1;
+        }
+        return inside;
+    }
+    return false;
+}
+
+}
+
+feature_index::feature_index(featureset_ptr const& fs, box2d<double> const& extent)
+    : tree_(extent),
+      size_(0)
+{
+    if (!fs) return;
+    feature_ptr feature;
+    while ((feature = fs->next()))
+    {
+        if (feature->num_geometries() == 0) continue;
+        box2d<double> box = feature->envelope();
+        tree_.insert(entry(box, feature), box);
+        ++size_;
+    }
+}
+
+void feature_index::hit_test(double x, double y, double tol, point_query_result & result) const
+{
+    box2d<double> box(x - tol, y - tol, x + tol, y + tol);
+    quad_tree<entry>::result_t candidates;
+    tree_.query_in_box(box, candidates);
+    quad_tree<entry>::query_iterator itr = candidates.begin();
+    quad_tree<entry>::query_iterator end = candidates.end();
+    for (; itr != end; ++itr)
+    {
+        if (!itr->box.intersects(box)) continue;
+        Feature const& feature = *itr->feature;
+        for (unsigned i = 0; i < feature.num_geometries(); ++i)
+        {
+            if (mapnik::hit_test(feature.get_geometry(i), x, y, tol))
+            {
+                result.push_back(itr->feature);
+                break;
+            }
+        }
+    }
+}
+
+point_query_cache::point_query_cache(unsigned hot_threshold)
+    : hot_threshold_(hot_threshold) {}
+
+feature_index_ptr point_query_cache::find(datasource_ptr const& ds,
+                                          std::vector<std::string> const& fields)
+{
+    std::ostringstream s;
+    for (unsigned i = 0; i < fields.size(); ++i)
+    {
+        s << fields[i] << '\n';
+    }
+    cache_type::key_type key(ds.get(), s.str());
+    {
+#ifdef MAPNIK_THREADSAFE
+        boost::mutex::scoped_lock lock(mutex_);
+#endif
+        entry & e = cache_[key];
+        if (e.index) return e.index;
+        e.ds = ds;
+        if (++e.hits < hot_threshold_) return feature_index_ptr();
+    }
+
+    // load the whole datasource without holding the lock,
+    // a concurrent build of the same index is harmless
+    box2d<double> extent = ds->envelope();
+    query q(extent);
+    for (unsigned i = 0; i < fields.size(); ++i)
+    {
+        q.add_property_name(fields[i]);
+    }
+    feature_index_ptr index(new feature_index(ds->features(q), extent));
+
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    cache_type::iterator itr = cache_.find(key);
+    // invalidated while we were building
+    if (itr == cache_.end()) return index;
+    if (!itr->second.index) itr->second.index = index;
+    return itr->second.index;
+}
+
+void point_query_cache::invalidate(datasource_ptr const& ds)
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    cache_type::iterator itr = cache_.begin();
+    while (itr != cache_.end())
+    {
+        if (itr->first.first == ds.get()) cache_.erase(itr++);
+        else ++itr;
+    }
+}
+
+void point_query_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    cache_.clear();
+}
+
+std::size_t point_query_cache::size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    std::size_t count = 0;
+    for (cache_type::const_iterator itr = cache_.begin(); itr != cache_.end(); ++itr)
+    {
+        if (itr->second.index) ++count;
+    }
+    return count;
+}
+
+}
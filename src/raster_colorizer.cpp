@@ -24,6 +24,8 @@
 
 #include <mapnik/raster_colorizer.hpp>
 #include <limits>
+#include <cmath>
+#include <vector>
 
 namespace mapnik
 {
@@ -89,7 +91,7 @@ raster_colorizer::raster_colorizer(colorizer_mode mode/* = COLORIZER_LINEAR*/, c
     , default_color_(_color)
     , epsilon_(std::numeric_limits<float>::epsilon())
 {
-    
+    update_table();
 }
 
 raster_colorizer::~raster_colorizer()
@@ -105,10 +107,124 @@ bool raster_colorizer::add_stop(const colorizer_stop & stop) {
     }
     
     stops_.push_back(stop);
+    update_table();
 
     return true;
 }
 
+/*! \brief Stop table compiled from a raster_colorizer
+ *
+ * Stop modes are resolved against the default mode and the colour deltas
+ * and value ranges used for linear interpolation are computed up front, so
+ * that colouring a pixel is a binary search (usually skipped, since
+ * neighbouring pixels tend to fall into the same stop) plus a few flops.
+ * The arithmetic is kept identical to the original per-value code so the
+ * output does not change. The table is immutable once built, so it can be
+ * used from several threads; callers keep their own search hint.
+ */
+class raster_colorizer::compiled_table
+{
+public:
+    explicit compiled_table(raster_colorizer const& rc)
+        : default_color_(rc.get_default_color()),
+          epsilon_(rc.get_epsilon())
+    {
+        colorizer_stops const& stops = rc.get_stops();
+        colorizer_mode_enum default_mode = rc.get_default_mode();
+        std::size_t count = stops.size();
+        entries_.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            colorizer_stop const& stop = stops[i];
+            colorizer_stop const& next = stops[(i + 1 < count) ? i + 1 : i];
+            color const& c = stop.get_color();
+            color const& n = next.get_color();
+            entry e;
+            e.value = stop.get_value();
+            e.range = next.get_value() - e.value;
+            e.mode = stop.get_mode();
+            if (e.mode == COLORIZER_INHERIT) e.mode = default_mode;
+            e.c = c;
+            e.r = c.red();
+            e.g = c.green();
+            e.b = c.blue();
+            e.a = c.alpha();
+            e.dr = float(n.red()) - e.r;
+            e.dg = float(n.green()) - e.g;
+            e.db = float(n.blue()) - e.b;
+            e.da = float(n.alpha()) - e.a;
+            entries_.push_back(e);
+        }
+    }
+
+    // last is the stop found by the previous lookup, -1 initially
+    inline color operator() (float value, int & last) const
+    {
+        int idx = find(value, last);
+        if (idx < 0) return default_color_;
+
+        entry const& e = entries_[idx];
+        switch (e.mode)
+        {
+        case COLORIZER_LINEAR:
+            if (e.range == 0) return e.c;
+            {
+                float fraction = (value - e.value) / e.range;
+                return color(unsigned(fraction * e.dr + e.r),
+                             unsigned(fraction * e.dg + e.g),
+                             unsigned(fraction * e.db + e.b),
+                             unsigned(fraction * e.da + e.a));
+            }
+        case COLORIZER_DISCRETE:
+            return e.c;
+        case COLORIZER_EXACT:
+        default:
+            return (std::fabs(value - e.value) < epsilon_) ? e.c : default_color_;
+        }
+    }
+
+private:
+    struct entry
+    {
+        float value;
+        float range;  // distance to the next stop, 0 for the last one
+        colorizer_mode_enum mode;
+        color c;
+        float r, g, b, a;
+        float dr, dg, db, da;
+    };
+
+    // index of the last stop whose value is <= value, or -1
+    inline int find(float value, int & last) const
+    {
+        int count = entries_.size();
+        if (last >= 0 && value >= entries_[last].value &&
+            (last + 1 == count || value < entries_[last + 1].value))
+        {
+            return last;
+        }
+        int lo = 0;
+        int hi = count;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (value < entries_[mid].value) hi = mid;
+            else lo = mid + 1;
+        }
+        last = lo - 1;
+        return last;
+    }
+
+    std::vector<entry> entries_;
+    color default_color_;
+    float epsilon_;
+};
+
+void raster_colorizer::update_table()
+{
+    table_.reset(new compiled_table(*this));
+}
+
 void raster_colorizer::colorize(raster_ptr const& raster,const std::map<std::string,value> &Props) const
 {
     unsigned *imageData = raster->data_.getData();
@@ -118,140 +234,32 @@ void raster_colorizer::colorize(raster_ptr const& raster,const std::map<std::str
     bool hasNoData = false;
     float noDataValue = 0;
 
-    if (Props.count("NODATA")>0)
+    std::map<std::string,value>::const_iterator nodata = Props.find("NODATA");
+    if (nodata != Props.end())
     {
         hasNoData = true;
-        noDataValue = Props.at("NODATA").to_double();
+        noDataValue = nodata->second.to_double();
     }
 
+    unsigned const noDataColor = color(0,0,0,0).rgba();
+    compiled_table const& table = *table_;
+    int last = -1;
+
     for (int i=0; i<len; ++i)
     {
         // the GDAL plugin reads single bands as floats
         float value = *reinterpret_cast<float *> (&imageData[i]);
         if (hasNoData && noDataValue == value)
-            imageData[i] = color(0,0,0,0).rgba();
+            imageData[i] = noDataColor;
         else
-            imageData[i] = get_color(value).rgba();
+            imageData[i] = table(value, last).rgba();
     }
 }
 
-inline float interpolate(float start,float end, float fraction)
+color raster_colorizer::get_color(float value) const
 {
-    return fraction * (end - start) + start;
-}
-
-color raster_colorizer::get_color(float value) const {
-    int stopCount = stops_.size();
-    
-    //use default color if no stops
-    if(stopCount == 0) {
-        return default_color_;
-    }
-    
-    //1 - Find the stop that the value is in
-    int stopIdx = -1;
-    bool foundStopIdx = false;
-    
-    for(int i=0; i<stopCount; i++) {
-        if(value < stops_[i].get_value()) {
-            stopIdx = i-1;
-            foundStopIdx = true;
-            break;
-        }
-    }
-    if(!foundStopIdx) {
-        stopIdx = stopCount-1;
-    }
-    
-    //2 - Find the next stop
-    int nextStopIdx = stopIdx + 1;
-    if(nextStopIdx >= stopCount) {      //there is no next stop
-        nextStopIdx = stopCount - 1;
-    }
-    
-    //3 - Work out the mode
-    colorizer_mode stopMode;
-    if( stopIdx == -1 ) {       //before the first stop
-        stopMode = default_mode_;
-    }
-    else {
-        stopMode = stops_[stopIdx].get_mode();
-        if(stopMode == COLORIZER_INHERIT) {
-            stopMode = default_mode_;
-        }
-    }
-    
-    //4 - Calculate the colour
-    color stopColor;
-    color nextStopColor;
-    float stopValue = 0;
-    float nextStopValue = 0;
-    color outputColor = get_default_color();
-    if(stopIdx == -1) {
-        stopColor = default_color_;
-        nextStopColor = stops_[nextStopIdx].get_color();
-        stopValue = value;
-        nextStopValue = stops_[nextStopIdx].get_value();
-    }
-    else {
-        stopColor = stops_[stopIdx].get_color();
-        nextStopColor = stops_[nextStopIdx].get_color();
-        stopValue = stops_[stopIdx].get_value();
-        nextStopValue = stops_[nextStopIdx].get_value();
-    }
-    
-    switch(stopMode) {
-    case COLORIZER_LINEAR:
-        {
-            //deal with this separately so we don't have to worry about div0
-            if(nextStopValue == stopValue) {
-                outputColor = stopColor;
-            }
-            else {
-                float fraction = (value - stopValue) / (nextStopValue - stopValue);
-                
-                float r = interpolate(stopColor.red(), nextStopColor.red(),fraction);
-                float g = interpolate(stopColor.green(), nextStopColor.green(),fraction);
-                float b = interpolate(stopColor.blue(), nextStopColor.blue(),fraction);
-                float a = interpolate(stopColor.alpha(), nextStopColor.alpha(),fraction);
-                
-                outputColor.set_red(r);
-                outputColor.set_green(g);
-                outputColor.set_blue(b);
-                outputColor.set_alpha(a);
-            }
-            
-        }
-        break;
-    case COLORIZER_DISCRETE:
-        outputColor = stopColor;
-        break;
-    case COLORIZER_EXACT:
-    default:
-        //approximately equal (within epsilon)
-        if(fabs(value - stopValue) < epsilon_) {
-            outputColor = stopColor;
-        }
-        else {
-            outputColor = default_color_;
-        }
-        break;
-    }
-    
-
-    /*
-    std::clog << "get_color: " << value << "\n";
-    std::clog << "\tstopIdx: " << stopIdx << "\n";
-    std::clog << "\tnextStopIdx: " << nextStopIdx << "\n";
-    std::clog << "\tstopValue: " << stopValue << "\n";
-    std::clog << "\tnextStopValue: " << nextStopValue << "\n";
-    std::clog << "\tstopColor: " << stopColor.to_string() << "\n";
-    std::clog << "\tnextStopColor: " << nextStopColor.to_string() << "\n";
-    std::clog << "\tstopMode: " << stopMode.as_string() << "\n";
-    std::clog << "\toutputColor: " << outputColor.to_string() << "\n";
-*/
-
-    return outputColor;
+    int last = -1;
+    return (*table_)(value, last);
 }
 
 
@@ -0,0 +1,490 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+//$Id$
+
+// mapnik
+#include <mapnik/render_cache.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/scale_denominator.hpp>
+#include <mapnik/graphics.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image_util.hpp>
+
+// boost
+#include <boost/functional/hash.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/convenience.hpp>
+
+// stl
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+#ifdef _WINDOWS
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace mapnik
+{
+
+render_cache_key::render_cache_key(std::string const& map_id,
+                                   Map const& map,
+                                   double scale_factor,
+                                   std::string const& format)
+{
+    init(map_id, map.get_current_extent(), map.width(), map.height(),
+         map.buffer_size(), scale_factor, format);
+}
+
+render_cache_key::render_cache_key(std::string const& map_id,
+                                   box2d<double> const& extent,
+                                   unsigned width,
+                                   unsigned height,
+                                   double scale_factor,
+                                   std::string const& format,
+                                   int buffer_size)
+{
+    init(map_id, extent, width, height, buffer_size, scale_factor, format);
+}
+
+void render_cache_key::init(std::string const& map_id,
+                            box2d<double> const& extent,
+                            unsigned width,
+                            unsigned height,
+                            int buffer_size,
+                            double scale_factor,
+                            std::string const& format)
+{
+    std::ostringstream s;
+    s << std::setprecision(16)
+      << map_id << '|'
+      << extent.minx() << ',' << extent.miny() << ','
+      << extent.maxx() << ',' << extent.maxy() << '|'
+      << width << 'x' << height << '|'
+      << buffer_size << '|'
+      << scale_factor << '|'
+      << format;
+    key_ = s.str();
+}
+
+render_cache::render_cache()
+    : generation_(0) {}
+
+unsigned render_cache::generation() const
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(generation_mutex_);
+#endif
+    return generation_;
+}
+
+void render_cache::next_generation()
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(generation_mutex_);
+#endif
+    ++generation_;
+}
+
+void render_cache::invalidate_layer(std::string const& name)
+{
+    invalidate(layer_dependency(name));
+}
+
+void render_cache::invalidate_datasource(datasource const& ds)
+{
+    invalidate(datasource_dependency(ds.params()));
+}
+
+std::string render_cache::layer_dependency(std::string const& name)
+{
+    return "layer:" + name;
+}
+
+std::string render_cache::datasource_dependency(parameters const& params)
+{
+    std::ostringstream s;
+    s << "datasource:";
+    parameters::const_iterator itr = params.begin();
+    parameters::const_iterator end = params.end();
+    for (; itr != end; ++itr)
+    {
+        s << itr->first << '=' << itr->second << ';';
+    }
+    return s.str();
+}
+
+render_cache::dependencies render_cache::map_dependencies(Map const& map, double scale_factor)
+{
+    dependencies deps;
+    projection proj(map.srs());
+    double scale_denom = mapnik::scale_denominator(map, proj.is_geographic());
+    scale_denom *= scale_factor;
+
+    std::vector<layer>::const_iterator itr = map.layers().begin();
+    std::vector<layer>::const_iterator end = map.layers().end();
+    for (; itr != end; ++itr)
+    {
+        if (itr->isActive() && itr->isVisible(scale_denom))
+        {
+            deps.push_back(layer_dependency(itr->name()));
+            datasource_ptr ds = itr->datasource();
+            if (ds)
+            {
+                deps.push_back(datasource_dependency(ds->params()));
+            }
+        }
+    }
+    return deps;
+}
+
+// memory_render_cache
+
+memory_render_cache::memory_render_cache(std::size_t max_bytes)
+    : max_bytes_(max_bytes),
+      bytes_(0) {}
+
+boost::optional<std::string> memory_render_cache::find(render_cache_key const& key)
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    boost::optional<std::string> result;
+    entry_map::iterator itr = index_.find(key.str());
+    if (itr != index_.end())
+    {
+        // move to front of the lru list
+        entries_.splice(entries_.begin(), entries_, itr->second);
+        result.reset(itr->second->data);
+    }
+    return result;
+}
+
+void memory_render_cache::insert(render_cache_key const& key,
+                                 std::string const& data,
+                                 dependencies const& deps,
+                                 unsigned generation)
+{
+    if (data.size() > max_bytes_) return;
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    if (generation != this->generation()) return;
+    entry_map::iterator itr = index_.find(key.str());
+    if (itr != index_.end())
+    {
+        erase(itr->second);
+    }
+
+    entry e;
+    e.key = key.str();
+    e.data = data;
+    e.deps = deps;
+    entries_.push_front(e);
+    index_.insert(std::make_pair(e.key, entries_.begin()));
+    dependencies::const_iterator dep = deps.begin();
+    for (; dep != deps.end(); ++dep)
+    {
+        dependents_[*dep].insert(e.key);
+    }
+    bytes_ += data.size();
+
+    while (bytes_ > max_bytes_ && !entries_.empty())
+    {
+        erase(--entries_.end());
+    }
+}
+
+void memory_render_cache::erase(entry_list::iterator itr)
+{
+    dependencies::const_iterator dep = itr->deps.begin();
+    for (; dep != itr->deps.end(); ++dep)
+    {
+        dependency_map::iterator keys = dependents_.find(*dep);
+        if (keys != dependents_.end())
+        {
+            keys->second.erase(itr->key);
+            if (keys->second.empty()) dependents_.erase(keys);
+        }
+    }
+    bytes_ -= itr->data.size();
+    index_.erase(itr->key);
+    entries_.erase(itr);
+}
+
+void memory_render_cache::invalidate(std::string const& dependency)
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    next_generation();
+    dependency_map::const_iterator dependents = dependents_.find(dependency);
+    if (dependents == dependents_.end()) return;
+    // erase() updates the set, so iterate over a copy
+    std::set<std::string> const keys(dependents->second);
+    std::set<std::string>::const_iterator key = keys.begin();
+    for (; key != keys.end(); ++key)
+    {
+        entry_map::iterator itr = index_.find(*key);
+        if (itr != index_.end())
+        {
+            erase(itr->second);
+        }
+    }
+}
+
+void memory_render_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    next_generation();
+    entries_.clear();
+    index_.clear();
+    dependents_.clear();
+    bytes_ = 0;
+}
+
+std::size_t memory_render_cache::size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    return index_.size();
+}
+
+std::size_t memory_render_cache::bytes() const
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    return bytes_;
+}
+
+// file_render_cache
+//
+// entry layout: key size, key, dependency count, for each dependency
+// its size and bytes, data size, data
+
+namespace {
+
+void write_string(std::ostream & out, std::string const& str)
+{
+    unsigned size = str.size();
+    out.write(reinterpret_cast<char const*>(&size), sizeof(size));
+    out.write(str.data(), size);
+}
+
+bool read_string(std::istream & in, std::string & str)
+{
+    unsigned size = 0;
+    if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) return false;
+    str.resize(size);
+    if (size > 0 && !in.read(&str[0], size)) return false;
+    return true;
+}
+
+bool read_header(std::istream & in, std::string & key, render_cache::dependencies & deps)
+{
+    if (!read_string(in, key)) return false;
+    unsigned count = 0;
+    if (!in.read(reinterpret_cast<char*>(&count), sizeof(count))) return false;
+    deps.resize(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (!read_string(in, deps[i])) return false;
+    }
+    return true;
+}
+
+}
+
+file_render_cache::file_render_cache(std::string const& directory)
+    : directory_(directory),
+      temp_count_(0)
+{
+    boost::filesystem::path path(directory_);
+    if (!boost::filesystem::exists(path))
+    {
+        boost::filesystem::create_directories(path);
+    }
+}
+
+std::string file_render_cache::filename(render_cache_key const& key) const
+{
+    std::ostringstream s;
+    s << directory_ << "/" << std::hex << std::setw(16) << std::setfill('0')
+      << boost::hash<std::string>()(key.str()) << ".cache";
+    return s.str();
+}
+
+// unique per process, cache object and write, so that concurrent writers
+// of the same entry never share a temporary file
+std::string file_render_cache::temp_filename(std::string const& name)
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    std::ostringstream s;
+    s << name << '.' << getpid() << '.' << std::hex
+      << reinterpret_cast<std::size_t>(this) << '.' << std::dec
+      << temp_count_++ << ".tmp";
+    return s.str();
+}
+
+// entries are renamed into place whole, so reading one needs no lock
+boost::optional<std::string> file_render_cache::find(render_cache_key const& key)
+{
+    boost::optional<std::string> result;
+    std::ifstream file(filename(key).c_str(), std::ios::in | std::ios::binary);
+    if (!file) return result;
+
+    std::string stored_key;
+    dependencies deps;
+    std::string data;
+    // hash collisions are resolved by comparing the stored key
+    if (read_header(file, stored_key, deps)
+        && stored_key == key.str()
+        && read_string(file, data))
+    {
+        result.reset(data);
+    }
+    return result;
+}
+
+void file_render_cache::insert(render_cache_key const& key,
+                               std::string const& data,
+                               dependencies const& deps,
+                               unsigned generation)
+{
+    std::string name = filename(key);
+    std::string tmp_name = temp_filename(name);
+    {
+        std::ofstream file(tmp_name.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file) return;
+        write_string(file, key.str());
+        unsigned count = deps.size();
+        file.write(reinterpret_cast<char const*>(&count), sizeof(count));
+        for (unsigned i = 0; i < count; ++i)
+        {
+            write_string(file, deps[i]);
+        }
+        write_string(file, data);
+        if (!file) 
+        {
+            file.close();
+            boost::filesystem::remove(tmp_name);
+            return;
+        }
+    }
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    if (generation != this->generation())
+    {
+        boost::filesystem::remove(tmp_name);
+        return;
+    }
+    // readers never see a partially written entry
+    boost::filesystem::rename(tmp_name, name);
+}
+
+void file_render_cache::invalidate(std::string const& dependency)
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    next_generation();
+    std::vector<boost::filesystem::path> expired;
+    boost::filesystem::directory_iterator end;
+    for (boost::filesystem::directory_iterator itr(directory_); itr != end; ++itr)
+    {
+        if (boost::filesystem::extension(itr->path()) != ".cache") continue;
+        std::ifstream file(itr->path().string().c_str(), std::ios::in | std::ios::binary);
+        std::string key;
+        dependencies deps;
+        if (!read_header(file, key, deps)) continue;
+        if (std::find(deps.begin(), deps.end(), dependency) != deps.end())
+        {
+            expired.push_back(itr->path());
+        }
+    }
+    std::vector<boost::filesystem::path>::const_iterator path = expired.begin();
+    for (; path != expired.end(); ++path)
+    {
+        boost::filesystem::remove(*path);
+    }
+}
+
+void file_render_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex::scoped_lock lock(mutex_);
+#endif
+    next_generation();
+    std::vector<boost::filesystem::path> entries;
+    boost::filesystem::directory_iterator end;
+    for (boost::filesystem::directory_iterator itr(directory_); itr != end; ++itr)
+    {
+        if (boost::filesystem::extension(itr->path()) == ".cache")
+        {
+            entries.push_back(itr->path());
+        }
+    }
+    std::vector<boost::filesystem::path>::const_iterator path = entries.begin();
+    for (; path != entries.end(); ++path)
+    {
+        boost::filesystem::remove(*path);
+    }
+}
+
+std::string render_to_string_cached(Map const& map,
+                                    render_cache & cache,
+                                    std::string const& map_id,
+                                    std::string const& format,
+                                    double scale_factor)
+{
+    render_cache_key key(map_id, map, scale_factor, format);
+    boost::optional<std::string> cached = cache.find(key);
+    if (cached)
+    {
+        return *cached;
+    }
+    // an invalidation arriving while rendering keeps the result out
+    unsigned generation = cache.generation();
+    image_32 image(map.width(), map.height());
+    agg_renderer<image_32> ren(map, image, scale_factor);
+    ren.apply();
+    std::string data = save_to_string(image, format);
+    cache.insert(key, data, render_cache::map_dependencies(map, scale_factor), generation);
+    return data;
+}
+
+}
@@ -168,6 +168,11 @@ public:
             set_attr( sym_node, "mesh-size", sym.get_mesh_size() );
         }
 
+        if ( sym.get_warp_threads() != dfl.get_warp_threads() || explicit_defaults_ )
+        {
+            set_attr( sym_node, "warp-threads", sym.get_warp_threads() );
+        }
+
         if (sym.get_colorizer()) {
             serialize_raster_colorizer(sym_node, sym.get_colorizer(),
                                        explicit_defaults_);
@@ -44,15 +44,231 @@
 #include "agg_image_accessors.h"
 #include "agg_renderer_scanline.h"
 
+// boost
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+#endif
+
+// stl
+#include <vector>
+#include <algorithm>
+
 namespace mapnik {
 
+namespace {
+
+// target rows rendered per work item when warping in parallel
+const unsigned warp_band_height = 64;
+
+// rasters smaller than this (in target pixels) are warped on the calling thread
+const unsigned warp_parallel_min_pixels = 512 * 512;
+
+typedef agg::pixfmt_rgba32 pixfmt;
+typedef pixfmt::color_type color_type;
+typedef agg::pixfmt_rgba32_pre pixfmt_pre;
+typedef agg::renderer_base<pixfmt_pre> renderer_base_pre;
+typedef agg::image_accessor_clone<pixfmt> img_accessor_type;
+
+// A reprojected mesh cell in target pixel space
+struct warp_cell
+{
+    double polygon[8];
+    double miny;
+    double maxy;
+    unsigned x0, y0, x1, y1;
+};
+
+// Renders the mesh cells into horizontal bands of the target. Every band only
+// touches its own target rows and visits the cells in mesh order, so bands can
+// be rendered concurrently and still produce the same result as a single pass.
+class mesh_warper
+{
+public:
+    mesh_warper(raster & target, raster const& source,
+                std::vector<warp_cell> const& cells,
+                scaling_method_e scaling_method,
+                double filter_radius)
+        : target_(target),
+          source_(source),
+          cells_(cells),
+          scaling_method_(scaling_method),
+          next_band_(0),
+          num_bands_((target.data_.height() + warp_band_height - 1) / warp_band_height)
+    {
+        switch(scaling_method_)
+        {
+            case SCALING_NEAR: break;
+            case SCALING_BILINEAR:
+                filter_.calculate(agg::image_filter_bilinear(), true); break;
+            case SCALING_BICUBIC:
+                filter_.calculate(agg::image_filter_bicubic(), true); break;
+            case SCALING_SPLINE16:
+                filter_.calculate(agg::image_filter_spline16(), true); break;
+            case SCALING_SPLINE36:
+                filter_.calculate(agg::image_filter_spline36(), true); break;
+            case SCALING_HANNING:
+                filter_.calculate(agg::image_filter_hanning(), true); break;
+            case SCALING_HAMMING:
+                filter_.calculate(agg::image_filter_hamming(), true); break;
+            case SCALING_HERMITE:
+                filter_.calculate(agg::image_filter_hermite(), true); break;
+            case SCALING_KAISER:
+                filter_.calculate(agg::image_filter_kaiser(), true); break;
+            case SCALING_QUADRIC:
+                filter_.calculate(agg::image_filter_quadric(), true); break;
+            case SCALING_CATROM:
+                filter_.calculate(agg::image_filter_catrom(), true); break;
+            case SCALING_GAUSSIAN:
+                filter_.calculate(agg::image_filter_gaussian(), true); break;
+            case SCALING_BESSEL:
+                filter_.calculate(agg::image_filter_bessel(), true); break;
+            case SCALING_MITCHELL:
+                filter_.calculate(agg::image_filter_mitchell(), true); break;
+            case SCALING_SINC:
+                filter_.calculate(agg::image_filter_sinc(filter_radius), true); break;
+            case SCALING_LANCZOS:
+                filter_.calculate(agg::image_filter_lanczos(filter_radius), true); break;
+            case SCALING_BLACKMAN:
+                filter_.calculate(agg::image_filter_blackman(filter_radius), true); break;
+        }
+    }
+
+    // threads > 1 splits rasters of at least warp_parallel_min_pixels
+    // between that many threads, capped by the hardware concurrency
+    void render(unsigned threads)
+    {
+        unsigned width = target_.data_.width();
+        unsigned height = target_.data_.height();
+#ifdef MAPNIK_THREADSAFE
+        unsigned num_threads = std::min(threads, num_bands_);
+        unsigned hardware_threads = boost::thread::hardware_concurrency();
+        if (hardware_threads > 0) num_threads = std::min(num_threads, hardware_threads);
+        if (num_threads > 1 && width * height >= warp_parallel_min_pixels)
+        {
+            // workers pull the next free band until all are done
+            boost::thread_group workers;
+            for (unsigned i = 1; i < num_threads; ++i)
+            {
+                workers.create_thread(boost::bind(&mesh_warper::render_bands, this));
+            }
+            render_bands();
+            workers.join_all();
+            return;
+        }
+#endif
+        render_band(0, height);
+    }
+
+private:
+#ifdef MAPNIK_THREADSAFE
+    void render_bands()
+    {
+        unsigned height = target_.data_.height();
+        for (;;)
+        {
+            unsigned band;
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+                if (next_band_ >= num_bands_) return;
+                band = next_band_++;
+            }
+            unsigned y0 = band * warp_band_height;
+            render_band(y0, std::min(y0 + warp_band_height, height));
+        }
+    }
+#endif
+
+    void render_band(unsigned y0, unsigned y1)
+    {
+        agg::rasterizer_scanline_aa<> rasterizer;
+        agg::scanline_u8 scanline;
+        agg::rendering_buffer buf((unsigned char*)target_.data_.getData(),
+                                  target_.data_.width(),
+                                  target_.data_.height(),
+                                  target_.data_.width()*4);
+        pixfmt_pre pixf_pre(buf);
+        renderer_base_pre rb_pre(pixf_pre);
+        // clip writes to the band only, clipping the rasterizer would move
+        // cell edges and make the result depend on the band layout
+        rb_pre.clip_box(0, y0, target_.data_.width() - 1, y1 - 1);
+        rasterizer.clip_box(0, 0, target_.data_.width(), target_.data_.height());
+        agg::rendering_buffer buf_tile(
+            (unsigned char*)source_.data_.getData(),
+            source_.data_.width(),
+            source_.data_.height(),
+            source_.data_.width() * 4);
+
+        pixfmt pixf_tile(buf_tile);
+        img_accessor_type ia(pixf_tile);
+        agg::span_allocator<color_type> sa;
+
+        // Project mesh cells into target interpolating raster inside each one
+        std::vector<warp_cell>::const_iterator itr = cells_.begin();
+        std::vector<warp_cell>::const_iterator end = cells_.end();
+        for (; itr != end; ++itr)
+        {
+            warp_cell const& cell = *itr;
+            // cells are outset by one pixel when rasterized
+            if (cell.maxy + 1 < y0 || cell.miny - 1 > y1) continue;
+            double const* polygon = cell.polygon;
+
+            rasterizer.reset();
+            rasterizer.move_to_d(polygon[0]-1, polygon[1]-1);
+            rasterizer.line_to_d(polygon[2]+1, polygon[3]-1);
+            rasterizer.line_to_d(polygon[4]+1, polygon[5]+1);
+            rasterizer.line_to_d(polygon[6]-1, polygon[7]+1);
+
+            agg::trans_affine tr(polygon, cell.x0, cell.y0, cell.x1, cell.y1);
+            if (tr.is_valid())
+            {
+                typedef agg::span_interpolator_linear<agg::trans_affine>
+                    interpolator_type;
+                interpolator_type interpolator(tr);
+
+                if (scaling_method_ == SCALING_NEAR) {
+                    typedef agg::span_image_filter_rgba_nn
+                        <img_accessor_type, interpolator_type>
+                        span_gen_type;
+                    span_gen_type sg(ia, interpolator);
+                    agg::render_scanlines_aa(rasterizer, scanline, rb_pre,
+                                             sa, sg);
+                } else {
+                    typedef agg::span_image_filter_rgba_2x2
+                        <img_accessor_type, interpolator_type>
+                        span_gen_type;
+
+                    span_gen_type sg(ia, interpolator, filter_);
+                    agg::render_scanlines_aa(rasterizer, scanline, rb_pre,
+                                             sa, sg);
+                }
+            }
+        }
+    }
+
+    raster & target_;
+    raster const& source_;
+    std::vector<warp_cell> const& cells_;
+    scaling_method_e scaling_method_;
+    agg::image_filter_lut filter_;
+    unsigned next_band_;
+    unsigned num_bands_;
+#ifdef MAPNIK_THREADSAFE
+    boost::mutex mutex_;
+#endif
+};
+
+}
+
 void reproject_raster(raster &target, raster const& source,
                       proj_transform const& prj_trans,
                       double offset_x, double offset_y,
                       unsigned mesh_size,
                       double filter_radius,
                       double scale_factor,
-                      std::string scaling_method_name)
+                      std::string scaling_method_name,
+                      unsigned threads)
 {
     if (prj_trans.equal()) {
     
@@ -85,126 +301,35 @@ void reproject_raster(raster &target, raster const& source,
         }
         prj_trans.backward(xs.getData(), ys.getData(), NULL, mesh_nx*mesh_ny);
 
-        // Initialize AGG objects
-        typedef agg::pixfmt_rgba32 pixfmt;
-        typedef pixfmt::color_type color_type;
-        typedef agg::renderer_base<pixfmt> renderer_base;
-        typedef agg::pixfmt_rgba32_pre pixfmt_pre;
-        typedef agg::renderer_base<pixfmt_pre> renderer_base_pre;
-
-        agg::rasterizer_scanline_aa<> rasterizer;
-        agg::scanline_u8  scanline;
-        agg::rendering_buffer buf((unsigned char*)target.data_.getData(),
-                                  target.data_.width(),
-                                  target.data_.height(),
-                                  target.data_.width()*4);
-        pixfmt_pre pixf_pre(buf);
-        renderer_base_pre rb_pre(pixf_pre);
-        rasterizer.clip_box(0, 0, target.data_.width(), target.data_.height());
-        agg::rendering_buffer buf_tile(
-            (unsigned char*)source.data_.getData(),
-            source.data_.width(),
-            source.data_.height(),
-            source.data_.width() * 4);
-
-        pixfmt pixf_tile(buf_tile);
-
-        typedef agg::image_accessor_clone<pixfmt> img_accessor_type;
-        img_accessor_type ia(pixf_tile);
-
-        agg::span_allocator<color_type> sa;
-
-        // Initialize filter
-        agg::image_filter_lut filter;
-        scaling_method_e scaling_method = get_scaling_method_by_name(
-            scaling_method_name);
-        switch(scaling_method)
-        {
-            case SCALING_NEAR: break;
-            case SCALING_BILINEAR:
-                filter.calculate(agg::image_filter_bilinear(), true); break;
-            case SCALING_BICUBIC:
-                filter.calculate(agg::image_filter_bicubic(), true); break;
-            case SCALING_SPLINE16:
-                filter.calculate(agg::image_filter_spline16(), true); break;
-            case SCALING_SPLINE36:
-                filter.calculate(agg::image_filter_spline36(), true); break;
-            case SCALING_HANNING:
-                filter.calculate(agg::image_filter_hanning(), true); break;
-            case SCALING_HAMMING:
-                filter.calculate(agg::image_filter_hamming(), true); break;
-            case SCALING_HERMITE:
-                filter.calculate(agg::image_filter_hermite(), true); break;
-            case SCALING_KAISER:
-                filter.calculate(agg::image_filter_kaiser(), true); break;
-            case SCALING_QUADRIC:
-                filter.calculate(agg::image_filter_quadric(), true); break;
-            case SCALING_CATROM:
-                filter.calculate(agg::image_filter_catrom(), true); break;
-            case SCALING_GAUSSIAN:
-                filter.calculate(agg::image_filter_gaussian(), true); break;
-            case SCALING_BESSEL:
-                filter.calculate(agg::image_filter_bessel(), true); break;
-            case SCALING_MITCHELL:
-                filter.calculate(agg::image_filter_mitchell(), true); break;
-            case SCALING_SINC:
-                filter.calculate(agg::image_filter_sinc(filter_radius), true); break;
-            case SCALING_LANCZOS:
-                filter.calculate(agg::image_filter_lanczos(filter_radius), true); break;
-            case SCALING_BLACKMAN:
-                filter.calculate(agg::image_filter_blackman(filter_radius), true); break;
-        }
-
-        // Project mesh cells into target interpolating raster inside each one
+        // Transform mesh cells into target pixel space once
+        std::vector<warp_cell> cells;
+        cells.reserve((mesh_nx-1)*(mesh_ny-1));
         for(j=0; j<mesh_ny-1; j++) {
             for (i=0; i<mesh_nx-1; i++) {
-                double polygon[8] = {xs(i,j), ys(i,j),
-                                     xs(i+1,j), ys(i+1,j),
-                                     xs(i+1,j+1), ys(i+1,j+1),
-                                     xs(i,j+1), ys(i,j+1)};
+                warp_cell cell;
+                double * polygon = cell.polygon;
+                polygon[0] = xs(i,j);     polygon[1] = ys(i,j);
+                polygon[2] = xs(i+1,j);   polygon[3] = ys(i+1,j);
+                polygon[4] = xs(i+1,j+1); polygon[5] = ys(i+1,j+1);
+                polygon[6] = xs(i,j+1);   polygon[7] = ys(i,j+1);
                 tt.forward(polygon+0, polygon+1);
                 tt.forward(polygon+2, polygon+3);
                 tt.forward(polygon+4, polygon+5);
                 tt.forward(polygon+6, polygon+7);
-
-                rasterizer.reset();
-                rasterizer.move_to_d(polygon[0]-1, polygon[1]-1);
-                rasterizer.line_to_d(polygon[2]+1, polygon[3]-1);
-                rasterizer.line_to_d(polygon[4]+1, polygon[5]+1);
-                rasterizer.line_to_d(polygon[6]-1, polygon[7]+1);
-
-                unsigned x0 = i * mesh_size;
-                unsigned y0 = j * mesh_size;
-                unsigned x1 = (i+1) * mesh_size;
-                unsigned y1 = (j+1) * mesh_size;
-
-                agg::trans_affine tr(polygon, x0, y0, x1, y1);
-                if (tr.is_valid())
-                {
-                    typedef agg::span_interpolator_linear<agg::trans_affine>
-                        interpolator_type;
-                    interpolator_type interpolator(tr);
-
-                    if (scaling_method == SCALING_NEAR) {
-                        typedef agg::span_image_filter_rgba_nn
-                            <img_accessor_type, interpolator_type>
-                            span_gen_type;
-                        span_gen_type sg(ia, interpolator);
-                        agg::render_scanlines_aa(rasterizer, scanline, rb_pre,
-                                                 sa, sg);
-                    } else {
-                        typedef agg::span_image_filter_rgba_2x2
-                            <img_accessor_type, interpolator_type>
-                            span_gen_type;
-
-                        span_gen_type sg(ia, interpolator, filter);
-                        agg::render_scanlines_aa(rasterizer, scanline, rb_pre,
-                                                 sa, sg);
-                    }
-                }
-
+                cell.miny = std::min(std::min(polygon[1], polygon[3]), std::min(polygon[5], polygon[7]));
+                cell.maxy = std::max(std::max(polygon[1], polygon[3]), std::max(polygon[5], polygon[7]));
+                cell.x0 = i * mesh_size;
+                cell.y0 = j * mesh_size;
+                cell.x1 = (i+1) * mesh_size;
+                cell.y1 = (j+1) * mesh_size;
+                cells.push_back(cell);
             }
         }
+
+        mesh_warper warper(target, source, cells,
+                           get_scaling_method_by_name(scaling_method_name),
+                           filter_radius);
+        warper.render(threads);
     }
 }
 }// namespace mapnik
@@ -0,0 +1,180 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../../plugins/input/csv/csv_table.cpp"
+
+static void parse(csv_table & table, std::string const& data, unsigned chunks)
+{
+    csv_options options;
+    options.chunks = chunks;
+    table.parse(data.data(), data.data() + data.size(), options);
+}
+
+// same rows, ids, envelopes, types and field text
+static bool same_table(csv_table const& a, csv_table const& b)
+{
+    if (a.headers() != b.headers() || a.types() != b.types() || a.size() != b.size()) return false;
+    for (unsigned row = 0; row < a.size(); ++row)
+    {
+        if (a.id(row) != b.id(row) || !(a.envelope(row) == b.envelope(row))) return false;
+        for (unsigned column = 0; column < a.num_columns(); ++column)
+        {
+            if (std::string(a.field(row, column), a.field_size(row, column)) !=
+                std::string(b.field(row, column), b.field_size(row, column))) return false;
+        }
+    }
+    return true;
+}
+
+// a note spread over several lines, with separators and quotes in it
+static std::string note(unsigned row)
+{
+    std::ostringstream s;
+    s << "row " << row;
+    for (unsigned line = 0; line < row % 4; ++line)
+    {
+        s << "\nline " << line << ", \"quoted\"";
+    }
+    return s.str();
+}
+
+// rows of x, y, a multi-line quoted note and a label; every seventh
+// line ends with \r\n and every fifth record has no usable coordinates
+static std::string points(unsigned num_rows)
+{
+    std::ostringstream s;
+    s << "x,y,note,label\n";
+    for (unsigned row = 0; row < num_rows; ++row)
+    {
+        std::string text = note(row);
+        std::string quoted;
+        for (unsigned i = 0; i < text.size(); ++i)
+        {
+            if (text[i] == '"') quoted += '"';
+            quoted += text[i];
+        }
+        if (row % 5 == 4) s << "x,";
+        else s << row % 360 << ",";
+        s << row % 180 << ",\"" << quoted << "\",label " << row;
+        s << (row % 7 == 0 ? "\r\n" : "\n");
+    }
+    return s.str();
+}
+
+static bool rows_match(csv_table const& table, unsigned num_rows)
+{
+    unsigned row = 0;
+    for (unsigned record = 0; record < num_rows; ++record)
+    {
+        if (record % 5 == 4) continue;
+        if (row >= table.size() || table.id(row) != int(record + 1)) return false;
+        if (!(table.envelope(row) == box2d<double>(record % 360, record % 180, record % 360, record % 180))) return false;
+        if (std::string(table.field(row, 2), table.field_size(row, 2)) != note(record)) return false;
+        std::ostringstream label;
+        label << "label " << record;
+        if (std::string(table.field(row, 3), table.field_size(row, 3)) != label.str()) return false;
+        ++row;
+    }
+    return row == table.size();
+}
+
+int main( int, char*[] )
+{
+    // quoted fields with embedded newlines are never cut between chunks
+    {
+        std::string data = points(500);
+        csv_table single;
+        parse(single, data, 1);
+        BOOST_TEST(single.size() == 400u);
+        BOOST_TEST(rows_match(single, 500));
+        BOOST_TEST(single.types()[0] == mapnik::Integer);
+        BOOST_TEST(single.types()[1] == mapnik::Integer);
+        BOOST_TEST(single.types()[3] == mapnik::String);
+        for (unsigned chunks = 2; chunks <= 16; ++chunks)
+        {
+            csv_table table;
+            parse(table, data, chunks);
+            BOOST_TEST(same_table(single, table));
+        }
+        // more chunks than bytes
+        csv_table table;
+        parse(table, "x,y\n1,2\n", 64);
+        BOOST_TEST(table.size() == 1u);
+    }
+
+    // files above the size that is parsed in parallel
+    {
+        std::string data = points(100000);
+        BOOST_TEST(data.size() > parallel_min_bytes);
+        csv_table table;
+        parse(table, data, 0);
+        BOOST_TEST(rows_match(table, 100000));
+        csv_table split;
+        parse(split, data, 7);
+        BOOST_TEST(same_table(table, split));
+    }
+
+    // a quote inside an unquoted field misleads the chunk boundaries,
+    // the file is then parsed in one go
+    {
+        std::ostringstream s;
+        s << "x,y,size\n";
+        for (unsigned row = 0; row < 200; ++row)
+        {
+            s << row << "," << row << ",";
+            if (row == 10) s << "12\" pipe\n";
+            else s << "\"quoted\nsize " << row << "\"\n";
+        }
+        csv_table single;
+        parse(single, s.str(), 1);
+        BOOST_TEST(single.size() == 200u);
+        BOOST_TEST(std::string(single.field(10, 2)) == "12\" pipe");
+        BOOST_TEST(std::string(single.field(11, 2)) == "quoted\nsize 11");
+        for (unsigned chunks = 2; chunks <= 8; ++chunks)
+        {
+            csv_table table;
+            parse(table, s.str(), chunks);
+            BOOST_TEST(same_table(single, table));
+        }
+    }
+
+    // wkt columns
+    {
+        std::string data =
+            "id,wkt,name\n"
+            "1,POINT(1 2),point\n"
+            "2,\"LINESTRING(0 0,10 5)\",line\n"
+            "3,not wkt,broken\n"
+            "4,\"POLYGON((0 0,4 0,4 3,0 3,0 0))\",polygon\n"
+            "5,\"MULTIPOLYGON(((20 20,21 20,21 21,20 20)),((-5 -6,-4 -6,-4 -5,-5 -6)))\",multi\n";
+        csv_table table;
+        parse(table, data, 1);
+        BOOST_TEST(table.wkt_column() == 1);
+        BOOST_TEST(table.size() == 4u);
+        BOOST_TEST(table.id(0) == 1 && table.id(1) == 2 && table.id(2) == 4 && table.id(3) == 5);
+        BOOST_TEST(table.envelope(0) == box2d<double>(1, 2, 1, 2));
+        BOOST_TEST(table.envelope(1) == box2d<double>(0, 0, 10, 5));
+        BOOST_TEST(table.envelope(2) == box2d<double>(0, 0, 4, 3));
+        BOOST_TEST(table.envelope(3) == box2d<double>(-5, -6, 21, 21));
+        BOOST_TEST(table.extent() == box2d<double>(-5, -6, 21, 21));
+        BOOST_TEST(table.types()[0] == mapnik::Integer);
+        BOOST_TEST(table.types()[2] == mapnik::String);
+        BOOST_TEST(std::string(table.field(3, 2)) == "multi");
+        for (unsigned chunks = 2; chunks <= 6; ++chunks)
+        {
+            csv_table split;
+            parse(split, data, chunks);
+            BOOST_TEST(same_table(table, split));
+        }
+
+        std::vector<unsigned> rows;
+        table.query(box2d<double>(3, 1, 5, 2), rows);
+        BOOST_TEST(rows.size() == 3u && rows[0] == 1u && rows[1] == 2u && rows[2] == 3u);
+        rows.clear();
+        table.query(box2d<double>(0.5, 1.5, 1.5, 2.5), rows);
+        BOOST_TEST(rows.size() == 4u && rows[0] == 0u);
+    }
+
+    return ::boost::report_errors();
+}
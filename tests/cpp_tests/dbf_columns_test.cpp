@@ -0,0 +1,127 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <mapnik/unicode.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <vector>
+#include "../../plugins/input/shape/dbfile.cpp"
+#include "../../utils/shapeindex/dbf_columns.hpp"
+
+static bool int_matches(const char* text)
+{
+    long expected = std::strtol(text, 0, 10);
+    if (expected > std::numeric_limits<int>::max()) expected = std::numeric_limits<int>::max();
+    if (expected < std::numeric_limits<int>::min()) expected = std::numeric_limits<int>::min();
+    return parse_int(text, text + std::strlen(text)) == expected;
+}
+
+static bool double_matches(const char* text)
+{
+    double expected = std::strtod(text, 0);
+    double val = parse_double(text, text + std::strlen(text));
+    // bitwise, so that the sign of zeros counts too
+    return std::memcmp(&val, &expected, sizeof(double)) == 0;
+}
+
+static bool same_features(dbf_file & a, dbf_file & b, mapnik::transcoder const& tr)
+{
+    if (a.num_records() != b.num_records() || a.num_fields() != b.num_fields()) return false;
+    for (int i = 1; i <= a.num_records(); ++i)
+    {
+        mapnik::Feature fa(i);
+        mapnik::Feature fb(i);
+        a.move_to(i);
+        b.move_to(i);
+        for (int col = 0; col < a.num_fields(); ++col)
+        {
+            a.add_attribute(col, tr, fa);
+            b.add_attribute(col, tr, fb);
+        }
+        if (fa.props() != fb.props()) return false;
+    }
+    return true;
+}
+
+int main( int, char*[] )
+{
+    // numeric fields parse as strtol/strtod read them
+    const char* ints[] = { "", "   ", "0", "7", "  42", "-42", "+42", "000000000001234",
+                           "123456789", "1234567890", "2147483647", "-2147483648",
+                           "99999999999", "-99999999999", "12.7", "-", "abc", " 3 " };
+    for (unsigned i = 0; i < sizeof(ints) / sizeof(ints[0]); ++i)
+    {
+        BOOST_TEST(int_matches(ints[i]));
+    }
+    const char* doubles[] = { "", "   ", "0", "-0", "-0.000", "1.5", "  -1.5", "+2.25", ".5", "5.",
+                              "0.1", "0.3", "123.456", "-987654.321", "0.000000000000001",
+                              "0.0000000000000001234", "000000000000000000123.5",
+                              "123456789012345", "1234567890123456", "12345678901234567890",
+                              "9223372036854775807", "99999999999999999999.99",
+                              "3.141592653589793238", "1.7976931348623157", "1e5", "-2.5E-3",
+                              "1.5abc", "abc", "inf", "12.34.56", "   8.000000000000000" };
+    for (unsigned i = 0; i < sizeof(doubles) / sizeof(doubles[0]); ++i)
+    {
+        BOOST_TEST(double_matches(doubles[i]));
+    }
+
+    // a column sidecar gives the same attributes as the dbf text
+    {
+        const std::string plain = "dbf_columns_test_plain";
+        const std::string columns = "dbf_columns_test_columns";
+        boost::filesystem::remove(plain + ".dbf");
+        boost::filesystem::remove(columns + ".dbf");
+        boost::filesystem::remove(columns + ".dbc");
+        boost::filesystem::copy_file("tests/data/shp/world_merc.dbf", plain + ".dbf");
+        boost::filesystem::copy_file("tests/data/shp/world_merc.dbf", columns + ".dbf");
+
+        std::vector<std::string> names;
+        names.push_back("NAME");
+        names.push_back("POP2005");
+        names.push_back("LON");
+        names.push_back("LAT");
+        BOOST_TEST(dbf_column_writer::write(columns, names) == 4);
+
+        mapnik::transcoder tr("latin1");
+        dbf_file a(plain + ".dbf");
+        dbf_file b(columns + ".dbf");
+        BOOST_TEST(a.num_records() == 245);
+        int sidecar_columns = 0;
+        for (int col = 0; col < b.num_fields(); ++col)
+        {
+            BOOST_TEST(!a.has_column_data(col));
+            if (b.has_column_data(col)) ++sidecar_columns;
+        }
+        BOOST_TEST(sidecar_columns == 4);
+        BOOST_TEST(same_features(a, b, tr));
+
+        // a dbf rewritten after its sidecar no longer uses it
+        std::time_t written = boost::filesystem::last_write_time(columns + ".dbc");
+        boost::filesystem::last_write_time(columns + ".dbf", written + 10);
+        {
+            dbf_file c(columns + ".dbf");
+            for (int col = 0; col < c.num_fields(); ++col)
+            {
+                BOOST_TEST(!c.has_column_data(col));
+            }
+        }
+        boost::filesystem::last_write_time(columns + ".dbf", written - 10);
+        {
+            dbf_file c(columns + ".dbf");
+            sidecar_columns = 0;
+            for (int col = 0; col < c.num_fields(); ++col)
+            {
+                if (c.has_column_data(col)) ++sidecar_columns;
+            }
+            BOOST_TEST(sidecar_columns == 4);
+        }
+
+        boost::filesystem::remove(plain + ".dbf");
+        boost::filesystem::remove(columns + ".dbf");
+        boost::filesystem::remove(columns + ".dbc");
+    }
+
+    return ::boost::report_errors();
+}
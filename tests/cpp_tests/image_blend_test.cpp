@@ -0,0 +1,252 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <mapnik/graphics.hpp>
+#include <mapnik/image_compositing.hpp>
+
+using mapnik::image_32;
+using mapnik::image_data_32;
+using mapnik::blend_div;
+
+//  reference blends, as written before the reciprocal table  ----------------//
+
+static unsigned channel(unsigned rgba, unsigned i)
+{
+    return (rgba >> (8 * i)) & 0xff;
+}
+
+static unsigned pack(unsigned r, unsigned g, unsigned b, unsigned a)
+{
+#ifdef MAPNIK_BIG_ENDIAN
+    return (a) | (b << 8) | (g << 16) | (r << 24);
+#else
+    return (a << 24) | (b << 16) | (g << 8) | (r);
+#endif
+}
+
+static void unpack(unsigned rgba, unsigned & r, unsigned & g, unsigned & b, unsigned & a)
+{
+#ifdef MAPNIK_BIG_ENDIAN
+    r = channel(rgba, 3); g = channel(rgba, 2); b = channel(rgba, 1); a = channel(rgba, 0);
+#else
+    r = channel(rgba, 0); g = channel(rgba, 1); b = channel(rgba, 2); a = channel(rgba, 3);
+#endif
+}
+
+static unsigned alpha2_reference(unsigned rgba0, unsigned rgba1, float opacity)
+{
+    unsigned r0, g0, b0, a0, r1, g1, b1, a1;
+    unpack(rgba0, r0, g0, b0, a0);
+    unpack(rgba1, r1, g1, b1, a1);
+    a1 = int(a1 * opacity);
+    if (a1 == 0) return rgba0;
+    if (a1 == 0xff) return rgba1;
+    unsigned atmp = a1 + a0 - ((a1 * a0 + 255) >> 8);
+    if (atmp)
+    {
+        r0 = mapnik::byte((r1 * a1 + (r0 * a0) - ((r0 * a0 * a1 + 255) >> 8)) / atmp);
+        g0 = mapnik::byte((g1 * a1 + (g0 * a0) - ((g0 * a0 * a1 + 255) >> 8)) / atmp);
+        b0 = mapnik::byte((b1 * a1 + (b0 * a0) - ((b0 * a0 * a1 + 255) >> 8)) / atmp);
+    }
+    return pack(r0, g0, b0, mapnik::byte(atmp));
+}
+
+static unsigned alpha_reference(unsigned rgba0, unsigned rgba1)
+{
+    unsigned r0, g0, b0, a0, r1, g1, b1, a1;
+    unpack(rgba0, r0, g0, b0, a0);
+    unpack(rgba1, r1, g1, b1, a1);
+    if (a1 == 0) return rgba0;
+    if (a1 == 0xff) return rgba1;
+    r0 *= a0; g0 *= a0; b0 *= a0;
+    a0 = ((a1 + a0) << 8) - a0*a1;
+    r0 = ((((r1 << 8) - r0) * a1 + (r0 << 8)) / a0);
+    g0 = ((((g1 << 8) - g0) * a1 + (g0 << 8)) / a0);
+    b0 = ((((b1 << 8) - b0) * a1 + (b0 << 8)) / a0);
+    return pack(r0, g0, b0, a0 >> 8);
+}
+
+template <typename MergeMethod>
+static unsigned merge_reference(unsigned rgba0, unsigned rgba1, float opacity)
+{
+    unsigned r0, g0, b0, a0, r1, g1, b1, a1;
+    unpack(rgba0, r0, g0, b0, a0);
+    unpack(rgba1, r1, g1, b1, a1);
+    a1 = int(a1 * opacity);
+    if (a1 == 0) return rgba0;
+    unsigned a = (a1 * 255 + (255 - a1) * a0 + 127)/255;
+    MergeMethod::mergeRGB(r0,g0,b0,r1,g1,b1);
+    r0 = (r1*a1 + (((255 - a1) * a0 + 127)/255) * r0 + 127)/a;
+    g0 = (g1*a1 + (((255 - a1) * a0 + 127)/255) * g0 + 127)/a;
+    b0 = (b1*a1 + (((255 - a1) * a0 + 127)/255) * b0 + 127)/a;
+    return pack(r0, g0, b0, a);
+}
+
+// agg::comp_op_rgba_src_over behind comp_op_adaptor_rgba, full cover
+static unsigned src_over_reference(unsigned rgba0, unsigned rgba1)
+{
+    unsigned r0, g0, b0, a0, r1, g1, b1, a1;
+    unpack(rgba0, r0, g0, b0, a0);
+    unpack(rgba1, r1, g1, b1, a1);
+    r1 = (r1 * a1 + 255) >> 8;
+    g1 = (g1 * a1 + 255) >> 8;
+    b1 = (b1 * a1 + 255) >> 8;
+    unsigned s1a = 255 - a1;
+    r0 = mapnik::byte(r1 + ((r0 * s1a + 255) >> 8));
+    g0 = mapnik::byte(g1 + ((g0 * s1a + 255) >> 8));
+    b0 = mapnik::byte(b1 + ((b0 * s1a + 255) >> 8));
+    a0 = mapnik::byte(a1 + a0 - ((a1 * a0 + 255) >> 8));
+    return pack(r0, g0, b0, a0);
+}
+
+static unsigned random_pixel()
+{
+    unsigned a = 0;
+    switch (std::rand() % 4)
+    {
+    case 0: a = 0; break;
+    case 1: a = 255; break;
+    default: a = std::rand() % 256;
+    }
+    return pack(std::rand() % 256, std::rand() % 256, std::rand() % 256, a);
+}
+
+static void copy(image_data_32 const& from, image_32 & to)
+{
+    for (unsigned y = 0; y < from.height(); ++y)
+        for (unsigned x = 0; x < from.width(); ++x)
+            to.data()(x, y) = from(x, y);
+}
+
+// pixels of im that differ from blending src at (x0, y0) into dst
+template <typename Reference>
+static unsigned mismatches(image_32 & im, image_data_32 const& dst, image_data_32 const& src,
+                           int x0, int y0, Reference reference)
+{
+    unsigned count = 0;
+    for (int y = 0; y < int(dst.height()); ++y)
+    {
+        for (int x = 0; x < int(dst.width()); ++x)
+        {
+            unsigned expected = dst(x, y);
+            if (x >= x0 && y >= y0 && x - x0 < int(src.width()) && y - y0 < int(src.height()))
+            {
+                expected = reference(dst(x, y), src(x - x0, y - y0));
+            }
+            if (im.data()(x, y) != expected) ++count;
+        }
+    }
+    return count;
+}
+
+struct alpha2_blend
+{
+    float opacity;
+    explicit alpha2_blend(float o) : opacity(o) {}
+    unsigned operator() (unsigned rgba0, unsigned rgba1) const
+    {
+        return alpha2_reference(rgba0, rgba1, opacity);
+    }
+};
+
+template <typename MergeMethod>
+struct merge_blend
+{
+    float opacity;
+    explicit merge_blend(float o) : opacity(o) {}
+    unsigned operator() (unsigned rgba0, unsigned rgba1) const
+    {
+        return merge_reference<MergeMethod>(rgba0, rgba1, opacity);
+    }
+};
+
+template <typename MergeMethod>
+static unsigned merge_mismatches(image_data_32 const& dst, image_data_32 const& src,
+                                 int x0, int y0, float opacity)
+{
+    image_32 im(dst.width(), dst.height());
+    copy(dst, im);
+    im.merge_rectangle<MergeMethod>(src, x0, y0, opacity);
+    return mismatches(im, dst, src, x0, y0, merge_blend<MergeMethod>(opacity));
+}
+
+static void fill(image_data_32 & image)
+{
+    for (unsigned y = 0; y < image.height(); ++y)
+        for (unsigned x = 0; x < image.width(); ++x)
+            image(x, y) = random_pixel();
+}
+
+int main( int, char*[] )
+{
+//  blend_div() tests  ---------------------------------------------------------//
+
+    unsigned failures = 0;
+    for (unsigned d = 1; d < 256; ++d)
+    {
+        for (unsigned n = 0; n < (1u << 17); ++n)
+        {
+            if (blend_div(n, d) != n / d) ++failures;
+        }
+        for (unsigned n = (1u << 17); n < (1u << 24); n += 4093)
+        {
+            if (blend_div(n, d) != n / d) ++failures;
+        }
+    }
+    BOOST_TEST( failures == 0 );
+    BOOST_TEST( blend_div(1000000000u, 7) == 1000000000u / 7 );
+    BOOST_TEST( blend_div(1000, 300) == 1000 / 300 );
+
+//  blit tests  ----------------------------------------------------------------//
+
+    // odd sizes and offsets leave rows that do not split into four pixel
+    // runs, and clip the source at the right and bottom edges
+    std::srand(42);
+    image_data_32 dst(67, 64);
+    image_data_32 src(61, 59);
+    fill(dst);
+    fill(src);
+    int offsets[][2] = { { 0, 0 }, { 3, 1 }, { 10, 9 } };
+
+    for (unsigned j = 0; j < sizeof(offsets) / sizeof(offsets[0]); ++j)
+    {
+        int x0 = offsets[j][0];
+        int y0 = offsets[j][1];
+
+        image_32 im(dst.width(), dst.height());
+        copy(dst, im);
+        im.set_rectangle_alpha(x0, y0, src);
+        BOOST_TEST( mismatches(im, dst, src, x0, y0, alpha_reference) == 0 );
+
+        float opacities[] = { 1.0f, 0.75f, 0.5f, 0.33f, 0.01f };
+        for (unsigned i = 0; i < sizeof(opacities) / sizeof(float); ++i)
+        {
+            float opacity = opacities[i];
+
+            image_32 im2(dst.width(), dst.height());
+            copy(dst, im2);
+            im2.set_rectangle_alpha2(src, x0, y0, opacity);
+            BOOST_TEST( mismatches(im2, dst, src, x0, y0, alpha2_blend(opacity)) == 0 );
+
+            BOOST_TEST( merge_mismatches<mapnik::Multiply>(dst, src, x0, y0, opacity) == 0 );
+            BOOST_TEST( merge_mismatches<mapnik::Multiply2>(dst, src, x0, y0, opacity) == 0 );
+            BOOST_TEST( merge_mismatches<mapnik::Divide>(dst, src, x0, y0, opacity) == 0 );
+            BOOST_TEST( merge_mismatches<mapnik::Divide2>(dst, src, x0, y0, opacity) == 0 );
+            BOOST_TEST( merge_mismatches<mapnik::Screen>(dst, src, x0, y0, opacity) == 0 );
+            BOOST_TEST( merge_mismatches<mapnik::HardLight>(dst, src, x0, y0, opacity) == 0 );
+            BOOST_TEST( merge_mismatches<mapnik::MergeGrain>(dst, src, x0, y0, opacity) == 0 );
+            BOOST_TEST( merge_mismatches<mapnik::MergeGrain2>(dst, src, x0, y0, opacity) == 0 );
+        }
+    }
+
+//  composite() tests  ---------------------------------------------------------//
+
+    {
+        image_32 im(dst.width(), dst.height());
+        copy(dst, im);
+        mapnik::composite(im.data(), src, mapnik::src_over);
+        BOOST_TEST( mismatches(im, dst, src, 0, 0, src_over_reference) == 0 );
+    }
+
+    return ::boost::report_errors();
+}
@@ -0,0 +1,115 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/font_set.hpp>
+#include <mapnik/load_map.hpp>
+#include <string>
+
+using mapnik::Map;
+using mapnik::feature_type_style;
+
+static feature_type_style style_with_rules(unsigned num_rules)
+{
+    feature_type_style style;
+    for (unsigned i = 0; i < num_rules; ++i)
+    {
+        style.add_rule(mapnik::rule());
+    }
+    return style;
+}
+
+static unsigned num_rules(Map const& m, std::string const& name)
+{
+    boost::optional<feature_type_style const&> style = m.find_style(name);
+    return style ? (*style).get_rules().size() : 0;
+}
+
+int main( int, char*[] )
+{
+    // copies share the styles until one of them changes them
+    {
+        Map m(256, 256);
+        m.insert_style("a", style_with_rules(1));
+        Map copy(m);
+        BOOST_TEST(copy.insert_style("b", style_with_rules(2)));
+        BOOST_TEST(num_rules(copy, "b") == 2u);
+        BOOST_TEST(num_rules(m, "b") == 0u);
+        m.remove_style("a");
+        BOOST_TEST(num_rules(m, "a") == 0u);
+        BOOST_TEST(num_rules(copy, "a") == 1u);
+    }
+
+    // a reference taken through styles() before a copy must not
+    // write into the copy
+    {
+        Map m(256, 256);
+        m.insert_style("a", style_with_rules(1));
+        feature_type_style & style = m.styles()["a"];
+        Map copy(m);
+        style.add_rule(mapnik::rule());
+        BOOST_TEST(num_rules(m, "a") == 2u);
+        BOOST_TEST(num_rules(copy, "a") == 1u);
+
+        Map assigned;
+        assigned = m;
+        style.add_rule(mapnik::rule());
+        BOOST_TEST(num_rules(m, "a") == 3u);
+        BOOST_TEST(num_rules(assigned, "a") == 2u);
+
+        // the copies do not hand out references, so they share again
+        Map second(copy);
+        BOOST_TEST(&*second.find_style("a") == &*copy.find_style("a"));
+    }
+
+    // the same for style iterators and fontsets
+    {
+        Map m(256, 256);
+        m.insert_style("a", style_with_rules(1));
+        Map::style_iterator itr = m.begin_styles();
+        Map copy(m);
+        itr->second.add_rule(mapnik::rule());
+        BOOST_TEST(num_rules(copy, "a") == 1u);
+
+        m.insert_fontset("f", mapnik::font_set("f"));
+        mapnik::font_set & fontset = m.fontsets()["f"];
+        Map fontset_copy(m);
+        fontset.add_face_name("DejaVu Sans Book");
+        BOOST_TEST(m.find_fontset("f").get_face_names().size() == 1u);
+        BOOST_TEST(fontset_copy.find_fontset("f").get_face_names().empty());
+    }
+
+    // a style found on a copy stays valid while the original changes
+    {
+        Map m(256, 256);
+        m.insert_style("a", style_with_rules(3));
+        Map copy(m);
+        feature_type_style const& style = *copy.find_style("a");
+        m.remove_style("a");
+        m.insert_style("b", style_with_rules(1));
+        BOOST_TEST(style.get_rules().size() == 3u);
+    }
+
+    // a map loaded from a stylesheet stays shared with its copies
+    {
+        Map m;
+        mapnik::load_map_string(m,
+            "<Map srs='+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs'>"
+            "<FontSet name='fonts'><Font face-name='DejaVu Sans Book'/></FontSet>"
+            "<Style name='a'><Rule><LineSymbolizer/></Rule></Style>"
+            "</Map>");
+        Map copy(m);
+        BOOST_TEST(num_rules(copy, "a") == 1u);
+        BOOST_TEST(&*copy.find_style("a") == &*m.find_style("a"));
+        Map const& loaded = m;
+        Map const& copied = copy;
+        BOOST_TEST(&copied.fontsets() == &loaded.fontsets());
+
+        // remove_all drops the fontsets with the styles
+        m.remove_all();
+        BOOST_TEST(m.styles().empty());
+        BOOST_TEST(m.fontsets().empty());
+        BOOST_TEST(copy.find_fontset("fonts").get_face_names().size() == 1u);
+    }
+
+    return ::boost::report_errors();
+}
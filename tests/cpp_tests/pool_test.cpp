@@ -0,0 +1,109 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <mapnik/pool.hpp>
+
+// a pooled object with an idle timeout
+struct handle : mapnik::pool_idle_timeout
+{
+    explicit handle(unsigned idle_timeout)
+        : mapnik::pool_idle_timeout(idle_timeout) {}
+    bool isOK() const { return !expired(); }
+};
+
+// a pooled object without one
+struct connection
+{
+    connection() : ok(true) {}
+    bool isOK() const { return ok; }
+    bool ok;
+};
+
+template <typename T>
+struct handle_creator
+{
+    explicit handle_creator(unsigned idle_timeout)
+        : idle_timeout(idle_timeout) {}
+    T* operator()() const { return new T(idle_timeout); }
+    unsigned idle_timeout;
+};
+
+template <typename T>
+struct connection_creator
+{
+    T* operator()() const { return new T; }
+};
+
+int main( int, char*[] )
+{
+    typedef mapnik::Pool<handle, handle_creator> handle_pool;
+    typedef mapnik::Pool<connection, connection_creator> connection_pool;
+
+    // borrowed objects go back to the pool with the last reference
+    {
+        handle_creator<handle> creator(0);
+        boost::shared_ptr<handle_pool> pool(new handle_pool(creator, 1, 2));
+        BOOST_TEST( pool->size() == std::make_pair(1u, 0u) );
+        boost::shared_ptr<handle> first = mapnik::borrow_pooled(pool, creator);
+        BOOST_TEST( pool->size() == std::make_pair(0u, 1u) );
+        boost::shared_ptr<handle> copy = first;
+        first.reset();
+        BOOST_TEST( pool->size() == std::make_pair(0u, 1u) );
+        handle * raw = copy.get();
+        copy.reset();
+        BOOST_TEST( pool->size() == std::make_pair(1u, 0u) );
+        // and are handed out again
+        boost::shared_ptr<handle> again = mapnik::borrow_pooled(pool, creator);
+        BOOST_TEST( again.get() == raw );
+    }
+
+    // an exhausted pool hands out objects of their own
+    {
+        handle_creator<handle> creator(0);
+        boost::shared_ptr<handle_pool> pool(new handle_pool(creator, 1, 2));
+        boost::shared_ptr<handle> a = mapnik::borrow_pooled(pool, creator);
+        boost::shared_ptr<handle> b = mapnik::borrow_pooled(pool, creator);
+        boost::shared_ptr<handle> c = mapnik::borrow_pooled(pool, creator);
+        BOOST_TEST( a && b && c );
+        BOOST_TEST( pool->size() == std::make_pair(0u, 2u) );
+        c.reset();
+        BOOST_TEST( pool->size() == std::make_pair(0u, 2u) );
+        a.reset();
+        b.reset();
+        BOOST_TEST( pool->size() == std::make_pair(2u, 0u) );
+    }
+
+    // objects without an idle timeout are pooled the same way
+    {
+        connection_creator<connection> creator;
+        boost::shared_ptr<connection_pool> pool(new connection_pool(creator, 0, 1));
+        boost::shared_ptr<connection> conn = mapnik::borrow_pooled(pool, creator);
+        BOOST_TEST( pool->size() == std::make_pair(0u, 1u) );
+        conn.reset();
+        BOOST_TEST( pool->size() == std::make_pair(1u, 0u) );
+    }
+
+    // idle objects that went bad are dropped when another one comes back
+    {
+        connection_creator<connection> creator;
+        boost::shared_ptr<connection_pool> pool(new connection_pool(creator, 0, 2));
+        boost::shared_ptr<connection> a = mapnik::borrow_pooled(pool, creator);
+        boost::shared_ptr<connection> b = mapnik::borrow_pooled(pool, creator);
+        connection * idle = a.get();
+        a.reset();
+        BOOST_TEST( pool->size() == std::make_pair(1u, 1u) );
+        idle->ok = false;
+        b.reset();
+        BOOST_TEST( pool->size() == std::make_pair(1u, 0u) );
+    }
+
+    // idle timeouts
+    {
+        mapnik::pool_idle_timeout never(0);
+        BOOST_TEST( !never.expired() );
+        mapnik::pool_idle_timeout later(3600);
+        BOOST_TEST( !later.expired() );
+        later.touch();
+        BOOST_TEST( !later.expired() );
+    }
+
+    return ::boost::report_errors();
+}
@@ -0,0 +1,120 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <boost/make_shared.hpp>
+#include <vector>
+#include "../../plugins/input/rasterlite/rasterlite_tile_cache.hpp"
+
+using mapnik::image_data_32;
+
+static rasterlite_tile_ptr make_tile(unsigned size, unsigned value)
+{
+    boost::shared_ptr<image_data_32> tile = boost::make_shared<image_data_32>(size, size);
+    tile->set(value);
+    return tile;
+}
+
+int main( int, char*[] )
+{
+    // pixel sizes of a pyramid with four levels
+    std::vector<double> levels;
+    levels.push_back(1.0);
+    levels.push_back(2.0);
+    levels.push_back(4.0);
+    levels.push_back(8.0);
+
+    // finer than the base level reads the base level
+    BOOST_TEST(rasterlite_select_level(levels, 4.0) == 0u);
+    BOOST_TEST(rasterlite_select_level(levels, 1.0) == 0u);
+    // between two levels reads the finer one so nothing is upsampled
+    BOOST_TEST(rasterlite_select_level(levels, 0.75) == 0u);
+    BOOST_TEST(rasterlite_select_level(levels, 0.5) == 1u);
+    BOOST_TEST(rasterlite_select_level(levels, 0.3) == 1u);
+    BOOST_TEST(rasterlite_select_level(levels, 0.25) == 2u);
+    // pixel sizes computed from extents are not exact
+    BOOST_TEST(rasterlite_select_level(levels, 0.25 * (1.0 + 1e-12)) == 2u);
+    BOOST_TEST(rasterlite_select_level(levels, 0.25 * (1.0 - 1e-12)) == 2u);
+    // coarser than the top level reads the top level
+    BOOST_TEST(rasterlite_select_level(levels, 0.125) == 3u);
+    BOOST_TEST(rasterlite_select_level(levels, 0.01) == 3u);
+    BOOST_TEST(rasterlite_select_level(std::vector<double>(1, 1.0), 0.01) == 0u);
+
+    const std::size_t tile_bytes = 16 * 16 * 4;
+
+    // keys differ by level, column and row
+    {
+        rasterlite_tile_cache cache(10 * tile_bytes);
+        cache.insert(rasterlite_tile_key(0, 1, 2), make_tile(16, 1));
+        cache.insert(rasterlite_tile_key(1, 1, 2), make_tile(16, 2));
+        cache.insert(rasterlite_tile_key(0, 2, 1), make_tile(16, 3));
+        BOOST_TEST(cache.size() == 3u);
+        BOOST_TEST(cache.bytes() == 3 * tile_bytes);
+
+        rasterlite_tile_ptr tile;
+        BOOST_TEST(cache.find(rasterlite_tile_key(0, 1, 2), tile));
+        BOOST_TEST(tile && tile->getRow(0)[0] == 1u);
+        BOOST_TEST(cache.find(rasterlite_tile_key(1, 1, 2), tile));
+        BOOST_TEST(tile && tile->getRow(0)[0] == 2u);
+        BOOST_TEST(cache.find(rasterlite_tile_key(0, 2, 1), tile));
+        BOOST_TEST(tile && tile->getRow(0)[0] == 3u);
+        BOOST_TEST(!cache.find(rasterlite_tile_key(1, 2, 1), tile));
+
+        // replacing a block keeps the byte count
+        cache.insert(rasterlite_tile_key(0, 1, 2), make_tile(16, 4));
+        BOOST_TEST(cache.size() == 3u);
+        BOOST_TEST(cache.bytes() == 3 * tile_bytes);
+        BOOST_TEST(cache.find(rasterlite_tile_key(0, 1, 2), tile));
+        BOOST_TEST(tile && tile->getRow(0)[0] == 4u);
+    }
+
+    // the least recently used block is evicted first
+    {
+        rasterlite_tile_cache cache(2 * tile_bytes);
+        rasterlite_tile_ptr tile;
+        cache.insert(rasterlite_tile_key(0, 0, 0), make_tile(16, 1));
+        cache.insert(rasterlite_tile_key(0, 1, 0), make_tile(16, 2));
+        BOOST_TEST(cache.find(rasterlite_tile_key(0, 0, 0), tile));
+        cache.insert(rasterlite_tile_key(0, 2, 0), make_tile(16, 3));
+        BOOST_TEST(cache.size() == 2u);
+        BOOST_TEST(cache.bytes() == 2 * tile_bytes);
+        BOOST_TEST(cache.find(rasterlite_tile_key(0, 0, 0), tile));
+        BOOST_TEST(!cache.find(rasterlite_tile_key(0, 1, 0), tile));
+        BOOST_TEST(cache.find(rasterlite_tile_key(0, 2, 0), tile));
+
+        // blocks larger than the cache are not kept
+        cache.insert(rasterlite_tile_key(0, 3, 0), make_tile(32, 4));
+        BOOST_TEST(!cache.find(rasterlite_tile_key(0, 3, 0), tile));
+        BOOST_TEST(cache.size() == 2u);
+    }
+
+    // blocks that failed to read are cached as null tiles
+    {
+        rasterlite_tile_cache cache(2 * tile_bytes);
+        rasterlite_tile_ptr tile = make_tile(16, 1);
+        cache.insert(rasterlite_tile_key(0, 0, 0), rasterlite_tile_ptr());
+        BOOST_TEST(cache.find(rasterlite_tile_key(0, 0, 0), tile));
+        BOOST_TEST(!tile);
+        BOOST_TEST(cache.bytes() > 0);
+        BOOST_TEST(cache.bytes() < tile_bytes);
+
+        // and evicted like any other block
+        cache.insert(rasterlite_tile_key(0, 1, 0), make_tile(16, 2));
+        cache.insert(rasterlite_tile_key(0, 2, 0), make_tile(16, 3));
+        BOOST_TEST(!cache.find(rasterlite_tile_key(0, 0, 0), tile));
+        BOOST_TEST(cache.bytes() == 2 * tile_bytes);
+    }
+
+    // but only for a while, so that transient failures are retried
+    {
+        rasterlite_tile_cache cache(2 * tile_bytes, 0);
+        rasterlite_tile_ptr tile;
+        cache.insert(rasterlite_tile_key(0, 0, 0), rasterlite_tile_ptr());
+        cache.insert(rasterlite_tile_key(0, 1, 0), make_tile(16, 2));
+        BOOST_TEST(!cache.find(rasterlite_tile_key(0, 0, 0), tile));
+        BOOST_TEST(cache.size() == 1u);
+        BOOST_TEST(cache.bytes() == tile_bytes);
+        // decoded blocks do not expire
+        BOOST_TEST(cache.find(rasterlite_tile_key(0, 1, 0), tile));
+        BOOST_TEST(tile && tile->getRow(0)[0] == 2u);
+    }
+
+    return ::boost::report_errors();
+}
@@ -0,0 +1,150 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/ctrans.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <vector>
+
+using mapnik::CoordTransform;
+using mapnik::proj_transform;
+
+// transforms one vertex at a time, skipping the ones that fail to
+// project, as coord_transform2 did before vertices were batched
+template <typename Geometry>
+struct per_vertex_transform
+{
+    per_vertex_transform(CoordTransform const& t, Geometry const& geom, proj_transform const& prj_trans)
+        : t_(t), geom_(geom), prj_trans_(prj_trans) {}
+
+    unsigned vertex(double * x, double * y) const
+    {
+        unsigned command = mapnik::SEG_MOVETO;
+        bool ok = false;
+        bool skipped_points = false;
+        while (!ok)
+        {
+            command = geom_.vertex(x, y);
+            double z = 0;
+            ok = prj_trans_.backward(*x, *y, z);
+            if (!ok) skipped_points = true;
+            ok = ok || (command == mapnik::SEG_END);
+        }
+        if (skipped_points && command == mapnik::SEG_LINETO) command = mapnik::SEG_MOVETO;
+        t_.forward(x, y);
+        return command;
+    }
+
+    CoordTransform const& t_;
+    Geometry const& geom_;
+    proj_transform const& prj_trans_;
+};
+
+// paths of the given lengths, with the vertices at every 'fail'th
+// position (when not 0) moved to the far side of the globe
+template <typename Geometry>
+static void add_paths(Geometry & geom, std::vector<unsigned> const& lengths, unsigned fail)
+{
+    unsigned n = 0;
+    for (unsigned k = 0; k < lengths.size(); ++k)
+    {
+        for (unsigned i = 0; i < lengths[k]; ++i, ++n)
+        {
+            double x = -60.0 + (n * 7) % 120;
+            double y = -50.0 + (n * 3) % 100;
+            if (fail && n % fail == fail / 2) x = 150.0;
+            if (i == 0) geom.move_to(x, y);
+            else geom.line_to(x, y);
+        }
+    }
+}
+
+template <typename Geometry>
+static bool same_path(Geometry const& geom, CoordTransform const& t, proj_transform const& prj_trans, unsigned & num_vertices)
+{
+    per_vertex_transform<Geometry> expected(t, geom, prj_trans);
+    mapnik::coord_transform2<CoordTransform, Geometry> path(t, geom, prj_trans);
+    geom.rewind(0);
+    path.rewind(0);
+    num_vertices = 0;
+    for (;;)
+    {
+        double ex, ey, x, y;
+        unsigned expected_command = expected.vertex(&ex, &ey);
+        unsigned command = path.vertex(&x, &y);
+        if (command != expected_command) return false;
+        if (command == mapnik::SEG_END) return true;
+        if (x != ex || y != ey) return false;
+        ++num_vertices;
+    }
+}
+
+template <typename Geometry>
+static void test_paths(CoordTransform const& t,
+                       proj_transform const& equal_trans,
+                       proj_transform const& prj_trans)
+{
+    // around the batch size (64) and the vertex_vector block size (256)
+    unsigned const sizes[] = { 1, 2, 63, 64, 65, 127, 128, 129, 255, 256, 257, 513 };
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        std::vector<unsigned> lengths(1, sizes[s]);
+        unsigned num_vertices;
+
+        // every vertex comes out once, unprojected or projected
+        {
+            Geometry geom(mapnik::LineString);
+            add_paths(geom, lengths, 0);
+            BOOST_TEST(same_path(geom, t, equal_trans, num_vertices));
+            BOOST_TEST(num_vertices == sizes[s]);
+            BOOST_TEST(same_path(geom, t, prj_trans, num_vertices));
+            BOOST_TEST(num_vertices == sizes[s]);
+        }
+
+        // vertices that fail to project are skipped and the next
+        // line_to becomes a move_to
+        {
+            Geometry geom(mapnik::LineString);
+            add_paths(geom, lengths, 17);
+            BOOST_TEST(same_path(geom, t, prj_trans, num_vertices));
+            BOOST_TEST(num_vertices == sizes[s] - (sizes[s] + 8) / 17);
+        }
+
+        // the same with several paths in one geometry, so paths start
+        // at every offset within a batch
+        {
+            Geometry geom(mapnik::Polygon);
+            std::vector<unsigned> rings(3, sizes[s]);
+            rings.push_back(5);
+            rings.push_back(1);
+            add_paths(geom, rings, 0);
+            BOOST_TEST(same_path(geom, t, prj_trans, num_vertices));
+            Geometry failing(mapnik::Polygon);
+            add_paths(failing, rings, 5);
+            BOOST_TEST(same_path(failing, t, prj_trans, num_vertices));
+        }
+    }
+
+    // a path that fails to project entirely
+    {
+        Geometry geom(mapnik::LineString);
+        add_paths(geom, std::vector<unsigned>(1, 100), 1);
+        unsigned num_vertices;
+        BOOST_TEST(same_path(geom, t, prj_trans, num_vertices));
+        BOOST_TEST(num_vertices == 0u);
+    }
+}
+
+int main( int, char*[] )
+{
+    mapnik::projection longlat("+proj=longlat +a=6370997 +b=6370997 +no_defs");
+    // only the hemisphere around 0,0 is visible
+    mapnik::projection ortho("+proj=ortho +lat_0=0 +lon_0=0 +a=6370997 +b=6370997 +units=m +no_defs");
+    proj_transform equal_trans(longlat, longlat);
+    proj_transform prj_trans(ortho, longlat);
+    CoordTransform t(256, 256, mapnik::box2d<double>(-6370997, -6370997, 6370997, 6370997));
+
+    test_paths<mapnik::geometry_type>(t, equal_trans, prj_trans);
+    test_paths<mapnik::geometry<mapnik::vertex2d, mapnik::vertex_vector> >(t, equal_trans, prj_trans);
+
+    return ::boost::report_errors();
+}
@@ -0,0 +1,151 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <mapnik/vertex_array.hpp>
+#include <mapnik/vertex_vector.hpp>
+#include <vector>
+
+using mapnik::vertex2d;
+using mapnik::vertex_array;
+using mapnik::vertex_vector;
+
+// fills a container with paths of the given lengths, vertex i at (i, -i)
+template <typename Container>
+static void add_paths(Container & cont, std::vector<unsigned> & commands, std::vector<unsigned> const& lengths)
+{
+    for (unsigned k = 0; k < lengths.size(); ++k)
+    {
+        for (unsigned i = 0; i < lengths[k]; ++i)
+        {
+            double pos = cont.size();
+            unsigned command = i == 0 ? mapnik::SEG_MOVETO : mapnik::SEG_LINETO;
+            cont.push_back(pos, -pos, command);
+            commands.push_back(command);
+        }
+    }
+}
+
+// runs cover every vertex once, in order, with the right coordinates and commands
+template <typename Container>
+static bool runs_match(Container const& cont, std::vector<unsigned> const& commands, unsigned max_run)
+{
+    unsigned pos = 0;
+    double const* coords;
+    unsigned command;
+    while (unsigned count = cont.get_vertices(pos, &coords, &command))
+    {
+        if (count > max_run) return false;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (commands[pos + i] != command) return false;
+            if (coords[2 * i] != pos + i || coords[2 * i + 1] != -double(pos + i)) return false;
+        }
+        pos += count;
+        // a run ends where the command changes, or at a block end
+        if (pos < commands.size() && commands[pos] == command && pos % max_run != 0) return false;
+    }
+    return pos == commands.size();
+}
+
+// single vertices read in any order
+template <typename Container>
+static bool vertex_matches(Container const& cont, std::vector<unsigned> const& commands, unsigned pos)
+{
+    double x, y;
+    unsigned command = cont.get_vertex(pos, &x, &y);
+    if (pos >= commands.size()) return command == mapnik::SEG_END;
+    return command == commands[pos] && x == pos && y == -double(pos);
+}
+
+int main( int, char*[] )
+{
+    std::vector<unsigned> lengths;
+    lengths.push_back(1);
+    lengths.push_back(6);
+    lengths.push_back(1);
+    lengths.push_back(300);
+    lengths.push_back(4);
+
+    // vertex_array: a MOVETO and the LINETOs after it are two runs
+    {
+        vertex_array<vertex2d> cont;
+        std::vector<unsigned> commands;
+        add_paths(cont, commands, lengths);
+        BOOST_TEST(cont.size() == 312u);
+        BOOST_TEST(runs_match(cont, commands, 312));
+
+        double const* coords;
+        unsigned command;
+        // consecutive MOVETOs share a run
+        BOOST_TEST(cont.get_vertices(0, &coords, &command) == 2u);
+        BOOST_TEST(command == mapnik::SEG_MOVETO);
+        BOOST_TEST(cont.get_vertices(2, &coords, &command) == 5u);
+        BOOST_TEST(command == mapnik::SEG_LINETO);
+        // from the middle of a run to its end
+        BOOST_TEST(cont.get_vertices(4, &coords, &command) == 3u);
+        BOOST_TEST(coords[0] == 4.0 && coords[1] == -4.0);
+        BOOST_TEST(cont.get_vertices(7, &coords, &command) == 2u);
+        BOOST_TEST(command == mapnik::SEG_MOVETO);
+        BOOST_TEST(cont.get_vertices(9, &coords, &command) == 299u);
+        BOOST_TEST(cont.get_vertices(308, &coords, &command) == 1u);
+        BOOST_TEST(command == mapnik::SEG_MOVETO);
+        BOOST_TEST(cont.get_vertices(311, &coords, &command) == 1u);
+        BOOST_TEST(command == mapnik::SEG_LINETO);
+        BOOST_TEST(cont.get_vertices(312, &coords, &command) == 0u);
+
+        // the run of a vertex is found whatever was looked up before
+        bool found = true;
+        for (unsigned pos = 0; pos <= 312; ++pos) found = found && vertex_matches(cont, commands, pos);
+        for (unsigned pos = 313; pos-- > 0;) found = found && vertex_matches(cont, commands, pos);
+        for (unsigned pos = 0; pos < 312; pos += 7) found = found && vertex_matches(cont, commands, 311 - pos) && vertex_matches(cont, commands, pos);
+        BOOST_TEST(found);
+    }
+
+    // vertex_array with a single run, and empty
+    {
+        vertex_array<vertex2d> cont;
+        double const* coords;
+        unsigned command;
+        double x, y;
+        BOOST_TEST(cont.get_vertices(0, &coords, &command) == 0u);
+        BOOST_TEST(cont.get_vertex(0, &x, &y) == unsigned(mapnik::SEG_END));
+        cont.push_back(1, 2, mapnik::SEG_MOVETO);
+        BOOST_TEST(cont.get_vertices(0, &coords, &command) == 1u);
+        BOOST_TEST(command == mapnik::SEG_MOVETO && coords[0] == 1.0 && coords[1] == 2.0);
+    }
+
+    // vertex_vector: runs also end at the end of each 256 vertex block
+    {
+        vertex_vector<vertex2d> cont;
+        std::vector<unsigned> commands;
+        add_paths(cont, commands, lengths);
+        BOOST_TEST(runs_match(cont, commands, 256));
+
+        double const* coords;
+        unsigned command;
+        BOOST_TEST(cont.get_vertices(0, &coords, &command) == 2u);
+        BOOST_TEST(cont.get_vertices(9, &coords, &command) == 247u);
+        BOOST_TEST(command == mapnik::SEG_LINETO);
+        BOOST_TEST(cont.get_vertices(256, &coords, &command) == 52u);
+        BOOST_TEST(command == mapnik::SEG_LINETO && coords[0] == 256.0);
+        BOOST_TEST(cont.get_vertices(255, &coords, &command) == 1u);
+        BOOST_TEST(cont.get_vertices(312, &coords, &command) == 0u);
+
+        bool found = true;
+        for (unsigned pos = 313; pos-- > 0;) found = found && vertex_matches(cont, commands, pos);
+        BOOST_TEST(found);
+    }
+
+    // a path filling whole blocks exactly
+    {
+        vertex_vector<vertex2d> cont;
+        std::vector<unsigned> commands;
+        add_paths(cont, commands, std::vector<unsigned>(1, 512));
+        BOOST_TEST(runs_match(cont, commands, 256));
+        double const* coords;
+        unsigned command;
+        BOOST_TEST(cont.get_vertices(1, &coords, &command) == 255u);
+        BOOST_TEST(cont.get_vertices(256, &coords, &command) == 256u);
+        BOOST_TEST(cont.get_vertices(512, &coords, &command) == 0u);
+    }
+
+    return ::boost::report_errors();
+}
@@ -2,6 +2,7 @@
 
 import os
 import mapnik2
+from StringIO import StringIO
 from nose.tools import *
 from utilities import execution_path,Todo
 
@@ -54,6 +55,55 @@ def test_pycairo_svg_surface():
 def test_pycairo_svg_surface():
     return _pycairo_surface('ps','polygon')
 
+# leading bytes of each output format
+cairo_stream_signatures = {
+    'pdf': '%PDF-',
+    'ps': '%!PS-Adobe',
+    'svg': '<?xml',
+    'ARGB32': '\x89PNG\r\n\x1a\n',
+    'RGB24': '\x89PNG\r\n\x1a\n',
+}
+
+def _cairo_stream(format, sym, font_cache=None):
+    m = mapnik2.Map(256,256)
+    mapnik2.load_map(m,'../data/good_maps/%s_symbolizer.xml' % sym)
+    m.zoom_all()
+    output = StringIO()
+    if font_cache is not None:
+        mapnik2.render_to_stream(m, output, format, font_cache)
+    else:
+        mapnik2.render_to_stream(m, output, format)
+    return output.getvalue()
+
+if mapnik2.has_cairo():
+
+    def test_render_to_stream():
+        for format, signature in cairo_stream_signatures.items():
+            data = _cairo_stream(format, 'polygon')
+            eq_(data.startswith(signature), True, format)
+        # the document is complete, not just started
+        eq_(_cairo_stream('pdf', 'polygon').rstrip().endswith('%%EOF'), True)
+        eq_(_cairo_stream('svg', 'polygon').rstrip().endswith('</svg>'), True)
+        eq_(_cairo_stream('ps', 'polygon').rstrip().endswith('%%EOF'), True)
+
+    def test_render_to_stream_matches_image_size():
+        data = _cairo_stream('ARGB32', 'point')
+        # width and height of the png IHDR chunk
+        eq_(data[12:16], 'IHDR')
+        eq_(data[16:24], '\x00\x00\x01\x00\x00\x00\x01\x00')
+
+    def test_render_to_stream_with_font_cache():
+        font_cache = mapnik2.CairoFontCache()
+        # the cache is reused by later renders
+        for i in range(2):
+            data = _cairo_stream('pdf', 'point', font_cache)
+            eq_(data.startswith('%PDF-'), True)
+            eq_(data.rstrip().endswith('%%EOF'), True)
+
+    @raises(RuntimeError)
+    def test_render_to_stream_unknown_format():
+        _cairo_stream('gif', 'point')
+
 if __name__ == "__main__":
     setup()
     [eval(run)() for run in dir() if 'test_' in run]
@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+from nose.tools import *
+from utilities import execution_path
+
+import os, shutil, tempfile, mapnik2
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+if 'csv' in mapnik2.DatasourceCache.plugin_names():
+
+    def test_csv_points():
+        ds = mapnik2.CSV(file='../data/csv/points.csv')
+        eq_(ds.fields(), ['x', 'y', 'label'])
+        eq_(ds.field_types(), ['int', 'int', 'str'])
+        e = ds.envelope()
+        eq_((e.minx, e.miny, e.maxx, e.maxy), (0, 0, 5, 5))
+        features = ds.all_features()
+        eq_(len(features), 5)
+        eq_(features[0].id(), 1)
+        eq_(features[0]['label'], u'0,0')
+        eq_(features[4]['label'], u'2.5,2.5')
+
+    def test_csv_query_only_materializes_requested_fields():
+        ds = mapnik2.CSV(file='../data/csv/points.csv')
+        q = mapnik2.Query(mapnik2.Box2d(4, 4, 6, 6))
+        q.add_property_name('label')
+        features = ds.features(q).features
+        eq_(len(features), 1)
+        eq_(features[0].attributes, {'label': u'5,5'})
+
+    def test_csv_wkt_column():
+        ds = mapnik2.CSV(file='../data/csv/wkt.csv')
+        # the geometry column is not an attribute
+        eq_(ds.fields(), ['id', 'name'])
+        eq_(ds.field_types(), ['int', 'str'])
+        eq_(ds.envelope(), mapnik2.Box2d(-5, -6, 21, 21))
+        features = ds.all_features()
+        # the row with invalid wkt is skipped, ids stay record numbers
+        eq_([f.id() for f in features], [1, 2, 4, 5])
+        eq_([f['name'] for f in features], [u'point', u'line', u'polygon', u'multi'])
+        eq_([[g.type() for g in f.geometries()] for f in features],
+            [[mapnik2.GeometryType.Point],
+             [mapnik2.GeometryType.LineString],
+             [mapnik2.GeometryType.Polygon],
+             [mapnik2.GeometryType.Polygon, mapnik2.GeometryType.Polygon]])
+        eq_(features[1].envelope(), mapnik2.Box2d(0, 0, 10, 5))
+        eq_(features[3].envelope(), mapnik2.Box2d(-5, -6, 21, 21))
+
+    def test_csv_quoted_fields_with_newlines():
+        ds = mapnik2.CSV(file='../data/csv/multiline.csv')
+        features = ds.all_features()
+        eq_(len(features), 3)
+        eq_(features[0]['note'], u'first line\nsecond line')
+        eq_(features[1]['note'], u'says "hi", twice\r\nand again')
+        eq_(features[2]['note'], u'plain')
+        eq_(features[2].envelope(), mapnik2.Box2d(2, 2, 2, 2))
+
+    def _large_csv_note(row):
+        return ''.join(['row %d' % row] + ['\nline %d, "quoted"' % i for i in range(row % 4)])
+
+    def test_csv_large_file():
+        # above the 4MB from which files are split and parsed in parallel,
+        # with quoted fields spanning lines everywhere the file may be cut
+        num_rows = 100000
+        tmp_dir = tempfile.mkdtemp()
+        try:
+            path = os.path.join(tmp_dir, 'large.csv')
+            f = open(path, 'wb')
+            f.write('x,y,note,label\n')
+            for row in range(num_rows):
+                f.write('%d,%d,"%s",label %d\n' % (row % 360, row % 180, _large_csv_note(row).replace('"', '""'), row))
+            f.close()
+            assert os.path.getsize(path) > 4 * 1024 * 1024
+
+            ds = mapnik2.CSV(file=path)
+            eq_(ds.fields(), ['x', 'y', 'note', 'label'])
+            eq_(ds.field_types(), ['int', 'int', 'str', 'str'])
+            eq_(ds.envelope(), mapnik2.Box2d(0, 0, 359, 179))
+            features = ds.all_features()
+            eq_(len(features), num_rows)
+            for row in (0, 1, 2, 3, 12345, 50001, num_rows - 1):
+                feature = features[row]
+                eq_(feature.id(), row + 1)
+                eq_(feature['note'], unicode(_large_csv_note(row)))
+                eq_(feature['label'], u'label %d' % row)
+                eq_(feature.envelope(), mapnik2.Box2d(row % 360, row % 180, row % 360, row % 180))
+            # every row ended up in the index
+            q = mapnik2.Query(mapnik2.Box2d(99.5, 99.5, 100.5, 100.5))
+            q.add_property_name('label')
+            labels = [f['label'] for f in ds.features(q).features]
+            eq_(labels, [u'label %d' % row for row in range(num_rows) if row % 360 == 100])
+        finally:
+            shutil.rmtree(tmp_dir)
+
+if __name__ == "__main__":
+    setup()
+    [eval(run)() for run in dir() if 'test_' in run]
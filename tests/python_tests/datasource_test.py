@@ -85,6 +85,25 @@ def test_hit_grid():
     eq_(hit_list[:16],'730:|2:Greenland')
     eq_(hit_list[-12:],'1:Chile|812:')
 
+def test_batched_hit_grid():
+    m = mapnik2.Map(256,256);
+    mapnik2.load_map(m,'../data/good_maps/agg_poly_gamma_map.xml');
+    m.zoom_all()
+    join_field = 'NAME'
+    points = [(x,y) for y in range(0, 256, 4) for x in range(0, 256, 4)]
+    expected = [[f[join_field] for f in m.query_map_point(0,x,y).features] for x,y in points]
+    cache = mapnik2.PointQueryCache(2)
+    for i in range(3):
+        results = m.query_map_points(0, points, 3, [join_field], cache)
+        eq_([[f[join_field] for f in features] for features in results], expected)
+        # only the requested field is loaded
+        for features in results:
+            for f in features:
+                eq_(f.attributes.keys(), [join_field])
+    eq_(len(cache), 1)
+    cache.clear()
+    eq_(len(cache), 0)
+
 if __name__ == '__main__':
     setup()
     [eval(run)() for run in dir() if 'test_' in run]
@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+from nose.tools import *
+from utilities import execution_path
+
+import os, mapnik2
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+if 'geojson' in mapnik2.DatasourceCache.plugin_names():
+
+    def test_geojson_query_only_decodes_requested_properties():
+        ds = mapnik2.GeoJSON(file='../data/json/lines.json')
+        q = mapnik2.Query(mapnik2.Box2d(5.5, 4.5, 7, 6))
+        q.add_property_name('label')
+        features = ds.features(q).features
+        eq_(len(features), 1)
+        eq_(features[0].attributes, {'label': u'D'})
+
+    def test_geojson_string_escapes():
+        ds = mapnik2.GeoJSON(file='../data/json/escapes.json')
+        eq_(ds.fields(), ['name'])
+        features = ds.all_features()
+        eq_(len(features), 2)
+        eq_(features[0]['name'], u'quote " backslash \\ slash / tab \t e-acute \xe9')
+        eq_(features[1]['name'], u'plain')
+
+    def test_geojson_geometry_collection():
+        ds = mapnik2.GeoJSON(file='../data/json/collection.json')
+        features = ds.all_features()
+        eq_(len(features), 1)
+        geoms = features[0].geometries()
+        eq_(len(geoms), 3)
+        eq_([g.type() for g in geoms],
+            [mapnik2.GeometryType.Point,
+             mapnik2.GeometryType.LineString,
+             mapnik2.GeometryType.Polygon])
+        eq_(features[0].envelope(), mapnik2.Box2d(0, 0, 6, 6))
+        eq_(ds.envelope(), mapnik2.Box2d(0, 0, 6, 6))
+
+    def test_geojson_empty_and_null_geometries_are_skipped():
+        ds = mapnik2.GeoJSON(file='../data/json/empty.json')
+        features = ds.all_features()
+        # only the features with coordinates remain, numbered in order
+        eq_([f['label'] for f in features], [u'point', u'empty part first'])
+        eq_([f.id() for f in features], [1, 2])
+        eq_(len(features[1].geometries()), 1)
+        eq_(features[1].envelope(), mapnik2.Box2d(1, 2, 3, 4))
+        eq_(ds.envelope(), mapnik2.Box2d(1, 2, 7, 8))
+
+    @raises(RuntimeError)
+    def test_geojson_malformed_document_throws():
+        mapnik2.GeoJSON(file='../data/json/malformed.json')
+
+    @raises(RuntimeError)
+    def test_geojson_missing_file_throws():
+        mapnik2.GeoJSON(file='../data/json/does_not_exist.json')
+
+if __name__ == "__main__":
+    setup()
+    [eval(run)() for run in dir() if 'test_' in run]
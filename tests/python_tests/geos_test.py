@@ -0,0 +1,56 @@
+#!/usr/bin/env python
+
+from nose.tools import *
+from utilities import execution_path
+
+import os, mapnik2
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+if 'geos' in mapnik2.DatasourceCache.plugin_names():
+
+    polygon = 'POLYGON((0 0,150 0,150 150,0 150,0 0))'
+
+    def query_envelopes(ds, box):
+        # queries built from a box have a resolution of one pixel per unit
+        features = ds.features(mapnik2.Query(box)).features
+        return [f.envelope() for f in features]
+
+    def test_geos_polygon_partly_inside_is_clipped_with_buffer():
+        ds = mapnik2.Geos(wkt=polygon)
+        eq_(query_envelopes(ds, mapnik2.Box2d(100,100,300,300)),
+            [mapnik2.Box2d(84,84,150,150)])
+
+    def test_geos_clip_buffer_parameter():
+        ds = mapnik2.Geos(wkt=polygon, clip_buffer=4)
+        eq_(query_envelopes(ds, mapnik2.Box2d(100,100,300,300)),
+            [mapnik2.Box2d(96,96,150,150)])
+        ds = mapnik2.Geos(wkt=polygon, clip_buffer=0)
+        eq_(query_envelopes(ds, mapnik2.Box2d(100,100,300,300)),
+            [mapnik2.Box2d(100,100,150,150)])
+
+    def test_geos_query_inside_polygon_returns_buffered_box():
+        ds = mapnik2.Geos(wkt=polygon)
+        eq_(query_envelopes(ds, mapnik2.Box2d(50,50,60,60)),
+            [mapnik2.Box2d(34,34,76,76)])
+
+    def test_geos_line_is_clipped_with_buffer():
+        ds = mapnik2.Geos(wkt='LINESTRING(0 0,400 400)')
+        eq_(query_envelopes(ds, mapnik2.Box2d(100,100,200,200)),
+            [mapnik2.Box2d(84,84,216,216)])
+
+    def test_geos_query_covering_extent_returns_whole_geometry():
+        ds = mapnik2.Geos(wkt=polygon)
+        eq_(query_envelopes(ds, mapnik2.Box2d(-10,-10,200,200)),
+            [mapnik2.Box2d(0,0,150,150)])
+
+    def test_geos_query_missing_geometry_returns_nothing():
+        ds = mapnik2.Geos(wkt=polygon)
+        eq_(ds.features(mapnik2.Query(mapnik2.Box2d(200,200,300,300))), None)
+
+if __name__ == "__main__":
+    setup()
+    [eval(run)() for run in dir() if 'test_' in run]
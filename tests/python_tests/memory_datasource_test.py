@@ -38,5 +38,50 @@ class MemoryDatasource(unittest.TestCase):
         retrieved = md.features_at_point(Coord(20,30)).features
         self.failUnlessEqual(len(retrieved), 0)
 
+    def test_remove_and_update_feature(self):
+        from mapnik2 import Coord
+        md = self.makeOne()
+        first = self.makeFeature('Point(2 3)', foo='bar')
+        second = self.makeFeature('Point(4 5)', foo='baz')
+        md.add_feature(first)
+        md.add_feature(second)
+
+        from mapnik2 import Feature
+        moved = Feature(first.id())
+        moved.add_geometries_from_wkt('Point(20 30)')
+        moved['foo'] = 'moved'
+        md.update_feature(moved)
+        self.failUnlessEqual(md.num_features(), 2)
+        self.failUnlessEqual(len(md.features_at_point(Coord(2,3)).features), 0)
+        retrieved = md.features_at_point(Coord(20,30)).features
+        self.failUnlessEqual(len(retrieved), 1)
+        self.failUnlessEqual(retrieved[0]['foo'], 'moved')
+
+        self.failUnlessEqual(md.remove_features(second.id()), 1)
+        self.failUnlessEqual(md.remove_features(second.id()), 0)
+        self.failUnlessEqual(md.num_features(), 1)
+        self.failUnlessEqual(len(md.features_at_point(Coord(4,5)).features), 0)
+        e = md.envelope()
+        self.failUnlessEqual((e.minx, e.miny, e.maxx, e.maxy), (20, 30, 20, 30))
+
+        md.clear()
+        self.failUnlessEqual(md.num_features(), 0)
+
+    def test_update_feature_shrinks_envelope(self):
+        from mapnik2 import Feature
+        md = self.makeOne()
+        md.add_feature(self.makeFeature('Point(0 0)'))
+        mover = self.makeFeature('Point(10 10)')
+        md.add_feature(mover)
+        e = md.envelope()
+        self.failUnlessEqual((e.minx, e.miny, e.maxx, e.maxy), (0, 0, 10, 10))
+
+        for x, y in ((50, 50), (5, 5), (3, 4)):
+            moved = Feature(mover.id())
+            moved.add_geometries_from_wkt('Point(%d %d)' % (x, y))
+            md.update_feature(moved)
+            e = md.envelope()
+            self.failUnlessEqual((e.minx, e.miny, e.maxx, e.maxy), (0, 0, x, y))
+
 if __name__ == "__main__":
     [eval(run)() for run in dir() if 'test_' in run]
@@ -349,6 +349,20 @@ def test_layer_init():
     eq_(l.srs,'+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs')
     eq_(l.title,'')
 
+# Layer envelope caching
+def test_layer_envelope_follows_datasource():
+    l = mapnik2.Layer('test')
+    ds = mapnik2.PointDatasource()
+    l.datasource = ds
+    eq_(l.envelope(),mapnik2.Box2d())
+    ds.add_point(0,0,'name','a')
+    ds.add_point(10,10,'name','b')
+    eq_(l.envelope(),mapnik2.Box2d(0,0,10,10))
+    ds.add_point(20,20,'name','c')
+    eq_(l.envelope(),mapnik2.Box2d(0,0,20,20))
+    l.reset_envelope()
+    eq_(l.envelope(),mapnik2.Box2d(0,0,20,20))
+
 # Map initialization
 def test_map_init():
     m = mapnik2.Map(256, 256)
@@ -0,0 +1,61 @@
+#!/usr/bin/env python
+
+from nose.tools import *
+from utilities import execution_path
+
+import os, gc, shutil, tempfile, mapnik2
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+if 'osm' in mapnik2.DatasourceCache.plugin_names():
+
+    def test_osm_fields_and_extent():
+        ds = mapnik2.Osm(file='../data/osm/nodes.osm')
+        eq_(ds.fields(), ['bicycle', 'foot', 'horse', 'name', 'width'])
+        e = ds.envelope()
+        eq_((e.minx, e.miny, e.maxx, e.maxy), (-2, -2, 2, 2))
+        eq_(len(ds.all_features()), 8)
+
+    def test_osm_query_uses_bbox():
+        ds = mapnik2.Osm(file='../data/osm/nodes.osm')
+        features = ds.features(mapnik2.Query(mapnik2.Box2d(1.5, -0.5, 2.5, 0.5))).features
+        # the node and the way through it
+        eq_([f.id() for f in features], [1, 5])
+
+    def test_osm_cache_file():
+        tmp = tempfile.mkdtemp()
+        osm = os.path.join(tmp, 'nodes.osm')
+        cache = os.path.join(tmp, 'nodes.cache')
+        shutil.copy('../data/osm/nodes.osm', osm)
+        ds = mapnik2.Osm(file=osm, cache_file=cache)
+        eq_(os.path.exists(cache), True)
+        count = len(ds.all_features())
+        # drop the store shared by datasources of the same file so that
+        # the next datasource has to read the file or the cache
+        del ds
+        gc.collect()
+        # replace the file by one that does not parse but has the same
+        # size and time stamp, so that only the cache can provide the data
+        stat = os.stat(osm)
+        open(osm, 'w').write(' ' * stat.st_size)
+        os.utime(osm, (stat.st_atime, stat.st_mtime))
+        cached = mapnik2.Osm(file=osm, cache_file=cache)
+        eq_(len(cached.all_features()), count)
+        eq_(cached.fields(), ['bicycle', 'foot', 'horse', 'name', 'width'])
+        del cached
+        gc.collect()
+        # a cache older than the file is not used
+        os.utime(osm, (stat.st_atime, stat.st_mtime + 10))
+        try:
+            mapnik2.Osm(file=osm, cache_file=cache)
+            raise AssertionError('expected the modified file to be parsed')
+        except RuntimeError:
+            pass
+        shutil.rmtree(tmp)
+
+if __name__ == "__main__":
+    setup()
+    [eval(run)() for run in dir() if 'test_' in run]
@@ -188,7 +188,36 @@ def test_raster_warping_does_not_overclip_source():
     save_data('test_raster_warping_does_not_overclip_source.png',
               im.tostring('png'))
     assert im.view(0,200,1,1).tostring()=='\xff\xff\x00\xff'
-    
+
+def test_raster_warping_threads_match_serial():
+    lyrSrs = "+init=epsg:32630"
+    mapSrs = '+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs'
+    eq_(mapnik2.RasterSymbolizer().warp_threads, 1)
+    images = []
+    for threads in (1, 4):
+        lyr = mapnik2.Layer('dataraster', lyrSrs)
+        lyr.datasource = mapnik2.Gdal(
+            file = '../data/raster/dataraster.tif',
+            band = 1,
+            )
+        sym = mapnik2.RasterSymbolizer()
+        sym.scaling = 'bilinear'
+        sym.warp_threads = threads
+        rule = mapnik2.Rule()
+        rule.symbols.append(sym)
+        style = mapnik2.Style()
+        style.rules.append(rule)
+        # large enough to be split between the threads
+        _map = mapnik2.Map(1024,1024, mapSrs)
+        _map.append_style('foo', style)
+        lyr.styles.append('foo')
+        _map.layers.append(lyr)
+        _map.zoom_to_box(mapnik2.Box2d(3,42,4,43))
+        im = mapnik2.Image(_map.width,_map.height)
+        mapnik2.render(_map, im)
+        images.append(im.tostring())
+    assert images[0] == images[1]
+
 if __name__ == "__main__":
     setup()
     [eval(run)() for run in dir() if 'test_' in run]
@@ -0,0 +1,93 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+from nose.tools import *
+
+import os, shutil, mapnik2
+
+from utilities import execution_path
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+def test_memory_render_cache():
+    m = mapnik2.Map(256, 256)
+    m.zoom_to_box(mapnik2.Box2d(-180,-90,180,90))
+    cache = mapnik2.MemoryRenderCache()
+    eq_(len(cache), 0)
+    first = mapnik2.render_to_string_cached(m, cache, 'empty', 'png')
+    eq_(len(cache), 1)
+    eq_(cache.bytes, len(first))
+    second = mapnik2.render_to_string_cached(m, cache, 'empty', 'png')
+    eq_(first, second)
+    eq_(len(cache), 1)
+    m.zoom_to_box(mapnik2.Box2d(-90,-45,90,45))
+    mapnik2.render_to_string_cached(m, cache, 'empty', 'png')
+    eq_(len(cache), 2)
+    cache.clear()
+    eq_(len(cache), 0)
+
+def test_render_cache_key_buffer_size():
+    m = mapnik2.Map(256, 256)
+    m.zoom_to_box(mapnik2.Box2d(-180,-90,180,90))
+    cache = mapnik2.MemoryRenderCache()
+    mapnik2.render_to_string_cached(m, cache, 'empty', 'png')
+    m.buffer_size = 64
+    mapnik2.render_to_string_cached(m, cache, 'empty', 'png')
+    eq_(len(cache), 2)
+
+def test_memory_render_cache_invalidate_layer():
+    m = mapnik2.Map(256, 256)
+    lyr = mapnik2.Layer('points')
+    lyr.datasource = mapnik2.PointDatasource()
+    m.layers.append(lyr)
+    m.zoom_to_box(mapnik2.Box2d(-180,-90,180,90))
+    cache = mapnik2.MemoryRenderCache()
+    mapnik2.render_to_string_cached(m, cache, 'points', 'png')
+    eq_(len(cache), 1)
+    cache.invalidate_layer('other')
+    eq_(len(cache), 1)
+    cache.invalidate_layer('points')
+    eq_(len(cache), 0)
+
+def test_memory_render_cache_invalidate_datasource():
+    m = mapnik2.Map(256, 256)
+    for name in ('a', 'b'):
+        lyr = mapnik2.Layer(name)
+        lyr.datasource = mapnik2.Shapefile(file='../data/shp/poly.shp')
+        m.layers.append(lyr)
+    m.zoom_to_box(mapnik2.Box2d(-180,-90,180,90))
+    cache = mapnik2.MemoryRenderCache()
+    mapnik2.render_to_string_cached(m, cache, 'poly', 'png')
+    m.zoom_to_box(mapnik2.Box2d(-90,-45,90,45))
+    mapnik2.render_to_string_cached(m, cache, 'poly', 'png')
+    eq_(len(cache), 2)
+    cache.invalidate_datasource(mapnik2.Shapefile(file='../data/shp/world_merc.shp'))
+    eq_(len(cache), 2)
+    # both entries depend on the datasource through two layers
+    cache.invalidate_datasource(m.layers[1].datasource)
+    eq_(len(cache), 0)
+    cache.invalidate_layer('a')
+    eq_(len(cache), 0)
+    mapnik2.render_to_string_cached(m, cache, 'poly', 'png')
+    eq_(len(cache), 1)
+
+def test_file_render_cache():
+    directory = 'render_cache_test_dir'
+    m = mapnik2.Map(256, 256)
+    m.zoom_to_box(mapnik2.Box2d(-180,-90,180,90))
+    cache = mapnik2.FileRenderCache(directory)
+    first = mapnik2.render_to_string_cached(m, cache, 'empty', 'png')
+    eq_(len(os.listdir(directory)), 1)
+    # a new cache over the same directory sees the stored entry
+    cache = mapnik2.FileRenderCache(directory)
+    eq_(mapnik2.render_to_string_cached(m, cache, 'empty', 'png'), first)
+    cache.clear()
+    eq_(len(os.listdir(directory)), 0)
+    shutil.rmtree(directory)
+
+if __name__ == "__main__":
+    setup()
+    [eval(run)() for run in dir() if 'test_' in run]
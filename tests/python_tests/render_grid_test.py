@@ -142,5 +142,47 @@ def test_render_grid2():
     eq_(resolve(utf5,38,10),{"Name": "South West"})
     eq_(resolve(utf5,38,46),{"Name": "South East"})
     
+def test_render_grid_to_json():
+    """ test streaming json against the python encoding """
+    width,height = 256,256
+    m = create_grid_map(width,height)
+    ul_lonlat = mapnik2.Coord(142.30,-38.20)
+    lr_lonlat = mapnik2.Coord(143.40,-38.80)
+    m.zoom_to_box(mapnik2.Box2d(ul_lonlat,lr_lonlat))
+    grid = mapnik2.Grid(m.width,m.height,key='Name')
+    mapnik2.render_layer(m,grid,layer=0,fields=['Name'])
+    eq_(json.loads(grid.to_json(resolution=4)),grid_correct_new)
+    eq_(json.loads(grid.to_json(resolution=4)),grid.encode('utf',resolution=4))
+    eq_(json.loads(grid.to_json(features=False,resolution=1))['data'],{})
+
+def test_render_grid_reduced_resolution():
+    """ grids rendered at reduced resolution are not resampled again """
+    width,height = 256,256
+    m = create_grid_map(width,height)
+    ul_lonlat = mapnik2.Coord(142.30,-38.20)
+    lr_lonlat = mapnik2.Coord(143.40,-38.80)
+    m.zoom_to_box(mapnik2.Box2d(ul_lonlat,lr_lonlat))
+    grid = mapnik2.Grid(m.width/4,m.height/4,key='Name',resolution=4)
+    mapnik2.render_layer(m,grid,layer=0,fields=['Name'])
+    utf = grid.encode('utf',resolution=4)
+    eq_(len(utf['grid']),64)
+    eq_(len(utf['grid'][0]),64)
+    eq_(utf,grid.encode('utf',resolution=1))
+
+def test_render_with_grid():
+    """ single pass image and grid against separate renders """
+    width,height = 256,256
+    m = create_grid_map(width,height)
+    ul_lonlat = mapnik2.Coord(142.30,-38.20)
+    lr_lonlat = mapnik2.Coord(143.40,-38.80)
+    m.zoom_to_box(mapnik2.Box2d(ul_lonlat,lr_lonlat))
+    im = mapnik2.Image(m.width,m.height)
+    grid = mapnik2.Grid(m.width,m.height,key='Name')
+    mapnik2.render_with_grid(m,im,grid,layer=0,fields=['Name'])
+    eq_(grid.encode('utf',resolution=4),grid_correct_new)
+    im2 = mapnik2.Image(m.width,m.height)
+    mapnik2.render(m,im2)
+    eq_(im.tostring(),im2.tostring())
+
 if __name__ == "__main__":
     [eval(run)() for run in dir() if 'test_' in run]
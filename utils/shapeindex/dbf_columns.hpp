@@ -0,0 +1,289 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef DBF_COLUMNS_HPP
+#define DBF_COLUMNS_HPP
+
+// boost
+#include <boost/cstdint.hpp>
+#include <boost/algorithm/string.hpp>
+// stl
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+
+// Writes the columns sidecar <shape_name>.dbc read by the shape plugin's
+// dbf_file (see dbfile.hpp for the layout): the named dbf columns are
+// decoded once here so that rendering does not parse their text again.
+class dbf_column_writer
+{
+public:
+    // Returns the number of columns written or -1 on errors.
+    static int write(std::string const& shape_name, std::vector<std::string> const& names)
+    {
+        std::ifstream dbf((shape_name + ".dbf").c_str(), std::ios::in | std::ios::binary);
+        if (!dbf)
+        {
+            std::clog << "error : cannot open " << shape_name << ".dbf" << std::endl;
+            return -1;
+        }
+        char header[32];
+        if (!dbf.read(header, 32) || (header[0] != '\3' && header[0] != '\131'))
+        {
+            std::clog << "error : " << shape_name << ".dbf is not a dbf file" << std::endl;
+            return -1;
+        }
+        boost::int32_t num_records = read_ndr(header + 4);
+        int num_fields = ((read_ndr(header + 8) & 0xffff) - 33) / 32;
+
+        std::vector<field> fields;
+        std::size_t record_length = 0;
+        for (int i = 0; i < num_fields; ++i)
+        {
+            char desc[32];
+            if (!dbf.read(desc, 32)) return -1;
+            field f;
+            f.name = boost::trim_left_copy(std::string(desc, std::find(desc, desc + 10, '\0')));
+            f.type = desc[11];
+            f.offset = record_length;
+            f.length = static_cast<unsigned char>(desc[16]);
+            f.dec = static_cast<unsigned char>(desc[17]);
+            record_length += f.length;
+            fields.push_back(f);
+        }
+
+        std::vector<column> columns;
+        for (unsigned i = 0; i < names.size(); ++i)
+        {
+            unsigned col = 0;
+            while (col < fields.size() && fields[col].name != names[i]) ++col;
+            if (col == fields.size())
+            {
+                std::clog << "warning : no column '" << names[i] << "' in " << shape_name << ".dbf" << std::endl;
+                continue;
+            }
+            column c;
+            c.field = col;
+            switch (fields[col].type)
+            {
+            case 'N':
+            case 'F':
+                c.type = fields[col].dec > 0 ? 'd' : 'i';
+                break;
+            default:
+                c.type = 's';
+                break;
+            }
+            c.offsets.push_back(0);
+            columns.push_back(c);
+        }
+
+        std::vector<char> record(record_length + 1);
+        for (boost::int32_t i = 0; i < num_records; ++i)
+        {
+            dbf.seekg((num_fields << 5) + 34 + std::streamoff(i) * (record_length + 1), std::ios::beg);
+            if (!dbf.read(&record[0], record_length))
+            {
+                std::clog << "error : cannot read record " << i + 1 << " of " << shape_name << ".dbf" << std::endl;
+                return -1;
+            }
+            for (unsigned k = 0; k < columns.size(); ++k)
+            {
+                add_value(columns[k], fields[columns[k].field], &record[0]);
+            }
+        }
+
+        for (unsigned k = 0; k < columns.size(); ++k)
+        {
+            column & c = columns[k];
+            if (c.type != 's') continue;
+            c.data.resize(4 * c.offsets.size());
+            for (unsigned i = 0; i < c.offsets.size(); ++i)
+            {
+                write_ndr(&c.data[4 * i], c.offsets[i]);
+            }
+            c.data.insert(c.data.end(), c.text.begin(), c.text.end());
+        }
+
+        // numeric columns holding overflow markers ('*') keep being
+        // read from the dbf, where they turn into integer zeros
+        std::vector<column> written;
+        for (unsigned k = 0; k < columns.size(); ++k)
+        {
+            if (columns[k].overflow)
+            {
+                std::clog << "warning : column '" << fields[columns[k].field].name << "' has overflowed values, skipped" << std::endl;
+                continue;
+            }
+            written.push_back(columns[k]);
+        }
+
+        std::ofstream out((shape_name + ".dbc").c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!out)
+        {
+            std::clog << "error : cannot open " << shape_name << ".dbc for writing" << std::endl;
+            return -1;
+        }
+        char file_header[20];
+        std::memcpy(file_header, "MDBFCOL1", 8);
+        write_ndr(file_header + 8, num_records);
+        write_ndr(file_header + 12, static_cast<boost::int32_t>(record_length));
+        write_ndr(file_header + 16, static_cast<boost::int32_t>(written.size()));
+        out.write(file_header, 20);
+
+        std::size_t offset = 20 + 16 * written.size();
+        for (unsigned k = 0; k < written.size(); ++k)
+        {
+            char entry[16];
+            std::memset(entry, 0, 16);
+            std::string const& name = fields[written[k].field].name;
+            std::memcpy(entry, name.c_str(), std::min<std::size_t>(name.size(), 11));
+            entry[11] = written[k].type;
+            write_ndr(entry + 12, static_cast<boost::int32_t>(offset));
+            out.write(entry, 16);
+            offset += written[k].data.size();
+        }
+        for (unsigned k = 0; k < written.size(); ++k)
+        {
+            if (!written[k].data.empty()) out.write(&written[k].data[0], written[k].data.size());
+        }
+        if (!out)
+        {
+            std::clog << "error : failed writing " << shape_name << ".dbc" << std::endl;
+            return -1;
+        }
+        return written.size();
+    }
+
+private:
+    struct field
+    {
+        std::string name;
+        char type;
+        std::size_t offset;
+        int length;
+        int dec;
+    };
+
+    struct column
+    {
+        column()
+            : field(0), type(0), overflow(false) {}
+
+        unsigned field;
+        char type;
+        bool overflow;
+        std::vector<boost::int32_t> offsets;
+        std::vector<char> text;
+        // values, or the offsets followed by the text
+        std::vector<char> data;
+    };
+
+    static void add_value(column & c, field const& f, const char* record)
+    {
+        const char* itr = record + f.offset;
+        const char* end = itr + f.length;
+        switch (c.type)
+        {
+        case 'i':
+        {
+            int val = 0;
+            if (*itr == '*') c.overflow = true;
+            else val = parse_int(itr, end);
+            char buf[4];
+            write_ndr(buf, val);
+            c.data.insert(c.data.end(), buf, buf + 4);
+            break;
+        }
+        case 'd':
+        {
+            double val = 0.0;
+            if (*itr == '*') c.overflow = true;
+            else val = std::strtod(std::string(itr, end).c_str(), 0);
+            char buf[8];
+            write_double(buf, val);
+            c.data.insert(c.data.end(), buf, buf + 8);
+            break;
+        }
+        default:
+        {
+            const char* nul = static_cast<const char*>(std::memchr(itr, '\0', end - itr));
+            if (nul) end = nul;
+            while (itr != end && is_blank(*itr)) ++itr;
+            while (end != itr && is_blank(*(end - 1))) --end;
+            c.text.insert(c.text.end(), itr, end);
+            c.offsets.push_back(c.text.size());
+            break;
+        }
+        }
+    }
+
+    // values are converted as the plugin converts the text of columns
+    // without a sidecar, through strtol clamped to int and strtod
+    static int parse_int(const char* itr, const char* end)
+    {
+        long val = std::strtol(std::string(itr, end).c_str(), 0, 10);
+        if (val > std::numeric_limits<int>::max()) return std::numeric_limits<int>::max();
+        if (val < std::numeric_limits<int>::min()) return std::numeric_limits<int>::min();
+        return static_cast<int>(val);
+    }
+
+    static bool is_blank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    static boost::int32_t read_ndr(const char * data)
+    {
+        boost::int32_t val = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            val |= static_cast<boost::int32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        return val;
+    }
+
+    static void write_ndr(char * data, boost::int32_t val)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            data[i] = static_cast<char>((val >> (8 * i)) & 0xff);
+        }
+    }
+
+    static void write_double(char * data, double val)
+    {
+        boost::uint64_t bits;
+        std::memcpy(&bits, &val, 8);
+        for (int i = 0; i < 8; ++i)
+        {
+            data[i] = static_cast<char>((bits >> (8 * i)) & 0xff);
+        }
+    }
+};
+
+#endif // DBF_COLUMNS_HPP
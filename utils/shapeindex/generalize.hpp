@@ -0,0 +1,390 @@
+/*****************************************************************************
+ * 
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2011 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef GENERALIZE_HPP
+#define GENERALIZE_HPP
+
+// mapnik
+#include <mapnik/global.hpp>
+#include <mapnik/box2d.hpp>
+// boost
+#include <boost/cstdint.hpp>
+// stl
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstring>
+
+#include "quadtree.hpp"
+#include "shapefile.hpp"
+#include "shape_io.hpp"
+
+// Writes generalized copies of a shapefile's geometries (".lodN.shp" and
+// ".lodN.index" next to the original) keeping the record numbers, so the
+// shape plugin can read attributes for them from the original dbf file.
+class shape_generalizer
+{
+public:
+    struct point
+    {
+        double x;
+        double y;
+    };
+    typedef std::vector<point> points;
+
+    // Douglas-Peucker simplification, rings are kept closed
+    // and never collapse below a triangle
+    static void simplify(points const& in, double tolerance, bool ring, points & out)
+    {
+        out.clear();
+        std::size_t size = in.size();
+        if (size < 3 || tolerance <= 0.0)
+        {
+            out = in;
+            return;
+        }
+        std::vector<bool> keep(size, false);
+        keep[0] = keep[size - 1] = true;
+        std::vector<std::pair<std::size_t, std::size_t> > stack;
+        stack.push_back(std::make_pair(std::size_t(0), size - 1));
+        double tolerance2 = tolerance * tolerance;
+        while (!stack.empty())
+        {
+            std::size_t first = stack.back().first;
+            std::size_t last = stack.back().second;
+            stack.pop_back();
+            double max_dist2 = 0.0;
+            std::size_t index = first;
+            for (std::size_t i = first + 1; i < last; ++i)
+            {
+                double d2 = distance2(in[i], in[first], in[last]);
+                if (d2 > max_dist2)
+                {
+                    max_dist2 = d2;
+                    index = i;
+                }
+            }
+            if (max_dist2 > tolerance2)
+            {
+                keep[index] = true;
+                stack.push_back(std::make_pair(first, index));
+                stack.push_back(std::make_pair(index, last));
+            }
+        }
+        if (ring)
+        {
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                if (keep[i]) ++kept;
+            }
+            if (kept < 4)
+            {
+                // keep the vertices spanning the largest triangle
+                std::size_t a = farthest(in, in[0], in[0]);
+                std::size_t b = farthest(in, in[0], in[a]);
+                keep[a] = keep[b] = true;
+            }
+        }
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            if (keep[i]) out.push_back(in[i]);
+        }
+    }
+
+    // Write the generalized shapefile <lod_name>.shp and its index.
+    // Returns the number of records written.
+    static int write(std::string const& shape_name,
+                     std::string const& lod_name,
+                     double tolerance,
+                     int depth,
+                     double ratio)
+    {
+        shape_file shp(shape_name + ".shp");
+        if (!shp.is_open())
+        {
+            std::clog << "error : cannot open " << shape_name << ".shp" << std::endl;
+            return -1;
+        }
+        std::fstream out((lod_name + ".shp").c_str(),
+                         std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!out)
+        {
+            std::clog << "cannot open file for writing \"" << lod_name << ".shp\"" << std::endl;
+            return -1;
+        }
+
+        char header[100];
+        shp.file().read(header, 100);
+        boost::int32_t file_length;
+        mapnik::read_int32_xdr(header + 24, file_length);
+        boost::int32_t shape_type;
+        mapnik::read_int32_ndr(header + 32, shape_type);
+        write_ndr(header + 32, planar_type(shape_type));
+        box2d<double> extent;
+        double minx, miny, maxx, maxy;
+        mapnik::read_double_ndr(header + 36, minx);
+        mapnik::read_double_ndr(header + 44, miny);
+        mapnik::read_double_ndr(header + 52, maxx);
+        mapnik::read_double_ndr(header + 60, maxy);
+        extent.init(minx, miny, maxx, maxy);
+        out.write(header, 100);
+
+        quadtree<int> tree(extent, depth, ratio);
+        std::vector<char> content;
+        std::vector<char> generalized;
+        points in;
+        points simplified;
+        int count = 0;
+        long pos = 100;
+        while (pos < file_length * 2)
+        {
+            char record_header[8];
+            if (!shp.file().read(record_header, 8)) break;
+            boost::int32_t content_length;
+            mapnik::read_int32_xdr(record_header + 4, content_length);
+            content.resize(content_length * 2);
+            if (content_length > 0 && !shp.file().read(&content[0], content.size())) break;
+            pos += 8 + content.size();
+
+            boost::int32_t type = shape_io::shape_null;
+            if (content.size() >= 4) mapnik::read_int32_ndr(&content[0], type);
+            long offset = out.tellp();
+            box2d<double> item_ext;
+            bool has_extent = false;
+            if (content.size() >= 44 && is_multi_part(type) &&
+                generalize(content, tolerance, ring_type(type), in, simplified, generalized, item_ext))
+            {
+                write_xdr(record_header + 4, generalized.size() / 2);
+                out.write(record_header, 8);
+                out.write(&generalized[0], generalized.size());
+                has_extent = true;
+            }
+            else
+            {
+                if (content.size() >= 44 && is_multi_part(type))
+                {
+                    std::clog << "warning : record " << count + 1 << " of " << shape_name
+                              << ".shp has invalid parts, copied unchanged" << std::endl;
+                }
+                out.write(record_header, 8);
+                if (!content.empty()) out.write(&content[0], content.size());
+                if (content.size() >= 20 && type != shape_io::shape_null)
+                {
+                    double x, y;
+                    mapnik::read_double_ndr(&content[4], x);
+                    mapnik::read_double_ndr(&content[12], y);
+                    item_ext.init(x, y, x, y);
+                    if (content.size() >= 36 && type != shape_io::shape_point
+                        && type != shape_io::shape_pointm && type != shape_io::shape_pointz)
+                    {
+                        mapnik::read_double_ndr(&content[20], maxx);
+                        mapnik::read_double_ndr(&content[28], maxy);
+                        item_ext.init(x, y, maxx, maxy);
+                    }
+                    has_extent = true;
+                }
+            }
+            if (has_extent) tree.insert(offset, item_ext);
+            ++count;
+        }
+
+        char length[4];
+        write_xdr(length, static_cast<boost::int32_t>(out.tellp() / 2));
+        out.seekp(24, std::ios::beg);
+        out.write(length, 4);
+        out.close();
+
+        std::fstream index((lod_name + ".index").c_str(),
+                           std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!index)
+        {
+            std::clog << "cannot open index file for writing file \"" << lod_name << ".index\"" << std::endl;
+            return -1;
+        }
+        tree.trim();
+        index.exceptions(std::ios::failbit | std::ios::badbit);
+        tree.write(index);
+        index.close();
+        return count;
+    }
+
+private:
+    static double distance2(point const& p, point const& a, point const& b)
+    {
+        double dx = b.x - a.x;
+        double dy = b.y - a.y;
+        double len2 = dx * dx + dy * dy;
+        double t = 0.0;
+        if (len2 > 0.0)
+        {
+            t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2;
+            if (t < 0.0) t = 0.0;
+            else if (t > 1.0) t = 1.0;
+        }
+        double ex = a.x + t * dx - p.x;
+        double ey = a.y + t * dy - p.y;
+        return ex * ex + ey * ey;
+    }
+
+    static std::size_t farthest(points const& in, point const& a, point const& b)
+    {
+        std::size_t index = 0;
+        double max_dist2 = -1.0;
+        for (std::size_t i = 0; i < in.size(); ++i)
+        {
+            double d2 = distance2(in[i], a, b);
+            if (d2 > max_dist2)
+            {
+                max_dist2 = d2;
+                index = i;
+            }
+        }
+        return index;
+    }
+
+    static bool is_multi_part(int type)
+    {
+        return type == shape_io::shape_polyline || type == shape_io::shape_polylinez
+            || type == shape_io::shape_polylinem || ring_type(type);
+    }
+
+    static bool ring_type(int type)
+    {
+        return type == shape_io::shape_polygon || type == shape_io::shape_polygonz
+            || type == shape_io::shape_polygonm;
+    }
+
+    // z and m values are dropped from generalized geometries
+    static int planar_type(int type)
+    {
+        if (type == shape_io::shape_polylinez || type == shape_io::shape_polylinem)
+            return shape_io::shape_polyline;
+        if (type == shape_io::shape_polygonz || type == shape_io::shape_polygonm)
+            return shape_io::shape_polygon;
+        return type;
+    }
+
+    // Returns false, leaving result alone, when the part and point
+    // counts or the part offsets do not fit the record.
+    static bool generalize(std::vector<char> const& content,
+                           double tolerance,
+                           bool ring,
+                           points & in,
+                           points & simplified,
+                           std::vector<char> & result,
+                           box2d<double> & item_ext)
+    {
+        boost::int32_t type, num_parts, num_points;
+        mapnik::read_int32_ndr(&content[0], type);
+        mapnik::read_int32_ndr(&content[36], num_parts);
+        mapnik::read_int32_ndr(&content[40], num_points);
+        if (num_parts < 0 || num_points < 0 ||
+            std::size_t(num_parts) > (content.size() - 44) / 4 ||
+            std::size_t(num_points) > (content.size() - 44 - 4 * std::size_t(num_parts)) / 16)
+        {
+            return false;
+        }
+        std::size_t points_offset = 44 + 4 * num_parts;
+
+        std::vector<boost::int32_t> parts;
+        points all;
+        for (int i = 0; i < num_parts; ++i)
+        {
+            boost::int32_t start, end;
+            mapnik::read_int32_ndr(&content[44 + 4 * i], start);
+            if (i == num_parts - 1) end = num_points;
+            else mapnik::read_int32_ndr(&content[44 + 4 * (i + 1)], end);
+            if (start < 0 || start > end || end > num_points) return false;
+            in.clear();
+            for (int j = start; j < end; ++j)
+            {
+                point pt;
+                mapnik::read_double_ndr(&content[points_offset + 16 * j], pt.x);
+                mapnik::read_double_ndr(&content[points_offset + 16 * j + 8], pt.y);
+                in.push_back(pt);
+            }
+            simplify(in, tolerance, ring, simplified);
+            parts.push_back(all.size());
+            all.insert(all.end(), simplified.begin(), simplified.end());
+        }
+
+        result.resize(44 + 4 * parts.size() + 16 * all.size());
+        write_ndr(&result[0], planar_type(type));
+        double minx = 0, miny = 0, maxx = 0, maxy = 0;
+        for (std::size_t i = 0; i < all.size(); ++i)
+        {
+            if (i == 0 || all[i].x < minx) minx = all[i].x;
+            if (i == 0 || all[i].y < miny) miny = all[i].y;
+            if (i == 0 || all[i].x > maxx) maxx = all[i].x;
+            if (i == 0 || all[i].y > maxy) maxy = all[i].y;
+        }
+        item_ext.init(minx, miny, maxx, maxy);
+        write_double(&result[4], minx);
+        write_double(&result[12], miny);
+        write_double(&result[20], maxx);
+        write_double(&result[28], maxy);
+        write_ndr(&result[36], parts.size());
+        write_ndr(&result[40], all.size());
+        for (std::size_t i = 0; i < parts.size(); ++i)
+        {
+            write_ndr(&result[44 + 4 * i], parts[i]);
+        }
+        std::size_t offset = 44 + 4 * parts.size();
+        for (std::size_t i = 0; i < all.size(); ++i)
+        {
+            write_double(&result[offset + 16 * i], all[i].x);
+            write_double(&result[offset + 16 * i + 8], all[i].y);
+        }
+        return true;
+    }
+
+    static void write_ndr(char * data, boost::int32_t val)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            data[i] = static_cast<char>((val >> (8 * i)) & 0xff);
+        }
+    }
+
+    static void write_xdr(char * data, boost::int32_t val)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            data[3 - i] = static_cast<char>((val >> (8 * i)) & 0xff);
+        }
+    }
+
+    static void write_double(char * data, double val)
+    {
+        boost::uint64_t bits;
+        std::memcpy(&bits, &val, 8);
+        for (int i = 0; i < 8; ++i)
+        {
+            data[i] = static_cast<char>((bits >> (8 * i)) & 0xff);
+        }
+    }
+};
+
+#endif // GENERALIZE_HPP
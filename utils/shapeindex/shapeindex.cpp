@@ -23,8 +23,10 @@
 
 
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <string>
+#include <algorithm>
 
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string.hpp>
@@ -33,6 +35,8 @@
 #include "quadtree.hpp"
 #include "shapefile.hpp"
 #include "shape_io.hpp"
+#include "generalize.hpp"
+#include "dbf_columns.hpp"
 
 const int MAXDEPTH = 64;
 const int DEFAULT_DEPTH = 8;
@@ -53,6 +57,8 @@ int main (int argc,char** argv)
     unsigned int depth=DEFAULT_DEPTH;
     double ratio=DEFAULT_RATIO;
     vector<string> shape_files;
+    vector<double> tolerances;
+    vector<string> columns;
     
     try
     {
@@ -63,6 +69,8 @@ int main (int argc,char** argv)
             ("verbose,v","verbose output")
             ("depth,d", po::value<unsigned int>(), "max tree depth\n(default 8)")   
             ("ratio,r",po::value<double>(),"split ratio (default 0.55)")
+            ("lod,l",po::value<vector<double> >(),"also write geometries generalized to this tolerance\n(in layer units, may be repeated)")
+            ("columns,c",po::value<vector<string> >(),"also write these dbf columns decoded into a .dbc file\n(may be repeated)")
             ("shape_files",po::value<vector<string> >(),"shape files to index: file1 file2 ...fileN")
             ;
         
@@ -96,6 +104,17 @@ int main (int argc,char** argv)
             ratio = vm["ratio"].as<double>();
         }
         
+        if (vm.count("lod"))
+        {
+            tolerances = vm["lod"].as< vector<double> >();
+            std::sort(tolerances.begin(), tolerances.end());
+        }
+        
+        if (vm.count("columns"))
+        {
+            columns = vm["columns"].as< vector<string> >();
+        }
+        
         if (vm.count("shape_files"))
         {
             shape_files=vm["shape_files"].as< vector<string> >();
@@ -231,6 +250,32 @@ int main (int argc,char** argv)
             file.flush();
             file.close();
         }
+
+        if (!tolerances.empty())
+        {
+            // the .lod file lists "<tolerance> <suffix>" for each level of detail
+            std::ofstream lod_file((shapename+".lod").c_str(), std::ios::out | std::ios::trunc);
+            for (unsigned i = 0; i < tolerances.size(); ++i)
+            {
+                std::ostringstream suffix;
+                suffix << ".lod" << i;
+                clog << "generalizing to tolerance " << tolerances[i] << endl;
+                int lod_count = shape_generalizer::write(shapename, shapename + suffix.str(),
+                                                         tolerances[i], depth, ratio);
+                if (lod_count < 0) break;
+                lod_file.precision(16);
+                lod_file << tolerances[i] << " " << suffix.str() << "\n";
+            }
+        }
+
+        if (!columns.empty())
+        {
+            int column_count = dbf_column_writer::write(shapename, columns);
+            if (column_count >= 0)
+            {
+                clog << " number columns=" << column_count << endl;
+            }
+        }
     }
     
     clog << "done!" << endl;